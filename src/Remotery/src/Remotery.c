@@ -39,10 +39,13 @@
     @SAMPLE:        Base Sample Description (CPU by default)
     @SAMPLETREE:    A tree of samples with their allocator
     @TSAMPLER:      Per-Thread Sampler
+    @CAPTURE:       Capture to file and replay
     @REMOTERY:      Remotery
+    @PROPERTY:      Properties: named values sent to the viewer with each snapshot
     @CUDA:          CUDA event sampling
     @D3D11:         Direct3D 11 event sampling
     @OPENGL:        OpenGL event sampling
+    @VULKAN:        Vulkan event sampling
     @METAL:         Metal event sampling
 */
 
@@ -150,6 +153,20 @@ static rmtBool g_SettingsInitialized = RMT_FALSE;
     #include <cuda.h>
 #endif
 
+#if RMT_USE_VULKAN
+    // Functions are loaded when bound so there's no link dependency on the Vulkan loader
+    #define VK_NO_PROTOTYPES
+    #include <vulkan/vulkan.h>
+#endif
+
+#if RMT_USE_CAPTURE
+    #include <stdio.h>
+#endif
+
+#if RMT_USE_ZLIB
+    #include <zlib.h>
+#endif
+
 
 
 static rmtU8 minU8(rmtU8 a, rmtU8 b)
@@ -182,7 +199,7 @@ static void rmtFree( void* ptr )
     g_Settings.free( g_Settings.mm_context, ptr );
 }
 
-#if RMT_USE_OPENGL
+#if RMT_USE_OPENGL || RMT_USE_VULKAN
 // DLL/Shared Library functions
 
 static void* rmtLoadLibrary(const char* path)
@@ -261,7 +278,10 @@ static rmtU32 msTimer_Get()
 
 
 //
-// Micro-second accuracy high performance counter
+// Nanosecond accuracy high performance counter, monotonic on all platforms.
+// On x86 Linux with an invariant TSC that the kernel also uses as its clocksource, the TSC is read directly
+// and converted with an integer multiply & shift calibrated once in nsTimer_Init. Otherwise CLOCK_MONOTONIC_RAW
+// is used, which is immune to NTP slewing.
 //
 #ifndef RMT_PLATFORM_WINDOWS
     typedef rmtU64 LARGE_INTEGER;
@@ -270,19 +290,81 @@ typedef struct
 {
     LARGE_INTEGER counter_start;
     double counter_scale;
-} usTimer;
 
+#if defined(RMT_PLATFORM_LINUX)
+    // TSC to nanosecond conversion: ns = (ticks * tsc_mult) >> 32, or 0 if the TSC isn't used
+    rmtU64 tsc_mult;
+#endif
+} nsTimer;
+
+
+#if defined(RMT_PLATFORM_LINUX)
+
+    #if defined(__x86_64__) || defined(__i386__)
+        #define RMT_TSC_AVAILABLE
+        #include <cpuid.h>
+        #include <x86intrin.h>
+    #endif
+
+    #ifdef CLOCK_MONOTONIC_RAW
+        #define RMT_CLOCK_MONOTONIC CLOCK_MONOTONIC_RAW
+    #else
+        #define RMT_CLOCK_MONOTONIC CLOCK_MONOTONIC
+    #endif
+
+    static rmtU64 MonotonicClock_Get()
+    {
+        struct timespec tv;
+        clock_gettime(RMT_CLOCK_MONOTONIC, &tv);
+        return (rmtU64)tv.tv_sec * 1000000000ULL + (rmtU64)tv.tv_nsec;
+    }
+
+    #ifdef RMT_TSC_AVAILABLE
+
+        static rmtBool TSC_IsReliable()
+        {
+            unsigned int eax, ebx, ecx, edx;
+            char clocksource[16];
+            ssize_t size;
+            int fd;
+
+            // Invariant TSC: constant rate across P-/C-/T-states
+            if (__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) == 0 || eax < 0x80000007)
+                return RMT_FALSE;
+            __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+            if ((edx & (1 << 8)) == 0)
+                return RMT_FALSE;
+
+            // The kernel only keeps the TSC as its clocksource if it found it synchronised between CPUs
+            fd = open("/sys/devices/system/clocksource/clocksource0/current_clocksource", O_RDONLY);
+            if (fd < 0)
+                return RMT_FALSE;
+            size = read(fd, clocksource, sizeof(clocksource) - 1);
+            close(fd);
+            return size >= 3 && strncmp(clocksource, "tsc", 3) == 0 ? RMT_TRUE : RMT_FALSE;
+        }
+
+        static rmtU64 TSC_ToNs(rmtU64 ticks, rmtU64 mult)
+        {
+            // Split so that the multiply can't overflow
+            return (ticks >> 32) * mult + (((ticks & 0xFFFFFFFFULL) * mult) >> 32);
+        }
+
+    #endif
 
-static void usTimer_Init(usTimer* timer)
+#endif
+
+
+static void nsTimer_Init(nsTimer* timer)
 {
     #if defined(RMT_PLATFORM_WINDOWS)
         LARGE_INTEGER performance_frequency;
 
         assert(timer != NULL);
 
-        // Calculate the scale from performance counter to microseconds
+        // Calculate the scale from performance counter to nanoseconds
         QueryPerformanceFrequency(&performance_frequency);
-        timer->counter_scale = 1000000.0 / performance_frequency.QuadPart;
+        timer->counter_scale = 1000000000.0 / performance_frequency.QuadPart;
 
         // Record the offset for each read of the counter
         QueryPerformanceCounter(&timer->counter_start);
@@ -291,29 +373,56 @@ static void usTimer_Init(usTimer* timer)
 
         mach_timebase_info_data_t nsScale;
         mach_timebase_info( &nsScale );
-        const double ns_per_us = 1.0e3;
-        timer->counter_scale = (double)(nsScale.numer) / ((double)nsScale.denom * ns_per_us);
+        timer->counter_scale = (double)(nsScale.numer) / (double)nsScale.denom;
 
         timer->counter_start = mach_absolute_time();
 
     #elif defined(RMT_PLATFORM_LINUX)
 
-        struct timespec tv;
-        clock_gettime(CLOCK_REALTIME, &tv);
-        timer->counter_start = (rmtU64)(tv.tv_sec * (rmtU64)1000000) + (rmtU64)(tv.tv_nsec * 0.001);
+        timer->tsc_mult = 0;
+
+        #ifdef RMT_TSC_AVAILABLE
+        if (TSC_IsReliable())
+        {
+            // Calibrate against the monotonic clock over ~10ms, bracketing each clock read with TSC reads
+            rmtU64 ns_start, ns_end, tsc_start, tsc_end, tsc_before;
+
+            // Warm up the clock so the first read isn't slowed by page faults in the vDSO
+            MonotonicClock_Get();
+
+            tsc_before = __rdtsc();
+            ns_start = MonotonicClock_Get();
+            tsc_start = (tsc_before + __rdtsc()) / 2;
+            do
+            {
+                tsc_before = __rdtsc();
+                ns_end = MonotonicClock_Get();
+                tsc_end = (tsc_before + __rdtsc()) / 2;
+            } while (ns_end - ns_start < 10000000ULL);
+
+            if (tsc_end > tsc_start)
+            {
+                timer->tsc_mult = ((ns_end - ns_start) << 32) / (tsc_end - tsc_start);
+                timer->counter_start = __rdtsc();
+                return;
+            }
+        }
+        #endif
+
+        timer->counter_start = MonotonicClock_Get();
 
     #endif
 }
 
 
-static rmtU64 usTimer_Get(usTimer* timer)
+static rmtU64 nsTimer_Get(nsTimer* timer)
 {
     #if defined(RMT_PLATFORM_WINDOWS)
         LARGE_INTEGER performance_count;
 
         assert(timer != NULL);
 
-        // Read counter and convert to microseconds
+        // Read counter and convert to nanoseconds
         QueryPerformanceCounter(&performance_count);
         return (rmtU64)((performance_count.QuadPart - timer->counter_start.QuadPart) * timer->counter_scale);
 
@@ -324,9 +433,12 @@ static rmtU64 usTimer_Get(usTimer* timer)
 
     #elif defined(RMT_PLATFORM_LINUX)
 
-        struct timespec tv;
-        clock_gettime(CLOCK_REALTIME, &tv);
-        return  ((rmtU64)(tv.tv_sec * (rmtU64)1000000) + (rmtU64)(tv.tv_nsec * 0.001)) - timer->counter_start;
+        #ifdef RMT_TSC_AVAILABLE
+        if (timer->tsc_mult != 0)
+            return TSC_ToNs(__rdtsc() - timer->counter_start, timer->tsc_mult);
+        #endif
+
+        return MonotonicClock_Get() - timer->counter_start;
 
     #endif
 }
@@ -470,6 +582,16 @@ static rmtBool AtomicCompareAndSwapPointer(long* volatile* ptr, long* old_ptr, l
 }
 
 
+static rmtBool AtomicCompareAndSwapU64(rmtU64 volatile* val, rmtU64 old_val, rmtU64 new_val)
+{
+    #if defined(RMT_PLATFORM_WINDOWS) && !defined(__MINGW32__)
+        return _InterlockedCompareExchange64((__int64 volatile*)val, (__int64)new_val, (__int64)old_val) == (__int64)old_val ? RMT_TRUE : RMT_FALSE;
+    #elif defined(RMT_PLATFORM_POSIX) || defined(__MINGW32__)
+        return __sync_bool_compare_and_swap(val, old_val, new_val) ? RMT_TRUE : RMT_FALSE;
+    #endif
+}
+
+
 //
 // NOTE: Does not guarantee a memory barrier
 // TODO: Make sure all platforms don't insert a memory barrier as this is only for stats
@@ -1830,10 +1952,8 @@ static rmtBool IsLittleEndian()
 }
 
 
-static rmtError Buffer_WriteU64(Buffer* buffer, rmtU64 value)
+static rmtError Buffer_WriteF64(Buffer* buffer, double value)
 {
-    // Write as a double as Javascript DataView doesn't have a 64-bit integer read
-
     assert(buffer != NULL);
 
     // Reallocate the buffer on overflow
@@ -1846,7 +1966,7 @@ static rmtError Buffer_WriteU64(Buffer* buffer, rmtU64 value)
 
     // Copy all bytes
     #if RMT_ASSUME_LITTLE_ENDIAN
-        *(double*)(buffer->data + buffer->bytes_used) = (double)value;
+        *(double*)(buffer->data + buffer->bytes_used) = value;
     #else
     {
         union
@@ -1855,7 +1975,7 @@ static rmtError Buffer_WriteU64(Buffer* buffer, rmtU64 value)
             unsigned char c[sizeof(double)];
         } u;
         rmtU8* dest = buffer->data + buffer->bytes_used;
-        u.d = (double)value;
+        u.d = value;
         if (IsLittleEndian())
         {
             dest[0] = u.c[0];
@@ -1887,6 +2007,13 @@ static rmtError Buffer_WriteU64(Buffer* buffer, rmtU64 value)
 }
 
 
+static rmtError Buffer_WriteU64(Buffer* buffer, rmtU64 value)
+{
+    // Write as a double as Javascript DataView doesn't have a 64-bit integer read
+    return Buffer_WriteF64(buffer, (double)value);
+}
+
+
 static rmtError Buffer_WriteStringWithLength(Buffer* buffer, rmtPStr string)
 {
     rmtU32 length = (rmtU32)strnlen_s(string, 2048);
@@ -3212,7 +3339,7 @@ static void WriteSize(rmtU32 size, rmtU8* dest, rmtU32 dest_size, rmtU32 dest_of
 
 static void WebSocket_PrepareBuffer(Buffer* buffer)
 {
-    char empty_frame_header[WEBSOCKET_MAX_FRAME_HEADER_SIZE];
+    char empty_frame_header[WEBSOCKET_MAX_FRAME_HEADER_SIZE] = { 0 };
 
     assert(buffer != NULL);
  
@@ -3433,6 +3560,7 @@ typedef enum MessageID
     MsgID_NotReady,
     MsgID_LogText,
     MsgID_SampleTree,
+    MsgID_PropertySnapshot,
 } MessageID;
 
 
@@ -3855,6 +3983,7 @@ enum SampleType
     SampleType_CUDA,
     SampleType_D3D11,
     SampleType_OpenGL,
+    SampleType_Vulkan,
     SampleType_Metal,
     SampleType_Count,
 };
@@ -3889,13 +4018,13 @@ typedef struct Sample
     // This is also mixed with the callstack hash to allow consistent addressing of any point in the tree
     rmtU32 nb_children;
 
-    // Sample end points and length in microseconds
-    rmtU64 us_start;
-    rmtU64 us_end;
-    rmtU64 us_length;
+    // Sample end points and length in nanoseconds
+    rmtU64 ns_start;
+    rmtU64 ns_end;
+    rmtU64 ns_length;
 
     // Total sampled length of all children
-    rmtU64 us_sampled_length;
+    rmtU64 ns_sampled_length;
 
     // Number of times this sample was used in a call in aggregate mode, 1 otherwise
     rmtU32 call_count;
@@ -3925,10 +4054,10 @@ static rmtError Sample_Constructor(Sample* sample)
     sample->last_child = NULL;
     sample->next_sibling = NULL;
     sample->nb_children = 0;
-    sample->us_start = 0;
-    sample->us_end = 0;
-    sample->us_length = 0;
-    sample->us_sampled_length =0;
+    sample->ns_start = 0;
+    sample->ns_end = 0;
+    sample->ns_length = 0;
+    sample->ns_sampled_length =0;
     sample->call_count = 0;
     sample->recurse_depth = 0;
     sample->max_recurse_depth = 0;
@@ -3952,10 +4081,10 @@ static void Sample_Prepare(Sample* sample, rmtU32 name_hash, Sample* parent)
     sample->last_child = NULL;
     sample->next_sibling = NULL;
     sample->nb_children = 0;
-    sample->us_start = 0;
-    sample->us_end = 0;
-    sample->us_length = 0;
-    sample->us_sampled_length = 0;
+    sample->ns_start = 0;
+    sample->ns_end = 0;
+    sample->ns_length = 0;
+    sample->ns_sampled_length = 0;
     sample->call_count = 1;
     sample->recurse_depth = 0;
     sample->max_recurse_depth = 0;
@@ -3977,9 +4106,9 @@ static rmtError bin_Sample(Buffer* buffer, Sample* sample)
     BIN_ERROR_CHECK(Buffer_WriteU32(buffer, sample->name_hash));
     BIN_ERROR_CHECK(Buffer_WriteU32(buffer, sample->unique_id));
     BIN_ERROR_CHECK(Buffer_Write(buffer, sample->unique_id_html_colour, 7));
-    BIN_ERROR_CHECK(Buffer_WriteU64(buffer, sample->us_start));
-    BIN_ERROR_CHECK(Buffer_WriteU64(buffer, sample->us_length));
-    BIN_ERROR_CHECK(Buffer_WriteU64(buffer, maxS64(sample->us_length - sample->us_sampled_length, 0)));
+    BIN_ERROR_CHECK(Buffer_WriteU64(buffer, sample->ns_start));
+    BIN_ERROR_CHECK(Buffer_WriteU64(buffer, sample->ns_length));
+    BIN_ERROR_CHECK(Buffer_WriteU64(buffer, maxS64(sample->ns_length - sample->ns_sampled_length, 0)));
     BIN_ERROR_CHECK(Buffer_WriteU32(buffer, sample->call_count));
     BIN_ERROR_CHECK(Buffer_WriteU32(buffer, sample->max_recurse_depth));
     BIN_ERROR_CHECK(bin_SampleArray(buffer, sample));
@@ -4243,6 +4372,143 @@ static void AddSampleTreeMessage(rmtMessageQueue* queue, Sample* sample, ObjectA
 
 
 
+// Set on end events
+#define SAMPLE_EVENT_END 0x80000000
+
+
+// Fixed-size record of the beginning or end of a CPU sample
+typedef struct SampleEvent
+{
+    rmtU64 ns_time;
+
+    // Unused for end events
+    rmtU32 name_hash;
+
+    // Sample flags for begin events, SAMPLE_EVENT_END for end events
+    rmtU32 flags;
+} SampleEvent;
+
+
+//
+// Ring buffer of CPU sample events written by one thread and read by the Remotery thread, which builds the
+// sample trees from them. This keeps allocating and linking samples off the sampled thread.
+//
+// When the buffer fills up, begin events are dropped along with everything up to the matching end. Space
+// is always kept for the end events of samples that have begun, so the Remotery thread never sees a sample
+// that doesn't end.
+//
+typedef struct SampleEventBuffer
+{
+    SampleEvent* events;
+
+    // Number of events - 1, with the number of events a power of two
+    rmtU32 mask;
+
+    // Positions never wrap; the write position is only changed by the sampled thread and the read
+    // position by the Remotery thread
+    rmtU32 volatile write_pos;
+    rmtU32 volatile read_pos;
+
+    // Samples that have begun but not ended, with and without their events written
+    rmtU32 nb_open;
+    rmtU32 nb_dropped_open;
+} SampleEventBuffer;
+
+
+static rmtError SampleEventBuffer_Constructor(SampleEventBuffer* buffer, rmtU32 size_in_bytes)
+{
+    rmtU32 nb_events = 64;
+
+    assert(buffer != NULL);
+
+    // Round up to a power of two so that positions can be masked
+    while (nb_events * sizeof(SampleEvent) < size_in_bytes && nb_events < 0x40000000)
+        nb_events *= 2;
+
+    buffer->mask = nb_events - 1;
+    buffer->write_pos = 0;
+    buffer->read_pos = 0;
+    buffer->nb_open = 0;
+    buffer->nb_dropped_open = 0;
+
+    buffer->events = (SampleEvent*)rmtMalloc(nb_events * sizeof(SampleEvent));
+    if (buffer->events == NULL)
+        return RMT_ERROR_MALLOC_FAIL;
+
+    return RMT_ERROR_NONE;
+}
+
+
+static void SampleEventBuffer_Destructor(SampleEventBuffer* buffer)
+{
+    assert(buffer != NULL);
+
+    if (buffer->events != NULL)
+    {
+        rmtFree(buffer->events);
+        buffer->events = NULL;
+    }
+}
+
+
+static void SampleEventBuffer_Write(SampleEventBuffer* buffer, rmtU64 ns_time, rmtU32 name_hash, rmtU32 flags)
+{
+    SampleEvent* event = buffer->events + (buffer->write_pos & buffer->mask);
+    event->ns_time = ns_time;
+    event->name_hash = name_hash;
+    event->flags = flags;
+
+    // Ensure the event is complete before the Remotery thread can see it
+    WriteFence();
+    buffer->write_pos++;
+}
+
+
+static void SampleEventBuffer_Begin(SampleEventBuffer* buffer, rmtU64 ns_time, rmtU32 name_hash, rmtU32 flags)
+{
+    rmtU32 nb_free;
+
+    assert(buffer != NULL);
+
+    // Samples within a dropped sample are dropped too
+    if (buffer->nb_dropped_open > 0)
+    {
+        buffer->nb_dropped_open++;
+        return;
+    }
+
+    // Need space for this event, its end and the ends of all open samples
+    nb_free = buffer->mask + 1 - (buffer->write_pos - buffer->read_pos);
+    if (nb_free < buffer->nb_open + 2)
+    {
+        buffer->nb_dropped_open = 1;
+        return;
+    }
+
+    SampleEventBuffer_Write(buffer, ns_time, name_hash, flags);
+    buffer->nb_open++;
+}
+
+
+static void SampleEventBuffer_End(SampleEventBuffer* buffer, rmtU64 ns_time)
+{
+    assert(buffer != NULL);
+
+    if (buffer->nb_dropped_open > 0)
+    {
+        buffer->nb_dropped_open--;
+        return;
+    }
+
+    // Ignore unmatched ends, as the sample tree does
+    if (buffer->nb_open == 0)
+        return;
+
+    SampleEventBuffer_Write(buffer, ns_time, 0, SAMPLE_EVENT_END);
+    buffer->nb_open--;
+}
+
+
 typedef struct ThreadSampler
 {
     // Name to assign to the thread in the viewer
@@ -4251,6 +4517,9 @@ typedef struct ThreadSampler
     // Store a unique sample tree for each type
     SampleTree* sample_trees[SampleType_Count];
 
+    // If set, CPU samples are recorded here and the CPU sample tree is only used by the Remotery thread
+    SampleEventBuffer* events;
+
     // Table of all sample names encountered on this thread
     StringTable* names;
 
@@ -4269,6 +4538,7 @@ static rmtError ThreadSampler_Constructor(ThreadSampler* thread_sampler)
     // Set defaults
     for (i = 0; i < SampleType_Count; i++)
         thread_sampler->sample_trees[i] = NULL;
+    thread_sampler->events = NULL;
     thread_sampler->names = NULL;
     thread_sampler->next = NULL;
 
@@ -4295,6 +4565,13 @@ static rmtError ThreadSampler_Constructor(ThreadSampler* thread_sampler)
     if (error != RMT_ERROR_NONE)
         return error;
 
+    if (g_Settings.eventBufferSizeInBytes != 0)
+    {
+        New_1(SampleEventBuffer, thread_sampler->events, g_Settings.eventBufferSizeInBytes);
+        if (error != RMT_ERROR_NONE)
+            return error;
+    }
+
     return RMT_ERROR_NONE;
 }
 
@@ -4305,6 +4582,7 @@ static void ThreadSampler_Destructor(ThreadSampler* ts)
 
     assert(ts != NULL);
 
+    Delete(SampleEventBuffer, ts->events);
     Delete(StringTable, ts->names);
 
     for (i = 0; i < SampleType_Count; i++)
@@ -4340,6 +4618,74 @@ static rmtBool ThreadSampler_Pop(ThreadSampler* ts, rmtMessageQueue* queue, Samp
 }
 
 
+static void Sample_SetStartTime(Sample* sample, rmtU64 ns_time)
+{
+    // If this is an aggregate sample, store the time in 'end' as we want to preserve 'start'
+    if (sample->call_count > 1)
+        sample->ns_end = ns_time;
+    else
+        sample->ns_start = ns_time;
+}
+
+
+static void ThreadSampler_EndCPUSample(ThreadSampler* ts, rmtMessageQueue* queue, rmtU64 ns_end)
+{
+    Sample* sample = ts->sample_trees[SampleType_CPU]->current_parent;
+
+    if (sample->recurse_depth > 0)
+    {
+        sample->recurse_depth--;
+    }
+    else
+    {
+        // Aggregate samples use ns_end to store start so that ns_start is preserved
+        rmtU64 ns_length = 0;
+        if (sample->call_count > 1 && sample->max_recurse_depth == 0)
+            ns_length = (ns_end - sample->ns_end);
+        else
+            ns_length = (ns_end - sample->ns_start);
+
+        sample->ns_length += ns_length;
+
+        // Sum length on the parent to track un-sampled time in the parent
+        if (sample->parent != NULL)
+            sample->parent->ns_sampled_length += ns_length;
+
+        ThreadSampler_Pop(ts, queue, sample);
+    }
+}
+
+
+static void ThreadSampler_ProcessEvents(ThreadSampler* ts, rmtMessageQueue* queue)
+{
+    SampleEventBuffer* buffer = ts->events;
+    rmtU32 read_pos, write_pos;
+
+    assert(buffer != NULL);
+
+    // Only read up to the events written so far, as this thread may be adding events to its own buffer
+    write_pos = buffer->write_pos;
+    for (read_pos = buffer->read_pos; read_pos != write_pos; read_pos++)
+    {
+        SampleEvent* event = buffer->events + (read_pos & buffer->mask);
+        if (event->flags & SAMPLE_EVENT_END)
+        {
+            ThreadSampler_EndCPUSample(ts, queue, event->ns_time);
+        }
+        else
+        {
+            Sample* sample;
+            if (ThreadSampler_Push(ts->sample_trees[SampleType_CPU], event->name_hash, event->flags, &sample) == RMT_ERROR_NONE)
+                Sample_SetStartTime(sample, event->ns_time);
+        }
+    }
+
+    // Ensure events have been read before their space can be reused
+    WriteFence();
+    buffer->read_pos = write_pos;
+}
+
+
 static rmtU32 ThreadSampler_GetNameHash(ThreadSampler* ts, rmtPStr name, rmtU32* hash_cache)
 {
     rmtU32 name_hash = 0;
@@ -4372,304 +4718,403 @@ static rmtU32 ThreadSampler_GetNameHash(ThreadSampler* ts, rmtPStr name, rmtU32*
 /*
 ------------------------------------------------------------------------------------------------------------------------
 ------------------------------------------------------------------------------------------------------------------------
-   @REMOTERY: Remotery
+   @CAPTURE: Capture to file and replay
 ------------------------------------------------------------------------------------------------------------------------
 ------------------------------------------------------------------------------------------------------------------------
 */
 
 
 
-#if RMT_USE_D3D11
-typedef struct D3D11 D3D11;
-static rmtError D3D11_Create(D3D11** d3d11);
-static void D3D11_Destructor(D3D11* d3d11);
-#endif
+#if RMT_USE_CAPTURE
 
+//
+// A capture file stores the same messages that are sent to the viewer, so that they can be served to it later.
+//
+//    Header:   "RMTC", version
+//    Chunks:   "CHNK", compression, packed size, raw size, first frame, frame count, first time (ns)
+//              Packed records: size, time (ns), message payload
+//    Index:    "INDX", chunk count, { chunk offset, first time (ns), first frame, frame count } * chunk count
+//    Trailer:  index offset, "RMTE"
+//
+// Sample and property names are written as "SSMP" messages before their first use in each chunk, so that replay
+// can start at any chunk without reading the ones before it. A frame is a "SMPL" message and property values are
+// "PSNP" messages.
+// The index and trailer are written when the capture is closed. If they're missing (e.g. the process was killed),
+// replay rebuilds the index from the chunk headers and ignores any chunk that was only partially written.
+//
 
-#if RMT_USE_OPENGL
-typedef struct OpenGL_t OpenGL;
-static rmtError OpenGL_Create(OpenGL** opengl);
-static void OpenGL_Destructor(OpenGL* opengl);
-#endif
+#define CAPTURE_VERSION 1
+#define CAPTURE_HEADER_SIZE 8
+#define CAPTURE_CHUNK_HEADER_SIZE 32
+#define CAPTURE_RECORD_HEADER_SIZE 12
+#define CAPTURE_INDEX_ENTRY_SIZE 24
+#define CAPTURE_TRAILER_SIZE 12
 
+// Raw size and age at which a chunk is written to the file
+#define CAPTURE_CHUNK_SIZE (1024 * 1024)
+#define CAPTURE_CHUNK_NS 1000000000ULL
 
-#if RMT_USE_METAL
-typedef struct Metal_t Metal;
-static rmtError Metal_Create(Metal** metal);
-static void Metal_Destructor(Metal* metal);
+#define CAPTURE_STORED 0
+#define CAPTURE_DEFLATED 1
+
+#if defined(_MSC_VER)
+    #define rmtFileSeek _fseeki64
+    #define rmtFileTell _ftelli64
+#else
+    #define rmtFileSeek fseeko
+    #define rmtFileTell ftello
 #endif
 
 
-struct Remotery
+static void U64ToByteArray(rmtU8* dest, rmtU64 value)
 {
-    Server* server;
-
-    // Microsecond accuracy timer for CPU timestamps
-    usTimer timer;
+    U32ToByteArray(dest, (rmtU32)value);
+    U32ToByteArray(dest + 4, (rmtU32)(value >> 32));
+}
 
-    rmtTLS thread_sampler_tls_handle;
 
-    // Linked list of all known threads being sampled
-    ThreadSampler* volatile first_thread_sampler;
+static rmtU32 ByteArrayToU32(const rmtU8* src)
+{
+    return src[0] | (src[1] << 8) | (src[2] << 16) | ((rmtU32)src[3] << 24);
+}
 
-    // Queue between clients and main remotery thread
-    rmtMessageQueue* mq_to_rmt_thread;
 
-    // The main server thread
-    rmtThread* thread;
+static rmtU64 ByteArrayToU64(const rmtU8* src)
+{
+    return ByteArrayToU32(src) | ((rmtU64)ByteArrayToU32(src + 4) << 32);
+}
 
-#if RMT_USE_CUDA
-    rmtCUDABind cuda;
-#endif
 
-#if RMT_USE_D3D11
-    D3D11* d3d11;
-#endif
+typedef struct CaptureChunk
+{
+    rmtU64 offset;
+    rmtU64 first_time;
+    rmtU32 first_frame;
+    rmtU32 nb_frames;
+} CaptureChunk;
 
-#if RMT_USE_OPENGL
-    OpenGL* opengl;
-#endif
 
-#if RMT_USE_METAL
-    Metal* metal;
-#endif
-};
+static void CaptureChunk_Write(const CaptureChunk* chunk, rmtU8* dest)
+{
+    U64ToByteArray(dest, chunk->offset);
+    U64ToByteArray(dest + 8, chunk->first_time);
+    U32ToByteArray(dest + 16, chunk->first_frame);
+    U32ToByteArray(dest + 20, chunk->nb_frames);
+}
 
 
-//
-// Global remotery context
-//
-static Remotery* g_Remotery = NULL;
+static void CaptureChunk_Read(CaptureChunk* chunk, const rmtU8* src)
+{
+    chunk->offset = ByteArrayToU64(src);
+    chunk->first_time = ByteArrayToU64(src + 8);
+    chunk->first_frame = ByteArrayToU32(src + 16);
+    chunk->nb_frames = ByteArrayToU32(src + 20);
+}
 
 
-//
-// This flag marks the EXE/DLL that created the global remotery instance. We want to allow
-// only the creating EXE/DLL to destroy the remotery instance.
-//
-static rmtBool g_RemoteryCreated = RMT_FALSE;
+typedef struct
+{
+    FILE* file;
 
+    // Records of the chunk being filled and its description
+    Buffer* chunk;
+    CaptureChunk chunk_info;
 
-static void Remotery_DestroyThreadSamplers(Remotery* rmt);
+    // Compressed chunk data
+    Buffer* packed;
 
+    // Index entries of all chunks written
+    Buffer* index;
 
-static const rmtU8 g_DecimalToHex[17] = "0123456789abcdef";
+    // Hashes of sample names already written to the current chunk
+    rmtHashTable* names;
 
+    rmtU32 nb_frames;
 
-static void GetSampleDigest(Sample* sample, rmtU32* digest_hash, rmtU32* nb_samples)
-{
-    Sample* child;
+    // Set on the first write failure, after which nothing more is written
+    rmtError error;
+} Capture;
 
-    assert(sample != NULL);
-    assert(digest_hash != NULL);
-    assert(nb_samples != NULL);
 
-    // Concatenate this sample
-    (*nb_samples)++;
-    *digest_hash = HashCombine(*digest_hash, sample->unique_id);
+static rmtError Capture_Constructor(Capture* capture, rmtPStr filename)
+{
+    rmtU8 header[CAPTURE_HEADER_SIZE] = { 'R', 'M', 'T', 'C' };
+    rmtError error;
 
-    {
-        rmtU8 shift = 4;
-
-        // Get 6 nibbles for lower 3 bytes of the name hash
-        rmtU8* sample_id = (rmtU8*)&sample->name_hash;
-        rmtU8 hex_sample_id[6];
-        hex_sample_id[0] = sample_id[0] & 15;
-        hex_sample_id[1] = sample_id[0] >> 4;
-        hex_sample_id[2] = sample_id[1] & 15;
-        hex_sample_id[3] = sample_id[1] >> 4;
-        hex_sample_id[4] = sample_id[2] & 15;
-        hex_sample_id[5] = sample_id[2] >> 4;
+    assert(capture != NULL);
+    capture->file = NULL;
+    capture->chunk = NULL;
+    capture->chunk_info.offset = CAPTURE_HEADER_SIZE;
+    capture->chunk_info.first_time = 0;
+    capture->chunk_info.first_frame = 0;
+    capture->chunk_info.nb_frames = 0;
+    capture->packed = NULL;
+    capture->index = NULL;
+    capture->names = NULL;
+    capture->nb_frames = 0;
+    capture->error = RMT_ERROR_NONE;
+
+    New_1(Buffer, capture->chunk, 64 * 1024);
+    if (error != RMT_ERROR_NONE)
+        return error;
+    New_1(Buffer, capture->packed, 64 * 1024);
+    if (error != RMT_ERROR_NONE)
+        return error;
+    New_1(Buffer, capture->index, 4 * 1024);
+    if (error != RMT_ERROR_NONE)
+        return error;
+    New_1(rmtHashTable, capture->names, 1 * 1024);
+    if (error != RMT_ERROR_NONE)
+        return error;
 
-        // As the nibbles will be used as hex colour digits, shift them up to make pastel colours
-        hex_sample_id[0] = minU8(hex_sample_id[0] + shift, 15);
-        hex_sample_id[1] = minU8(hex_sample_id[1] + shift, 15);
-        hex_sample_id[2] = minU8(hex_sample_id[2] + shift, 15);
-        hex_sample_id[3] = minU8(hex_sample_id[3] + shift, 15);
-        hex_sample_id[4] = minU8(hex_sample_id[4] + shift, 15);
-        hex_sample_id[5] = minU8(hex_sample_id[5] + shift, 15);
+    capture->file = fopen(filename, "wb");
+    if (capture->file == NULL)
+        return RMT_ERROR_CAPTURE_OPEN_FAIL;
 
-        // Convert the nibbles to hex for the final colour
-        sample->unique_id_html_colour[1] = g_DecimalToHex[hex_sample_id[0]];
-        sample->unique_id_html_colour[2] = g_DecimalToHex[hex_sample_id[1]];
-        sample->unique_id_html_colour[3] = g_DecimalToHex[hex_sample_id[2]];
-        sample->unique_id_html_colour[4] = g_DecimalToHex[hex_sample_id[3]];
-        sample->unique_id_html_colour[5] = g_DecimalToHex[hex_sample_id[4]];
-        sample->unique_id_html_colour[6] = g_DecimalToHex[hex_sample_id[5]];
-    }
+    U32ToByteArray(header + 4, CAPTURE_VERSION);
+    if (fwrite(header, sizeof(header), 1, capture->file) != 1)
+        return RMT_ERROR_CAPTURE_WRITE_FAIL;
 
-    // Concatenate children
-    for (child = sample->first_child; child != NULL; child = child->next_sibling)
-        GetSampleDigest(child, digest_hash, nb_samples);
+    return RMT_ERROR_NONE;
 }
 
 
-static rmtError Remotery_SendLogTextMessage(Remotery* rmt, Message* message)
+static rmtError Capture_WriteChunk(Capture* capture)
 {
-    Buffer* bin_buf;
+    rmtU8 header[CAPTURE_CHUNK_HEADER_SIZE] = { 'C', 'H', 'N', 'K' };
+    rmtU8 entry[CAPTURE_INDEX_ENTRY_SIZE];
+    Buffer* chunk = capture->chunk;
+    const rmtU8* data = chunk->data;
+    rmtU32 size = chunk->bytes_used;
+    rmtU32 compression = CAPTURE_STORED;
+    rmtError error;
 
-    assert(rmt != NULL);
-    assert(message != NULL);
-    
-    bin_buf = rmt->server->bin_buf;
-    WebSocket_PrepareBuffer(bin_buf);
-    Buffer_Write(bin_buf, message->payload, message->payload_size);
+    if (chunk->bytes_used == 0 || capture->error != RMT_ERROR_NONE)
+        return capture->error;
 
-    return Server_Send(rmt->server, bin_buf->data, bin_buf->bytes_used, 20);
+    #if RMT_USE_ZLIB
+    {
+        // Fall back to storing the chunk if it doesn't compress
+        uLongf packed_size = compressBound(chunk->bytes_used);
+        if (capture->packed->bytes_allocated < packed_size)
+        {
+            error = Buffer_Grow(capture->packed, (rmtU32)packed_size - capture->packed->bytes_allocated);
+            if (error != RMT_ERROR_NONE)
+                return error;
+        }
+        if (compress2(capture->packed->data, &packed_size, chunk->data, chunk->bytes_used, Z_BEST_SPEED) == Z_OK &&
+            packed_size < chunk->bytes_used)
+        {
+            data = capture->packed->data;
+            size = (rmtU32)packed_size;
+            compression = CAPTURE_DEFLATED;
+        }
+    }
+    #endif
+
+    U32ToByteArray(header + 4, compression);
+    U32ToByteArray(header + 8, size);
+    U32ToByteArray(header + 12, chunk->bytes_used);
+    U32ToByteArray(header + 16, capture->chunk_info.first_frame);
+    U32ToByteArray(header + 20, capture->chunk_info.nb_frames);
+    U64ToByteArray(header + 24, capture->chunk_info.first_time);
+    if (fwrite(header, sizeof(header), 1, capture->file) != 1 || fwrite(data, size, 1, capture->file) != 1)
+    {
+        capture->error = RMT_ERROR_CAPTURE_WRITE_FAIL;
+        return capture->error;
+    }
+
+    // Make the chunk available to replay as soon as possible
+    fflush(capture->file);
+
+    CaptureChunk_Write(&capture->chunk_info, entry);
+    error = Buffer_Write(capture->index, entry, sizeof(entry));
+    if (error != RMT_ERROR_NONE)
+        return error;
+
+    // Start the next chunk, which writes again the names it uses
+    capture->chunk_info.offset += CAPTURE_CHUNK_HEADER_SIZE + size;
+    capture->chunk_info.first_frame = capture->nb_frames;
+    capture->chunk_info.nb_frames = 0;
+    chunk->bytes_used = 0;
+    memset(capture->names->slots, 0, capture->names->max_nb_slots * sizeof(HashSlot));
+    capture->names->nb_slots = 0;
+
+    return RMT_ERROR_NONE;
 }
 
 
-static rmtError bin_SampleTree(Buffer* buffer, Msg_SampleTree* msg)
+static void Capture_Destructor(Capture* capture)
 {
-    Sample* root_sample;
-    char thread_name[256];
-    rmtU32 digest_hash = 0, nb_samples = 0;
-    rmtError error;
+    assert(capture != NULL);
 
-    assert(buffer != NULL);
-    assert(msg != NULL);
+    if (capture->file != NULL)
+    {
+        // Write the last chunk, followed by the index
+        Capture_WriteChunk(capture);
+        if (capture->error == RMT_ERROR_NONE)
+        {
+            rmtU8 header[8] = { 'I', 'N', 'D', 'X' };
+            rmtU8 trailer[CAPTURE_TRAILER_SIZE];
+
+            U32ToByteArray(header + 4, capture->index->bytes_used / CAPTURE_INDEX_ENTRY_SIZE);
+            U64ToByteArray(trailer, capture->chunk_info.offset);
+            memcpy(trailer + 8, "RMTE", 4);
+            fwrite(header, sizeof(header), 1, capture->file);
+            if (capture->index->bytes_used != 0)
+                fwrite(capture->index->data, capture->index->bytes_used, 1, capture->file);
+            fwrite(trailer, sizeof(trailer), 1, capture->file);
+        }
 
-    // Get the message root sample
-    root_sample = msg->root_sample;
-    assert(root_sample != NULL);
+        fclose(capture->file);
+        capture->file = NULL;
+    }
 
-    // Add any sample types as a thread name post-fix to ensure they get their own viewer
-    thread_name[0] = 0;
-    strncat_s(thread_name, sizeof(thread_name), msg->thread_name, strnlen_s(msg->thread_name, 255));
-    if (root_sample->type == SampleType_CUDA)
-        strncat_s(thread_name, sizeof(thread_name), " (CUDA)", 7);
-    if (root_sample->type == SampleType_D3D11)
-        strncat_s(thread_name, sizeof(thread_name), " (D3D11)", 8);
-    if (root_sample->type == SampleType_OpenGL)
-        strncat_s(thread_name, sizeof(thread_name), " (OpenGL)", 9);
-    if (root_sample->type == SampleType_Metal)
-        strncat_s(thread_name, sizeof(thread_name), " (Metal)", 8);
+    Delete(rmtHashTable, capture->names);
+    Delete(Buffer, capture->index);
+    Delete(Buffer, capture->packed);
+    Delete(Buffer, capture->chunk);
+}
 
-    // Get digest hash of samples so that viewer can efficiently rebuild its tables
-    GetSampleDigest(root_sample, &digest_hash, &nb_samples);
 
-    // Write global message header
-    BIN_ERROR_CHECK(Buffer_Write(buffer, (void*)"SMPL    ", 8));
+static rmtError Capture_WriteMessage(Capture* capture, const void* data, rmtU32 length, rmtU64 time)
+{
+    rmtU8 header[CAPTURE_RECORD_HEADER_SIZE];
+    Buffer* chunk;
+    rmtError error;
 
-    // Write sample message header
-    BIN_ERROR_CHECK(Buffer_WriteStringWithLength(buffer, thread_name));
-    BIN_ERROR_CHECK(Buffer_WriteU32(buffer, nb_samples));
-    BIN_ERROR_CHECK(Buffer_WriteU32(buffer, digest_hash));
+    assert(capture != NULL);
+    if (capture->error != RMT_ERROR_NONE)
+        return capture->error;
 
-    // Write entire sample tree
-    BIN_ERROR_CHECK(bin_Sample(buffer, root_sample));
+    chunk = capture->chunk;
+    if (chunk->bytes_used == 0)
+        capture->chunk_info.first_time = time;
 
-    // Patch message size
-    U32ToByteArray(buffer->data + 4, buffer->bytes_used);
+    U32ToByteArray(header, length);
+    U64ToByteArray(header + 4, time);
+    error = Buffer_Write(chunk, header, sizeof(header));
+    if (error != RMT_ERROR_NONE)
+        return error;
+    error = Buffer_Write(chunk, data, length);
+    if (error != RMT_ERROR_NONE)
+        return error;
+
+    if (length >= 4 && memcmp(data, "SMPL", 4) == 0)
+    {
+        capture->chunk_info.nb_frames++;
+        capture->nb_frames++;
+    }
+
+    // Names stay in the chunk of the message that follows them
+    if (chunk->bytes_used >= CAPTURE_CHUNK_SIZE && (length < 4 || memcmp(data, "SSMP", 4) != 0))
+        return Capture_WriteChunk(capture);
 
     return RMT_ERROR_NONE;
 }
 
 
-
-#if RMT_USE_CUDA
-static rmtBool AreCUDASamplesReady(Sample* sample);
-static rmtBool GetCUDASampleTimes(Sample* root_sample, Sample* sample);
-#endif
+static rmtBool Capture_HasName(Capture* capture, rmtU32 name_hash)
+{
+    assert(capture != NULL);
+    return rmtHashTable_Find(capture->names, name_hash) != RMT_NOT_FOUND ? RMT_TRUE : RMT_FALSE;
+}
 
 
-static rmtError Remotery_SendSampleTreeMessage(Remotery* rmt, Message* message)
+static rmtError Capture_WriteName(Capture* capture, rmtU32 name_hash, rmtPStr name, rmtU64 time)
 {
-    Msg_SampleTree* sample_tree;
-    rmtError error = RMT_ERROR_NONE;
-    Sample* sample;
-    Buffer* bin_buf;
+    rmtU8 message[12 + 256];
+    rmtU32 name_length;
+    rmtError error;
 
-    assert(rmt != NULL);
-    assert(message != NULL);
+    assert(capture != NULL);
 
-    // Get the message root sample
-    sample_tree = (Msg_SampleTree*)message->payload;
-    sample = sample_tree->root_sample;
-    assert(sample != NULL);
+    // Same as the response to the viewer's name request
+    name_length = (rmtU32)strnlen_s(name, 256);
+    memcpy(message, "SSMP", 4);
+    U32ToByteArray(message + 4, name_hash);
+    U32ToByteArray(message + 8, name_length);
+    memcpy(message + 12, name, name_length);
 
-    #if RMT_USE_CUDA
-    if (sample->type == SampleType_CUDA)
-    {
-        // If these CUDA samples aren't ready yet, stick them to the back of the queue and continue
-        rmtBool are_samples_ready;
-        rmt_BeginCPUSample(AreCUDASamplesReady, 0);
-        are_samples_ready = AreCUDASamplesReady(sample);
-        rmt_EndCPUSample();
-        if (!are_samples_ready)
-        {
-            AddSampleTreeMessage(rmt->mq_to_rmt_thread, sample, sample_tree->allocator, sample_tree->thread_name, message->thread_sampler);
-            return RMT_ERROR_NONE;
-        }
+    error = rmtHashTable_Insert(capture->names, name_hash, 0);
+    if (error != RMT_ERROR_NONE)
+        return error;
 
-        // Retrieve timing of all CUDA samples
-        rmt_BeginCPUSample(GetCUDASampleTimes, 0);
-        GetCUDASampleTimes(sample->parent, sample);
-        rmt_EndCPUSample();
-    }
-    #endif
+    return Capture_WriteMessage(capture, message, 12 + name_length, time);
+}
 
-    // Reset the buffer for sending a websocket message
-    bin_buf = rmt->server->bin_buf;
-    WebSocket_PrepareBuffer(bin_buf);
 
-    // Serialise the sample tree and send to the viewer with a reasonably long timeout as the size
-    // of the sample data may be large
-    rmt_BeginCPUSample(bin_SampleTree, RMTSF_Aggregate);
-    error = bin_SampleTree(bin_buf, sample_tree);
-    rmt_EndCPUSample();
-    if (error == RMT_ERROR_NONE)
-    {
-        rmt_BeginCPUSample(Server_Send, RMTSF_Aggregate);
-        error = Server_Send(rmt->server, bin_buf->data, bin_buf->bytes_used, 50000);
-        rmt_EndCPUSample();
-    }
+static rmtError Capture_Update(Capture* capture, rmtU64 time)
+{
+    assert(capture != NULL);
 
-    // Release the sample tree back to its allocator
-    FreeSampleTree(sample, sample_tree->allocator);
+    // Bound how much is lost if the process ends without closing the capture
+    if (capture->chunk->bytes_used != 0 && time - capture->chunk_info.first_time >= CAPTURE_CHUNK_NS)
+        return Capture_WriteChunk(capture);
 
-    return error;
+    return RMT_ERROR_NONE;
 }
 
 
-static rmtError Remotery_ConsumeMessageQueue(Remotery* rmt)
+typedef struct
 {
-    rmtU32 nb_messages_sent = 0;
-    const rmtU32 maxNbMessagesPerUpdate = g_Settings.maxNbMessagesPerUpdate;
+    FILE* file;
 
-    assert(rmt != NULL);
+    // All complete chunks in the file
+    CaptureChunk* chunks;
+    rmtU32 nb_chunks;
 
-    // Absorb as many messages in the queue while disconnected
-    if (Server_IsClientConnected(rmt->server) == RMT_FALSE)
-        return RMT_ERROR_NONE;
+    // Packed and raw records of the current chunk
+    Buffer* packed;
+    Buffer* chunk;
+} CaptureReader;
 
-    // Loop reading the max number of messages for this update
-    while( nb_messages_sent++ < maxNbMessagesPerUpdate )
+
+static rmtError CaptureReader_AddChunk(CaptureReader* reader, const CaptureChunk* chunk, rmtU32* max_nb_chunks)
+{
+    if (reader->nb_chunks == *max_nb_chunks)
     {
-        rmtError error = RMT_ERROR_NONE;
-        Message* message = rmtMessageQueue_PeekNextMessage(rmt->mq_to_rmt_thread);
-        if (message == NULL)
-            break;
+        CaptureChunk* chunks;
+        *max_nb_chunks = *max_nb_chunks ? *max_nb_chunks * 2 : 64;
+        chunks = (CaptureChunk*)rmtRealloc(reader->chunks, *max_nb_chunks * sizeof(CaptureChunk));
+        if (chunks == NULL)
+            return RMT_ERROR_MALLOC_FAIL;
+        reader->chunks = chunks;
+    }
 
-        switch (message->id)
-        {
-            // This shouldn't be possible
-            case MsgID_NotReady:
-                assert(RMT_FALSE);
-                break;
+    reader->chunks[reader->nb_chunks++] = *chunk;
+    return RMT_ERROR_NONE;
+}
 
-            // Dispatch to message handler
-            case MsgID_LogText:
-                error = Remotery_SendLogTextMessage(rmt, message);
-                break;
-            case MsgID_SampleTree:
-                rmt_BeginCPUSample(SendSampleTreeMessage, RMTSF_Aggregate);
-                error = Remotery_SendSampleTreeMessage(rmt, message);
-                rmt_EndCPUSample();
-                break;
-        }
 
-        // Consume the message before reacting to any errors
-        rmtMessageQueue_ConsumeNextMessage(rmt->mq_to_rmt_thread, message);
+static rmtError CaptureReader_ReadIndex(CaptureReader* reader)
+{
+    rmtU8 trailer[CAPTURE_TRAILER_SIZE];
+    rmtU8 header[8];
+    rmtU8 entry[CAPTURE_INDEX_ENTRY_SIZE];
+    rmtU32 max_nb_chunks = 0;
+    rmtU32 i, nb_chunks;
+    rmtError error;
+
+    // Use the index written when the capture was closed
+    if (rmtFileSeek(reader->file, -CAPTURE_TRAILER_SIZE, SEEK_END) != 0 ||
+        fread(trailer, sizeof(trailer), 1, reader->file) != 1 ||
+        memcmp(trailer + 8, "RMTE", 4) != 0 ||
+        rmtFileSeek(reader->file, (rmtS64)ByteArrayToU64(trailer), SEEK_SET) != 0 ||
+        fread(header, sizeof(header), 1, reader->file) != 1 ||
+        memcmp(header, "INDX", 4) != 0)
+    {
+        return RMT_ERROR_CAPTURE_BAD_FILE;
+    }
+
+    nb_chunks = ByteArrayToU32(header + 4);
+    for (i = 0; i < nb_chunks; i++)
+    {
+        CaptureChunk chunk;
+        if (fread(entry, sizeof(entry), 1, reader->file) != 1)
+            return RMT_ERROR_CAPTURE_BAD_FILE;
+        CaptureChunk_Read(&chunk, entry);
+        error = CaptureReader_AddChunk(reader, &chunk, &max_nb_chunks);
         if (error != RMT_ERROR_NONE)
             return error;
     }
@@ -4678,797 +5123,2391 @@ static rmtError Remotery_ConsumeMessageQueue(Remotery* rmt)
 }
 
 
-static void Remotery_FlushMessageQueue(Remotery* rmt)
+static rmtError CaptureReader_ScanChunks(CaptureReader* reader)
 {
-    assert(rmt != NULL);
+    rmtU8 header[CAPTURE_CHUNK_HEADER_SIZE];
+    rmtU32 max_nb_chunks = reader->nb_chunks;
+    rmtS64 file_size;
+    CaptureChunk chunk;
+    rmtError error;
 
-    // Loop reading all remaining messages
-    for (;;)
+    if (rmtFileSeek(reader->file, 0, SEEK_END) != 0)
+        return RMT_ERROR_CAPTURE_BAD_FILE;
+    file_size = (rmtS64)rmtFileTell(reader->file);
+
+    // Walk the chunk headers, stopping at the first that's incomplete
+    chunk.offset = CAPTURE_HEADER_SIZE;
+    while (rmtFileSeek(reader->file, (rmtS64)chunk.offset, SEEK_SET) == 0 &&
+           fread(header, sizeof(header), 1, reader->file) == 1 &&
+           memcmp(header, "CHNK", 4) == 0)
     {
-        Message* message = rmtMessageQueue_PeekNextMessage(rmt->mq_to_rmt_thread);
-        if (message == NULL)
+        rmtU64 end = chunk.offset + CAPTURE_CHUNK_HEADER_SIZE + ByteArrayToU32(header + 8);
+        if (end > (rmtU64)file_size)
             break;
 
-        switch (message->id)
-        {
-            // These can be safely ignored
-            case MsgID_NotReady:
-            case MsgID_LogText:
-                break;
-
-            // Release all samples back to their allocators
-            case MsgID_SampleTree:
-            {
-                Msg_SampleTree* sample_tree = (Msg_SampleTree*)message->payload;
-                FreeSampleTree(sample_tree->root_sample, sample_tree->allocator);
-                break;
-            }
-        }
+        chunk.first_frame = ByteArrayToU32(header + 16);
+        chunk.nb_frames = ByteArrayToU32(header + 20);
+        chunk.first_time = ByteArrayToU64(header + 24);
+        error = CaptureReader_AddChunk(reader, &chunk, &max_nb_chunks);
+        if (error != RMT_ERROR_NONE)
+            return error;
 
-        rmtMessageQueue_ConsumeNextMessage(rmt->mq_to_rmt_thread, message);
+        chunk.offset = end;
     }
+
+    return RMT_ERROR_NONE;
 }
 
 
-static rmtError Remotery_ThreadMain(rmtThread* thread)
+static rmtError CaptureReader_Constructor(CaptureReader* reader, rmtPStr filename)
 {
-    Remotery* rmt = (Remotery*)thread->param;
-    assert(rmt != NULL);
-
-    rmt_SetCurrentThreadName("Remotery");
+    rmtU8 header[CAPTURE_HEADER_SIZE];
+    rmtError error;
 
-    while (thread->request_exit == RMT_FALSE)
-    {
-        rmt_BeginCPUSample(Wakeup, 0);
+    assert(reader != NULL);
+    reader->file = NULL;
+    reader->chunks = NULL;
+    reader->nb_chunks = 0;
+    reader->packed = NULL;
+    reader->chunk = NULL;
 
-            rmt_BeginCPUSample(ServerUpdate, 0);
-            Server_Update(rmt->server);
-            rmt_EndCPUSample();
+    New_1(Buffer, reader->packed, 64 * 1024);
+    if (error != RMT_ERROR_NONE)
+        return error;
+    New_1(Buffer, reader->chunk, 64 * 1024);
+    if (error != RMT_ERROR_NONE)
+        return error;
 
-            rmt_BeginCPUSample(ConsumeMessageQueue, 0);
-            Remotery_ConsumeMessageQueue(rmt);
-            rmt_EndCPUSample();
+    reader->file = fopen(filename, "rb");
+    if (reader->file == NULL)
+        return RMT_ERROR_CAPTURE_OPEN_FAIL;
 
-        rmt_EndCPUSample();
+    if (fread(header, sizeof(header), 1, reader->file) != 1 || memcmp(header, "RMTC", 4) != 0 ||
+        ByteArrayToU32(header + 4) != CAPTURE_VERSION)
+    {
+        return RMT_ERROR_CAPTURE_BAD_FILE;
+    }
 
-        //
-        // [NOTE-A]
-        //
-        // Possible sequence of user events at this point:
-        //
-        //    1. Add samples to the queue.
-        //    2. Shutdown remotery.
-        //
-        // This loop will exit with unrelease samples.
-        //
+    error = CaptureReader_ReadIndex(reader);
+    if (error == RMT_ERROR_CAPTURE_BAD_FILE)
+    {
+        reader->nb_chunks = 0;
+        error = CaptureReader_ScanChunks(reader);
+    }
 
-        msSleep(g_Settings.msSleepBetweenServerUpdates);
+    return error;
+}
+
+
+static void CaptureReader_Destructor(CaptureReader* reader)
+{
+    assert(reader != NULL);
+
+    if (reader->file != NULL)
+    {
+        fclose(reader->file);
+        reader->file = NULL;
     }
 
-    // Release all samples to their allocators as a consequence of [NOTE-A]
-    Remotery_FlushMessageQueue(rmt);
+    if (reader->chunks != NULL)
+    {
+        rmtFree(reader->chunks);
+        reader->chunks = NULL;
+    }
 
-    return RMT_ERROR_NONE;
+    Delete(Buffer, reader->chunk);
+    Delete(Buffer, reader->packed);
 }
 
 
-static rmtError Remotery_ReceiveMessage(void* context, char* message_data, rmtU32 message_length)
+static rmtError CaptureReader_ReadChunk(CaptureReader* reader, rmtU32 chunk_index)
 {
-    Remotery* rmt = (Remotery*)context;
+    rmtU8 header[CAPTURE_CHUNK_HEADER_SIZE];
+    rmtU32 compression, packed_size, raw_size;
+    Buffer* chunk = reader->chunk;
+    rmtError error;
 
-    // Manual dispatch on 4-byte message headers (message ID is little-endian encoded)
-    #define FOURCC(a, b, c, d) (rmtU32)( ((d) << 24) | ((c) << 16) | ((b) << 8) | (a) )
-    rmtU32 message_id = *(rmtU32*)message_data;
+    assert(chunk_index < reader->nb_chunks);
 
-    switch (message_id)
+    if (rmtFileSeek(reader->file, (rmtS64)reader->chunks[chunk_index].offset, SEEK_SET) != 0 ||
+        fread(header, sizeof(header), 1, reader->file) != 1 ||
+        memcmp(header, "CHNK", 4) != 0)
     {
-        case FOURCC('C', 'O', 'N', 'I'):
-        {
-            // Pass on to any registered handler
-            if (g_Settings.input_handler != NULL)
-                g_Settings.input_handler(message_data + 4, g_Settings.input_handler_context);
+        return RMT_ERROR_CAPTURE_BAD_FILE;
+    }
 
-            rmt_LogText("Console message received...");
-            rmt_LogText(message_data + 4);
-            break;
-        }
+    compression = ByteArrayToU32(header + 4);
+    packed_size = ByteArrayToU32(header + 8);
+    raw_size = ByteArrayToU32(header + 12);
 
-        case FOURCC('G', 'S', 'M', 'P'):
+    chunk->bytes_used = 0;
+    if (compression == CAPTURE_STORED)
+    {
+        if (packed_size != raw_size)
+            return RMT_ERROR_CAPTURE_BAD_FILE;
+        if (chunk->bytes_allocated < raw_size)
         {
-            ThreadSampler* ts;
-
-            // Convert name hash to integer
-            rmtU32 name_hash = 0;
-            const char* cur = message_data + 4;
-            const char* end = cur + message_length - 4;
-            while (cur < end)
-                name_hash = name_hash * 10 + *cur++ - '0';
+            error = Buffer_Grow(chunk, raw_size - chunk->bytes_allocated);
+            if (error != RMT_ERROR_NONE)
+                return error;
+        }
+        if (raw_size != 0 && fread(chunk->data, raw_size, 1, reader->file) != 1)
+            return RMT_ERROR_CAPTURE_BAD_FILE;
+    }
 
-            // Search all threads for a matching string hash
-            for (ts = rmt->first_thread_sampler; ts != NULL; ts = ts->next)
+    else if (compression == CAPTURE_DEFLATED)
+    {
+        #if RMT_USE_ZLIB
+            uLongf size = raw_size;
+            Buffer* packed = reader->packed;
+            if (packed->bytes_allocated < packed_size)
             {
-                rmtPStr name = StringTable_Find(ts->names, name_hash);
-                if (name != NULL)
-                {
-                    rmtU32 name_length;
-
-                    // Construct a response message containing the matching name
-                    Buffer* bin_buf = rmt->server->bin_buf;
-                    WebSocket_PrepareBuffer(bin_buf);
-                    Buffer_Write(bin_buf, "SSMP", 4);
-                    Buffer_WriteU32(bin_buf, name_hash);
-                    name_length = (rmtU32)strnlen_s(name, 256 - 12);
-                    Buffer_WriteU32(bin_buf, name_length);
-                    Buffer_Write(bin_buf, (void*)name, name_length);
-
-                    // Send back immediately as we're on the server thread
-                    return Server_Send(rmt->server, bin_buf->data, bin_buf->bytes_used, 10);
-                }
+                error = Buffer_Grow(packed, packed_size - packed->bytes_allocated);
+                if (error != RMT_ERROR_NONE)
+                    return error;
             }
-
-            break;
-        }
+            if (chunk->bytes_allocated < raw_size)
+            {
+                error = Buffer_Grow(chunk, raw_size - chunk->bytes_allocated);
+                if (error != RMT_ERROR_NONE)
+                    return error;
+            }
+            if (fread(packed->data, packed_size, 1, reader->file) != 1 ||
+                uncompress(chunk->data, &size, packed->data, packed_size) != Z_OK || size != raw_size)
+            {
+                return RMT_ERROR_CAPTURE_BAD_FILE;
+            }
+        #else
+            return RMT_ERROR_CAPTURE_UNSUPPORTED_COMPRESSION;
+        #endif
     }
 
-    #undef FOURCC
+    else
+    {
+        return RMT_ERROR_CAPTURE_UNSUPPORTED_COMPRESSION;
+    }
 
+    chunk->bytes_used = raw_size;
     return RMT_ERROR_NONE;
 }
 
 
-static rmtError Remotery_Constructor(Remotery* rmt)
+static rmtError Replay_Send(Server* server, const rmtU8* data, rmtU32 length)
 {
-    rmtError error;
+    Buffer* bin_buf = server->bin_buf;
+    WebSocket_PrepareBuffer(bin_buf);
+    Buffer_Write(bin_buf, data, length);
+    return Server_Send(server, bin_buf->data, bin_buf->bytes_used, 50000);
+}
 
-    assert(rmt != NULL);
 
-    // Set default state
-    rmt->server = NULL;
-    rmt->thread_sampler_tls_handle = TLS_INVALID_HANDLE;
-    rmt->first_thread_sampler = NULL;
-    rmt->mq_to_rmt_thread = NULL;
-    rmt->thread = NULL;
+static rmtError Replay_Serve(CaptureReader* reader, Server* server, rmtU32 start_ms)
+{
+    const rmtU64 start_time = reader->chunks[0].first_time + start_ms * 1000000ULL;
+    rmtU32 first_chunk = 0;
+    rmtU64 replay_start;
+    nsTimer timer;
+    rmtU32 i;
 
-    #if RMT_USE_CUDA
-        rmt->cuda.CtxSetCurrent = NULL;
-        rmt->cuda.EventCreate = NULL;
-        rmt->cuda.EventDestroy = NULL;
-        rmt->cuda.EventElapsedTime = NULL;
-        rmt->cuda.EventQuery = NULL;
-        rmt->cuda.EventRecord = NULL;
-    #endif
+    // Start from the last chunk beginning before the requested time
+    for (i = 1; i < reader->nb_chunks && reader->chunks[i].first_time <= start_time; i++)
+        first_chunk = i;
 
-    #if RMT_USE_D3D11
-        rmt->d3d11 = NULL;
-    #endif
+    nsTimer_Init(&timer);
+    replay_start = nsTimer_Get(&timer);
 
-    #if RMT_USE_OPENGL
-        rmt->opengl = NULL;
-    #endif
+    for (i = first_chunk; i < reader->nb_chunks; i++)
+    {
+        const rmtU8* cur;
+        const rmtU8* end;
 
-    #if RMT_USE_METAL
-        rmt->metal = NULL;
-    #endif
+        rmtError error = CaptureReader_ReadChunk(reader, i);
+        if (error != RMT_ERROR_NONE)
+            return error;
 
-    // Kick-off the timer
-    usTimer_Init(&rmt->timer);
+        cur = reader->chunk->data;
+        end = cur + reader->chunk->bytes_used;
+        while (end - cur >= CAPTURE_RECORD_HEADER_SIZE)
+        {
+            const rmtU32 length = ByteArrayToU32(cur);
+            const rmtU64 time = ByteArrayToU64(cur + 4);
+            const rmtU8* message = cur + CAPTURE_RECORD_HEADER_SIZE;
+            if ((rmtU64)(end - message) < length)
+                return RMT_ERROR_CAPTURE_BAD_FILE;
+            cur = message + length;
+
+            // Names are needed by the frames after them, even those before the start
+            if (length < 4 || (memcmp(message, "SSMP", 4) != 0 && time < start_time))
+                continue;
 
-    // Allocate a TLS handle for the thread sampler
-    error = tlsAlloc(&rmt->thread_sampler_tls_handle);
+            // Send each message at the time it was captured
+            while (time > start_time && time - start_time > nsTimer_Get(&timer) - replay_start)
+            {
+                Server_Update(server);
+                if (!Server_IsClientConnected(server))
+                    return RMT_ERROR_WEBSOCKET_DISCONNECTED;
+                msSleep(1);
+            }
+
+            error = Replay_Send(server, message, length);
+            if (error != RMT_ERROR_NONE)
+                return error;
+        }
+    }
+
+    return RMT_ERROR_NONE;
+}
+
+
+RMT_API rmtError _rmt_ReplayCapture(rmtPStr filename, rmtU32 start_ms)
+{
+    CaptureReader* reader;
+    Server* server;
+    rmtError error;
+
+    // Default-initialise if user has not set values
+    rmt_Settings();
+
+    New_1(CaptureReader, reader, filename);
     if (error != RMT_ERROR_NONE)
         return error;
+    if (reader->nb_chunks == 0)
+    {
+        Delete(CaptureReader, reader);
+        return RMT_ERROR_CAPTURE_BAD_FILE;
+    }
 
-    // Create the server
-    New_3(Server, rmt->server, g_Settings.port, g_Settings.reuse_open_port, g_Settings.limit_connections_to_localhost);
+    New_3(Server, server, g_Settings.port, g_Settings.reuse_open_port, g_Settings.limit_connections_to_localhost);
     if (error != RMT_ERROR_NONE)
+    {
+        Delete(CaptureReader, reader);
         return error;
+    }
 
-    // Setup incoming message handler
-    rmt->server->receive_handler = Remotery_ReceiveMessage;
-    rmt->server->receive_handler_context = rmt;
+    for (;;)
+    {
+        // Wait for a viewer
+        while (!Server_IsClientConnected(server))
+        {
+            Server_Update(server);
+            msSleep(g_Settings.msSleepBetweenServerUpdates);
+        }
 
-    // Create the main message thread with only one page
-    New_1(rmtMessageQueue, rmt->mq_to_rmt_thread, g_Settings.messageQueueSizeInBytes);
-    if (error != RMT_ERROR_NONE)
-        return error;
+        // Keep the connection open once the capture has been sent so that the viewer can be used
+        error = Replay_Serve(reader, server, start_ms);
+        while (error == RMT_ERROR_NONE && Server_IsClientConnected(server))
+        {
+            Server_Update(server);
+            msSleep(g_Settings.msSleepBetweenServerUpdates);
+        }
 
-    #if RMT_USE_D3D11
-        error = D3D11_Create(&rmt->d3d11);
-        if (error != RMT_ERROR_NONE)
-            return error;
-    #endif
+        // Losing the viewer only ends its replay
+        if (error != RMT_ERROR_NONE && error != RMT_ERROR_WEBSOCKET_DISCONNECTED && error != RMT_ERROR_SOCKET_SEND_FAIL)
+            break;
+        Server_DisconnectClient(server);
+    }
 
-    #if RMT_USE_OPENGL
-        error = OpenGL_Create(&rmt->opengl);
-        if (error != RMT_ERROR_NONE)
-            return error;
-    #endif
+    Delete(Server, server);
+    Delete(CaptureReader, reader);
+    return error;
+}
 
-    #if RMT_USE_METAL
-        error = Metal_Create(&rmt->metal);
-        if (error != RMT_ERROR_NONE)
-            return error;
-    #endif
+#endif  // RMT_USE_CAPTURE
 
 
-    // Set as the global instance before creating any threads that uses it for sampling itself
-    assert(g_Remotery == NULL);
-    g_Remotery = rmt;
-    g_RemoteryCreated = RMT_TRUE;
 
-    // Ensure global instance writes complete before other threads get a chance to use it
-    WriteFence();
+/*
+------------------------------------------------------------------------------------------------------------------------
+------------------------------------------------------------------------------------------------------------------------
+   @REMOTERY: Remotery
+------------------------------------------------------------------------------------------------------------------------
+------------------------------------------------------------------------------------------------------------------------
+*/
 
-    // Create the main update thread once everything has been defined for the global remotery object
-    New_2(rmtThread, rmt->thread, Remotery_ThreadMain, rmt);
-    return error;
-}
 
 
-static void Remotery_Destructor(Remotery* rmt)
-{
-    assert(rmt != NULL);
+#if RMT_USE_D3D11
+typedef struct D3D11 D3D11;
+static rmtError D3D11_Create(D3D11** d3d11);
+static void D3D11_Destructor(D3D11* d3d11);
+#endif
 
-    // Join the remotery thread before clearing the global object as the thread is profiling itself
-    Delete(rmtThread, rmt->thread);
 
-    if (g_RemoteryCreated)
-    {
-      g_Remotery = NULL;
-      g_RemoteryCreated = RMT_FALSE;
-    }
+#if RMT_USE_OPENGL
+typedef struct OpenGL_t OpenGL;
+static rmtError OpenGL_Create(OpenGL** opengl);
+static void OpenGL_Destructor(OpenGL* opengl);
+#endif
 
-    #if RMT_USE_D3D11
-        Delete(D3D11, rmt->d3d11);
-    #endif
 
-    #if RMT_USE_OPENGL
-        Delete(OpenGL, rmt->opengl);
-    #endif
+#if RMT_USE_VULKAN
+typedef struct Vulkan_t Vulkan;
+static rmtError Vulkan_Create(Vulkan** vulkan);
+static void Vulkan_Destructor(Vulkan* vulkan);
+#endif
 
-    #if RMT_USE_METAL
-        Delete(Metal, rmt->metal);
-    #endif
 
-    Delete(rmtMessageQueue, rmt->mq_to_rmt_thread);
+#if RMT_USE_METAL
+typedef struct Metal_t Metal;
+static rmtError Metal_Create(Metal** metal);
+static void Metal_Destructor(Metal* metal);
+#endif
 
-    Remotery_DestroyThreadSamplers(rmt);
 
-    Delete(Server, rmt->server);
+struct Remotery
+{
+    Server* server;
 
-    if (rmt->thread_sampler_tls_handle != TLS_INVALID_HANDLE)
-    {
-        tlsFree(rmt->thread_sampler_tls_handle);
-        rmt->thread_sampler_tls_handle = 0;
-    }
-}
+    // Nanosecond accuracy timer for CPU timestamps
+    nsTimer timer;
 
+    rmtTLS thread_sampler_tls_handle;
 
-static rmtError Remotery_GetThreadSampler(Remotery* rmt, ThreadSampler** thread_sampler)
-{
-    ThreadSampler* ts;
+    // Linked list of all known threads being sampled
+    ThreadSampler* volatile first_thread_sampler;
 
-    // Is there a thread sampler associated with this thread yet?
-    assert(rmt != NULL);
-    ts = (ThreadSampler*)tlsGet(rmt->thread_sampler_tls_handle);
-    if (ts == NULL)
-    {
-        // Allocate on-demand
-        rmtError error;
-        New_0(ThreadSampler, *thread_sampler);
-        if (error != RMT_ERROR_NONE)
-            return error;
-        ts = *thread_sampler;
+    // Queue between clients and main remotery thread
+    rmtMessageQueue* mq_to_rmt_thread;
 
-        // Add to the beginning of the global linked list of thread samplers
-        for (;;)
-        {
-            ThreadSampler* old_ts = rmt->first_thread_sampler;
-            ts->next = old_ts;
+    // The main server thread
+    rmtThread* thread;
 
-            // If the old value is what we expect it to be then no other thread has
-            // changed it since this thread sampler was used as a candidate first list item
-            if (AtomicCompareAndSwapPointer((long* volatile*)&rmt->first_thread_sampler, (long*)old_ts, (long*)ts) == RMT_TRUE)
-                break;
-        }
+    // Number of property snapshots taken, used as their frame index
+    rmtS32 volatile nb_property_snapshots;
 
-        tlsSet(rmt->thread_sampler_tls_handle, ts);
-    }
+#if RMT_USE_CAPTURE
+    // Optional copy of all messages written to file
+    Capture* capture;
+#endif
 
-    assert(thread_sampler != NULL);
-    *thread_sampler = ts;
-    return RMT_ERROR_NONE;
-}
+#if RMT_USE_CUDA
+    rmtCUDABind cuda;
+#endif
 
-static void Remotery_DestroyThreadSamplers(Remotery* rmt)
-{
-    // If the handle failed to create in the first place then it shouldn't be possible to create thread samplers
-    assert(rmt != NULL);
-    if (rmt->thread_sampler_tls_handle == TLS_INVALID_HANDLE)
-    {
-        assert(rmt->first_thread_sampler == NULL);
-        return;
-    }
+#if RMT_USE_D3D11
+    D3D11* d3d11;
+#endif
 
-    // Keep popping thread samplers off the linked list until they're all gone
-    // This does not make any assumptions, making it possible for thread samplers to be created while they're all
-    // deleted. While this is erroneous calling code, this will prevent a confusing crash.
-    while (rmt->first_thread_sampler != NULL)
-    {
-        ThreadSampler* ts;
+#if RMT_USE_OPENGL
+    OpenGL* opengl;
+#endif
 
-        for (;;)
-        {
-            ThreadSampler* old_ts = rmt->first_thread_sampler;
-            ThreadSampler* next_ts = old_ts->next;
+#if RMT_USE_VULKAN
+    Vulkan* vulkan;
+#endif
 
-            if (AtomicCompareAndSwapPointer((long* volatile*)&rmt->first_thread_sampler, (long*)old_ts, (long*)next_ts) == RMT_TRUE)
-            {
-                ts = old_ts;
-                break;
-            }
-        }
+#if RMT_USE_METAL
+    Metal* metal;
+#endif
+};
 
-        Delete(ThreadSampler, ts);
-    }
-}
 
+//
+// Global remotery context
+//
+static Remotery* g_Remotery = NULL;
 
-static void* CRTMalloc(void* mm_context, rmtU32 size)
-{
-    RMT_UNREFERENCED_PARAMETER(mm_context);
-    return malloc((size_t)size);
-}
 
+//
+// This flag marks the EXE/DLL that created the global remotery instance. We want to allow
+// only the creating EXE/DLL to destroy the remotery instance.
+//
+static rmtBool g_RemoteryCreated = RMT_FALSE;
 
-static void CRTFree(void* mm_context, void* ptr)
-{
-    RMT_UNREFERENCED_PARAMETER(mm_context);
-    free(ptr);
-}
 
-static void* CRTRealloc(void* mm_context, void* ptr, rmtU32 size)
-{
-    RMT_UNREFERENCED_PARAMETER(mm_context);
-    return realloc(ptr, size);
-}
+//
+// All properties that have been modified at least once, most recently registered first. Properties are
+// global variables so the list is shared by any Remotery instances and is never cleared.
+//
+static rmtProperty* volatile g_FirstProperty = NULL;
 
 
-RMT_API rmtSettings* _rmt_Settings(void)
+static void Remotery_DestroyThreadSamplers(Remotery* rmt);
+
+
+static const rmtU8 g_DecimalToHex[17] = "0123456789abcdef";
+
+
+static void GetSampleDigest(Sample* sample, rmtU32* digest_hash, rmtU32* nb_samples)
 {
-    // Default-initialize on first call
-    if( g_SettingsInitialized == RMT_FALSE )
+    Sample* child;
+
+    assert(sample != NULL);
+    assert(digest_hash != NULL);
+    assert(nb_samples != NULL);
+
+    // Concatenate this sample
+    (*nb_samples)++;
+    *digest_hash = HashCombine(*digest_hash, sample->unique_id);
+
     {
-        g_Settings.port = 0x4597;
-        g_Settings.reuse_open_port = RMT_FALSE;
-        g_Settings.limit_connections_to_localhost = RMT_FALSE;
-        g_Settings.msSleepBetweenServerUpdates = 10;
-        g_Settings.messageQueueSizeInBytes = 128 * 1024;
-        g_Settings.maxNbMessagesPerUpdate = 10;
-        g_Settings.malloc = CRTMalloc;
-        g_Settings.free = CRTFree;
-        g_Settings.realloc = CRTRealloc;
-        g_Settings.input_handler = NULL;
-        g_Settings.input_handler_context = NULL;
-        g_Settings.logFilename = "rmtLog.txt";
+        rmtU8 shift = 4;
 
-        g_SettingsInitialized = RMT_TRUE;
+        // Get 6 nibbles for lower 3 bytes of the name hash
+        rmtU8* sample_id = (rmtU8*)&sample->name_hash;
+        rmtU8 hex_sample_id[6];
+        hex_sample_id[0] = sample_id[0] & 15;
+        hex_sample_id[1] = sample_id[0] >> 4;
+        hex_sample_id[2] = sample_id[1] & 15;
+        hex_sample_id[3] = sample_id[1] >> 4;
+        hex_sample_id[4] = sample_id[2] & 15;
+        hex_sample_id[5] = sample_id[2] >> 4;
+
+        // As the nibbles will be used as hex colour digits, shift them up to make pastel colours
+        hex_sample_id[0] = minU8(hex_sample_id[0] + shift, 15);
+        hex_sample_id[1] = minU8(hex_sample_id[1] + shift, 15);
+        hex_sample_id[2] = minU8(hex_sample_id[2] + shift, 15);
+        hex_sample_id[3] = minU8(hex_sample_id[3] + shift, 15);
+        hex_sample_id[4] = minU8(hex_sample_id[4] + shift, 15);
+        hex_sample_id[5] = minU8(hex_sample_id[5] + shift, 15);
+
+        // Convert the nibbles to hex for the final colour
+        sample->unique_id_html_colour[1] = g_DecimalToHex[hex_sample_id[0]];
+        sample->unique_id_html_colour[2] = g_DecimalToHex[hex_sample_id[1]];
+        sample->unique_id_html_colour[3] = g_DecimalToHex[hex_sample_id[2]];
+        sample->unique_id_html_colour[4] = g_DecimalToHex[hex_sample_id[3]];
+        sample->unique_id_html_colour[5] = g_DecimalToHex[hex_sample_id[4]];
+        sample->unique_id_html_colour[6] = g_DecimalToHex[hex_sample_id[5]];
     }
 
-    return &g_Settings;
+    // Concatenate children
+    for (child = sample->first_child; child != NULL; child = child->next_sibling)
+        GetSampleDigest(child, digest_hash, nb_samples);
 }
 
 
-RMT_API rmtError _rmt_CreateGlobalInstance(Remotery** remotery)
+static rmtPStr Remotery_FindSampleName(Remotery* rmt, rmtU32 name_hash)
 {
-    rmtError error;
-
-    // Default-initialise if user has not set values
-    rmt_Settings();
+    ThreadSampler* ts;
+    rmtProperty* property;
 
-    // Creating the Remotery instance also records it as the global instance
-    assert(remotery != NULL);
-    New_0(Remotery, *remotery);
-    return error;
-}
+    // Search all threads for a matching string hash
+    for (ts = rmt->first_thread_sampler; ts != NULL; ts = ts->next)
+    {
+        rmtPStr name = StringTable_Find(ts->names, name_hash);
+        if (name != NULL)
+            return name;
+    }
 
+    // Property names are hashed the same way and requested by the viewer with the same message
+    for (property = g_FirstProperty; property != NULL; property = property->next)
+    {
+        if (property->name_hash == name_hash)
+            return property->name;
+    }
 
-RMT_API void _rmt_DestroyGlobalInstance(Remotery* remotery)
-{
-    // Ensure this is the module that created it
-    assert(g_RemoteryCreated == RMT_TRUE);
-    assert(g_Remotery == remotery);
-    Delete(Remotery, remotery);
+    return NULL;
 }
 
 
-RMT_API void _rmt_SetGlobalInstance(Remotery* remotery)
+#if RMT_USE_CAPTURE
+
+static void Remotery_CaptureSampleNames(Remotery* rmt, Sample* sample, rmtU64 time)
 {
-    // Default-initialise if user has not set values
-    rmt_Settings();
+    Sample* child;
 
-    g_Remotery = remotery;
+    // Write each name before the first frame using it so that replay never has to ask for it
+    if (sample->name_hash != 0 && !Capture_HasName(rmt->capture, sample->name_hash))
+    {
+        rmtPStr name = Remotery_FindSampleName(rmt, sample->name_hash);
+        if (name != NULL)
+            Capture_WriteName(rmt->capture, sample->name_hash, name, time);
+    }
+
+    for (child = sample->first_child; child != NULL; child = child->next_sibling)
+        Remotery_CaptureSampleNames(rmt, child, time);
 }
 
 
-RMT_API Remotery* _rmt_GetGlobalInstance(void)
+static void Remotery_CaptureSampleTree(Remotery* rmt, Sample* root_sample, Buffer* bin_buf)
 {
-    return g_Remotery;
-}
+    rmtU64 time = nsTimer_Get(&rmt->timer);
+    Remotery_CaptureSampleNames(rmt, root_sample, time);
 
+    // Skip the space reserved for the WebSocket frame header
+    Capture_WriteMessage(rmt->capture,
+        bin_buf->data + WEBSOCKET_MAX_FRAME_HEADER_SIZE, bin_buf->bytes_used - WEBSOCKET_MAX_FRAME_HEADER_SIZE, time);
+}
 
-#ifdef RMT_PLATFORM_WINDOWS
-    #pragma pack(push,8)
-    typedef struct tagTHREADNAME_INFO
-    {
-       DWORD dwType; // Must be 0x1000.
-       LPCSTR szName; // Pointer to name (in user addr space).
-       DWORD dwThreadID; // Thread ID (-1=caller thread).
-       DWORD dwFlags; // Reserved for future use, must be zero.
-    } THREADNAME_INFO;
-    #pragma pack(pop)
 #endif
 
-static void SetDebuggerThreadName(const char* name)
+
+static rmtError Remotery_SendLogTextMessage(Remotery* rmt, Message* message)
 {
-    #ifdef RMT_PLATFORM_WINDOWS
-        THREADNAME_INFO info;
-        info.dwType = 0x1000;
-        info.szName = name;
-        info.dwThreadID = (DWORD)-1;
-        info.dwFlags = 0;
+    Buffer* bin_buf;
 
-        #ifndef __MINGW32__
-        __try
-        {
-            RaiseException(0x406D1388, 0, sizeof(info)/sizeof(ULONG_PTR), (ULONG_PTR*)&info);
-        }
-        __except(1 /* EXCEPTION_EXECUTE_HANDLER */)
-        {
-        }
-        #endif
-    #else
-        RMT_UNREFERENCED_PARAMETER(name);
-    #endif
+    assert(rmt != NULL);
+    assert(message != NULL);
+    
+    bin_buf = rmt->server->bin_buf;
+    WebSocket_PrepareBuffer(bin_buf);
+    Buffer_Write(bin_buf, message->payload, message->payload_size);
 
-    #ifdef RMT_PLATFORM_LINUX
-        // pthread_setname_np is a non-standard GNU extension.
-        char name_clamp[16];
-        name_clamp[0] = 0;
-        strncat_s(name_clamp, sizeof(name_clamp), name, 15);
-        #ifdef __FreeBSD__
-            pthread_set_name_np(pthread_self(), name_clamp);
-        #else
-            prctl(PR_SET_NAME,name_clamp,0,0,0);
-        #endif
+    #if RMT_USE_CAPTURE
+        if (rmt->capture != NULL)
+            Capture_WriteMessage(rmt->capture, message->payload, message->payload_size, nsTimer_Get(&rmt->timer));
     #endif
+
+    return Server_Send(rmt->server, bin_buf->data, bin_buf->bytes_used, 20);
 }
 
 
-RMT_API void _rmt_SetCurrentThreadName(rmtPStr thread_name)
+static rmtError bin_SampleTree(Buffer* buffer, Msg_SampleTree* msg)
 {
-    ThreadSampler* ts;
+    Sample* root_sample;
+    char thread_name[256];
+    rmtU32 digest_hash = 0, nb_samples = 0;
+    rmtError error;
 
-    if (g_Remotery == NULL)
-        return;
+    assert(buffer != NULL);
+    assert(msg != NULL);
 
-    // Get data for this thread
-    if (Remotery_GetThreadSampler(g_Remotery, &ts) != RMT_ERROR_NONE)
-        return;
-
-    // Copy name and apply to the debugger
-    strcpy_s(ts->name, sizeof(ts->name), thread_name);
-    SetDebuggerThreadName(thread_name);
-}
+    // Get the message root sample
+    root_sample = msg->root_sample;
+    assert(root_sample != NULL);
 
+    // Add any sample types as a thread name post-fix to ensure they get their own viewer
+    thread_name[0] = 0;
+    strncat_s(thread_name, sizeof(thread_name), msg->thread_name, strnlen_s(msg->thread_name, 255));
+    if (root_sample->type == SampleType_CUDA)
+        strncat_s(thread_name, sizeof(thread_name), " (CUDA)", 7);
+    if (root_sample->type == SampleType_D3D11)
+        strncat_s(thread_name, sizeof(thread_name), " (D3D11)", 8);
+    if (root_sample->type == SampleType_OpenGL)
+        strncat_s(thread_name, sizeof(thread_name), " (OpenGL)", 9);
+    if (root_sample->type == SampleType_Vulkan)
+        strncat_s(thread_name, sizeof(thread_name), " (Vulkan)", 9);
+    if (root_sample->type == SampleType_Metal)
+        strncat_s(thread_name, sizeof(thread_name), " (Metal)", 8);
 
-static rmtBool QueueLine(rmtMessageQueue* queue, unsigned char* text, rmtU32 size, struct ThreadSampler* thread_sampler)
-{
-    Message* message;
-    rmtU32 text_size;
+    // Get digest hash of samples so that viewer can efficiently rebuild its tables
+    GetSampleDigest(root_sample, &digest_hash, &nb_samples);
 
-    assert(queue != NULL);
+    // Write global message header
+    BIN_ERROR_CHECK(Buffer_Write(buffer, (void*)"SMPL    ", 8));
 
-    // Prefix with text size
-    text_size = size - 8;
-    U32ToByteArray(text + 4, text_size);
+    // Write sample message header
+    BIN_ERROR_CHECK(Buffer_WriteStringWithLength(buffer, thread_name));
+    BIN_ERROR_CHECK(Buffer_WriteU32(buffer, nb_samples));
+    BIN_ERROR_CHECK(Buffer_WriteU32(buffer, digest_hash));
 
-    // Allocate some space for the line
-    message = rmtMessageQueue_AllocMessage(queue, size, thread_sampler);
-    if (message == NULL)
-        return RMT_FALSE;
+    // Write entire sample tree
+    BIN_ERROR_CHECK(bin_Sample(buffer, root_sample));
 
-    // Copy the text and commit the message
-    memcpy(message->payload, text, size);
-    rmtMessageQueue_CommitMessage(message, MsgID_LogText);
+    // Patch message size
+    U32ToByteArray(buffer->data + 4, buffer->bytes_used);
 
-    return RMT_TRUE;
+    return RMT_ERROR_NONE;
 }
 
 
-RMT_API void _rmt_LogText(rmtPStr text)
-{
-    int start_offset, prev_offset, i;
-    unsigned char line_buffer[1024] = { 0 };
-    ThreadSampler* ts;
-
-    if (g_Remotery == NULL)
-        return;
 
-    Remotery_GetThreadSampler(g_Remotery, &ts);
+#if RMT_USE_CUDA
+static rmtBool AreCUDASamplesReady(Sample* sample);
+static rmtBool GetCUDASampleTimes(Sample* root_sample, Sample* sample);
+#endif
 
-    // Start the line with the message header
-    line_buffer[0] = 'L';
-    line_buffer[1] = 'O';
-    line_buffer[2] = 'G';
-    line_buffer[3] = 'M';
-    start_offset = 8;
 
-    // There might be newlines in the buffer, so split them into multiple network calls
-    prev_offset = start_offset;
-    for (i = 0; text[i] != 0; i++)
-    {
-        char c = text[i];
+static rmtError Remotery_SendSampleTreeMessage(Remotery* rmt, Message* message)
+{
+    Msg_SampleTree* sample_tree;
+    rmtError error = RMT_ERROR_NONE;
+    Sample* sample;
+    Buffer* bin_buf;
 
-        // Line wrap when too long or newline encountered
-        if (prev_offset == sizeof(line_buffer) - 3 || c == '\n')
-        {
-            if (QueueLine(g_Remotery->mq_to_rmt_thread, line_buffer, prev_offset, ts) == RMT_FALSE)
-                return;
+    assert(rmt != NULL);
+    assert(message != NULL);
 
-            // Restart line
-            prev_offset = start_offset;
-        }
+    // Get the message root sample
+    sample_tree = (Msg_SampleTree*)message->payload;
+    sample = sample_tree->root_sample;
+    assert(sample != NULL);
 
-        // Safe to insert 2 characters here as previous check would split lines if not enough space left
-        switch (c)
+    #if RMT_USE_CUDA
+    if (sample->type == SampleType_CUDA)
+    {
+        // If these CUDA samples aren't ready yet, stick them to the back of the queue and continue
+        rmtBool are_samples_ready;
+        rmt_BeginCPUSample(AreCUDASamplesReady, 0);
+        are_samples_ready = AreCUDASamplesReady(sample);
+        rmt_EndCPUSample();
+        if (!are_samples_ready)
         {
-            // Skip newline, dealt with above
-            case '\n':
-                break;
+            AddSampleTreeMessage(rmt->mq_to_rmt_thread, sample, sample_tree->allocator, sample_tree->thread_name, message->thread_sampler);
+            return RMT_ERROR_NONE;
+        }
 
-            // Escape these
-            case '\\':
-                line_buffer[prev_offset++] = '\\';
-                line_buffer[prev_offset++] = '\\';
-                break;
+        // Retrieve timing of all CUDA samples
+        rmt_BeginCPUSample(GetCUDASampleTimes, 0);
+        GetCUDASampleTimes(sample->parent, sample);
+        rmt_EndCPUSample();
+    }
+    #endif
 
-            case '\"':
-                line_buffer[prev_offset++] = '\\';
-                line_buffer[prev_offset++] = '\"';
-                break;
+    // Reset the buffer for sending a websocket message
+    bin_buf = rmt->server->bin_buf;
+    WebSocket_PrepareBuffer(bin_buf);
 
-            // Add the rest
-            default:
-                line_buffer[prev_offset++] = c;
-                break;
+    // Serialise the sample tree and send to the viewer with a reasonably long timeout as the size
+    // of the sample data may be large
+    rmt_BeginCPUSample(bin_SampleTree, RMTSF_Aggregate);
+    error = bin_SampleTree(bin_buf, sample_tree);
+    rmt_EndCPUSample();
+    #if RMT_USE_CAPTURE
+        if (error == RMT_ERROR_NONE && rmt->capture != NULL)
+        {
+            rmt_BeginCPUSample(Capture_WriteSampleTree, RMTSF_Aggregate);
+            Remotery_CaptureSampleTree(rmt, sample, bin_buf);
+            rmt_EndCPUSample();
         }
-    }
-
-    // Send the last line
-    if (prev_offset > start_offset)
+    #endif
+    if (error == RMT_ERROR_NONE)
     {
-        assert(prev_offset < ((int)sizeof(line_buffer) - 3));
-        QueueLine(g_Remotery->mq_to_rmt_thread, line_buffer, prev_offset, ts);
+        rmt_BeginCPUSample(Server_Send, RMTSF_Aggregate);
+        error = Server_Send(rmt->server, bin_buf->data, bin_buf->bytes_used, 50000);
+        rmt_EndCPUSample();
     }
+
+    // Release the sample tree back to its allocator
+    FreeSampleTree(sample, sample_tree->allocator);
+
+    return error;
 }
 
 
-RMT_API void _rmt_BeginCPUSample(rmtPStr name, rmtU32 flags, rmtU32* hash_cache)
+typedef struct PropertySnapshot
 {
-    // 'hash_cache' stores a pointer to a sample name's hash value. Internally this is used to identify unique callstacks and it
-    // would be ideal that it's not recalculated each time the sample is used. This can be statically cached at the point
-    // of call or stored elsewhere when dynamic names are required.
-    //
-    // If 'hash_cache' is NULL then this call becomes more expensive, as it has to recalculate the hash of the name.
+    rmtPropertyValue value;
+    rmtU32 name_hash;
+    rmtU32 parent_name_hash;
+    rmtU32 type;
+} PropertySnapshot;
 
-    ThreadSampler* ts;
 
-    if (g_Remotery == NULL)
-        return;
+typedef struct Msg_PropertySnapshot
+{
+    rmtU64 ns_time;
+    rmtU32 frame_index;
+    rmtU32 nb_properties;
 
-    // TODO: Time how long the bits outside here cost and subtract them from the parent
+    // Properties in the order they were registered, so that groups come before their children
+    PropertySnapshot properties[1];
+} Msg_PropertySnapshot;
 
-    if (Remotery_GetThreadSampler(g_Remotery, &ts) == RMT_ERROR_NONE)
+
+static double PropertyValueToF64(rmtU32 type, rmtPropertyValue value)
+{
+    switch (type)
     {
-        Sample* sample;
-        rmtU32 name_hash = ThreadSampler_GetNameHash(ts, name, hash_cache);
-        if (ThreadSampler_Push(ts->sample_trees[SampleType_CPU], name_hash, flags, &sample) == RMT_ERROR_NONE)
-        {
-            // If this is an aggregate sample, store the time in 'end' as we want to preserve 'start'
-            if (sample->call_count > 1)
-                sample->us_end = usTimer_Get(&g_Remotery->timer);
-            else
-                sample->us_start = usTimer_Get(&g_Remotery->timer);
-        }
+        case RMT_PropertyType_Bool: return value.Bool ? 1.0 : 0.0;
+        case RMT_PropertyType_S32: return (double)value.S32;
+        case RMT_PropertyType_U32: return (double)value.U32;
+        case RMT_PropertyType_F32: return (double)value.F32;
+        case RMT_PropertyType_S64: return (double)value.S64;
+        case RMT_PropertyType_U64: return (double)value.U64;
+        case RMT_PropertyType_F64: return value.F64;
     }
+
+    // Groups have no value
+    return 0.0;
 }
 
 
-RMT_API void _rmt_EndCPUSample(void)
+static rmtError bin_PropertySnapshot(Buffer* buffer, Msg_PropertySnapshot* msg)
 {
-    ThreadSampler* ts;
-
-    if (g_Remotery == NULL)
-        return;
+    rmtU32 message_start, i;
+    rmtError error;
 
-    if (Remotery_GetThreadSampler(g_Remotery, &ts) == RMT_ERROR_NONE)
-    {
-        Sample* sample = ts->sample_trees[SampleType_CPU]->current_parent;
+    assert(buffer != NULL);
+    assert(msg != NULL);
 
-        if (sample->recurse_depth > 0)
-        {
-            sample->recurse_depth--;
-        }
-        else
-        {
-            rmtU64 us_end = usTimer_Get(&g_Remotery->timer);
+    // Write global message header
+    message_start = buffer->bytes_used;
+    BIN_ERROR_CHECK(Buffer_Write(buffer, (void*)"PSNP    ", 8));
 
-            // Aggregate samples use us_end to store start so that us_start is preserved
-            rmtU64 us_length = 0;
-            if (sample->call_count > 1 && sample->max_recurse_depth == 0)
-                us_length = (us_end - sample->us_end);
-            else
-                us_length = (us_end - sample->us_start);
+    // Write snapshot header
+    BIN_ERROR_CHECK(Buffer_WriteU64(buffer, msg->ns_time));
+    BIN_ERROR_CHECK(Buffer_WriteU32(buffer, msg->frame_index));
+    BIN_ERROR_CHECK(Buffer_WriteU32(buffer, msg->nb_properties));
 
-            sample->us_length += us_length;
+    // All values are sent as doubles for the viewer to graph
+    for (i = 0; i < msg->nb_properties; i++)
+    {
+        PropertySnapshot* snapshot = msg->properties + i;
+        BIN_ERROR_CHECK(Buffer_WriteU32(buffer, snapshot->name_hash));
+        BIN_ERROR_CHECK(Buffer_WriteU32(buffer, snapshot->parent_name_hash));
+        BIN_ERROR_CHECK(Buffer_WriteU32(buffer, snapshot->type));
+        BIN_ERROR_CHECK(Buffer_WriteF64(buffer, PropertyValueToF64(snapshot->type, snapshot->value)));
+    }
 
-            // Sum length on the parent to track un-sampled time in the parent
-            if (sample->parent != NULL)
-                sample->parent->us_sampled_length += us_length;
+    // Patch message size
+    U32ToByteArray(buffer->data + message_start + 4, buffer->bytes_used - message_start);
 
-            ThreadSampler_Pop(ts, g_Remotery->mq_to_rmt_thread, sample);
-        }
-    }
+    return RMT_ERROR_NONE;
 }
 
-#if RMT_USE_OPENGL || RMT_USE_D3D11
-static void Remotery_BlockingDeleteSampleTree(Remotery* rmt, enum SampleType sample_type)
+
+static rmtError Remotery_SendPropertySnapshotMessage(Remotery* rmt, Message* message)
 {
-    ThreadSampler* ts;
+    Msg_PropertySnapshot* snapshot;
+    rmtError error;
+    Buffer* bin_buf;
 
-    // Get the attached thread sampler
     assert(rmt != NULL);
-    if (Remotery_GetThreadSampler(rmt, &ts) == RMT_ERROR_NONE)
-    {
-        SampleTree* sample_tree = ts->sample_trees[sample_type];
-        if (sample_tree != NULL)
-        {
-            // Wait around until the Remotery server thread has sent all sample trees
-            // of this type to the client
-            while (sample_tree->allocator->nb_inuse > 1)
-                msSleep(1);
-
-            // Now free to delete
-            Delete(SampleTree, sample_tree);
-            ts->sample_trees[sample_type] = NULL;
-        }
-    }
-}
+    assert(message != NULL);
 
-static rmtBool rmtMessageQueue_IsEmpty(rmtMessageQueue* queue)
-{
-    assert(queue != NULL);
-    return queue->write_pos - queue->read_pos == 0;
-}
+    snapshot = (Msg_PropertySnapshot*)message->payload;
 
-#endif
+    bin_buf = rmt->server->bin_buf;
+    WebSocket_PrepareBuffer(bin_buf);
+    error = bin_PropertySnapshot(bin_buf, snapshot);
+    if (error != RMT_ERROR_NONE)
+        return error;
 
-/*
-------------------------------------------------------------------------------------------------------------------------
-------------------------------------------------------------------------------------------------------------------------
-   @CUDA: CUDA event sampling
-------------------------------------------------------------------------------------------------------------------------
-------------------------------------------------------------------------------------------------------------------------
-*/
+    #if RMT_USE_CAPTURE
+        if (rmt->capture != NULL)
+        {
+            rmtU64 time = nsTimer_Get(&rmt->timer);
+            rmtU32 i;
 
+            // Write each property name before the first snapshot using it, as with sample names
+            for (i = 0; i < snapshot->nb_properties; i++)
+            {
+                rmtU32 name_hash = snapshot->properties[i].name_hash;
+                if (!Capture_HasName(rmt->capture, name_hash))
+                {
+                    rmtPStr name = Remotery_FindSampleName(rmt, name_hash);
+                    if (name != NULL)
+                        Capture_WriteName(rmt->capture, name_hash, name, time);
+                }
+            }
 
+            Capture_WriteMessage(rmt->capture,
+                bin_buf->data + WEBSOCKET_MAX_FRAME_HEADER_SIZE, bin_buf->bytes_used - WEBSOCKET_MAX_FRAME_HEADER_SIZE, time);
+        }
+    #endif
 
-#if RMT_USE_CUDA
+    return Server_Send(rmt->server, bin_buf->data, bin_buf->bytes_used, 20);
+}
 
 
-typedef struct CUDASample
+static rmtError Remotery_ConsumeMessageQueue(Remotery* rmt)
 {
-    // IS-A inheritance relationship
-    Sample base;
+    rmtU32 nb_messages_sent = 0;
+    const rmtU32 maxNbMessagesPerUpdate = g_Settings.maxNbMessagesPerUpdate;
+
+    assert(rmt != NULL);
+
+    // Absorb as many messages in the queue while disconnected, unless they're being captured
+    if (Server_IsClientConnected(rmt->server) == RMT_FALSE)
+    {
+        #if RMT_USE_CAPTURE
+            if (rmt->capture == NULL)
+                return RMT_ERROR_NONE;
+        #else
+            return RMT_ERROR_NONE;
+        #endif
+    }
+
+    // Loop reading the max number of messages for this update
+    while( nb_messages_sent++ < maxNbMessagesPerUpdate )
+    {
+        rmtError error = RMT_ERROR_NONE;
+        Message* message = rmtMessageQueue_PeekNextMessage(rmt->mq_to_rmt_thread);
+        if (message == NULL)
+            break;
+
+        switch (message->id)
+        {
+            // This shouldn't be possible
+            case MsgID_NotReady:
+                assert(RMT_FALSE);
+                break;
+
+            // Dispatch to message handler
+            case MsgID_LogText:
+                error = Remotery_SendLogTextMessage(rmt, message);
+                break;
+            case MsgID_SampleTree:
+                rmt_BeginCPUSample(SendSampleTreeMessage, RMTSF_Aggregate);
+                error = Remotery_SendSampleTreeMessage(rmt, message);
+                rmt_EndCPUSample();
+                break;
+            case MsgID_PropertySnapshot:
+                error = Remotery_SendPropertySnapshotMessage(rmt, message);
+                break;
+        }
+
+        // Consume the message before reacting to any errors
+        rmtMessageQueue_ConsumeNextMessage(rmt->mq_to_rmt_thread, message);
+        if (error != RMT_ERROR_NONE)
+            return error;
+    }
+
+    return RMT_ERROR_NONE;
+}
+
+
+static void Remotery_FlushMessageQueue(Remotery* rmt)
+{
+    assert(rmt != NULL);
+
+    // Loop reading all remaining messages
+    for (;;)
+    {
+        Message* message = rmtMessageQueue_PeekNextMessage(rmt->mq_to_rmt_thread);
+        if (message == NULL)
+            break;
+
+        switch (message->id)
+        {
+            // These can be safely ignored
+            case MsgID_NotReady:
+            case MsgID_LogText:
+            case MsgID_PropertySnapshot:
+                break;
+
+            // Release all samples back to their allocators
+            case MsgID_SampleTree:
+            {
+                Msg_SampleTree* sample_tree = (Msg_SampleTree*)message->payload;
+                FreeSampleTree(sample_tree->root_sample, sample_tree->allocator);
+                break;
+            }
+        }
+
+        rmtMessageQueue_ConsumeNextMessage(rmt->mq_to_rmt_thread, message);
+    }
+}
+
+
+static void Remotery_ProcessSampleEvents(Remotery* rmt)
+{
+    ThreadSampler* ts;
+
+    assert(rmt != NULL);
+
+    // Build the sample trees of threads that record events, queueing any that are complete
+    for (ts = rmt->first_thread_sampler; ts != NULL; ts = ts->next)
+    {
+        if (ts->events != NULL)
+            ThreadSampler_ProcessEvents(ts, rmt->mq_to_rmt_thread);
+    }
+}
+
+
+static rmtError Remotery_ThreadMain(rmtThread* thread)
+{
+    Remotery* rmt = (Remotery*)thread->param;
+    assert(rmt != NULL);
+
+    rmt_SetCurrentThreadName("Remotery");
+
+    while (thread->request_exit == RMT_FALSE)
+    {
+        rmt_BeginCPUSample(Wakeup, 0);
+
+            rmt_BeginCPUSample(ServerUpdate, 0);
+            Server_Update(rmt->server);
+            rmt_EndCPUSample();
+
+            rmt_BeginCPUSample(ProcessSampleEvents, 0);
+            Remotery_ProcessSampleEvents(rmt);
+            rmt_EndCPUSample();
+
+            rmt_BeginCPUSample(ConsumeMessageQueue, 0);
+            Remotery_ConsumeMessageQueue(rmt);
+            rmt_EndCPUSample();
+
+            #if RMT_USE_CAPTURE
+                if (rmt->capture != NULL)
+                    Capture_Update(rmt->capture, nsTimer_Get(&rmt->timer));
+            #endif
+
+        rmt_EndCPUSample();
+
+        //
+        // [NOTE-A]
+        //
+        // Possible sequence of user events at this point:
+        //
+        //    1. Add samples to the queue.
+        //    2. Shutdown remotery.
+        //
+        // This loop will exit with unrelease samples.
+        //
+
+        msSleep(g_Settings.msSleepBetweenServerUpdates);
+    }
+
+    // Release all samples to their allocators as a consequence of [NOTE-A]
+    Remotery_FlushMessageQueue(rmt);
+
+    return RMT_ERROR_NONE;
+}
+
+
+static rmtError Remotery_ReceiveMessage(void* context, char* message_data, rmtU32 message_length)
+{
+    Remotery* rmt = (Remotery*)context;
+
+    // Manual dispatch on 4-byte message headers (message ID is little-endian encoded)
+    #define FOURCC(a, b, c, d) (rmtU32)( ((d) << 24) | ((c) << 16) | ((b) << 8) | (a) )
+    rmtU32 message_id = *(rmtU32*)message_data;
+
+    switch (message_id)
+    {
+        case FOURCC('C', 'O', 'N', 'I'):
+        {
+            // Pass on to any registered handler
+            if (g_Settings.input_handler != NULL)
+                g_Settings.input_handler(message_data + 4, g_Settings.input_handler_context);
+
+            rmt_LogText("Console message received...");
+            rmt_LogText(message_data + 4);
+            break;
+        }
+
+        case FOURCC('G', 'S', 'M', 'P'):
+        {
+            rmtPStr name;
+
+            // Convert name hash to integer
+            rmtU32 name_hash = 0;
+            const char* cur = message_data + 4;
+            const char* end = cur + message_length - 4;
+            while (cur < end)
+                name_hash = name_hash * 10 + *cur++ - '0';
+
+            // Search all threads for a matching string hash
+            name = Remotery_FindSampleName(rmt, name_hash);
+            if (name != NULL)
+            {
+                rmtU32 name_length;
+
+                // Construct a response message containing the matching name
+                Buffer* bin_buf = rmt->server->bin_buf;
+                WebSocket_PrepareBuffer(bin_buf);
+                Buffer_Write(bin_buf, "SSMP", 4);
+                Buffer_WriteU32(bin_buf, name_hash);
+                name_length = (rmtU32)strnlen_s(name, 256 - 12);
+                Buffer_WriteU32(bin_buf, name_length);
+                Buffer_Write(bin_buf, (void*)name, name_length);
+
+                // Send back immediately as we're on the server thread
+                return Server_Send(rmt->server, bin_buf->data, bin_buf->bytes_used, 10);
+            }
+
+            break;
+        }
+    }
+
+    #undef FOURCC
+
+    return RMT_ERROR_NONE;
+}
+
+
+static rmtError Remotery_Constructor(Remotery* rmt)
+{
+    rmtError error;
+
+    assert(rmt != NULL);
+
+    // Set default state
+    rmt->server = NULL;
+    rmt->thread_sampler_tls_handle = TLS_INVALID_HANDLE;
+    rmt->first_thread_sampler = NULL;
+    rmt->mq_to_rmt_thread = NULL;
+    rmt->thread = NULL;
+    rmt->nb_property_snapshots = 0;
+
+    #if RMT_USE_CAPTURE
+        rmt->capture = NULL;
+    #endif
+
+    #if RMT_USE_CUDA
+        rmt->cuda.CtxSetCurrent = NULL;
+        rmt->cuda.EventCreate = NULL;
+        rmt->cuda.EventDestroy = NULL;
+        rmt->cuda.EventElapsedTime = NULL;
+        rmt->cuda.EventQuery = NULL;
+        rmt->cuda.EventRecord = NULL;
+    #endif
+
+    #if RMT_USE_D3D11
+        rmt->d3d11 = NULL;
+    #endif
+
+    #if RMT_USE_OPENGL
+        rmt->opengl = NULL;
+    #endif
+
+    #if RMT_USE_VULKAN
+        rmt->vulkan = NULL;
+    #endif
+
+    #if RMT_USE_METAL
+        rmt->metal = NULL;
+    #endif
+
+    // Kick-off the timer
+    nsTimer_Init(&rmt->timer);
+
+    // Allocate a TLS handle for the thread sampler
+    error = tlsAlloc(&rmt->thread_sampler_tls_handle);
+    if (error != RMT_ERROR_NONE)
+        return error;
+
+    // Create the server
+    New_3(Server, rmt->server, g_Settings.port, g_Settings.reuse_open_port, g_Settings.limit_connections_to_localhost);
+    if (error != RMT_ERROR_NONE)
+        return error;
+
+    // Setup incoming message handler
+    rmt->server->receive_handler = Remotery_ReceiveMessage;
+    rmt->server->receive_handler_context = rmt;
+
+    // Create the main message thread with only one page
+    New_1(rmtMessageQueue, rmt->mq_to_rmt_thread, g_Settings.messageQueueSizeInBytes);
+    if (error != RMT_ERROR_NONE)
+        return error;
+
+    #if RMT_USE_CAPTURE
+        if (g_Settings.captureFilename != NULL)
+        {
+            New_1(Capture, rmt->capture, g_Settings.captureFilename);
+            if (error != RMT_ERROR_NONE)
+                return error;
+        }
+    #endif
+
+    #if RMT_USE_D3D11
+        error = D3D11_Create(&rmt->d3d11);
+        if (error != RMT_ERROR_NONE)
+            return error;
+    #endif
+
+    #if RMT_USE_OPENGL
+        error = OpenGL_Create(&rmt->opengl);
+        if (error != RMT_ERROR_NONE)
+            return error;
+    #endif
+
+    #if RMT_USE_VULKAN
+        error = Vulkan_Create(&rmt->vulkan);
+        if (error != RMT_ERROR_NONE)
+            return error;
+    #endif
+
+    #if RMT_USE_METAL
+        error = Metal_Create(&rmt->metal);
+        if (error != RMT_ERROR_NONE)
+            return error;
+    #endif
+
+
+    // Set as the global instance before creating any threads that uses it for sampling itself
+    assert(g_Remotery == NULL);
+    g_Remotery = rmt;
+    g_RemoteryCreated = RMT_TRUE;
+
+    // Ensure global instance writes complete before other threads get a chance to use it
+    WriteFence();
+
+    // Create the main update thread once everything has been defined for the global remotery object
+    New_2(rmtThread, rmt->thread, Remotery_ThreadMain, rmt);
+    return error;
+}
+
+
+static void Remotery_Destructor(Remotery* rmt)
+{
+    assert(rmt != NULL);
+
+    // Join the remotery thread before clearing the global object as the thread is profiling itself
+    Delete(rmtThread, rmt->thread);
+
+    if (g_RemoteryCreated)
+    {
+      g_Remotery = NULL;
+      g_RemoteryCreated = RMT_FALSE;
+    }
+
+    #if RMT_USE_D3D11
+        Delete(D3D11, rmt->d3d11);
+    #endif
+
+    #if RMT_USE_OPENGL
+        Delete(OpenGL, rmt->opengl);
+    #endif
+
+    #if RMT_USE_VULKAN
+        Delete(Vulkan, rmt->vulkan);
+    #endif
+
+    #if RMT_USE_METAL
+        Delete(Metal, rmt->metal);
+    #endif
+
+    #if RMT_USE_CAPTURE
+        Delete(Capture, rmt->capture);
+    #endif
+
+    Delete(rmtMessageQueue, rmt->mq_to_rmt_thread);
+
+    Remotery_DestroyThreadSamplers(rmt);
+
+    Delete(Server, rmt->server);
+
+    if (rmt->thread_sampler_tls_handle != TLS_INVALID_HANDLE)
+    {
+        tlsFree(rmt->thread_sampler_tls_handle);
+        rmt->thread_sampler_tls_handle = 0;
+    }
+}
+
+
+static rmtError Remotery_GetThreadSampler(Remotery* rmt, ThreadSampler** thread_sampler)
+{
+    ThreadSampler* ts;
+
+    // Is there a thread sampler associated with this thread yet?
+    assert(rmt != NULL);
+    ts = (ThreadSampler*)tlsGet(rmt->thread_sampler_tls_handle);
+    if (ts == NULL)
+    {
+        // Allocate on-demand
+        rmtError error;
+        New_0(ThreadSampler, *thread_sampler);
+        if (error != RMT_ERROR_NONE)
+            return error;
+        ts = *thread_sampler;
+
+        // Add to the beginning of the global linked list of thread samplers
+        for (;;)
+        {
+            ThreadSampler* old_ts = rmt->first_thread_sampler;
+            ts->next = old_ts;
+
+            // If the old value is what we expect it to be then no other thread has
+            // changed it since this thread sampler was used as a candidate first list item
+            if (AtomicCompareAndSwapPointer((long* volatile*)&rmt->first_thread_sampler, (long*)old_ts, (long*)ts) == RMT_TRUE)
+                break;
+        }
+
+        tlsSet(rmt->thread_sampler_tls_handle, ts);
+    }
+
+    assert(thread_sampler != NULL);
+    *thread_sampler = ts;
+    return RMT_ERROR_NONE;
+}
+
+static void Remotery_DestroyThreadSamplers(Remotery* rmt)
+{
+    // If the handle failed to create in the first place then it shouldn't be possible to create thread samplers
+    assert(rmt != NULL);
+    if (rmt->thread_sampler_tls_handle == TLS_INVALID_HANDLE)
+    {
+        assert(rmt->first_thread_sampler == NULL);
+        return;
+    }
+
+    // Keep popping thread samplers off the linked list until they're all gone
+    // This does not make any assumptions, making it possible for thread samplers to be created while they're all
+    // deleted. While this is erroneous calling code, this will prevent a confusing crash.
+    while (rmt->first_thread_sampler != NULL)
+    {
+        ThreadSampler* ts;
+
+        for (;;)
+        {
+            ThreadSampler* old_ts = rmt->first_thread_sampler;
+            ThreadSampler* next_ts = old_ts->next;
+
+            if (AtomicCompareAndSwapPointer((long* volatile*)&rmt->first_thread_sampler, (long*)old_ts, (long*)next_ts) == RMT_TRUE)
+            {
+                ts = old_ts;
+                break;
+            }
+        }
+
+        Delete(ThreadSampler, ts);
+    }
+}
+
+
+static void* CRTMalloc(void* mm_context, rmtU32 size)
+{
+    RMT_UNREFERENCED_PARAMETER(mm_context);
+    return malloc((size_t)size);
+}
+
+
+static void CRTFree(void* mm_context, void* ptr)
+{
+    RMT_UNREFERENCED_PARAMETER(mm_context);
+    free(ptr);
+}
+
+static void* CRTRealloc(void* mm_context, void* ptr, rmtU32 size)
+{
+    RMT_UNREFERENCED_PARAMETER(mm_context);
+    return realloc(ptr, size);
+}
+
+
+RMT_API rmtSettings* _rmt_Settings(void)
+{
+    // Default-initialize on first call
+    if( g_SettingsInitialized == RMT_FALSE )
+    {
+        g_Settings.port = 0x4597;
+        g_Settings.reuse_open_port = RMT_FALSE;
+        g_Settings.limit_connections_to_localhost = RMT_FALSE;
+        g_Settings.msSleepBetweenServerUpdates = 10;
+        g_Settings.messageQueueSizeInBytes = 128 * 1024;
+        g_Settings.maxNbMessagesPerUpdate = 10;
+        g_Settings.malloc = CRTMalloc;
+        g_Settings.free = CRTFree;
+        g_Settings.realloc = CRTRealloc;
+        g_Settings.input_handler = NULL;
+        g_Settings.input_handler_context = NULL;
+        g_Settings.logFilename = "rmtLog.txt";
+        g_Settings.captureFilename = NULL;
+        g_Settings.eventBufferSizeInBytes = 0;
+
+        g_SettingsInitialized = RMT_TRUE;
+    }
+
+    return &g_Settings;
+}
+
+
+RMT_API rmtError _rmt_CreateGlobalInstance(Remotery** remotery)
+{
+    rmtError error;
+
+    // Default-initialise if user has not set values
+    rmt_Settings();
+
+    // Creating the Remotery instance also records it as the global instance
+    assert(remotery != NULL);
+    New_0(Remotery, *remotery);
+    return error;
+}
+
+
+RMT_API void _rmt_DestroyGlobalInstance(Remotery* remotery)
+{
+    // Ensure this is the module that created it
+    assert(g_RemoteryCreated == RMT_TRUE);
+    assert(g_Remotery == remotery);
+    Delete(Remotery, remotery);
+}
+
+
+RMT_API void _rmt_SetGlobalInstance(Remotery* remotery)
+{
+    // Default-initialise if user has not set values
+    rmt_Settings();
+
+    g_Remotery = remotery;
+}
+
+
+RMT_API Remotery* _rmt_GetGlobalInstance(void)
+{
+    return g_Remotery;
+}
+
+
+#ifdef RMT_PLATFORM_WINDOWS
+    #pragma pack(push,8)
+    typedef struct tagTHREADNAME_INFO
+    {
+       DWORD dwType; // Must be 0x1000.
+       LPCSTR szName; // Pointer to name (in user addr space).
+       DWORD dwThreadID; // Thread ID (-1=caller thread).
+       DWORD dwFlags; // Reserved for future use, must be zero.
+    } THREADNAME_INFO;
+    #pragma pack(pop)
+#endif
+
+static void SetDebuggerThreadName(const char* name)
+{
+    #ifdef RMT_PLATFORM_WINDOWS
+        THREADNAME_INFO info;
+        info.dwType = 0x1000;
+        info.szName = name;
+        info.dwThreadID = (DWORD)-1;
+        info.dwFlags = 0;
+
+        #ifndef __MINGW32__
+        __try
+        {
+            RaiseException(0x406D1388, 0, sizeof(info)/sizeof(ULONG_PTR), (ULONG_PTR*)&info);
+        }
+        __except(1 /* EXCEPTION_EXECUTE_HANDLER */)
+        {
+        }
+        #endif
+    #else
+        RMT_UNREFERENCED_PARAMETER(name);
+    #endif
+
+    #ifdef RMT_PLATFORM_LINUX
+        // pthread_setname_np is a non-standard GNU extension.
+        char name_clamp[16];
+        name_clamp[0] = 0;
+        strncat_s(name_clamp, sizeof(name_clamp), name, 15);
+        #ifdef __FreeBSD__
+            pthread_set_name_np(pthread_self(), name_clamp);
+        #else
+            prctl(PR_SET_NAME,name_clamp,0,0,0);
+        #endif
+    #endif
+}
+
+
+RMT_API void _rmt_SetCurrentThreadName(rmtPStr thread_name)
+{
+    ThreadSampler* ts;
+
+    if (g_Remotery == NULL)
+        return;
+
+    // Get data for this thread
+    if (Remotery_GetThreadSampler(g_Remotery, &ts) != RMT_ERROR_NONE)
+        return;
+
+    // Copy name and apply to the debugger
+    strcpy_s(ts->name, sizeof(ts->name), thread_name);
+    SetDebuggerThreadName(thread_name);
+}
+
+
+static rmtBool QueueLine(rmtMessageQueue* queue, unsigned char* text, rmtU32 size, struct ThreadSampler* thread_sampler)
+{
+    Message* message;
+    rmtU32 text_size;
+
+    assert(queue != NULL);
+
+    // Prefix with text size
+    text_size = size - 8;
+    U32ToByteArray(text + 4, text_size);
+
+    // Allocate some space for the line
+    message = rmtMessageQueue_AllocMessage(queue, size, thread_sampler);
+    if (message == NULL)
+        return RMT_FALSE;
+
+    // Copy the text and commit the message
+    memcpy(message->payload, text, size);
+    rmtMessageQueue_CommitMessage(message, MsgID_LogText);
+
+    return RMT_TRUE;
+}
+
+
+RMT_API void _rmt_LogText(rmtPStr text)
+{
+    int start_offset, prev_offset, i;
+    unsigned char line_buffer[1024] = { 0 };
+    ThreadSampler* ts;
+
+    if (g_Remotery == NULL)
+        return;
+
+    Remotery_GetThreadSampler(g_Remotery, &ts);
+
+    // Start the line with the message header
+    line_buffer[0] = 'L';
+    line_buffer[1] = 'O';
+    line_buffer[2] = 'G';
+    line_buffer[3] = 'M';
+    start_offset = 8;
+
+    // There might be newlines in the buffer, so split them into multiple network calls
+    prev_offset = start_offset;
+    for (i = 0; text[i] != 0; i++)
+    {
+        char c = text[i];
+
+        // Line wrap when too long or newline encountered
+        if (prev_offset == sizeof(line_buffer) - 3 || c == '\n')
+        {
+            if (QueueLine(g_Remotery->mq_to_rmt_thread, line_buffer, prev_offset, ts) == RMT_FALSE)
+                return;
+
+            // Restart line
+            prev_offset = start_offset;
+        }
+
+        // Safe to insert 2 characters here as previous check would split lines if not enough space left
+        switch (c)
+        {
+            // Skip newline, dealt with above
+            case '\n':
+                break;
+
+            // Escape these
+            case '\\':
+                line_buffer[prev_offset++] = '\\';
+                line_buffer[prev_offset++] = '\\';
+                break;
+
+            case '\"':
+                line_buffer[prev_offset++] = '\\';
+                line_buffer[prev_offset++] = '\"';
+                break;
+
+            // Add the rest
+            default:
+                line_buffer[prev_offset++] = c;
+                break;
+        }
+    }
+
+    // Send the last line
+    if (prev_offset > start_offset)
+    {
+        assert(prev_offset < ((int)sizeof(line_buffer) - 3));
+        QueueLine(g_Remotery->mq_to_rmt_thread, line_buffer, prev_offset, ts);
+    }
+}
+
+
+RMT_API void _rmt_BeginCPUSample(rmtPStr name, rmtU32 flags, rmtU32* hash_cache)
+{
+    // 'hash_cache' stores a pointer to a sample name's hash value. Internally this is used to identify unique callstacks and it
+    // would be ideal that it's not recalculated each time the sample is used. This can be statically cached at the point
+    // of call or stored elsewhere when dynamic names are required.
+    //
+    // If 'hash_cache' is NULL then this call becomes more expensive, as it has to recalculate the hash of the name.
+
+    ThreadSampler* ts;
+
+    if (g_Remotery == NULL)
+        return;
+
+    // TODO: Time how long the bits outside here cost and subtract them from the parent
+
+    if (Remotery_GetThreadSampler(g_Remotery, &ts) == RMT_ERROR_NONE)
+    {
+        Sample* sample;
+        rmtU32 name_hash = ThreadSampler_GetNameHash(ts, name, hash_cache);
+
+        // Leave building the sample tree to the Remotery thread if this thread records events
+        if (ts->events != NULL)
+        {
+            SampleEventBuffer_Begin(ts->events, nsTimer_Get(&g_Remotery->timer), name_hash, flags);
+            return;
+        }
+
+        if (ThreadSampler_Push(ts->sample_trees[SampleType_CPU], name_hash, flags, &sample) == RMT_ERROR_NONE)
+            Sample_SetStartTime(sample, nsTimer_Get(&g_Remotery->timer));
+    }
+}
+
+
+RMT_API void _rmt_EndCPUSample(void)
+{
+    ThreadSampler* ts;
+
+    if (g_Remotery == NULL)
+        return;
+
+    if (Remotery_GetThreadSampler(g_Remotery, &ts) == RMT_ERROR_NONE)
+    {
+        rmtU64 ns_end = nsTimer_Get(&g_Remotery->timer);
+        if (ts->events != NULL)
+            SampleEventBuffer_End(ts->events, ns_end);
+        else
+            ThreadSampler_EndCPUSample(ts, g_Remotery->mq_to_rmt_thread, ns_end);
+    }
+}
+
+#if RMT_USE_OPENGL || RMT_USE_D3D11 || RMT_USE_VULKAN
+static void Remotery_BlockingDeleteSampleTree(Remotery* rmt, enum SampleType sample_type)
+{
+    ThreadSampler* ts;
+
+    // Get the attached thread sampler
+    assert(rmt != NULL);
+    if (Remotery_GetThreadSampler(rmt, &ts) == RMT_ERROR_NONE)
+    {
+        SampleTree* sample_tree = ts->sample_trees[sample_type];
+        if (sample_tree != NULL)
+        {
+            // Wait around until the Remotery server thread has sent all sample trees
+            // of this type to the client
+            while (sample_tree->allocator->nb_inuse > 1)
+                msSleep(1);
+
+            // Now free to delete
+            Delete(SampleTree, sample_tree);
+            ts->sample_trees[sample_type] = NULL;
+        }
+    }
+}
+
+static rmtBool rmtMessageQueue_IsEmpty(rmtMessageQueue* queue)
+{
+    assert(queue != NULL);
+    return queue->write_pos - queue->read_pos == 0;
+}
+
+#endif
+
+/*
+------------------------------------------------------------------------------------------------------------------------
+------------------------------------------------------------------------------------------------------------------------
+   @PROPERTY: Properties: named values sent to the viewer with each snapshot
+------------------------------------------------------------------------------------------------------------------------
+------------------------------------------------------------------------------------------------------------------------
+*/
+
+
+
+// Values of rmtProperty::initialised
+#define PROPERTY_UNREGISTERED 0
+#define PROPERTY_REGISTERING 1
+#define PROPERTY_REGISTERED 2
+
+
+static void RegisterProperty(rmtProperty* property)
+{
+    rmtProperty* old_first;
+
+    assert(property != NULL);
+
+    // Register parents first so that snapshots always list a group before its children
+    if (property->parent != NULL && property->parent->initialised != PROPERTY_REGISTERED)
+        RegisterProperty(property->parent);
+
+    // Only one thread gets to add the property. This only happens once per property so just sleep
+    // until that's done, to keep children of this property from being listed before it.
+    if (AtomicCompareAndSwap(&property->initialised, PROPERTY_UNREGISTERED, PROPERTY_REGISTERING) == RMT_FALSE)
+    {
+        while (property->initialised != PROPERTY_REGISTERED)
+            msSleep(1);
+        return;
+    }
+
+    // Use the same hash as sample names so that the viewer can request names the same way
+    property->name_hash = MurmurHash3_x86_32(property->name, (int)strnlen_s(property->name, 256), 0);
+
+    // Lock-free push onto the front of the list
+    do
+    {
+        old_first = g_FirstProperty;
+        property->next = old_first;
+        WriteFence();
+    }
+    while (AtomicCompareAndSwapPointer((long* volatile*)&g_FirstProperty, (long*)old_first, (long*)property) == RMT_FALSE);
+
+    WriteFence();
+    property->initialised = PROPERTY_REGISTERED;
+}
+
+
+RMT_API void _rmt_PropertySetValue(rmtProperty* property, rmtPropertyValue value)
+{
+    rmtU64 volatile* dest;
+    rmtU64 old_value;
+
+    assert(property != NULL);
+
+    if (property->initialised != PROPERTY_REGISTERED)
+        RegisterProperty(property);
+
+    // A plain store isn't atomic for 64-bit values on 32-bit platforms
+    dest = (rmtU64 volatile*)&property->value;
+    do
+    {
+        old_value = *dest;
+    }
+    while (AtomicCompareAndSwapU64(dest, old_value, value.U64) == RMT_FALSE);
+}
+
+
+RMT_API void _rmt_PropertyAddValue(rmtProperty* property, rmtPropertyValue add_value)
+{
+    rmtU64 volatile* dest;
+    rmtPropertyValue old_value, new_value;
+
+    assert(property != NULL);
+
+    if (property->initialised != PROPERTY_REGISTERED)
+        RegisterProperty(property);
+
+    // Compare-and-swap loop as there's no atomic add for floating point values
+    dest = (rmtU64 volatile*)&property->value;
+    do
+    {
+        old_value.U64 = *dest;
+        new_value = old_value;
+
+        switch (property->type)
+        {
+            case RMT_PropertyType_S32: new_value.S32 += add_value.S32; break;
+            case RMT_PropertyType_U32: new_value.U32 += add_value.U32; break;
+            case RMT_PropertyType_F32: new_value.F32 += add_value.F32; break;
+            case RMT_PropertyType_S64: new_value.S64 += add_value.S64; break;
+            case RMT_PropertyType_U64: new_value.U64 += add_value.U64; break;
+            case RMT_PropertyType_F64: new_value.F64 += add_value.F64; break;
+
+            // Groups and booleans can't be added to
+            default:
+                return;
+        }
+    }
+    while (AtomicCompareAndSwapU64(dest, old_value.U64, new_value.U64) == RMT_FALSE);
+}
+
+
+static rmtPropertyValue TakePropertyValue(rmtProperty* property)
+{
+    rmtU64 volatile* dest;
+    rmtPropertyValue value;
+    rmtU64 new_value;
+
+    assert(property != NULL);
+
+    // Swap in the default value if this is reset every frame, otherwise swap with the same value
+    // to get an untorn read on 32-bit platforms
+    dest = (rmtU64 volatile*)&property->value;
+    do
+    {
+        value.U64 = *dest;
+        new_value = (property->flags & RMT_PropertyFlags_FrameReset) ? property->default_value.U64 : value.U64;
+    }
+    while (AtomicCompareAndSwapU64(dest, value.U64, new_value) == RMT_FALSE);
+
+    return value;
+}
+
+
+RMT_API void _rmt_PropertySnapshotAll(void)
+{
+    rmtProperty* first_property;
+    rmtProperty* property;
+    rmtU32 nb_properties = 0;
+    ThreadSampler* ts;
+    Message* message;
+    Msg_PropertySnapshot* payload = NULL;
+
+    if (g_Remotery == NULL)
+        return;
+
+    // Properties registered while this runs are left for the next snapshot
+    first_property = g_FirstProperty;
+    for (property = first_property; property != NULL; property = property->next)
+        nb_properties++;
+    if (nb_properties == 0)
+        return;
+
+    Remotery_GetThreadSampler(g_Remotery, &ts);
+
+    // The values are copied here and sent to the viewer by the Remotery thread. If the queue is full the
+    // snapshot is dropped but values are still reset so that per-frame counts stay per-frame.
+    message = rmtMessageQueue_AllocMessage(g_Remotery->mq_to_rmt_thread,
+        sizeof(Msg_PropertySnapshot) + (nb_properties - 1) * sizeof(PropertySnapshot), ts);
+    if (message != NULL)
+    {
+        payload = (Msg_PropertySnapshot*)message->payload;
+        payload->ns_time = nsTimer_Get(&g_Remotery->timer);
+        payload->frame_index = (rmtU32)AtomicAdd(&g_Remotery->nb_property_snapshots, 1);
+        payload->nb_properties = nb_properties;
+    }
+
+    // The list is most recent first so fill the snapshot from the back to get registration order
+    for (property = first_property; property != NULL; property = property->next)
+    {
+        rmtPropertyValue value = TakePropertyValue(property);
+        if (payload != NULL)
+        {
+            PropertySnapshot* snapshot = payload->properties + --nb_properties;
+            snapshot->value = value;
+            snapshot->name_hash = property->name_hash;
+            snapshot->parent_name_hash = property->parent != NULL ? property->parent->name_hash : 0;
+            snapshot->type = property->type;
+        }
+    }
+
+    if (message != NULL)
+        rmtMessageQueue_CommitMessage(message, MsgID_PropertySnapshot);
+}
+
+
+
+/*
+------------------------------------------------------------------------------------------------------------------------
+------------------------------------------------------------------------------------------------------------------------
+   @CUDA: CUDA event sampling
+------------------------------------------------------------------------------------------------------------------------
+------------------------------------------------------------------------------------------------------------------------
+*/
+
+
+
+#if RMT_USE_CUDA
+
+
+typedef struct CUDASample
+{
+    // IS-A inheritance relationship
+    Sample base;
+
+    // Pair of events that wrap the sample
+    CUevent event_start;
+    CUevent event_end;
+
+} CUDASample;
+
+
+static rmtError MapCUDAResult(CUresult result)
+{
+    switch (result)
+    {
+        case CUDA_SUCCESS: return RMT_ERROR_NONE;
+        case CUDA_ERROR_DEINITIALIZED: return RMT_ERROR_CUDA_DEINITIALIZED;
+        case CUDA_ERROR_NOT_INITIALIZED: return RMT_ERROR_CUDA_NOT_INITIALIZED;
+        case CUDA_ERROR_INVALID_CONTEXT: return RMT_ERROR_CUDA_INVALID_CONTEXT;
+        case CUDA_ERROR_INVALID_VALUE: return RMT_ERROR_CUDA_INVALID_VALUE;
+        case CUDA_ERROR_INVALID_HANDLE: return RMT_ERROR_CUDA_INVALID_HANDLE;
+        case CUDA_ERROR_OUT_OF_MEMORY: return RMT_ERROR_CUDA_OUT_OF_MEMORY;
+        case CUDA_ERROR_NOT_READY: return RMT_ERROR_ERROR_NOT_READY;
+        default: return RMT_ERROR_CUDA_UNKNOWN;
+    }
+}
+
+
+#define CUDA_MAKE_FUNCTION(name, params)                    \
+    typedef CUresult (CUDAAPI *name##Ptr) params;           \
+    name##Ptr name = (name##Ptr)g_Remotery->cuda.name;
+
+
+#define CUDA_GUARD(call)                \
+    {                                   \
+        rmtError error = call;     \
+        if (error != RMT_ERROR_NONE)    \
+            return error;               \
+    }
+
+
+// Wrappers around CUDA driver functions that manage the active context.
+static rmtError CUDASetContext(void* context)
+{
+    CUDA_MAKE_FUNCTION(CtxSetCurrent, (CUcontext ctx));
+    assert(CtxSetCurrent != NULL);
+    return MapCUDAResult(CtxSetCurrent((CUcontext)context));
+}
+static rmtError CUDAGetContext(void** context)
+{
+    CUDA_MAKE_FUNCTION(CtxGetCurrent, (CUcontext* ctx));
+    assert(CtxGetCurrent != NULL);
+    return MapCUDAResult(CtxGetCurrent((CUcontext*)context));
+}
+static rmtError CUDAEnsureContext()
+{
+    void* current_context;
+    CUDA_GUARD(CUDAGetContext(&current_context));
+
+    assert(g_Remotery != NULL);
+    if (current_context != g_Remotery->cuda.context)
+        CUDA_GUARD(CUDASetContext(g_Remotery->cuda.context));
+
+    return RMT_ERROR_NONE;
+}
+
+
+// Wrappers around CUDA driver functions that manage events
+static rmtError CUDAEventCreate(CUevent* phEvent, unsigned int Flags)
+{
+    CUDA_MAKE_FUNCTION(EventCreate, (CUevent *phEvent, unsigned int Flags));
+    CUDA_GUARD(CUDAEnsureContext());
+    return MapCUDAResult(EventCreate(phEvent, Flags));
+}
+static rmtError CUDAEventDestroy(CUevent hEvent)
+{
+    CUDA_MAKE_FUNCTION(EventDestroy, (CUevent hEvent));
+    CUDA_GUARD(CUDAEnsureContext());
+    return MapCUDAResult(EventDestroy(hEvent));
+}
+static rmtError CUDAEventRecord(CUevent hEvent, void* hStream)
+{
+    CUDA_MAKE_FUNCTION(EventRecord, (CUevent hEvent, CUstream hStream));
+    CUDA_GUARD(CUDAEnsureContext());
+    return MapCUDAResult(EventRecord(hEvent, (CUstream)hStream));
+}
+static rmtError CUDAEventQuery(CUevent hEvent)
+{
+    CUDA_MAKE_FUNCTION(EventQuery,  (CUevent hEvent));
+    CUDA_GUARD(CUDAEnsureContext());
+    return MapCUDAResult(EventQuery(hEvent));
+}
+static rmtError CUDAEventElapsedTime(float* pMilliseconds, CUevent hStart, CUevent hEnd)
+{
+    CUDA_MAKE_FUNCTION(EventElapsedTime, (float *pMilliseconds, CUevent hStart, CUevent hEnd));
+    CUDA_GUARD(CUDAEnsureContext());
+    return MapCUDAResult(EventElapsedTime(pMilliseconds, hStart, hEnd));
+}
+
+
+static rmtError CUDASample_Constructor(CUDASample* sample)
+{
+    rmtError error;
+
+    assert(sample != NULL);
+
+    // Chain to sample constructor
+    Sample_Constructor((Sample*)sample);
+    sample->base.type = SampleType_CUDA;
+    sample->base.size_bytes = sizeof(CUDASample);
+    sample->event_start = NULL;
+    sample->event_end = NULL;
+
+    // Create non-blocking events with timing
+    assert(g_Remotery != NULL);
+    error = CUDAEventCreate(&sample->event_start, CU_EVENT_DEFAULT);
+    if (error == RMT_ERROR_NONE)
+        error = CUDAEventCreate(&sample->event_end, CU_EVENT_DEFAULT);
+    return error;
+}
+
+
+static void CUDASample_Destructor(CUDASample* sample)
+{
+    assert(sample != NULL);
+
+    // Destroy events
+    if (sample->event_start != NULL)
+        CUDAEventDestroy(sample->event_start);
+    if (sample->event_end != NULL)
+        CUDAEventDestroy(sample->event_end);
+
+    Sample_Destructor((Sample*)sample);
+}
+
+
+static rmtBool AreCUDASamplesReady(Sample* sample)
+{
+    rmtError error;
+    Sample* child;
 
-    // Pair of events that wrap the sample
-    CUevent event_start;
-    CUevent event_end;
+    CUDASample* cuda_sample = (CUDASample*)sample;
+    assert(sample->type == SampleType_CUDA);
+
+    // Check to see if both of the CUDA events have been processed
+    error = CUDAEventQuery(cuda_sample->event_start);
+    if (error != RMT_ERROR_NONE)
+        return RMT_FALSE;
+    error = CUDAEventQuery(cuda_sample->event_end);
+    if (error != RMT_ERROR_NONE)
+        return RMT_FALSE;
+
+    // Check child sample events
+    for (child = sample->first_child; child != NULL; child = child->next_sibling)
+    {
+        if (!AreCUDASamplesReady(child))
+            return RMT_FALSE;
+    }
+
+    return RMT_TRUE;
+}
+
+
+static rmtBool GetCUDASampleTimes(Sample* root_sample, Sample* sample)
+{
+    Sample* child;
+
+    CUDASample* cuda_root_sample = (CUDASample*)root_sample;
+    CUDASample* cuda_sample = (CUDASample*)sample;
+
+    float ms_start, ms_end;
+
+    assert(root_sample != NULL);
+    assert(sample != NULL);
+
+    // Get millisecond timing of each sample event, relative to initial root sample
+    if (CUDAEventElapsedTime(&ms_start, cuda_root_sample->event_start, cuda_sample->event_start) != RMT_ERROR_NONE)
+        return RMT_FALSE;
+    if (CUDAEventElapsedTime(&ms_end, cuda_root_sample->event_start, cuda_sample->event_end) != RMT_ERROR_NONE)
+        return RMT_FALSE;
+
+    // Convert to nanoseconds and add to the sample
+    sample->ns_start = (rmtU64)(ms_start * 1000000.0);
+    sample->ns_end = (rmtU64)(ms_end * 1000000.0);
+    sample->ns_length = sample->ns_end - sample->ns_start;
+
+    // Get child sample times
+    for (child = sample->first_child; child != NULL; child = child->next_sibling)
+    {
+        if (!GetCUDASampleTimes(root_sample, child))
+            return RMT_FALSE;
+    }
+
+    return RMT_TRUE;
+}
+
+
+RMT_API void _rmt_BindCUDA(const rmtCUDABind* bind)
+{
+    assert(bind != NULL);
+    if (g_Remotery != NULL)
+        g_Remotery->cuda = *bind;
+}
+
+
+RMT_API void _rmt_BeginCUDASample(rmtPStr name, rmtU32* hash_cache, void* stream)
+{
+    ThreadSampler* ts;
+
+    if (g_Remotery == NULL)
+        return;
+
+    if (Remotery_GetThreadSampler(g_Remotery, &ts) == RMT_ERROR_NONE)
+    {
+        rmtError error;
+        Sample* sample;
+        rmtU32 name_hash = ThreadSampler_GetNameHash(ts, name, hash_cache);
+
+        // Create the CUDA tree on-demand as the tree needs an up-front-created root.
+        // This is not possible to create on initialisation as a CUDA binding is not yet available.
+        SampleTree** cuda_tree = &ts->sample_trees[SampleType_CUDA];
+        if (*cuda_tree == NULL)
+        {
+            CUDASample* root_sample;
+
+            New_3(SampleTree, *cuda_tree, sizeof(CUDASample), (ObjConstructor)CUDASample_Constructor, (ObjDestructor)CUDASample_Destructor);
+            if (error != RMT_ERROR_NONE)
+                return;
+
+            // Record an event once on the root sample, used to measure absolute sample
+            // times since this point
+            root_sample = (CUDASample*)(*cuda_tree)->root;
+            error = CUDAEventRecord(root_sample->event_start, stream);
+            if (error != RMT_ERROR_NONE)
+                return;
+        }
+
+        // Push the same and record its event
+        if (ThreadSampler_Push(*cuda_tree, name_hash, 0, &sample) == RMT_ERROR_NONE)
+        {
+            CUDASample* cuda_sample = (CUDASample*)sample;
+            CUDAEventRecord(cuda_sample->event_start, stream);
+        }
+    }
+}
+
+
+RMT_API void _rmt_EndCUDASample(void* stream)
+{
+    ThreadSampler* ts;
+
+    if (g_Remotery == NULL)
+        return;
+
+    if (Remotery_GetThreadSampler(g_Remotery, &ts) == RMT_ERROR_NONE)
+    {
+        CUDASample* sample = (CUDASample*)ts->sample_trees[SampleType_CUDA]->current_parent;
+        if (sample->base.recurse_depth > 0)
+        {
+            sample->base.recurse_depth--;
+        }
+        else
+        {
+            CUDAEventRecord(sample->event_end, stream);
+            ThreadSampler_Pop(ts, g_Remotery->mq_to_rmt_thread, (Sample*)sample);
+        }
+    }
+}
+
+
+#endif  // RMT_USE_CUDA
+
+
+
+/*
+------------------------------------------------------------------------------------------------------------------------
+------------------------------------------------------------------------------------------------------------------------
+   @D3D11: Direct3D 11 event sampling
+------------------------------------------------------------------------------------------------------------------------
+------------------------------------------------------------------------------------------------------------------------
+*/
+
+
+
+#if RMT_USE_D3D11
+
+
+// As clReflect has no way of disabling C++ compile mode, this forces C interfaces everywhere...
+#define CINTERFACE
+
+// ...unfortunately these C++ helpers aren't wrapped by the same macro but they can be disabled individually
+#define D3D11_NO_HELPERS
+
+// Allow use of the D3D11 helper macros for accessing the C-style vtable
+#define COBJMACROS
+
+#ifdef _MSC_VER
+    // Disable for d3d11.h
+    // warning C4201: nonstandard extension used : nameless struct/union
+    #pragma warning(push)
+    #pragma warning(disable: 4201)
+#endif
+
+#include <d3d11.h>
+
+#ifdef _MSC_VER
+    #pragma warning(pop)
+#endif
+
+
+typedef struct D3D11
+{
+    // Context set by user
+    ID3D11Device* device;
+    ID3D11DeviceContext* context;
+
+    HRESULT last_error;
+
+    // Queue to the D3D 11 main update thread
+    // Given that BeginSample/EndSample need to be called from the same thread that does the update, there
+    // is really no need for this to be a thread-safe queue. I'm using it for its convenience.
+    rmtMessageQueue* mq_to_d3d11_main;
+
+    // Mark the first time so that remaining timestamps are offset from this
+    rmtU64 first_timestamp;
+    // Last time in ns (CPU time, via nsTimer_Get) since we last resync'ed CPU & GPU
+    rmtU64 last_resync;
+} D3D11;
+
+
+static rmtError D3D11_Create(D3D11** d3d11)
+{
+    rmtError error;
+
+    assert(d3d11 != NULL);
+
+    // Allocate space for the D3D11 data
+    *d3d11 = (D3D11*)rmtMalloc(sizeof(D3D11));
+    if (*d3d11 == NULL)
+        return RMT_ERROR_MALLOC_FAIL;
+
+    // Set defaults
+    (*d3d11)->device = NULL;
+    (*d3d11)->context = NULL;
+    (*d3d11)->last_error = S_OK;
+    (*d3d11)->mq_to_d3d11_main = NULL;
+    (*d3d11)->first_timestamp = 0;
+    (*d3d11)->last_resync = 0;
+
+    New_1(rmtMessageQueue, (*d3d11)->mq_to_d3d11_main, g_Settings.messageQueueSizeInBytes);
+    if (error != RMT_ERROR_NONE)
+    {
+        Delete(D3D11, *d3d11);
+        return error;
+    }
+
+    return RMT_ERROR_NONE;
+}
+
+
+static void D3D11_Destructor(D3D11* d3d11)
+{
+    assert(d3d11 != NULL);
+    Delete(rmtMessageQueue, d3d11->mq_to_d3d11_main);
+}
+
+static HRESULT rmtD3D11Finish(rmtU64 *out_timestamp, double *out_frequency)
+{
+    HRESULT result;
+    ID3D11Device* device = g_Remotery->d3d11->device;
+    ID3D11DeviceContext* context = g_Remotery->d3d11->context;
+    ID3D11Query* full_stall_fence;
+    ID3D11Query* query_disjoint;
+    D3D11_QUERY_DESC query_desc;
+    D3D11_QUERY_DESC disjoint_desc;
+    UINT64 timestamp;
+    D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint;
+
+    query_desc.Query = D3D11_QUERY_TIMESTAMP;
+    query_desc.MiscFlags = 0;
+    result = ID3D11Device_CreateQuery(device, &query_desc, &full_stall_fence);
+    if (result != S_OK)
+        return result;
+
+    disjoint_desc.Query = D3D11_QUERY_TIMESTAMP_DISJOINT;
+    disjoint_desc.MiscFlags = 0;
+    result = ID3D11Device_CreateQuery(device, &disjoint_desc, &query_disjoint);
+    if (result != S_OK)
+    {
+        ID3D11Query_Release(full_stall_fence);
+        return result;
+    }
+
+    ID3D11DeviceContext_Begin(context, (ID3D11Asynchronous*)query_disjoint);
+    ID3D11DeviceContext_End(context, (ID3D11Asynchronous*)full_stall_fence);
+    ID3D11DeviceContext_End(context, (ID3D11Asynchronous*)query_disjoint);
 
-} CUDASample;
+    result = S_FALSE;
 
+    while( result == S_FALSE )
+    {
+        result = ID3D11DeviceContext_GetData(context, (ID3D11Asynchronous*)query_disjoint, &disjoint, sizeof(disjoint), 0);
+        if (result != S_OK && result != S_FALSE)
+        {
+            ID3D11Query_Release(full_stall_fence);
+            ID3D11Query_Release(query_disjoint);
+            return result;
+        }
+        if( result == S_OK )
+        {
+            result = ID3D11DeviceContext_GetData(context, (ID3D11Asynchronous*)full_stall_fence, &timestamp, sizeof(timestamp), 0);
+            if (result != S_OK && result != S_FALSE)
+            {
+                ID3D11Query_Release(full_stall_fence);
+                ID3D11Query_Release(query_disjoint);
+                return result;
+            }
+        }
+        //Give HyperThreading threads a breath on this spinlock.
+        YieldProcessor();
+    }
 
-static rmtError MapCUDAResult(CUresult result)
-{
-    switch (result)
+    if (disjoint.Disjoint == FALSE)
     {
-        case CUDA_SUCCESS: return RMT_ERROR_NONE;
-        case CUDA_ERROR_DEINITIALIZED: return RMT_ERROR_CUDA_DEINITIALIZED;
-        case CUDA_ERROR_NOT_INITIALIZED: return RMT_ERROR_CUDA_NOT_INITIALIZED;
-        case CUDA_ERROR_INVALID_CONTEXT: return RMT_ERROR_CUDA_INVALID_CONTEXT;
-        case CUDA_ERROR_INVALID_VALUE: return RMT_ERROR_CUDA_INVALID_VALUE;
-        case CUDA_ERROR_INVALID_HANDLE: return RMT_ERROR_CUDA_INVALID_HANDLE;
-        case CUDA_ERROR_OUT_OF_MEMORY: return RMT_ERROR_CUDA_OUT_OF_MEMORY;
-        case CUDA_ERROR_NOT_READY: return RMT_ERROR_ERROR_NOT_READY;
-        default: return RMT_ERROR_CUDA_UNKNOWN;
+        double frequency = disjoint.Frequency / 1000000000.0;
+        *out_timestamp = timestamp;
+        *out_frequency = frequency;
     }
+    else
+    {
+        result = S_FALSE;
+    }
+
+    ID3D11Query_Release(full_stall_fence);
+    ID3D11Query_Release(query_disjoint);
+    return result;
 }
 
+static HRESULT SyncD3D11CpuGpuTimes(rmtU64* out_first_timestamp, rmtU64* out_last_resync)
+{
+    rmtU64 cpu_time_start = 0;
+    rmtU64 cpu_time_stop = 0;
+    rmtU64 average_half_RTT = 0; //RTT = Rountrip Time.
+    UINT64 gpu_base = 0;
+    double frequency = 1;
+    int i;
 
-#define CUDA_MAKE_FUNCTION(name, params)                    \
-    typedef CUresult (CUDAAPI *name##Ptr) params;           \
-    name##Ptr name = (name##Ptr)g_Remotery->cuda.name;
+    HRESULT result;
+    result = rmtD3D11Finish(&gpu_base, &frequency);
+    if (result != S_OK && result != S_FALSE)
+        return result;
+
+    for (i=0; i<RMT_GPU_CPU_SYNC_NUM_ITERATIONS; ++i)
+    {
+        rmtU64 half_RTT;
+        cpu_time_start = nsTimer_Get(&g_Remotery->timer);
+        result = rmtD3D11Finish(&gpu_base, &frequency);
+        cpu_time_stop = nsTimer_Get(&g_Remotery->timer);
 
+        if (result != S_OK && result != S_FALSE)
+            return result;
 
-#define CUDA_GUARD(call)                \
-    {                                   \
-        rmtError error = call;     \
-        if (error != RMT_ERROR_NONE)    \
-            return error;               \
+        //Ignore attempts where there was a disjoint, since there would
+        //be a lot of noise in those readings for measuring the RTT
+        if (result == S_OK)
+        {
+            //Average the time it takes a roundtrip from CPU to GPU
+            //while doing nothing other than getting timestamps
+            half_RTT = (cpu_time_stop - cpu_time_start) >> 1ULL;
+            if( i == 0 )
+                average_half_RTT = half_RTT;
+            else
+                average_half_RTT = (average_half_RTT + half_RTT) >> 1ULL;
+        }
     }
 
+    // All GPU times are offset from gpu_base, and then taken to
+    // the same relative origin CPU timestamps are based on.
+    // CPU is in us, we must translate it to ns.
+    *out_first_timestamp = gpu_base - (rmtU64)((cpu_time_start + average_half_RTT) * frequency);
+    *out_last_resync = cpu_time_stop;
 
-// Wrappers around CUDA driver functions that manage the active context.
-static rmtError CUDASetContext(void* context)
-{
-    CUDA_MAKE_FUNCTION(CtxSetCurrent, (CUcontext ctx));
-    assert(CtxSetCurrent != NULL);
-    return MapCUDAResult(CtxSetCurrent((CUcontext)context));
+    return result;
 }
-static rmtError CUDAGetContext(void** context)
+
+typedef struct D3D11Timestamp
 {
-    CUDA_MAKE_FUNCTION(CtxGetCurrent, (CUcontext* ctx));
-    assert(CtxGetCurrent != NULL);
-    return MapCUDAResult(CtxGetCurrent((CUcontext*)context));
-}
-static rmtError CUDAEnsureContext()
+    // Inherit so that timestamps can be quickly allocated
+    ObjectLink Link;
+
+    // Pair of timestamp queries that wrap the sample
+    ID3D11Query* query_start;
+    ID3D11Query* query_end;
+
+    // A disjoint to measure frequency/stability
+    // TODO: Does *each* sample need one of these?
+    ID3D11Query* query_disjoint;
+
+    rmtU64 cpu_timestamp;
+} D3D11Timestamp;
+
+
+static rmtError D3D11Timestamp_Constructor(D3D11Timestamp* stamp)
 {
-    void* current_context;
-    CUDA_GUARD(CUDAGetContext(&current_context));
+    D3D11_QUERY_DESC timestamp_desc;
+    D3D11_QUERY_DESC disjoint_desc;
+    ID3D11Device* device;
+    HRESULT* last_error;
+
+    assert(stamp != NULL);
+
+    ObjectLink_Constructor((ObjectLink*)stamp);
+
+    // Set defaults
+    stamp->query_start = NULL;
+    stamp->query_end = NULL;
+    stamp->query_disjoint = NULL;
+    stamp->cpu_timestamp = 0;
 
     assert(g_Remotery != NULL);
-    if (current_context != g_Remotery->cuda.context)
-        CUDA_GUARD(CUDASetContext(g_Remotery->cuda.context));
+    assert(g_Remotery->d3d11 != NULL);
+    device = g_Remotery->d3d11->device;
+    last_error = &g_Remotery->d3d11->last_error;
+
+    // Create start/end timestamp queries
+    timestamp_desc.Query = D3D11_QUERY_TIMESTAMP;
+    timestamp_desc.MiscFlags = 0;
+    *last_error = ID3D11Device_CreateQuery(device, &timestamp_desc, &stamp->query_start);
+    if (*last_error != S_OK)
+        return RMT_ERROR_D3D11_FAILED_TO_CREATE_QUERY;
+    *last_error = ID3D11Device_CreateQuery(device, &timestamp_desc, &stamp->query_end);
+    if (*last_error != S_OK)
+        return RMT_ERROR_D3D11_FAILED_TO_CREATE_QUERY;
+
+    // Create disjoint query
+    disjoint_desc.Query = D3D11_QUERY_TIMESTAMP_DISJOINT;
+    disjoint_desc.MiscFlags = 0;
+    *last_error = ID3D11Device_CreateQuery(device, &disjoint_desc, &stamp->query_disjoint);
+    if (*last_error != S_OK)
+        return RMT_ERROR_D3D11_FAILED_TO_CREATE_QUERY;
 
     return RMT_ERROR_NONE;
 }
 
 
-// Wrappers around CUDA driver functions that manage events
-static rmtError CUDAEventCreate(CUevent* phEvent, unsigned int Flags)
+static void D3D11Timestamp_Destructor(D3D11Timestamp* stamp)
 {
-    CUDA_MAKE_FUNCTION(EventCreate, (CUevent *phEvent, unsigned int Flags));
-    CUDA_GUARD(CUDAEnsureContext());
-    return MapCUDAResult(EventCreate(phEvent, Flags));
+    assert(stamp != NULL);
+
+    // Destroy queries
+    if (stamp->query_disjoint != NULL)
+        ID3D11Query_Release(stamp->query_disjoint);
+    if (stamp->query_end != NULL)
+        ID3D11Query_Release(stamp->query_end);
+    if (stamp->query_start != NULL)
+        ID3D11Query_Release(stamp->query_start);
 }
-static rmtError CUDAEventDestroy(CUevent hEvent)
+
+
+static void D3D11Timestamp_Begin(D3D11Timestamp* stamp, ID3D11DeviceContext* context)
 {
-    CUDA_MAKE_FUNCTION(EventDestroy, (CUevent hEvent));
-    CUDA_GUARD(CUDAEnsureContext());
-    return MapCUDAResult(EventDestroy(hEvent));
+    assert(stamp != NULL);
+
+    // Start of disjoint and first query
+    stamp->cpu_timestamp = nsTimer_Get(&g_Remotery->timer);
+    ID3D11DeviceContext_Begin(context, (ID3D11Asynchronous*)stamp->query_disjoint);
+    ID3D11DeviceContext_End(context, (ID3D11Asynchronous*)stamp->query_start);
 }
-static rmtError CUDAEventRecord(CUevent hEvent, void* hStream)
+
+
+static void D3D11Timestamp_End(D3D11Timestamp* stamp, ID3D11DeviceContext* context)
 {
-    CUDA_MAKE_FUNCTION(EventRecord, (CUevent hEvent, CUstream hStream));
-    CUDA_GUARD(CUDAEnsureContext());
-    return MapCUDAResult(EventRecord(hEvent, (CUstream)hStream));
+    assert(stamp != NULL);
+
+    // End of disjoint and second query
+    ID3D11DeviceContext_End(context, (ID3D11Asynchronous*)stamp->query_end);
+    ID3D11DeviceContext_End(context, (ID3D11Asynchronous*)stamp->query_disjoint);
 }
-static rmtError CUDAEventQuery(CUevent hEvent)
+
+
+static HRESULT D3D11Timestamp_GetData(D3D11Timestamp* stamp, ID3D11DeviceContext* context, rmtU64* out_start, rmtU64* out_end, rmtU64* out_first_timestamp, rmtU64* out_last_resync)
 {
-    CUDA_MAKE_FUNCTION(EventQuery,  (CUevent hEvent));
-    CUDA_GUARD(CUDAEnsureContext());
-    return MapCUDAResult(EventQuery(hEvent));
+    ID3D11Asynchronous* query_start;
+    ID3D11Asynchronous* query_end;
+    ID3D11Asynchronous* query_disjoint;
+    HRESULT result;
+
+    UINT64 start;
+    UINT64 end;
+    D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint;
+
+    assert(stamp != NULL);
+    query_start = (ID3D11Asynchronous*)stamp->query_start;
+    query_end = (ID3D11Asynchronous*)stamp->query_end;
+    query_disjoint = (ID3D11Asynchronous*)stamp->query_disjoint;
+
+    // Check to see if all queries are ready
+    // If any fail to arrive, wait until later
+    result = ID3D11DeviceContext_GetData(context, query_start, &start, sizeof(start), D3D11_ASYNC_GETDATA_DONOTFLUSH);
+    if (result != S_OK)
+        return result;
+    result = ID3D11DeviceContext_GetData(context, query_end, &end, sizeof(end), D3D11_ASYNC_GETDATA_DONOTFLUSH);
+    if (result != S_OK)
+        return result;
+    result = ID3D11DeviceContext_GetData(context, query_disjoint, &disjoint, sizeof(disjoint), D3D11_ASYNC_GETDATA_DONOTFLUSH);
+    if (result != S_OK)
+        return result;
+
+    if (disjoint.Disjoint == FALSE)
+    {
+        double frequency = disjoint.Frequency / 1000000000.0;
+
+        // Mark the first timestamp. We may resync if we detect the GPU timestamp is in the
+        // past (i.e. happened before the CPU command) since it should be impossible.
+        assert(out_first_timestamp != NULL);
+        if (*out_first_timestamp == 0 || ((start - *out_first_timestamp) / frequency) < stamp->cpu_timestamp)
+        {
+            result = SyncD3D11CpuGpuTimes(out_first_timestamp, out_last_resync);
+            if (result != S_OK)
+                return result;
+        }
+
+        // Calculate start and end timestamps from the disjoint info
+        *out_start = (rmtU64)((start - *out_first_timestamp) / frequency);
+        *out_end = (rmtU64)((end - *out_first_timestamp) / frequency);
+    }
+    else
+    {
+#if RMT_D3D11_RESYNC_ON_DISJOINT
+        result = SyncD3D11CpuGpuTimes(out_first_timestamp, out_last_resync);
+        if (result != S_OK)
+            return result;
+#endif
+    }
+
+    return S_OK;
 }
-static rmtError CUDAEventElapsedTime(float* pMilliseconds, CUevent hStart, CUevent hEnd)
+
+
+typedef struct D3D11Sample
 {
-    CUDA_MAKE_FUNCTION(EventElapsedTime, (float *pMilliseconds, CUevent hStart, CUevent hEnd));
-    CUDA_GUARD(CUDAEnsureContext());
-    return MapCUDAResult(EventElapsedTime(pMilliseconds, hStart, hEnd));
-}
+    // IS-A inheritance relationship
+    Sample base;
 
+    D3D11Timestamp* timestamp;
 
-static rmtError CUDASample_Constructor(CUDASample* sample)
+} D3D11Sample;
+
+
+static rmtError D3D11Sample_Constructor(D3D11Sample* sample)
 {
     rmtError error;
 
@@ -5476,88 +7515,154 @@ static rmtError CUDASample_Constructor(CUDASample* sample)
 
     // Chain to sample constructor
     Sample_Constructor((Sample*)sample);
-    sample->base.type = SampleType_CUDA;
-    sample->base.size_bytes = sizeof(CUDASample);
-    sample->event_start = NULL;
-    sample->event_end = NULL;
+    sample->base.type = SampleType_D3D11;
+    sample->base.size_bytes = sizeof(D3D11Sample);
+    New_0(D3D11Timestamp, sample->timestamp);
 
-    // Create non-blocking events with timing
-    assert(g_Remotery != NULL);
-    error = CUDAEventCreate(&sample->event_start, CU_EVENT_DEFAULT);
-    if (error == RMT_ERROR_NONE)
-        error = CUDAEventCreate(&sample->event_end, CU_EVENT_DEFAULT);
-    return error;
+    return RMT_ERROR_NONE;
 }
 
 
-static void CUDASample_Destructor(CUDASample* sample)
+static void D3D11Sample_Destructor(D3D11Sample* sample)
 {
-    assert(sample != NULL);
-
-    // Destroy events
-    if (sample->event_start != NULL)
-        CUDAEventDestroy(sample->event_start);
-    if (sample->event_end != NULL)
-        CUDAEventDestroy(sample->event_end);
-
+    Delete(D3D11Timestamp, sample->timestamp);
     Sample_Destructor((Sample*)sample);
 }
 
 
-static rmtBool AreCUDASamplesReady(Sample* sample)
+RMT_API void _rmt_BindD3D11(void* device, void* context)
 {
-    rmtError error;
-    Sample* child;
+    if (g_Remotery != NULL)
+    {
+        assert(g_Remotery->d3d11 != NULL);
 
-    CUDASample* cuda_sample = (CUDASample*)sample;
-    assert(sample->type == SampleType_CUDA);
+        assert(device != NULL);
+        g_Remotery->d3d11->device = (ID3D11Device*)device;
+        assert(context != NULL);
+        g_Remotery->d3d11->context = (ID3D11DeviceContext*)context;
+    }
+}
 
-    // Check to see if both of the CUDA events have been processed
-    error = CUDAEventQuery(cuda_sample->event_start);
-    if (error != RMT_ERROR_NONE)
-        return RMT_FALSE;
-    error = CUDAEventQuery(cuda_sample->event_end);
-    if (error != RMT_ERROR_NONE)
-        return RMT_FALSE;
 
-    // Check child sample events
-    for (child = sample->first_child; child != NULL; child = child->next_sibling)
+static void UpdateD3D11Frame(void);
+
+
+RMT_API void _rmt_UnbindD3D11(void)
+{
+    if (g_Remotery != NULL)
     {
-        if (!AreCUDASamplesReady(child))
-            return RMT_FALSE;
+        D3D11* d3d11 = g_Remotery->d3d11;
+        assert(d3d11 != NULL);
+
+        // Stall waiting for the D3D queue to empty into the Remotery queue
+        while (!rmtMessageQueue_IsEmpty(d3d11->mq_to_d3d11_main))
+            UpdateD3D11Frame();
+
+        // Inform sampler to not add any more samples
+        d3d11->device = NULL;
+        d3d11->context = NULL;
+
+        // Forcefully delete sample tree on this thread to release time stamps from
+        // the same thread that created them
+        Remotery_BlockingDeleteSampleTree(g_Remotery, SampleType_D3D11);
     }
+}
 
-    return RMT_TRUE;
+
+RMT_API void _rmt_BeginD3D11Sample(rmtPStr name, rmtU32* hash_cache)
+{
+    ThreadSampler* ts;
+    D3D11* d3d11;
+
+    if (g_Remotery == NULL)
+        return;
+
+    // Has D3D11 been unbound?
+    d3d11 = g_Remotery->d3d11;
+    assert(d3d11 != NULL);
+    if (d3d11->device == NULL || d3d11->context == NULL)
+        return;
+
+    if (Remotery_GetThreadSampler(g_Remotery, &ts) == RMT_ERROR_NONE)
+    {
+        Sample* sample;
+        rmtU32 name_hash = ThreadSampler_GetNameHash(ts, name, hash_cache);
+
+        // Create the D3D11 tree on-demand as the tree needs an up-front-created root.
+        // This is not possible to create on initialisation as a D3D11 binding is not yet available.
+        SampleTree** d3d_tree = &ts->sample_trees[SampleType_D3D11];
+        if (*d3d_tree == NULL)
+        {
+            rmtError error;
+            New_3(SampleTree, *d3d_tree, sizeof(D3D11Sample), (ObjConstructor)D3D11Sample_Constructor, (ObjDestructor)D3D11Sample_Destructor);
+            if (error != RMT_ERROR_NONE)
+                return;
+        }
+
+        // Push the sample and activate the timestamp
+        if (ThreadSampler_Push(*d3d_tree, name_hash, 0, &sample) == RMT_ERROR_NONE)
+        {
+            D3D11Sample* d3d_sample = (D3D11Sample*)sample;
+            D3D11Timestamp_Begin(d3d_sample->timestamp, d3d11->context);
+        }
+    }
 }
 
 
-static rmtBool GetCUDASampleTimes(Sample* root_sample, Sample* sample)
+static rmtBool GetD3D11SampleTimes(Sample* sample, rmtU64* out_first_timestamp, rmtU64* out_last_resync)
 {
     Sample* child;
 
-    CUDASample* cuda_root_sample = (CUDASample*)root_sample;
-    CUDASample* cuda_sample = (CUDASample*)sample;
-
-    float ms_start, ms_end;
+    D3D11Sample* d3d_sample = (D3D11Sample*)sample;
 
-    assert(root_sample != NULL);
     assert(sample != NULL);
+    if (d3d_sample->timestamp != NULL)
+    {
+        HRESULT result;
 
-    // Get millisecond timing of each sample event, relative to initial root sample
-    if (CUDAEventElapsedTime(&ms_start, cuda_root_sample->event_start, cuda_sample->event_start) != RMT_ERROR_NONE)
-        return RMT_FALSE;
-    if (CUDAEventElapsedTime(&ms_end, cuda_root_sample->event_start, cuda_sample->event_end) != RMT_ERROR_NONE)
-        return RMT_FALSE;
+        D3D11* d3d11 = g_Remotery->d3d11;
+        assert(d3d11 != NULL);
+
+        assert(out_last_resync != NULL);
+
+        #if (RMT_GPU_CPU_SYNC_SECONDS > 0)
+            if (*out_last_resync < d3d_sample->timestamp->cpu_timestamp)
+            {
+                //Convert from us to seconds.
+                rmtU64 time_diff = (d3d_sample->timestamp->cpu_timestamp - *out_last_resync) / 1000000000ULL;
+                if (time_diff > RMT_GPU_CPU_SYNC_SECONDS)
+                {
+                    result = SyncD3D11CpuGpuTimes(out_first_timestamp, out_last_resync);
+                    if (result != S_OK)
+                    {
+                        d3d11->last_error = result;
+                        return RMT_FALSE;
+                    }
+                }
+            }
+        #endif
+
+        result = D3D11Timestamp_GetData(
+            d3d_sample->timestamp,
+            d3d11->context,
+            &sample->ns_start,
+            &sample->ns_end,
+            out_first_timestamp,
+            out_last_resync);
+
+        if (result != S_OK)
+        {
+            d3d11->last_error = result;
+            return RMT_FALSE;
+        }
 
-    // Convert to microseconds and add to the sample
-    sample->us_start = (rmtU64)(ms_start * 1000);
-    sample->us_end = (rmtU64)(ms_end * 1000);
-    sample->us_length = sample->us_end - sample->us_start;
+        sample->ns_length = sample->ns_end - sample->ns_start;
+    }
 
     // Get child sample times
     for (child = sample->first_child; child != NULL; child = child->next_sibling)
     {
-        if (!GetCUDASampleTimes(root_sample, child))
+        if (!GetD3D11SampleTimes(child, out_first_timestamp, out_last_resync))
             return RMT_FALSE;
     }
 
@@ -5565,459 +7670,436 @@ static rmtBool GetCUDASampleTimes(Sample* root_sample, Sample* sample)
 }
 
 
-RMT_API void _rmt_BindCUDA(const rmtCUDABind* bind)
-{
-    assert(bind != NULL);
-    if (g_Remotery != NULL)
-        g_Remotery->cuda = *bind;
-}
-
-
-RMT_API void _rmt_BeginCUDASample(rmtPStr name, rmtU32* hash_cache, void* stream)
+static void UpdateD3D11Frame(void)
 {
-    ThreadSampler* ts;
+    D3D11* d3d11;
 
     if (g_Remotery == NULL)
         return;
 
-    if (Remotery_GetThreadSampler(g_Remotery, &ts) == RMT_ERROR_NONE)
+    d3d11 = g_Remotery->d3d11;
+    assert(d3d11 != NULL);
+
+    rmt_BeginCPUSample(rmt_UpdateD3D11Frame, 0);
+
+    // Process all messages in the D3D queue
+    for (;;)
     {
-        rmtError error;
+        Msg_SampleTree* sample_tree;
         Sample* sample;
-        rmtU32 name_hash = ThreadSampler_GetNameHash(ts, name, hash_cache);
 
-        // Create the CUDA tree on-demand as the tree needs an up-front-created root.
-        // This is not possible to create on initialisation as a CUDA binding is not yet available.
-        SampleTree** cuda_tree = &ts->sample_trees[SampleType_CUDA];
-        if (*cuda_tree == NULL)
-        {
-            CUDASample* root_sample;
+        Message* message = rmtMessageQueue_PeekNextMessage(d3d11->mq_to_d3d11_main);
+        if (message == NULL)
+            break;
 
-            New_3(SampleTree, *cuda_tree, sizeof(CUDASample), (ObjConstructor)CUDASample_Constructor, (ObjDestructor)CUDASample_Destructor);
-            if (error != RMT_ERROR_NONE)
-                return;
+        // There's only one valid message type in this queue
+        assert(message->id == MsgID_SampleTree);
+        sample_tree = (Msg_SampleTree*)message->payload;
+        sample = sample_tree->root_sample;
+        assert(sample->type == SampleType_D3D11);
 
-            // Record an event once on the root sample, used to measure absolute sample
-            // times since this point
-            root_sample = (CUDASample*)(*cuda_tree)->root;
-            error = CUDAEventRecord(root_sample->event_start, stream);
-            if (error != RMT_ERROR_NONE)
-                return;
-        }
+        // Retrieve timing of all D3D11 samples
+        // If they aren't ready leave the message unconsumed, holding up later frames and maintaining order
+        if (!GetD3D11SampleTimes(sample, &d3d11->first_timestamp, &d3d11->last_resync))
+            break;
 
-        // Push the same and record its event
-        if (ThreadSampler_Push(*cuda_tree, name_hash, 0, &sample) == RMT_ERROR_NONE)
-        {
-            CUDASample* cuda_sample = (CUDASample*)sample;
-            CUDAEventRecord(cuda_sample->event_start, stream);
-        }
+        // Pass samples onto the remotery thread for sending to the viewer
+        AddSampleTreeMessage(g_Remotery->mq_to_rmt_thread, sample, sample_tree->allocator, sample_tree->thread_name, message->thread_sampler);
+        rmtMessageQueue_ConsumeNextMessage(d3d11->mq_to_d3d11_main, message);
     }
+
+    rmt_EndCPUSample();
 }
 
 
-RMT_API void _rmt_EndCUDASample(void* stream)
+RMT_API void _rmt_EndD3D11Sample(void)
 {
     ThreadSampler* ts;
+    D3D11* d3d11;
 
     if (g_Remotery == NULL)
         return;
 
+    // Has D3D11 been unbound?
+    d3d11 = g_Remotery->d3d11;
+    assert(d3d11 != NULL);
+    if (d3d11->device == NULL || d3d11->context == NULL)
+        return;
+
     if (Remotery_GetThreadSampler(g_Remotery, &ts) == RMT_ERROR_NONE)
     {
-        CUDASample* sample = (CUDASample*)ts->sample_trees[SampleType_CUDA]->current_parent;
-        if (sample->base.recurse_depth > 0)
+        // Close the timestamp
+        D3D11Sample* d3d_sample = (D3D11Sample*)ts->sample_trees[SampleType_D3D11]->current_parent;
+        if (d3d_sample->base.recurse_depth > 0)
         {
-            sample->base.recurse_depth--;
+            d3d_sample->base.recurse_depth--;
         }
         else
         {
-            CUDAEventRecord(sample->event_end, stream);
-            ThreadSampler_Pop(ts, g_Remotery->mq_to_rmt_thread, (Sample*)sample);
+            if (d3d_sample->timestamp != NULL)
+                D3D11Timestamp_End(d3d_sample->timestamp, d3d11->context);
+
+            // Send to the update loop for ready-polling
+            if (ThreadSampler_Pop(ts, d3d11->mq_to_d3d11_main, (Sample*)d3d_sample))
+                // Perform ready-polling on popping of the root sample
+                UpdateD3D11Frame();
         }
     }
 }
 
 
-#endif  // RMT_USE_CUDA
+#endif  // RMT_USE_D3D11
 
 
 
 /*
 ------------------------------------------------------------------------------------------------------------------------
 ------------------------------------------------------------------------------------------------------------------------
-   @D3D11: Direct3D 11 event sampling
+@OpenGL: OpenGL event sampling
 ------------------------------------------------------------------------------------------------------------------------
 ------------------------------------------------------------------------------------------------------------------------
 */
 
 
 
-#if RMT_USE_D3D11
-
+#if RMT_USE_OPENGL
 
-// As clReflect has no way of disabling C++ compile mode, this forces C interfaces everywhere...
-#define CINTERFACE
 
-// ...unfortunately these C++ helpers aren't wrapped by the same macro but they can be disabled individually
-#define D3D11_NO_HELPERS
+#ifndef APIENTRY
+#  if defined(__MINGW32__) || defined(__CYGWIN__)
+#    define APIENTRY __stdcall
+#  elif (defined(_MSC_VER) && (_MSC_VER >= 800)) || defined(_STDCALL_SUPPORTED) || defined(__BORLANDC__)
+#    define APIENTRY __stdcall
+#  else
+#    define APIENTRY
+#  endif
+#endif
 
-// Allow use of the D3D11 helper macros for accessing the C-style vtable
-#define COBJMACROS
+#ifndef GLAPI
+#  if defined(__MINGW32__) || defined(__CYGWIN__)
+#    define GLAPI extern
+#  elif defined (_WIN32)
+#    define GLAPI WINGDIAPI
+#  else
+#    define GLAPI extern
+#  endif
+#endif
 
-#ifdef _MSC_VER
-    // Disable for d3d11.h
-    // warning C4201: nonstandard extension used : nameless struct/union
-    #pragma warning(push)
-    #pragma warning(disable: 4201)
+#ifndef GLAPIENTRY
+#define GLAPIENTRY APIENTRY
 #endif
 
-#include <d3d11.h>
+typedef rmtU32 GLenum;
+typedef rmtU32 GLuint;
+typedef rmtS32 GLint;
+typedef rmtS32 GLsizei;
+typedef rmtU64 GLuint64;
+typedef rmtS64 GLint64;
+typedef unsigned char GLubyte;
 
-#ifdef _MSC_VER
-    #pragma warning(pop)
-#endif
+typedef GLenum (GLAPIENTRY * PFNGLGETERRORPROC) (void);
+typedef void (GLAPIENTRY * PFNGLGENQUERIESPROC) (GLsizei n, GLuint* ids);
+typedef void (GLAPIENTRY * PFNGLDELETEQUERIESPROC) (GLsizei n, const GLuint* ids);
+typedef void (GLAPIENTRY * PFNGLBEGINQUERYPROC) (GLenum target, GLuint id);
+typedef void (GLAPIENTRY * PFNGLENDQUERYPROC) (GLenum target);
+typedef void (GLAPIENTRY * PFNGLGETQUERYOBJECTIVPROC) (GLuint id, GLenum pname, GLint* params);
+typedef void (GLAPIENTRY * PFNGLGETQUERYOBJECTUIVPROC) (GLuint id, GLenum pname, GLuint* params);
+typedef void (GLAPIENTRY * PFNGLGETQUERYOBJECTI64VPROC) (GLuint id, GLenum pname, GLint64* params);
+typedef void (GLAPIENTRY * PFNGLGETQUERYOBJECTUI64VPROC) (GLuint id, GLenum pname, GLuint64* params);
+typedef void (GLAPIENTRY * PFNGLQUERYCOUNTERPROC) (GLuint id, GLenum target);
+typedef void (GLAPIENTRY * PFNGLGETINTEGER64VPROC) (GLenum pname, GLint64 *data);
+typedef void (GLAPIENTRY * PFNGLFINISHPROC) (void);
 
+#define GL_NO_ERROR 0
+#define GL_QUERY_RESULT 0x8866
+#define GL_QUERY_RESULT_AVAILABLE 0x8867
+#define GL_TIME_ELAPSED 0x88BF
+#define GL_TIMESTAMP 0x8E28
 
-typedef struct D3D11
+#define RMT_GL_GET_FUN(x) assert(g_Remotery->opengl->x != NULL); g_Remotery->opengl->x
+
+#define rmtglGenQueries RMT_GL_GET_FUN(__glGenQueries)
+#define rmtglDeleteQueries RMT_GL_GET_FUN(__glDeleteQueries)
+#define rmtglBeginQuery RMT_GL_GET_FUN(__glBeginQuery)
+#define rmtglEndQuery RMT_GL_GET_FUN(__glEndQuery)
+#define rmtglGetQueryObjectiv RMT_GL_GET_FUN(__glGetQueryObjectiv)
+#define rmtglGetQueryObjectuiv RMT_GL_GET_FUN(__glGetQueryObjectuiv)
+#define rmtglGetQueryObjecti64v RMT_GL_GET_FUN(__glGetQueryObjecti64v)
+#define rmtglGetQueryObjectui64v RMT_GL_GET_FUN(__glGetQueryObjectui64v)
+#define rmtglQueryCounter RMT_GL_GET_FUN(__glQueryCounter)
+#define rmtglGetInteger64v RMT_GL_GET_FUN(__glGetInteger64v)
+#define rmtglFinish RMT_GL_GET_FUN(__glFinish)
+
+
+struct OpenGL_t
 {
-    // Context set by user
-    ID3D11Device* device;
-    ID3D11DeviceContext* context;
+    // Handle to the OS OpenGL DLL
+    void* dll_handle;
 
-    HRESULT last_error;
+    PFNGLGETERRORPROC __glGetError;
+    PFNGLGENQUERIESPROC __glGenQueries;
+    PFNGLDELETEQUERIESPROC __glDeleteQueries;
+    PFNGLBEGINQUERYPROC __glBeginQuery;
+    PFNGLENDQUERYPROC __glEndQuery;
+    PFNGLGETQUERYOBJECTIVPROC __glGetQueryObjectiv;
+    PFNGLGETQUERYOBJECTUIVPROC __glGetQueryObjectuiv;
+    PFNGLGETQUERYOBJECTI64VPROC __glGetQueryObjecti64v;
+    PFNGLGETQUERYOBJECTUI64VPROC __glGetQueryObjectui64v;
+    PFNGLQUERYCOUNTERPROC __glQueryCounter;
+    PFNGLGETINTEGER64VPROC __glGetInteger64v;
+    PFNGLFINISHPROC __glFinish;
 
-    // Queue to the D3D 11 main update thread
+    // Queue to the OpenGL main update thread
     // Given that BeginSample/EndSample need to be called from the same thread that does the update, there
     // is really no need for this to be a thread-safe queue. I'm using it for its convenience.
-    rmtMessageQueue* mq_to_d3d11_main;
+    rmtMessageQueue* mq_to_opengl_main;
 
     // Mark the first time so that remaining timestamps are offset from this
     rmtU64 first_timestamp;
-    // Last time in us (CPU time, via usTimer_Get) since we last resync'ed CPU & GPU
+    // Last time in ns (CPU time, via nsTimer_Get) since we last resync'ed CPU & GPU
     rmtU64 last_resync;
-} D3D11;
+};
 
 
-static rmtError D3D11_Create(D3D11** d3d11)
+static GLenum rmtglGetError(void)
 {
-    rmtError error;
-
-    assert(d3d11 != NULL);
-
-    // Allocate space for the D3D11 data
-    *d3d11 = (D3D11*)rmtMalloc(sizeof(D3D11));
-    if (*d3d11 == NULL)
-        return RMT_ERROR_MALLOC_FAIL;
-
-    // Set defaults
-    (*d3d11)->device = NULL;
-    (*d3d11)->context = NULL;
-    (*d3d11)->last_error = S_OK;
-    (*d3d11)->mq_to_d3d11_main = NULL;
-    (*d3d11)->first_timestamp = 0;
-    (*d3d11)->last_resync = 0;
-
-    New_1(rmtMessageQueue, (*d3d11)->mq_to_d3d11_main, g_Settings.messageQueueSizeInBytes);
-    if (error != RMT_ERROR_NONE)
+    if (g_Remotery != NULL)
     {
-        Delete(D3D11, *d3d11);
-        return error;
+        assert(g_Remotery->opengl != NULL);
+        if (g_Remotery->opengl->__glGetError != NULL)
+            return g_Remotery->opengl->__glGetError();
     }
 
-    return RMT_ERROR_NONE;
+    return (GLenum)0;
 }
 
 
-static void D3D11_Destructor(D3D11* d3d11)
-{
-    assert(d3d11 != NULL);
-    Delete(rmtMessageQueue, d3d11->mq_to_d3d11_main);
-}
-
-static HRESULT rmtD3D11Finish(rmtU64 *out_timestamp, double *out_frequency)
+static ProcReturnType rmtglGetProcAddress(OpenGL* opengl, const char* symbol)
 {
-    HRESULT result;
-    ID3D11Device* device = g_Remotery->d3d11->device;
-    ID3D11DeviceContext* context = g_Remotery->d3d11->context;
-    ID3D11Query* full_stall_fence;
-    ID3D11Query* query_disjoint;
-    D3D11_QUERY_DESC query_desc;
-    D3D11_QUERY_DESC disjoint_desc;
-    UINT64 timestamp;
-    D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint;
-
-    query_desc.Query = D3D11_QUERY_TIMESTAMP;
-    query_desc.MiscFlags = 0;
-    result = ID3D11Device_CreateQuery(device, &query_desc, &full_stall_fence);
-    if (result != S_OK)
-        return result;
-
-    disjoint_desc.Query = D3D11_QUERY_TIMESTAMP_DISJOINT;
-    disjoint_desc.MiscFlags = 0;
-    result = ID3D11Device_CreateQuery(device, &disjoint_desc, &query_disjoint);
-    if (result != S_OK)
+    #if defined(RMT_PLATFORM_WINDOWS)
     {
-        ID3D11Query_Release(full_stall_fence);
-        return result;
+        // Get OpenGL extension-loading function for each call
+        typedef ProcReturnType (WINAPI * wglGetProcAddressFn)(LPCSTR);
+        assert(opengl != NULL);
+        {
+            wglGetProcAddressFn wglGetProcAddress = (wglGetProcAddressFn)rmtGetProcAddress(opengl->dll_handle, "wglGetProcAddress");
+            if (wglGetProcAddress != NULL)
+                return wglGetProcAddress(symbol);
+        }
     }
 
-    ID3D11DeviceContext_Begin(context, (ID3D11Asynchronous*)query_disjoint);
-    ID3D11DeviceContext_End(context, (ID3D11Asynchronous*)full_stall_fence);
-    ID3D11DeviceContext_End(context, (ID3D11Asynchronous*)query_disjoint);
+    #elif defined(RMT_PLATFORM_MACOS) && !defined(GLEW_APPLE_GLX)
 
-    result = S_FALSE;
+        return rmtGetProcAddress(opengl->dll_handle, symbol);
 
-    while( result == S_FALSE )
+    #elif defined(RMT_PLATFORM_LINUX)
     {
-        result = ID3D11DeviceContext_GetData(context, (ID3D11Asynchronous*)query_disjoint, &disjoint, sizeof(disjoint), 0);
-        if (result != S_OK && result != S_FALSE)
-        {
-            ID3D11Query_Release(full_stall_fence);
-            ID3D11Query_Release(query_disjoint);
-            return result;
-        }
-        if( result == S_OK )
+        // Get GLX extension-loading function from libGL so that Remotery isn't left with an undefined symbol
+        typedef ProcReturnType (*glXGetProcAddressARBFn)(const GLubyte*);
+        assert(opengl != NULL);
         {
-            result = ID3D11DeviceContext_GetData(context, (ID3D11Asynchronous*)full_stall_fence, &timestamp, sizeof(timestamp), 0);
-            if (result != S_OK && result != S_FALSE)
-            {
-                ID3D11Query_Release(full_stall_fence);
-                ID3D11Query_Release(query_disjoint);
-                return result;
-            }
+            glXGetProcAddressARBFn glXGetProcAddressARB = (glXGetProcAddressARBFn)rmtGetProcAddress(opengl->dll_handle, "glXGetProcAddressARB");
+            if (glXGetProcAddressARB != NULL)
+                return glXGetProcAddressARB((const GLubyte*)symbol);
         }
-        //Give HyperThreading threads a breath on this spinlock.
-        YieldProcessor();
     }
 
-    if (disjoint.Disjoint == FALSE)
-    {
-        double frequency = disjoint.Frequency / 1000000.0;
-        *out_timestamp = timestamp;
-        *out_frequency = frequency;
-    }
-    else
-    {
-        result = S_FALSE;
-    }
+    #endif
+
+    return NULL;
+}
+
+
+static rmtError OpenGL_Create(OpenGL** opengl)
+{
+    rmtError error;
+
+    assert(opengl != NULL);
+
+    *opengl = (OpenGL*)rmtMalloc(sizeof(OpenGL));
+    if (*opengl == NULL)
+        return RMT_ERROR_MALLOC_FAIL;
+
+    (*opengl)->dll_handle = NULL;
+
+    (*opengl)->__glGetError = NULL;
+    (*opengl)->__glGenQueries = NULL;
+    (*opengl)->__glDeleteQueries = NULL;
+    (*opengl)->__glBeginQuery = NULL;
+    (*opengl)->__glEndQuery = NULL;
+    (*opengl)->__glGetQueryObjectiv = NULL;
+    (*opengl)->__glGetQueryObjectuiv = NULL;
+    (*opengl)->__glGetQueryObjecti64v = NULL;
+    (*opengl)->__glGetQueryObjectui64v = NULL;
+    (*opengl)->__glQueryCounter = NULL;
+    (*opengl)->__glGetInteger64v = NULL;
+    (*opengl)->__glFinish = NULL;
+
+    (*opengl)->mq_to_opengl_main = NULL;
+    (*opengl)->first_timestamp = 0;
+    (*opengl)->last_resync = 0;
 
-    ID3D11Query_Release(full_stall_fence);
-    ID3D11Query_Release(query_disjoint);
-    return result;
+    New_1(rmtMessageQueue, (*opengl)->mq_to_opengl_main, g_Settings.messageQueueSizeInBytes);
+    return error;
 }
 
-static HRESULT SyncD3D11CpuGpuTimes(rmtU64* out_first_timestamp, rmtU64* out_last_resync)
+
+static void OpenGL_Destructor(OpenGL* opengl)
+{
+    assert(opengl != NULL);
+    Delete(rmtMessageQueue, opengl->mq_to_opengl_main);
+}
+
+static void SyncOpenGLCpuGpuTimes(rmtU64* out_first_timestamp, rmtU64* out_last_resync)
 {
     rmtU64 cpu_time_start = 0;
     rmtU64 cpu_time_stop = 0;
     rmtU64 average_half_RTT = 0; //RTT = Rountrip Time.
-    UINT64 gpu_base = 0;
-    double frequency = 1;
+    GLint64 gpu_base = 0;
     int i;
 
-    HRESULT result;
-    result = rmtD3D11Finish(&gpu_base, &frequency);
-    if (result != S_OK && result != S_FALSE)
-        return result;
+    rmtglFinish();
 
     for (i=0; i<RMT_GPU_CPU_SYNC_NUM_ITERATIONS; ++i)
     {
         rmtU64 half_RTT;
-        cpu_time_start = usTimer_Get(&g_Remotery->timer);
-        result = rmtD3D11Finish(&gpu_base, &frequency);
-        cpu_time_stop = usTimer_Get(&g_Remotery->timer);
 
-        if (result != S_OK && result != S_FALSE)
-            return result;
-
-        //Ignore attempts where there was a disjoint, since there would
-        //be a lot of noise in those readings for measuring the RTT
-        if (result == S_OK)
-        {
-            //Average the time it takes a roundtrip from CPU to GPU
-            //while doing nothing other than getting timestamps
-            half_RTT = (cpu_time_stop - cpu_time_start) >> 1ULL;
-            if( i == 0 )
-                average_half_RTT = half_RTT;
-            else
-                average_half_RTT = (average_half_RTT + half_RTT) >> 1ULL;
-        }
+        rmtglFinish();
+        cpu_time_start = nsTimer_Get(&g_Remotery->timer);
+        rmtglGetInteger64v(GL_TIMESTAMP, &gpu_base);
+        cpu_time_stop = nsTimer_Get(&g_Remotery->timer);
+        //Average the time it takes a roundtrip from CPU to GPU
+        //while doing nothing other than getting timestamps
+        half_RTT = (cpu_time_stop - cpu_time_start) >> 1ULL;
+        if( i == 0 )
+            average_half_RTT = half_RTT;
+        else
+            average_half_RTT = (average_half_RTT + half_RTT) >> 1ULL;
     }
 
     // All GPU times are offset from gpu_base, and then taken to
     // the same relative origin CPU timestamps are based on.
     // CPU is in us, we must translate it to ns.
-    *out_first_timestamp = gpu_base - (rmtU64)((cpu_time_start + average_half_RTT) * frequency);
+    *out_first_timestamp = (rmtU64)(gpu_base) - (cpu_time_start + average_half_RTT);
     *out_last_resync = cpu_time_stop;
-
-    return result;
 }
 
-typedef struct D3D11Timestamp
+
+typedef struct OpenGLTimestamp
 {
     // Inherit so that timestamps can be quickly allocated
     ObjectLink Link;
 
     // Pair of timestamp queries that wrap the sample
-    ID3D11Query* query_start;
-    ID3D11Query* query_end;
-
-    // A disjoint to measure frequency/stability
-    // TODO: Does *each* sample need one of these?
-    ID3D11Query* query_disjoint;
-
+    GLuint queries[2];
     rmtU64 cpu_timestamp;
-} D3D11Timestamp;
+} OpenGLTimestamp;
 
 
-static rmtError D3D11Timestamp_Constructor(D3D11Timestamp* stamp)
+static rmtError OpenGLTimestamp_Constructor(OpenGLTimestamp* stamp)
 {
-    D3D11_QUERY_DESC timestamp_desc;
-    D3D11_QUERY_DESC disjoint_desc;
-    ID3D11Device* device;
-    HRESULT* last_error;
+    GLenum error;
 
     assert(stamp != NULL);
 
     ObjectLink_Constructor((ObjectLink*)stamp);
 
     // Set defaults
-    stamp->query_start = NULL;
-    stamp->query_end = NULL;
-    stamp->query_disjoint = NULL;
+    stamp->queries[0] = stamp->queries[1] = 0;
     stamp->cpu_timestamp = 0;
 
-    assert(g_Remotery != NULL);
-    assert(g_Remotery->d3d11 != NULL);
-    device = g_Remotery->d3d11->device;
-    last_error = &g_Remotery->d3d11->last_error;
+    // Empty the error queue before using it for glGenQueries
+    while ((error = rmtglGetError()) != GL_NO_ERROR)
+        ;
 
     // Create start/end timestamp queries
-    timestamp_desc.Query = D3D11_QUERY_TIMESTAMP;
-    timestamp_desc.MiscFlags = 0;
-    *last_error = ID3D11Device_CreateQuery(device, &timestamp_desc, &stamp->query_start);
-    if (*last_error != S_OK)
-        return RMT_ERROR_D3D11_FAILED_TO_CREATE_QUERY;
-    *last_error = ID3D11Device_CreateQuery(device, &timestamp_desc, &stamp->query_end);
-    if (*last_error != S_OK)
-        return RMT_ERROR_D3D11_FAILED_TO_CREATE_QUERY;
-
-    // Create disjoint query
-    disjoint_desc.Query = D3D11_QUERY_TIMESTAMP_DISJOINT;
-    disjoint_desc.MiscFlags = 0;
-    *last_error = ID3D11Device_CreateQuery(device, &disjoint_desc, &stamp->query_disjoint);
-    if (*last_error != S_OK)
-        return RMT_ERROR_D3D11_FAILED_TO_CREATE_QUERY;
+    assert(g_Remotery != NULL);
+    rmtglGenQueries(2, stamp->queries);
+    error = rmtglGetError();
+    if (error != GL_NO_ERROR)
+        return RMT_ERROR_OPENGL_ERROR;
 
     return RMT_ERROR_NONE;
 }
 
 
-static void D3D11Timestamp_Destructor(D3D11Timestamp* stamp)
+static void OpenGLTimestamp_Destructor(OpenGLTimestamp* stamp)
 {
     assert(stamp != NULL);
 
     // Destroy queries
-    if (stamp->query_disjoint != NULL)
-        ID3D11Query_Release(stamp->query_disjoint);
-    if (stamp->query_end != NULL)
-        ID3D11Query_Release(stamp->query_end);
-    if (stamp->query_start != NULL)
-        ID3D11Query_Release(stamp->query_start);
+    if (stamp->queries[0] != 0)
+        rmtglDeleteQueries(2, stamp->queries);
 }
 
 
-static void D3D11Timestamp_Begin(D3D11Timestamp* stamp, ID3D11DeviceContext* context)
+static void OpenGLTimestamp_Begin(OpenGLTimestamp* stamp)
 {
     assert(stamp != NULL);
 
-    // Start of disjoint and first query
-    stamp->cpu_timestamp = usTimer_Get(&g_Remotery->timer);
-    ID3D11DeviceContext_Begin(context, (ID3D11Asynchronous*)stamp->query_disjoint);
-    ID3D11DeviceContext_End(context, (ID3D11Asynchronous*)stamp->query_start);
+    // First query
+    assert(g_Remotery != NULL);
+    stamp->cpu_timestamp = nsTimer_Get(&g_Remotery->timer);
+    rmtglQueryCounter(stamp->queries[0], GL_TIMESTAMP);
 }
 
 
-static void D3D11Timestamp_End(D3D11Timestamp* stamp, ID3D11DeviceContext* context)
+static void OpenGLTimestamp_End(OpenGLTimestamp* stamp)
 {
     assert(stamp != NULL);
 
-    // End of disjoint and second query
-    ID3D11DeviceContext_End(context, (ID3D11Asynchronous*)stamp->query_end);
-    ID3D11DeviceContext_End(context, (ID3D11Asynchronous*)stamp->query_disjoint);
+    // Second query
+    assert(g_Remotery != NULL);
+    rmtglQueryCounter(stamp->queries[1], GL_TIMESTAMP);
 }
 
-
-static HRESULT D3D11Timestamp_GetData(D3D11Timestamp* stamp, ID3D11DeviceContext* context, rmtU64* out_start, rmtU64* out_end, rmtU64* out_first_timestamp, rmtU64* out_last_resync)
+static rmtBool OpenGLTimestamp_GetData(OpenGLTimestamp* stamp, rmtU64* out_start, rmtU64* out_end, rmtU64* out_first_timestamp, rmtU64* out_last_resync)
 {
-    ID3D11Asynchronous* query_start;
-    ID3D11Asynchronous* query_end;
-    ID3D11Asynchronous* query_disjoint;
-    HRESULT result;
+    GLuint64 start = 0, end = 0;
+    GLint startAvailable = 0, endAvailable = 0;
 
-    UINT64 start;
-    UINT64 end;
-    D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint;
+    assert(g_Remotery != NULL);
 
     assert(stamp != NULL);
-    query_start = (ID3D11Asynchronous*)stamp->query_start;
-    query_end = (ID3D11Asynchronous*)stamp->query_end;
-    query_disjoint = (ID3D11Asynchronous*)stamp->query_disjoint;
+    assert(stamp->queries[0] != 0 && stamp->queries[1] != 0);
 
     // Check to see if all queries are ready
     // If any fail to arrive, wait until later
-    result = ID3D11DeviceContext_GetData(context, query_start, &start, sizeof(start), D3D11_ASYNC_GETDATA_DONOTFLUSH);
-    if (result != S_OK)
-        return result;
-    result = ID3D11DeviceContext_GetData(context, query_end, &end, sizeof(end), D3D11_ASYNC_GETDATA_DONOTFLUSH);
-    if (result != S_OK)
-        return result;
-    result = ID3D11DeviceContext_GetData(context, query_disjoint, &disjoint, sizeof(disjoint), D3D11_ASYNC_GETDATA_DONOTFLUSH);
-    if (result != S_OK)
-        return result;
+    rmtglGetQueryObjectiv(stamp->queries[0], GL_QUERY_RESULT_AVAILABLE, &startAvailable);
+    if (!startAvailable)
+        return RMT_FALSE;
+    rmtglGetQueryObjectiv(stamp->queries[1], GL_QUERY_RESULT_AVAILABLE, &endAvailable);
+    if (!endAvailable)
+        return RMT_FALSE;
 
-    if (disjoint.Disjoint == FALSE)
-    {
-        double frequency = disjoint.Frequency / 1000000.0;
+    rmtglGetQueryObjectui64v(stamp->queries[0], GL_QUERY_RESULT, &start);
+    rmtglGetQueryObjectui64v(stamp->queries[1], GL_QUERY_RESULT, &end);
 
-        // Mark the first timestamp. We may resync if we detect the GPU timestamp is in the
-        // past (i.e. happened before the CPU command) since it should be impossible.
-        assert(out_first_timestamp != NULL);
-        if (*out_first_timestamp == 0 || ((start - *out_first_timestamp) / frequency) < stamp->cpu_timestamp)
-        {
-            result = SyncD3D11CpuGpuTimes(out_first_timestamp, out_last_resync);
-            if (result != S_OK)
-                return result;
-        }
+    // Mark the first timestamp. We may resync if we detect the GPU timestamp is in the
+    // past (i.e. happened before the CPU command) since it should be impossible.
+    assert(out_first_timestamp != NULL);
+    if (*out_first_timestamp == 0 || (start - *out_first_timestamp) < stamp->cpu_timestamp)
+        SyncOpenGLCpuGpuTimes(out_first_timestamp, out_last_resync);
 
-        // Calculate start and end timestamps from the disjoint info
-        *out_start = (rmtU64)((start - *out_first_timestamp) / frequency);
-        *out_end = (rmtU64)((end - *out_first_timestamp) / frequency);
-    }
-    else
-    {
-#if RMT_D3D11_RESYNC_ON_DISJOINT
-        result = SyncD3D11CpuGpuTimes(out_first_timestamp, out_last_resync);
-        if (result != S_OK)
-            return result;
-#endif
-    }
+    // Calculate start and end timestamps (we want us, the queries give us ns)
+    *out_start = (rmtU64)(start - *out_first_timestamp);
+    *out_end = (rmtU64)(end - *out_first_timestamp);
 
-    return S_OK;
+    return RMT_TRUE;
 }
 
 
-typedef struct D3D11Sample
+typedef struct OpenGLSample
 {
     // IS-A inheritance relationship
     Sample base;
 
-    D3D11Timestamp* timestamp;
+    OpenGLTimestamp* timestamp;
 
-} D3D11Sample;
+} OpenGLSample;
 
 
-static rmtError D3D11Sample_Constructor(D3D11Sample* sample)
+static rmtError OpenGLSample_Constructor(OpenGLSample* sample)
 {
     rmtError error;
 
@@ -6025,154 +8107,142 @@ static rmtError D3D11Sample_Constructor(D3D11Sample* sample)
 
     // Chain to sample constructor
     Sample_Constructor((Sample*)sample);
-    sample->base.type = SampleType_D3D11;
-    sample->base.size_bytes = sizeof(D3D11Sample);
-    New_0(D3D11Timestamp, sample->timestamp);
+    sample->base.type = SampleType_OpenGL;
+    sample->base.size_bytes = sizeof(OpenGLSample);
+    New_0(OpenGLTimestamp, sample->timestamp);
 
     return RMT_ERROR_NONE;
 }
 
 
-static void D3D11Sample_Destructor(D3D11Sample* sample)
+static void OpenGLSample_Destructor(OpenGLSample* sample)
 {
-    Delete(D3D11Timestamp, sample->timestamp);
+    Delete(OpenGLTimestamp, sample->timestamp);
     Sample_Destructor((Sample*)sample);
 }
 
-
-RMT_API void _rmt_BindD3D11(void* device, void* context)
+RMT_API void _rmt_BindOpenGL()
 {
     if (g_Remotery != NULL)
     {
-        assert(g_Remotery->d3d11 != NULL);
+        OpenGL* opengl = g_Remotery->opengl;
+        assert(opengl != NULL);
 
-        assert(device != NULL);
-        g_Remotery->d3d11->device = (ID3D11Device*)device;
-        assert(context != NULL);
-        g_Remotery->d3d11->context = (ID3D11DeviceContext*)context;
+        #if defined (RMT_PLATFORM_WINDOWS)
+            opengl->dll_handle = rmtLoadLibrary("opengl32.dll");
+        #elif defined (RMT_PLATFORM_MACOS)
+            opengl->dll_handle = rmtLoadLibrary("/System/Library/Frameworks/OpenGL.framework/Versions/Current/OpenGL");
+        #elif defined (RMT_PLATFORM_LINUX)
+            opengl->dll_handle = rmtLoadLibrary("libGL.so");
+        #endif
+
+        opengl->__glGetError = (PFNGLGETERRORPROC)rmtGetProcAddress(opengl->dll_handle, "glGetError");
+        opengl->__glGenQueries = (PFNGLGENQUERIESPROC)rmtglGetProcAddress(opengl, "glGenQueries");
+        opengl->__glDeleteQueries = (PFNGLDELETEQUERIESPROC)rmtglGetProcAddress(opengl, "glDeleteQueries");
+        opengl->__glBeginQuery = (PFNGLBEGINQUERYPROC)rmtglGetProcAddress(opengl, "glBeginQuery");
+        opengl->__glEndQuery = (PFNGLENDQUERYPROC)rmtglGetProcAddress(opengl, "glEndQuery");
+        opengl->__glGetQueryObjectiv = (PFNGLGETQUERYOBJECTIVPROC)rmtglGetProcAddress(opengl, "glGetQueryObjectiv");
+        opengl->__glGetQueryObjectuiv = (PFNGLGETQUERYOBJECTUIVPROC)rmtglGetProcAddress(opengl, "glGetQueryObjectuiv");
+        opengl->__glGetQueryObjecti64v = (PFNGLGETQUERYOBJECTI64VPROC)rmtglGetProcAddress(opengl, "glGetQueryObjecti64v");
+        opengl->__glGetQueryObjectui64v = (PFNGLGETQUERYOBJECTUI64VPROC)rmtglGetProcAddress(opengl, "glGetQueryObjectui64v");
+        opengl->__glQueryCounter = (PFNGLQUERYCOUNTERPROC)rmtglGetProcAddress(opengl, "glQueryCounter");
+        opengl->__glGetInteger64v = (PFNGLGETINTEGER64VPROC)rmtglGetProcAddress(opengl, "glGetInteger64v");
+        opengl->__glFinish = (PFNGLFINISHPROC)rmtGetProcAddress(opengl->dll_handle, "glFinish");
     }
 }
 
 
-static void UpdateD3D11Frame(void);
+static void UpdateOpenGLFrame(void);
 
 
-RMT_API void _rmt_UnbindD3D11(void)
+RMT_API void _rmt_UnbindOpenGL(void)
 {
     if (g_Remotery != NULL)
     {
-        D3D11* d3d11 = g_Remotery->d3d11;
-        assert(d3d11 != NULL);
-
-        // Stall waiting for the D3D queue to empty into the Remotery queue
-        while (!rmtMessageQueue_IsEmpty(d3d11->mq_to_d3d11_main))
-            UpdateD3D11Frame();
-
-        // Inform sampler to not add any more samples
-        d3d11->device = NULL;
-        d3d11->context = NULL;
+        OpenGL* opengl = g_Remotery->opengl;
+        assert(opengl != NULL);
+
+        // Stall waiting for the OpenGL queue to empty into the Remotery queue
+        while (!rmtMessageQueue_IsEmpty(opengl->mq_to_opengl_main))
+            UpdateOpenGLFrame();
 
         // Forcefully delete sample tree on this thread to release time stamps from
         // the same thread that created them
-        Remotery_BlockingDeleteSampleTree(g_Remotery, SampleType_D3D11);
+        Remotery_BlockingDeleteSampleTree(g_Remotery, SampleType_OpenGL);
+
+        // Release reference to the OpenGL DLL
+        if (opengl->dll_handle != NULL)
+        {
+            rmtFreeLibrary(opengl->dll_handle);
+            opengl->dll_handle = NULL;
+        }
     }
 }
 
 
-RMT_API void _rmt_BeginD3D11Sample(rmtPStr name, rmtU32* hash_cache)
+RMT_API void _rmt_BeginOpenGLSample(rmtPStr name, rmtU32* hash_cache)
 {
     ThreadSampler* ts;
-    D3D11* d3d11;
 
     if (g_Remotery == NULL)
         return;
 
-    // Has D3D11 been unbound?
-    d3d11 = g_Remotery->d3d11;
-    assert(d3d11 != NULL);
-    if (d3d11->device == NULL || d3d11->context == NULL)
-        return;
-
     if (Remotery_GetThreadSampler(g_Remotery, &ts) == RMT_ERROR_NONE)
     {
         Sample* sample;
         rmtU32 name_hash = ThreadSampler_GetNameHash(ts, name, hash_cache);
 
-        // Create the D3D11 tree on-demand as the tree needs an up-front-created root.
-        // This is not possible to create on initialisation as a D3D11 binding is not yet available.
-        SampleTree** d3d_tree = &ts->sample_trees[SampleType_D3D11];
-        if (*d3d_tree == NULL)
+        // Create the OpenGL tree on-demand as the tree needs an up-front-created root.
+        // This is not possible to create on initialisation as a OpenGL binding is not yet available.
+        SampleTree** ogl_tree = &ts->sample_trees[SampleType_OpenGL];
+        if (*ogl_tree == NULL)
         {
             rmtError error;
-            New_3(SampleTree, *d3d_tree, sizeof(D3D11Sample), (ObjConstructor)D3D11Sample_Constructor, (ObjDestructor)D3D11Sample_Destructor);
+            New_3(SampleTree, *ogl_tree, sizeof(OpenGLSample), (ObjConstructor)OpenGLSample_Constructor, (ObjDestructor)OpenGLSample_Destructor);
             if (error != RMT_ERROR_NONE)
                 return;
         }
 
         // Push the sample and activate the timestamp
-        if (ThreadSampler_Push(*d3d_tree, name_hash, 0, &sample) == RMT_ERROR_NONE)
+        if (ThreadSampler_Push(*ogl_tree, name_hash, 0, &sample) == RMT_ERROR_NONE)
         {
-            D3D11Sample* d3d_sample = (D3D11Sample*)sample;
-            D3D11Timestamp_Begin(d3d_sample->timestamp, d3d11->context);
+            OpenGLSample* ogl_sample = (OpenGLSample*)sample;
+            OpenGLTimestamp_Begin(ogl_sample->timestamp);
         }
     }
 }
 
 
-static rmtBool GetD3D11SampleTimes(Sample* sample, rmtU64* out_first_timestamp, rmtU64* out_last_resync)
+static rmtBool GetOpenGLSampleTimes(Sample* sample, rmtU64* out_first_timestamp, rmtU64* out_last_resync)
 {
     Sample* child;
 
-    D3D11Sample* d3d_sample = (D3D11Sample*)sample;
+    OpenGLSample* ogl_sample = (OpenGLSample*)sample;
 
     assert(sample != NULL);
-    if (d3d_sample->timestamp != NULL)
+    if (ogl_sample->timestamp != NULL)
     {
-        HRESULT result;
-
-        D3D11* d3d11 = g_Remotery->d3d11;
-        assert(d3d11 != NULL);
-
         assert(out_last_resync != NULL);
-
         #if (RMT_GPU_CPU_SYNC_SECONDS > 0)
-            if (*out_last_resync < d3d_sample->timestamp->cpu_timestamp)
+            if (*out_last_resync < ogl_sample->timestamp->cpu_timestamp)
             {
                 //Convert from us to seconds.
-                rmtU64 time_diff = (d3d_sample->timestamp->cpu_timestamp - *out_last_resync) / 1000000ULL;
+                rmtU64 time_diff = (ogl_sample->timestamp->cpu_timestamp - *out_last_resync) / 1000000000ULL;
                 if (time_diff > RMT_GPU_CPU_SYNC_SECONDS)
-                {
-                    result = SyncD3D11CpuGpuTimes(out_first_timestamp, out_last_resync);
-                    if (result != S_OK)
-                    {
-                        d3d11->last_error = result;
-                        return RMT_FALSE;
-                    }
-                }
+                    SyncOpenGLCpuGpuTimes(out_first_timestamp, out_last_resync);
             }
         #endif
 
-        result = D3D11Timestamp_GetData(
-            d3d_sample->timestamp,
-            d3d11->context,
-            &sample->us_start,
-            &sample->us_end,
-            out_first_timestamp,
-            out_last_resync);
-
-        if (result != S_OK)
-        {
-            d3d11->last_error = result;
+        if (!OpenGLTimestamp_GetData(ogl_sample->timestamp, &sample->ns_start, &sample->ns_end, out_first_timestamp, out_last_resync))
             return RMT_FALSE;
-        }
 
-        sample->us_length = sample->us_end - sample->us_start;
+        sample->ns_length = sample->ns_end - sample->ns_start;
     }
 
     // Get child sample times
     for (child = sample->first_child; child != NULL; child = child->next_sibling)
     {
-        if (!GetD3D11SampleTimes(child, out_first_timestamp, out_last_resync))
+        if (!GetOpenGLSampleTimes(child, out_first_timestamp, out_last_resync))
             return RMT_FALSE;
     }
 
@@ -6180,25 +8250,25 @@ static rmtBool GetD3D11SampleTimes(Sample* sample, rmtU64* out_first_timestamp,
 }
 
 
-static void UpdateD3D11Frame(void)
+static void UpdateOpenGLFrame(void)
 {
-    D3D11* d3d11;
+    OpenGL* opengl;
 
     if (g_Remotery == NULL)
         return;
 
-    d3d11 = g_Remotery->d3d11;
-    assert(d3d11 != NULL);
+    opengl = g_Remotery->opengl;
+    assert(opengl != NULL);
 
-    rmt_BeginCPUSample(rmt_UpdateD3D11Frame, 0);
+    rmt_BeginCPUSample(rmt_UpdateOpenGLFrame, 0);
 
-    // Process all messages in the D3D queue
-    for (;;)
+    // Process all messages in the OpenGL queue
+    while (1)
     {
         Msg_SampleTree* sample_tree;
         Sample* sample;
 
-        Message* message = rmtMessageQueue_PeekNextMessage(d3d11->mq_to_d3d11_main);
+        Message* message = rmtMessageQueue_PeekNextMessage(opengl->mq_to_opengl_main);
         if (message == NULL)
             break;
 
@@ -6206,411 +8276,351 @@ static void UpdateD3D11Frame(void)
         assert(message->id == MsgID_SampleTree);
         sample_tree = (Msg_SampleTree*)message->payload;
         sample = sample_tree->root_sample;
-        assert(sample->type == SampleType_D3D11);
+        assert(sample->type == SampleType_OpenGL);
 
-        // Retrieve timing of all D3D11 samples
+        // Retrieve timing of all OpenGL samples
         // If they aren't ready leave the message unconsumed, holding up later frames and maintaining order
-        if (!GetD3D11SampleTimes(sample, &d3d11->first_timestamp, &d3d11->last_resync))
+        if (!GetOpenGLSampleTimes(sample, &opengl->first_timestamp,&opengl->last_resync))
             break;
 
         // Pass samples onto the remotery thread for sending to the viewer
         AddSampleTreeMessage(g_Remotery->mq_to_rmt_thread, sample, sample_tree->allocator, sample_tree->thread_name, message->thread_sampler);
-        rmtMessageQueue_ConsumeNextMessage(d3d11->mq_to_d3d11_main, message);
+        rmtMessageQueue_ConsumeNextMessage(opengl->mq_to_opengl_main, message);
     }
 
     rmt_EndCPUSample();
 }
 
 
-RMT_API void _rmt_EndD3D11Sample(void)
+RMT_API void _rmt_EndOpenGLSample(void)
 {
     ThreadSampler* ts;
-    D3D11* d3d11;
 
     if (g_Remotery == NULL)
         return;
 
-    // Has D3D11 been unbound?
-    d3d11 = g_Remotery->d3d11;
-    assert(d3d11 != NULL);
-    if (d3d11->device == NULL || d3d11->context == NULL)
-        return;
-
     if (Remotery_GetThreadSampler(g_Remotery, &ts) == RMT_ERROR_NONE)
     {
         // Close the timestamp
-        D3D11Sample* d3d_sample = (D3D11Sample*)ts->sample_trees[SampleType_D3D11]->current_parent;
-        if (d3d_sample->base.recurse_depth > 0)
+        OpenGLSample* ogl_sample = (OpenGLSample*)ts->sample_trees[SampleType_OpenGL]->current_parent;
+        if (ogl_sample->base.recurse_depth > 0)
         {
-            d3d_sample->base.recurse_depth--;
+            ogl_sample->base.recurse_depth--;
         }
         else
         {
-            if (d3d_sample->timestamp != NULL)
-                D3D11Timestamp_End(d3d_sample->timestamp, d3d11->context);
+            if (ogl_sample->timestamp != NULL)
+                OpenGLTimestamp_End(ogl_sample->timestamp);
 
             // Send to the update loop for ready-polling
-            if (ThreadSampler_Pop(ts, d3d11->mq_to_d3d11_main, (Sample*)d3d_sample))
+            if (ThreadSampler_Pop(ts, g_Remotery->opengl->mq_to_opengl_main, (Sample*)ogl_sample))
                 // Perform ready-polling on popping of the root sample
-                UpdateD3D11Frame();
+                UpdateOpenGLFrame();
         }
     }
 }
 
 
-#endif  // RMT_USE_D3D11
+
+#endif  // RMT_USE_OPENGL
 
 
 
 /*
 ------------------------------------------------------------------------------------------------------------------------
 ------------------------------------------------------------------------------------------------------------------------
-@OpenGL: OpenGL event sampling
+   @VULKAN: Vulkan event sampling
 ------------------------------------------------------------------------------------------------------------------------
 ------------------------------------------------------------------------------------------------------------------------
 */
 
 
 
-#if RMT_USE_OPENGL
+#if RMT_USE_VULKAN
 
 
-#ifndef APIENTRY
-#  if defined(__MINGW32__) || defined(__CYGWIN__)
-#    define APIENTRY __stdcall
-#  elif (defined(_MSC_VER) && (_MSC_VER >= 800)) || defined(_STDCALL_SUPPORTED) || defined(__BORLANDC__)
-#    define APIENTRY __stdcall
-#  else
-#    define APIENTRY
-#  endif
+// Host clock that VK_EXT_calibrated_timestamps can sample alongside the GPU clock, matching the CPU timer
+#if defined(RMT_PLATFORM_WINDOWS)
+    #define RMT_VK_HOST_TIME_DOMAIN VK_TIME_DOMAIN_QUERY_PERFORMANCE_COUNTER_EXT
+#elif defined(RMT_PLATFORM_LINUX) && defined(CLOCK_MONOTONIC_RAW)
+    #define RMT_VK_HOST_TIME_DOMAIN VK_TIME_DOMAIN_CLOCK_MONOTONIC_RAW_EXT
+#elif defined(RMT_PLATFORM_LINUX)
+    #define RMT_VK_HOST_TIME_DOMAIN VK_TIME_DOMAIN_CLOCK_MONOTONIC_EXT
 #endif
 
-#ifndef GLAPI
-#  if defined(__MINGW32__) || defined(__CYGWIN__)
-#    define GLAPI extern
-#  elif defined (_WIN32)
-#    define GLAPI WINGDIAPI
-#  else
-#    define GLAPI extern
-#  endif
-#endif
+#define RMT_VK_GET_FUN(x) (assert(g_Remotery->vulkan->x != NULL), g_Remotery->vulkan->x)
 
-#ifndef GLAPIENTRY
-#define GLAPIENTRY APIENTRY
-#endif
+#define rmtvkCreateQueryPool RMT_VK_GET_FUN(__vkCreateQueryPool)
+#define rmtvkDestroyQueryPool RMT_VK_GET_FUN(__vkDestroyQueryPool)
+#define rmtvkCmdResetQueryPool RMT_VK_GET_FUN(__vkCmdResetQueryPool)
+#define rmtvkCmdWriteTimestamp RMT_VK_GET_FUN(__vkCmdWriteTimestamp)
+#define rmtvkGetQueryPoolResults RMT_VK_GET_FUN(__vkGetQueryPoolResults)
+#define rmtvkResetQueryPool RMT_VK_GET_FUN(__vkResetQueryPool)
+#define rmtvkGetCalibratedTimestamps RMT_VK_GET_FUN(__vkGetCalibratedTimestamps)
 
-typedef rmtU32 GLenum;
-typedef rmtU32 GLuint;
-typedef rmtS32 GLint;
-typedef rmtS32 GLsizei;
-typedef rmtU64 GLuint64;
-typedef rmtS64 GLint64;
-typedef unsigned char GLubyte;
 
-typedef GLenum (GLAPIENTRY * PFNGLGETERRORPROC) (void);
-typedef void (GLAPIENTRY * PFNGLGENQUERIESPROC) (GLsizei n, GLuint* ids);
-typedef void (GLAPIENTRY * PFNGLDELETEQUERIESPROC) (GLsizei n, const GLuint* ids);
-typedef void (GLAPIENTRY * PFNGLBEGINQUERYPROC) (GLenum target, GLuint id);
-typedef void (GLAPIENTRY * PFNGLENDQUERYPROC) (GLenum target);
-typedef void (GLAPIENTRY * PFNGLGETQUERYOBJECTIVPROC) (GLuint id, GLenum pname, GLint* params);
-typedef void (GLAPIENTRY * PFNGLGETQUERYOBJECTUIVPROC) (GLuint id, GLenum pname, GLuint* params);
-typedef void (GLAPIENTRY * PFNGLGETQUERYOBJECTI64VPROC) (GLuint id, GLenum pname, GLint64* params);
-typedef void (GLAPIENTRY * PFNGLGETQUERYOBJECTUI64VPROC) (GLuint id, GLenum pname, GLuint64* params);
-typedef void (GLAPIENTRY * PFNGLQUERYCOUNTERPROC) (GLuint id, GLenum target);
-typedef void (GLAPIENTRY * PFNGLGETINTEGER64VPROC) (GLenum pname, GLint64 *data);
-typedef void (GLAPIENTRY * PFNGLFINISHPROC) (void);
+struct Vulkan_t
+{
+    // Handle to the Vulkan loader, only opened if the bind didn't provide vkGetInstanceProcAddr
+    void* dll_handle;
 
-#define GL_NO_ERROR 0
-#define GL_QUERY_RESULT 0x8866
-#define GL_QUERY_RESULT_AVAILABLE 0x8867
-#define GL_TIME_ELAPSED 0x88BF
-#define GL_TIMESTAMP 0x8E28
+    VkDevice device;
 
-#define RMT_GL_GET_FUN(x) assert(g_Remotery->opengl->x != NULL); g_Remotery->opengl->x
+    PFN_vkCreateQueryPool __vkCreateQueryPool;
+    PFN_vkDestroyQueryPool __vkDestroyQueryPool;
+    PFN_vkCmdResetQueryPool __vkCmdResetQueryPool;
+    PFN_vkCmdWriteTimestamp __vkCmdWriteTimestamp;
+    PFN_vkGetQueryPoolResults __vkGetQueryPoolResults;
 
-#define rmtglGenQueries RMT_GL_GET_FUN(__glGenQueries)
-#define rmtglDeleteQueries RMT_GL_GET_FUN(__glDeleteQueries)
-#define rmtglBeginQuery RMT_GL_GET_FUN(__glBeginQuery)
-#define rmtglEndQuery RMT_GL_GET_FUN(__glEndQuery)
-#define rmtglGetQueryObjectiv RMT_GL_GET_FUN(__glGetQueryObjectiv)
-#define rmtglGetQueryObjectuiv RMT_GL_GET_FUN(__glGetQueryObjectuiv)
-#define rmtglGetQueryObjecti64v RMT_GL_GET_FUN(__glGetQueryObjecti64v)
-#define rmtglGetQueryObjectui64v RMT_GL_GET_FUN(__glGetQueryObjectui64v)
-#define rmtglQueryCounter RMT_GL_GET_FUN(__glQueryCounter)
-#define rmtglGetInteger64v RMT_GL_GET_FUN(__glGetInteger64v)
-#define rmtglFinish RMT_GL_GET_FUN(__glFinish)
+    // NULL unless the device has the hostQueryReset feature
+    PFN_vkResetQueryPoolEXT __vkResetQueryPool;
 
+    // NULL unless the device has calibrated timestamps in the same time domain as the CPU timer
+    PFN_vkGetCalibratedTimestampsEXT __vkGetCalibratedTimestamps;
 
-struct OpenGL_t
-{
-    // Handle to the OS OpenGL DLL
-    void* dll_handle;
+    // Timestamp queries are handed out in pairs as samples are first allocated and are only released with the pool.
+    // Samples are no-ops while there is no pool, e.g. before binding or if the queue doesn't support timestamps.
+    VkQueryPool query_pool;
+    rmtU32 nb_queries;
 
-    PFNGLGETERRORPROC __glGetError;
-    PFNGLGENQUERIESPROC __glGenQueries;
-    PFNGLDELETEQUERIESPROC __glDeleteQueries;
-    PFNGLBEGINQUERYPROC __glBeginQuery;
-    PFNGLENDQUERYPROC __glEndQuery;
-    PFNGLGETQUERYOBJECTIVPROC __glGetQueryObjectiv;
-    PFNGLGETQUERYOBJECTUIVPROC __glGetQueryObjectuiv;
-    PFNGLGETQUERYOBJECTI64VPROC __glGetQueryObjecti64v;
-    PFNGLGETQUERYOBJECTUI64VPROC __glGetQueryObjectui64v;
-    PFNGLQUERYCOUNTERPROC __glQueryCounter;
-    PFNGLGETINTEGER64VPROC __glGetInteger64v;
-    PFNGLFINISHPROC __glFinish;
+    // Conversion of GPU ticks to ns
+    double ns_per_tick;
+    rmtU64 tick_mask;
 
-    // Queue to the OpenGL main update thread
-    // Given that BeginSample/EndSample need to be called from the same thread that does the update, there
-    // is really no need for this to be a thread-safe queue. I'm using it for its convenience.
-    rmtMessageQueue* mq_to_opengl_main;
+    // Queue to the Vulkan main update thread
+    // As with OpenGL, BeginSample/EndSample need to be called from the same thread that does the update.
+    rmtMessageQueue* mq_to_vulkan_main;
 
-    // Mark the first time so that remaining timestamps are offset from this
+    // GPU time in ns at CPU time 0, subtracted from all GPU timestamps
     rmtU64 first_timestamp;
-    // Last time in us (CPU time, via usTimer_Get) since we last resync'ed CPU & GPU
+    // Last time in ns (CPU time, via nsTimer_Get) since we last resync'ed CPU & GPU
     rmtU64 last_resync;
 };
 
 
-static GLenum rmtglGetError(void)
-{
-    if (g_Remotery != NULL)
-    {
-        assert(g_Remotery->opengl != NULL);
-        if (g_Remotery->opengl->__glGetError != NULL)
-            return g_Remotery->opengl->__glGetError();
-    }
-
-    return (GLenum)0;
-}
-
-
-#ifdef RMT_PLATFORM_LINUX
-    #ifdef __cplusplus
-        extern "C" void* glXGetProcAddressARB(const GLubyte*);
-    #else
-        extern void* glXGetProcAddressARB(const GLubyte*);
-    #endif
-#endif
-
-
-static ProcReturnType rmtglGetProcAddress(OpenGL* opengl, const char* symbol)
-{
-    #if defined(RMT_PLATFORM_WINDOWS)
-    {
-        // Get OpenGL extension-loading function for each call
-        typedef ProcReturnType (WINAPI * wglGetProcAddressFn)(LPCSTR);
-        assert(opengl != NULL);
-        {
-            wglGetProcAddressFn wglGetProcAddress = (wglGetProcAddressFn)rmtGetProcAddress(opengl->dll_handle, "wglGetProcAddress");
-            if (wglGetProcAddress != NULL)
-                return wglGetProcAddress(symbol);
-        }
-    }
-
-    #elif defined(RMT_PLATFORM_MACOS) && !defined(GLEW_APPLE_GLX)
-
-        return rmtGetProcAddress(opengl->dll_handle, symbol);
-
-    #elif defined(RMT_PLATFORM_LINUX)
-
-        return glXGetProcAddressARB((const GLubyte*)symbol);
-
-    #endif
-
-    return NULL;
-}
-
-
-static rmtError OpenGL_Create(OpenGL** opengl)
+static rmtError Vulkan_Create(Vulkan** vulkan)
 {
     rmtError error;
 
-    assert(opengl != NULL);
-
-    *opengl = (OpenGL*)rmtMalloc(sizeof(OpenGL));
-    if (*opengl == NULL)
+    assert(vulkan != NULL);
+
+    *vulkan = (Vulkan*)rmtMalloc(sizeof(Vulkan));
+    if (*vulkan == NULL)
         return RMT_ERROR_MALLOC_FAIL;
 
-    (*opengl)->dll_handle = NULL;
+    (*vulkan)->dll_handle = NULL;
+    (*vulkan)->device = NULL;
 
-    (*opengl)->__glGetError = NULL;
-    (*opengl)->__glGenQueries = NULL;
-    (*opengl)->__glDeleteQueries = NULL;
-    (*opengl)->__glBeginQuery = NULL;
-    (*opengl)->__glEndQuery = NULL;
-    (*opengl)->__glGetQueryObjectiv = NULL;
-    (*opengl)->__glGetQueryObjectuiv = NULL;
-    (*opengl)->__glGetQueryObjecti64v = NULL;
-    (*opengl)->__glGetQueryObjectui64v = NULL;
-    (*opengl)->__glQueryCounter = NULL;
-    (*opengl)->__glGetInteger64v = NULL;
-    (*opengl)->__glFinish = NULL;
+    (*vulkan)->__vkCreateQueryPool = NULL;
+    (*vulkan)->__vkDestroyQueryPool = NULL;
+    (*vulkan)->__vkCmdResetQueryPool = NULL;
+    (*vulkan)->__vkCmdWriteTimestamp = NULL;
+    (*vulkan)->__vkGetQueryPoolResults = NULL;
+    (*vulkan)->__vkResetQueryPool = NULL;
+    (*vulkan)->__vkGetCalibratedTimestamps = NULL;
 
-    (*opengl)->mq_to_opengl_main = NULL;
-    (*opengl)->first_timestamp = 0;
-    (*opengl)->last_resync = 0;
+    (*vulkan)->query_pool = VK_NULL_HANDLE;
+    (*vulkan)->nb_queries = 0;
+    (*vulkan)->ns_per_tick = 1.0;
+    (*vulkan)->tick_mask = ~0ULL;
 
-    New_1(rmtMessageQueue, (*opengl)->mq_to_opengl_main, g_Settings.messageQueueSizeInBytes);
+    (*vulkan)->mq_to_vulkan_main = NULL;
+    (*vulkan)->first_timestamp = 0;
+    (*vulkan)->last_resync = 0;
+
+    New_1(rmtMessageQueue, (*vulkan)->mq_to_vulkan_main, g_Settings.messageQueueSizeInBytes);
     return error;
 }
 
 
-static void OpenGL_Destructor(OpenGL* opengl)
+static void Vulkan_Destructor(Vulkan* vulkan)
 {
-    assert(opengl != NULL);
-    Delete(rmtMessageQueue, opengl->mq_to_opengl_main);
+    assert(vulkan != NULL);
+    Delete(rmtMessageQueue, vulkan->mq_to_vulkan_main);
 }
 
-static void SyncOpenGLCpuGpuTimes(rmtU64* out_first_timestamp, rmtU64* out_last_resync)
+
+static rmtU64 VulkanTicksToNs(Vulkan* vulkan, rmtU64 ticks)
 {
-    rmtU64 cpu_time_start = 0;
-    rmtU64 cpu_time_stop = 0;
-    rmtU64 average_half_RTT = 0; //RTT = Rountrip Time.
-    GLint64 gpu_base = 0;
-    int i;
+    return (rmtU64)((double)(ticks & vulkan->tick_mask) * vulkan->ns_per_tick);
+}
 
-    rmtglFinish();
 
-    for (i=0; i<RMT_GPU_CPU_SYNC_NUM_ITERATIONS; ++i)
-    {
-        rmtU64 half_RTT;
+static rmtBool SyncVulkanCpuGpuTimes(Vulkan* vulkan)
+{
+#ifdef RMT_VK_HOST_TIME_DOMAIN
+    VkCalibratedTimestampInfoEXT info[2];
+    uint64_t timestamps[2];
+    uint64_t max_deviation;
+    rmtU64 cpu_time;
+    #ifndef RMT_PLATFORM_WINDOWS
+        rmtU64 host_now;
+    #endif
 
-        rmtglFinish();
-        cpu_time_start = usTimer_Get(&g_Remotery->timer);
-        rmtglGetInteger64v(GL_TIMESTAMP, &gpu_base);
-        cpu_time_stop = usTimer_Get(&g_Remotery->timer);
-        //Average the time it takes a roundtrip from CPU to GPU
-        //while doing nothing other than getting timestamps
-        half_RTT = (cpu_time_stop - cpu_time_start) >> 1ULL;
-        if( i == 0 )
-            average_half_RTT = half_RTT;
-        else
-            average_half_RTT = (average_half_RTT + half_RTT) >> 1ULL;
-    }
+    assert(vulkan != NULL);
+    if (vulkan->__vkGetCalibratedTimestamps == NULL)
+        return RMT_FALSE;
 
-    // All GPU times are offset from gpu_base, and then taken to
-    // the same relative origin CPU timestamps are based on.
-    // CPU is in us, we must translate it to ns.
-    *out_first_timestamp = (rmtU64)(gpu_base) - (cpu_time_start + average_half_RTT) * 1000ULL;
-    *out_last_resync = cpu_time_stop;
+    // Read the GPU and host clocks at the same time
+    info[0].sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT;
+    info[0].pNext = NULL;
+    info[0].timeDomain = VK_TIME_DOMAIN_DEVICE_EXT;
+    info[1] = info[0];
+    info[1].timeDomain = RMT_VK_HOST_TIME_DOMAIN;
+    if (rmtvkGetCalibratedTimestamps(vulkan->device, 2, info, timestamps, &max_deviation) != VK_SUCCESS)
+        return RMT_FALSE;
+
+    // Take the host time to CPU time
+    #if defined(RMT_PLATFORM_WINDOWS)
+        cpu_time = (rmtU64)((rmtS64)(timestamps[1] - g_Remotery->timer.counter_start.QuadPart) * g_Remotery->timer.counter_scale);
+    #else
+        // The CPU timer may be reading the TSC, so see how long ago the host time was on the same clock
+        host_now = MonotonicClock_Get();
+        cpu_time = nsTimer_Get(&g_Remotery->timer) - (host_now - timestamps[1]);
+    #endif
+
+    vulkan->first_timestamp = VulkanTicksToNs(vulkan, timestamps[0]) - cpu_time;
+    vulkan->last_resync = cpu_time;
+    return RMT_TRUE;
+#else
+    RMT_UNREFERENCED_PARAMETER(vulkan);
+    return RMT_FALSE;
+#endif
 }
 
 
-typedef struct OpenGLTimestamp
+typedef struct VulkanTimestamp
 {
     // Inherit so that timestamps can be quickly allocated
     ObjectLink Link;
 
-    // Pair of timestamp queries that wrap the sample
-    GLuint queries[2];
+    // First of the pair of timestamp queries that wrap the sample
+    rmtU32 first_query;
     rmtU64 cpu_timestamp;
-} OpenGLTimestamp;
 
+    // Results of the last use. Queries reset in a command buffer keep them until the reset executes.
+    rmtU64 last_ticks[2];
+} VulkanTimestamp;
 
-static rmtError OpenGLTimestamp_Constructor(OpenGLTimestamp* stamp)
+
+static rmtError VulkanTimestamp_Constructor(VulkanTimestamp* stamp)
 {
-    GLenum error;
+    Vulkan* vulkan;
 
     assert(stamp != NULL);
 
     ObjectLink_Constructor((ObjectLink*)stamp);
 
     // Set defaults
-    stamp->queries[0] = stamp->queries[1] = 0;
+    stamp->first_query = 0;
     stamp->cpu_timestamp = 0;
+    stamp->last_ticks[0] = stamp->last_ticks[1] = 0;
 
-    // Empty the error queue before using it for glGenQueries
-    while ((error = rmtglGetError()) != GL_NO_ERROR)
-        ;
-
-    // Create start/end timestamp queries
+    // Claim the next pair of queries in the pool
     assert(g_Remotery != NULL);
-    rmtglGenQueries(2, stamp->queries);
-    error = rmtglGetError();
-    if (error != GL_NO_ERROR)
-        return RMT_ERROR_OPENGL_ERROR;
+    vulkan = g_Remotery->vulkan;
+    if (vulkan->nb_queries + 2 > RMT_VULKAN_MAX_QUERIES)
+        return RMT_ERROR_VULKAN_OUT_OF_QUERIES;
+    stamp->first_query = vulkan->nb_queries;
+    vulkan->nb_queries += 2;
 
     return RMT_ERROR_NONE;
 }
 
 
-static void OpenGLTimestamp_Destructor(OpenGLTimestamp* stamp)
+static void VulkanTimestamp_Destructor(VulkanTimestamp* stamp)
 {
+    // Queries are released with the pool
     assert(stamp != NULL);
-
-    // Destroy queries
-    if (stamp->queries[0] != 0)
-        rmtglDeleteQueries(2, stamp->queries);
+    RMT_UNREFERENCED_PARAMETER(stamp);
 }
 
 
-static void OpenGLTimestamp_Begin(OpenGLTimestamp* stamp)
+static void VulkanTimestamp_Begin(VulkanTimestamp* stamp, VkCommandBuffer command_buffer)
 {
+    Vulkan* vulkan;
+
     assert(stamp != NULL);
 
-    // First query
     assert(g_Remotery != NULL);
-    stamp->cpu_timestamp = usTimer_Get(&g_Remotery->timer);
-    rmtglQueryCounter(stamp->queries[0], GL_TIMESTAMP);
+    vulkan = g_Remotery->vulkan;
+    stamp->cpu_timestamp = nsTimer_Get(&g_Remotery->timer);
+
+    // Queries must be reset before each use. The results of the last use have been read by now.
+    if (vulkan->__vkResetQueryPool != NULL)
+        rmtvkResetQueryPool(vulkan->device, vulkan->query_pool, stamp->first_query, 2);
+    else
+        rmtvkCmdResetQueryPool(command_buffer, vulkan->query_pool, stamp->first_query, 2);
+
+    // First query
+    rmtvkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, vulkan->query_pool, stamp->first_query);
 }
 
 
-static void OpenGLTimestamp_End(OpenGLTimestamp* stamp)
+static void VulkanTimestamp_End(VulkanTimestamp* stamp, VkCommandBuffer command_buffer)
 {
+    Vulkan* vulkan;
+
     assert(stamp != NULL);
 
     // Second query
     assert(g_Remotery != NULL);
-    rmtglQueryCounter(stamp->queries[1], GL_TIMESTAMP);
+    vulkan = g_Remotery->vulkan;
+    rmtvkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, vulkan->query_pool, stamp->first_query + 1);
 }
 
-static rmtBool OpenGLTimestamp_GetData(OpenGLTimestamp* stamp, rmtU64* out_start, rmtU64* out_end, rmtU64* out_first_timestamp, rmtU64* out_last_resync)
-{
-    GLuint64 start = 0, end = 0;
-    GLint startAvailable = 0, endAvailable = 0;
 
-    assert(g_Remotery != NULL);
+static rmtBool VulkanTimestamp_GetData(VulkanTimestamp* stamp, rmtBool is_root, rmtU64* out_start, rmtU64* out_end)
+{
+    Vulkan* vulkan;
+    rmtU64 ticks[2];
+    rmtU64 start, end;
 
     assert(stamp != NULL);
-    assert(stamp->queries[0] != 0 && stamp->queries[1] != 0);
 
-    // Check to see if all queries are ready
-    // If any fail to arrive, wait until later
-    rmtglGetQueryObjectiv(stamp->queries[0], GL_QUERY_RESULT_AVAILABLE, &startAvailable);
-    if (!startAvailable)
+    assert(g_Remotery != NULL);
+    vulkan = g_Remotery->vulkan;
+
+    // Without VK_QUERY_RESULT_WAIT_BIT this doesn't block and returns VK_NOT_READY until both queries are written
+    if (rmtvkGetQueryPoolResults(vulkan->device, vulkan->query_pool, stamp->first_query, 2, sizeof(ticks), ticks, sizeof(rmtU64), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
         return RMT_FALSE;
-    rmtglGetQueryObjectiv(stamp->queries[1], GL_QUERY_RESULT_AVAILABLE, &endAvailable);
-    if (!endAvailable)
+    if (ticks[0] == stamp->last_ticks[0] || ticks[1] == stamp->last_ticks[1])
         return RMT_FALSE;
+    stamp->last_ticks[0] = ticks[0];
+    stamp->last_ticks[1] = ticks[1];
 
-    rmtglGetQueryObjectui64v(stamp->queries[0], GL_QUERY_RESULT, &start);
-    rmtglGetQueryObjectui64v(stamp->queries[1], GL_QUERY_RESULT, &end);
+    start = VulkanTicksToNs(vulkan, ticks[0]);
+    end = VulkanTicksToNs(vulkan, ticks[1]);
 
     // Mark the first timestamp. We may resync if we detect the GPU timestamp is in the
     // past (i.e. happened before the CPU command) since it should be impossible.
-    assert(out_first_timestamp != NULL);
-    if (*out_first_timestamp == 0 || ((start - *out_first_timestamp) / 1000ULL) < stamp->cpu_timestamp)
-        SyncOpenGLCpuGpuTimes(out_first_timestamp, out_last_resync);
+    // Without calibrated timestamps, only that constraint aligns the GPU with the CPU. It's only
+    // checked at the root of a tree so that all of its samples move together and children stay
+    // inside their parents, as recording a sample on the CPU can take longer than running it.
+    if (is_root && (vulkan->first_timestamp == 0 || (start - vulkan->first_timestamp) < stamp->cpu_timestamp))
+    {
+        if (!SyncVulkanCpuGpuTimes(vulkan))
+            vulkan->first_timestamp = start - stamp->cpu_timestamp;
+    }
 
-    // Calculate start and end timestamps (we want us, the queries give us ns)
-    *out_start = (rmtU64)(start - *out_first_timestamp) / 1000ULL;
-    *out_end = (rmtU64)(end - *out_first_timestamp) / 1000ULL;
+    *out_start = start - vulkan->first_timestamp;
+    *out_end = end - vulkan->first_timestamp;
 
     return RMT_TRUE;
 }
 
 
-typedef struct OpenGLSample
+typedef struct VulkanSample
 {
     // IS-A inheritance relationship
     Sample base;
 
-    OpenGLTimestamp* timestamp;
+    VulkanTimestamp* timestamp;
 
-} OpenGLSample;
+} VulkanSample;
 
 
-static rmtError OpenGLSample_Constructor(OpenGLSample* sample)
+static rmtError VulkanSample_Constructor(VulkanSample* sample)
 {
     rmtError error;
 
@@ -6618,84 +8628,306 @@ static rmtError OpenGLSample_Constructor(OpenGLSample* sample)
 
     // Chain to sample constructor
     Sample_Constructor((Sample*)sample);
-    sample->base.type = SampleType_OpenGL;
-    sample->base.size_bytes = sizeof(OpenGLSample);
-    New_0(OpenGLTimestamp, sample->timestamp);
+    sample->base.type = SampleType_Vulkan;
+    sample->base.size_bytes = sizeof(VulkanSample);
+
+    // Left NULL, and the sample untimed, when the pool runs out of queries
+    New_0(VulkanTimestamp, sample->timestamp);
 
     return RMT_ERROR_NONE;
 }
 
 
-static void OpenGLSample_Destructor(OpenGLSample* sample)
+static void VulkanSample_Destructor(VulkanSample* sample)
 {
-    Delete(OpenGLTimestamp, sample->timestamp);
+    Delete(VulkanTimestamp, sample->timestamp);
     Sample_Destructor((Sample*)sample);
 }
 
-RMT_API void _rmt_BindOpenGL()
+
+static rmtError Vulkan_ResetQueryPool(Vulkan* vulkan, PFN_vkGetDeviceProcAddr get_device_proc_addr, rmtU32 queue_family_index)
 {
-    if (g_Remotery != NULL)
+    PFN_vkGetDeviceQueue get_device_queue;
+    PFN_vkCreateCommandPool create_command_pool;
+    PFN_vkDestroyCommandPool destroy_command_pool;
+    PFN_vkAllocateCommandBuffers allocate_command_buffers;
+    PFN_vkBeginCommandBuffer begin_command_buffer;
+    PFN_vkEndCommandBuffer end_command_buffer;
+    PFN_vkQueueSubmit queue_submit;
+    PFN_vkQueueWaitIdle queue_wait_idle;
+    VkCommandPoolCreateInfo pool_info;
+    VkCommandBufferAllocateInfo allocate_info;
+    VkCommandBufferBeginInfo begin_info;
+    VkSubmitInfo submit_info;
+    VkCommandPool command_pool;
+    VkCommandBuffer command_buffer;
+    VkQueue queue;
+    rmtError error = RMT_ERROR_VULKAN_ERROR;
+
+    // Reset from the host if the device allows it
+    if (vulkan->__vkResetQueryPool != NULL)
     {
-        OpenGL* opengl = g_Remotery->opengl;
-        assert(opengl != NULL);
+        rmtvkResetQueryPool(vulkan->device, vulkan->query_pool, 0, RMT_VULKAN_MAX_QUERIES);
+        return RMT_ERROR_NONE;
+    }
 
-        #if defined (RMT_PLATFORM_WINDOWS)
-            opengl->dll_handle = rmtLoadLibrary("opengl32.dll");
-        #elif defined (RMT_PLATFORM_MACOS)
-            opengl->dll_handle = rmtLoadLibrary("/System/Library/Frameworks/OpenGL.framework/Versions/Current/OpenGL");
-        #elif defined (RMT_PLATFORM_LINUX)
-            opengl->dll_handle = rmtLoadLibrary("libGL.so");
+    // Otherwise submit a reset of the whole pool and wait for it, so that queries are never read before their
+    // first reset has run, even if samples are read back before the command buffer resetting them is submitted
+    get_device_queue = (PFN_vkGetDeviceQueue)get_device_proc_addr(vulkan->device, "vkGetDeviceQueue");
+    create_command_pool = (PFN_vkCreateCommandPool)get_device_proc_addr(vulkan->device, "vkCreateCommandPool");
+    destroy_command_pool = (PFN_vkDestroyCommandPool)get_device_proc_addr(vulkan->device, "vkDestroyCommandPool");
+    allocate_command_buffers = (PFN_vkAllocateCommandBuffers)get_device_proc_addr(vulkan->device, "vkAllocateCommandBuffers");
+    begin_command_buffer = (PFN_vkBeginCommandBuffer)get_device_proc_addr(vulkan->device, "vkBeginCommandBuffer");
+    end_command_buffer = (PFN_vkEndCommandBuffer)get_device_proc_addr(vulkan->device, "vkEndCommandBuffer");
+    queue_submit = (PFN_vkQueueSubmit)get_device_proc_addr(vulkan->device, "vkQueueSubmit");
+    queue_wait_idle = (PFN_vkQueueWaitIdle)get_device_proc_addr(vulkan->device, "vkQueueWaitIdle");
+    if (get_device_queue == NULL || create_command_pool == NULL || destroy_command_pool == NULL || allocate_command_buffers == NULL ||
+        begin_command_buffer == NULL || end_command_buffer == NULL || queue_submit == NULL || queue_wait_idle == NULL)
+        return RMT_ERROR_VULKAN_ERROR;
+
+    pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    pool_info.pNext = NULL;
+    pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    pool_info.queueFamilyIndex = queue_family_index;
+    if (create_command_pool(vulkan->device, &pool_info, NULL, &command_pool) != VK_SUCCESS)
+        return RMT_ERROR_VULKAN_ERROR;
+
+    allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocate_info.pNext = NULL;
+    allocate_info.commandPool = command_pool;
+    allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocate_info.commandBufferCount = 1;
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.pNext = NULL;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    begin_info.pInheritanceInfo = NULL;
+    if (allocate_command_buffers(vulkan->device, &allocate_info, &command_buffer) == VK_SUCCESS &&
+        begin_command_buffer(command_buffer, &begin_info) == VK_SUCCESS)
+    {
+        rmtvkCmdResetQueryPool(command_buffer, vulkan->query_pool, 0, RMT_VULKAN_MAX_QUERIES);
+        if (end_command_buffer(command_buffer) == VK_SUCCESS)
+        {
+            submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+            submit_info.pNext = NULL;
+            submit_info.waitSemaphoreCount = 0;
+            submit_info.pWaitSemaphores = NULL;
+            submit_info.pWaitDstStageMask = NULL;
+            submit_info.commandBufferCount = 1;
+            submit_info.pCommandBuffers = &command_buffer;
+            submit_info.signalSemaphoreCount = 0;
+            submit_info.pSignalSemaphores = NULL;
+            get_device_queue(vulkan->device, queue_family_index, 0, &queue);
+            if (queue_submit(queue, 1, &submit_info, VK_NULL_HANDLE) == VK_SUCCESS && queue_wait_idle(queue) == VK_SUCCESS)
+                error = RMT_ERROR_NONE;
+        }
+    }
+
+    // Also frees the command buffer
+    destroy_command_pool(vulkan->device, command_pool, NULL);
+    return error;
+}
+
+
+static rmtError Vulkan_Bind(Vulkan* vulkan, const rmtVulkanBind* bind)
+{
+    VkInstance instance = (VkInstance)bind->instance;
+    VkPhysicalDevice physical_device = (VkPhysicalDevice)bind->physical_device;
+    PFN_vkGetInstanceProcAddr get_instance_proc_addr;
+    PFN_vkGetDeviceProcAddr get_device_proc_addr;
+    PFN_vkGetPhysicalDeviceProperties get_properties;
+    PFN_vkGetPhysicalDeviceQueueFamilyProperties get_queue_family_properties;
+    VkPhysicalDeviceProperties properties;
+    VkQueueFamilyProperties* queue_families;
+    uint32_t nb_queue_families = 0;
+    uint32_t valid_bits = 0;
+    VkQueryPoolCreateInfo pool_info;
+    rmtError error;
+
+    // Use the application's loader, or open the system one
+    get_instance_proc_addr = (PFN_vkGetInstanceProcAddr)bind->GetInstanceProcAddr;
+    if (get_instance_proc_addr == NULL)
+    {
+        #if defined(RMT_PLATFORM_WINDOWS)
+            vulkan->dll_handle = rmtLoadLibrary("vulkan-1.dll");
+        #elif defined(RMT_PLATFORM_MACOS)
+            vulkan->dll_handle = rmtLoadLibrary("libvulkan.1.dylib");
+        #else
+            vulkan->dll_handle = rmtLoadLibrary("libvulkan.so.1");
         #endif
+        if (vulkan->dll_handle == NULL)
+            return RMT_ERROR_VULKAN_ERROR;
+        get_instance_proc_addr = (PFN_vkGetInstanceProcAddr)rmtGetProcAddress(vulkan->dll_handle, "vkGetInstanceProcAddr");
+        if (get_instance_proc_addr == NULL)
+            return RMT_ERROR_VULKAN_ERROR;
+    }
+
+    get_device_proc_addr = (PFN_vkGetDeviceProcAddr)get_instance_proc_addr(instance, "vkGetDeviceProcAddr");
+    get_properties = (PFN_vkGetPhysicalDeviceProperties)get_instance_proc_addr(instance, "vkGetPhysicalDeviceProperties");
+    get_queue_family_properties = (PFN_vkGetPhysicalDeviceQueueFamilyProperties)get_instance_proc_addr(instance, "vkGetPhysicalDeviceQueueFamilyProperties");
+    if (get_device_proc_addr == NULL || get_properties == NULL || get_queue_family_properties == NULL)
+        return RMT_ERROR_VULKAN_ERROR;
+
+    vulkan->device = (VkDevice)bind->device;
+    vulkan->__vkCreateQueryPool = (PFN_vkCreateQueryPool)get_device_proc_addr(vulkan->device, "vkCreateQueryPool");
+    vulkan->__vkDestroyQueryPool = (PFN_vkDestroyQueryPool)get_device_proc_addr(vulkan->device, "vkDestroyQueryPool");
+    vulkan->__vkCmdResetQueryPool = (PFN_vkCmdResetQueryPool)get_device_proc_addr(vulkan->device, "vkCmdResetQueryPool");
+    vulkan->__vkCmdWriteTimestamp = (PFN_vkCmdWriteTimestamp)get_device_proc_addr(vulkan->device, "vkCmdWriteTimestamp");
+    vulkan->__vkGetQueryPoolResults = (PFN_vkGetQueryPoolResults)get_device_proc_addr(vulkan->device, "vkGetQueryPoolResults");
+    if (vulkan->__vkCreateQueryPool == NULL || vulkan->__vkDestroyQueryPool == NULL || vulkan->__vkCmdResetQueryPool == NULL ||
+        vulkan->__vkCmdWriteTimestamp == NULL || vulkan->__vkGetQueryPoolResults == NULL)
+        return RMT_ERROR_VULKAN_ERROR;
+
+    // Optional host query reset, which is a core function from Vulkan 1.2 that still needs the feature enabling
+    if (bind->host_query_reset)
+    {
+        vulkan->__vkResetQueryPool = (PFN_vkResetQueryPoolEXT)get_device_proc_addr(vulkan->device, "vkResetQueryPool");
+        if (vulkan->__vkResetQueryPool == NULL)
+            vulkan->__vkResetQueryPool = (PFN_vkResetQueryPoolEXT)get_device_proc_addr(vulkan->device, "vkResetQueryPoolEXT");
+    }
+
+    // Timestamps need a non-zero period and valid bits on the queue family
+    get_properties(physical_device, &properties);
+    get_queue_family_properties(physical_device, &nb_queue_families, NULL);
+    if (bind->queue_family_index < nb_queue_families)
+    {
+        queue_families = (VkQueueFamilyProperties*)rmtMalloc(nb_queue_families * sizeof(VkQueueFamilyProperties));
+        if (queue_families == NULL)
+            return RMT_ERROR_MALLOC_FAIL;
+        get_queue_family_properties(physical_device, &nb_queue_families, queue_families);
+        valid_bits = queue_families[bind->queue_family_index].timestampValidBits;
+        rmtFree(queue_families);
+    }
+    if (valid_bits == 0 || properties.limits.timestampPeriod <= 0.0f)
+        return RMT_ERROR_VULKAN_NO_TIMESTAMPS;
+    vulkan->ns_per_tick = properties.limits.timestampPeriod;
+    vulkan->tick_mask = valid_bits >= 64 ? ~0ULL : (1ULL << valid_bits) - 1;
+
+    // Optional calibrated timestamps, only returned by the device if the extension is enabled
+    #ifdef RMT_VK_HOST_TIME_DOMAIN
+    vulkan->__vkGetCalibratedTimestamps = (PFN_vkGetCalibratedTimestampsEXT)get_device_proc_addr(vulkan->device, "vkGetCalibratedTimestampsKHR");
+    if (vulkan->__vkGetCalibratedTimestamps == NULL)
+        vulkan->__vkGetCalibratedTimestamps = (PFN_vkGetCalibratedTimestampsEXT)get_device_proc_addr(vulkan->device, "vkGetCalibratedTimestampsEXT");
+    if (vulkan->__vkGetCalibratedTimestamps != NULL)
+    {
+        PFN_vkGetPhysicalDeviceCalibrateableTimeDomainsEXT get_time_domains;
+        VkTimeDomainEXT time_domains[8];
+        uint32_t i, nb_time_domains = sizeof(time_domains) / sizeof(time_domains[0]);
+        rmtU32 nb_found = 0;
+
+        // Both the GPU and the host clock must be available
+        get_time_domains = (PFN_vkGetPhysicalDeviceCalibrateableTimeDomainsEXT)get_instance_proc_addr(instance, "vkGetPhysicalDeviceCalibrateableTimeDomainsKHR");
+        if (get_time_domains == NULL)
+            get_time_domains = (PFN_vkGetPhysicalDeviceCalibrateableTimeDomainsEXT)get_instance_proc_addr(instance, "vkGetPhysicalDeviceCalibrateableTimeDomainsEXT");
+        if (get_time_domains != NULL && get_time_domains(physical_device, &nb_time_domains, time_domains) >= 0)
+        {
+            for (i = 0; i < nb_time_domains; i++)
+            {
+                if (time_domains[i] == VK_TIME_DOMAIN_DEVICE_EXT || time_domains[i] == RMT_VK_HOST_TIME_DOMAIN)
+                    nb_found++;
+            }
+        }
+        if (nb_found != 2)
+            vulkan->__vkGetCalibratedTimestamps = NULL;
+    }
+    #endif
 
-        opengl->__glGetError = (PFNGLGETERRORPROC)rmtGetProcAddress(opengl->dll_handle, "glGetError");
-        opengl->__glGenQueries = (PFNGLGENQUERIESPROC)rmtglGetProcAddress(opengl, "glGenQueries");
-        opengl->__glDeleteQueries = (PFNGLDELETEQUERIESPROC)rmtglGetProcAddress(opengl, "glDeleteQueries");
-        opengl->__glBeginQuery = (PFNGLBEGINQUERYPROC)rmtglGetProcAddress(opengl, "glBeginQuery");
-        opengl->__glEndQuery = (PFNGLENDQUERYPROC)rmtglGetProcAddress(opengl, "glEndQuery");
-        opengl->__glGetQueryObjectiv = (PFNGLGETQUERYOBJECTIVPROC)rmtglGetProcAddress(opengl, "glGetQueryObjectiv");
-        opengl->__glGetQueryObjectuiv = (PFNGLGETQUERYOBJECTUIVPROC)rmtglGetProcAddress(opengl, "glGetQueryObjectuiv");
-        opengl->__glGetQueryObjecti64v = (PFNGLGETQUERYOBJECTI64VPROC)rmtglGetProcAddress(opengl, "glGetQueryObjecti64v");
-        opengl->__glGetQueryObjectui64v = (PFNGLGETQUERYOBJECTUI64VPROC)rmtglGetProcAddress(opengl, "glGetQueryObjectui64v");
-        opengl->__glQueryCounter = (PFNGLQUERYCOUNTERPROC)rmtglGetProcAddress(opengl, "glQueryCounter");
-        opengl->__glGetInteger64v = (PFNGLGETINTEGER64VPROC)rmtglGetProcAddress(opengl, "glGetInteger64v");
-        opengl->__glFinish = (PFNGLFINISHPROC)rmtGetProcAddress(opengl->dll_handle, "glFinish");
+    // Create the pool last, as its existence enables sampling
+    pool_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    pool_info.pNext = NULL;
+    pool_info.flags = 0;
+    pool_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    pool_info.queryCount = RMT_VULKAN_MAX_QUERIES;
+    pool_info.pipelineStatistics = 0;
+    if (rmtvkCreateQueryPool(vulkan->device, &pool_info, NULL, &vulkan->query_pool) != VK_SUCCESS)
+    {
+        vulkan->query_pool = VK_NULL_HANDLE;
+        return RMT_ERROR_VULKAN_ERROR;
     }
+
+    // New queries can't be read until they've been reset
+    error = Vulkan_ResetQueryPool(vulkan, get_device_proc_addr, bind->queue_family_index);
+    if (error != RMT_ERROR_NONE)
+        return error;
+
+    vulkan->nb_queries = 0;
+    vulkan->first_timestamp = 0;
+    vulkan->last_resync = 0;
+
+    return RMT_ERROR_NONE;
 }
 
 
-static void UpdateOpenGLFrame(void);
+static void Vulkan_Unbind(Vulkan* vulkan)
+{
+    if (vulkan->query_pool != VK_NULL_HANDLE)
+    {
+        rmtvkDestroyQueryPool(vulkan->device, vulkan->query_pool, NULL);
+        vulkan->query_pool = VK_NULL_HANDLE;
+    }
 
+    vulkan->__vkCreateQueryPool = NULL;
+    vulkan->__vkDestroyQueryPool = NULL;
+    vulkan->__vkCmdResetQueryPool = NULL;
+    vulkan->__vkCmdWriteTimestamp = NULL;
+    vulkan->__vkGetQueryPoolResults = NULL;
+    vulkan->__vkResetQueryPool = NULL;
+    vulkan->__vkGetCalibratedTimestamps = NULL;
+    vulkan->device = NULL;
 
-RMT_API void _rmt_UnbindOpenGL(void)
+    // Release reference to the Vulkan loader
+    if (vulkan->dll_handle != NULL)
+    {
+        rmtFreeLibrary(vulkan->dll_handle);
+        vulkan->dll_handle = NULL;
+    }
+}
+
+
+RMT_API void _rmt_BindVulkan(const rmtVulkanBind* bind)
 {
+    assert(bind != NULL);
     if (g_Remotery != NULL)
     {
-        OpenGL* opengl = g_Remotery->opengl;
-        assert(opengl != NULL);
+        Vulkan* vulkan = g_Remotery->vulkan;
+        assert(vulkan != NULL);
 
-        // Stall waiting for the OpenGL queue to empty into the Remotery queue
-        while (!rmtMessageQueue_IsEmpty(opengl->mq_to_opengl_main))
-            UpdateOpenGLFrame();
+        // Samples stay no-ops if Vulkan or its timestamps are unavailable
+        if (vulkan->query_pool == VK_NULL_HANDLE && Vulkan_Bind(vulkan, bind) != RMT_ERROR_NONE)
+            Vulkan_Unbind(vulkan);
+    }
+}
 
-        // Forcefully delete sample tree on this thread to release time stamps from
-        // the same thread that created them
-        Remotery_BlockingDeleteSampleTree(g_Remotery, SampleType_OpenGL);
 
-        // Release reference to the OpenGL DLL
-        if (opengl->dll_handle != NULL)
-        {
-            rmtFreeLibrary(opengl->dll_handle);
-            opengl->dll_handle = NULL;
-        }
+static void UpdateVulkanFrame(void);
+
+
+RMT_API void _rmt_UnbindVulkan(void)
+{
+    if (g_Remotery != NULL)
+    {
+        Vulkan* vulkan = g_Remotery->vulkan;
+        assert(vulkan != NULL);
+
+        if (vulkan->query_pool == VK_NULL_HANDLE)
+            return;
+
+        // Stall waiting for the Vulkan queue to empty into the Remotery queue
+        while (!rmtMessageQueue_IsEmpty(vulkan->mq_to_vulkan_main))
+            UpdateVulkanFrame();
+
+        // Delete the sample tree before its queries go with the pool
+        Remotery_BlockingDeleteSampleTree(g_Remotery, SampleType_Vulkan);
+
+        Vulkan_Unbind(vulkan);
     }
 }
 
 
-RMT_API void _rmt_BeginOpenGLSample(rmtPStr name, rmtU32* hash_cache)
+RMT_API void _rmt_BeginVulkanSample(rmtPStr name, rmtU32* hash_cache, void* command_buffer)
 {
     ThreadSampler* ts;
 
-    if (g_Remotery == NULL)
+    if (g_Remotery == NULL || g_Remotery->vulkan->query_pool == VK_NULL_HANDLE)
         return;
 
     if (Remotery_GetThreadSampler(g_Remotery, &ts) == RMT_ERROR_NONE)
@@ -6703,57 +8935,57 @@ RMT_API void _rmt_BeginOpenGLSample(rmtPStr name, rmtU32* hash_cache)
         Sample* sample;
         rmtU32 name_hash = ThreadSampler_GetNameHash(ts, name, hash_cache);
 
-        // Create the OpenGL tree on-demand as the tree needs an up-front-created root.
-        // This is not possible to create on initialisation as a OpenGL binding is not yet available.
-        SampleTree** ogl_tree = &ts->sample_trees[SampleType_OpenGL];
-        if (*ogl_tree == NULL)
+        // Create the Vulkan tree on-demand as the tree needs an up-front-created root.
+        // This is not possible to create on initialisation as a Vulkan binding is not yet available.
+        SampleTree** vk_tree = &ts->sample_trees[SampleType_Vulkan];
+        if (*vk_tree == NULL)
         {
             rmtError error;
-            New_3(SampleTree, *ogl_tree, sizeof(OpenGLSample), (ObjConstructor)OpenGLSample_Constructor, (ObjDestructor)OpenGLSample_Destructor);
+            New_3(SampleTree, *vk_tree, sizeof(VulkanSample), (ObjConstructor)VulkanSample_Constructor, (ObjDestructor)VulkanSample_Destructor);
             if (error != RMT_ERROR_NONE)
                 return;
         }
 
         // Push the sample and activate the timestamp
-        if (ThreadSampler_Push(*ogl_tree, name_hash, 0, &sample) == RMT_ERROR_NONE)
+        if (ThreadSampler_Push(*vk_tree, name_hash, 0, &sample) == RMT_ERROR_NONE)
         {
-            OpenGLSample* ogl_sample = (OpenGLSample*)sample;
-            OpenGLTimestamp_Begin(ogl_sample->timestamp);
+            VulkanSample* vk_sample = (VulkanSample*)sample;
+            if (vk_sample->timestamp != NULL)
+                VulkanTimestamp_Begin(vk_sample->timestamp, (VkCommandBuffer)command_buffer);
         }
     }
 }
 
 
-static rmtBool GetOpenGLSampleTimes(Sample* sample, rmtU64* out_first_timestamp, rmtU64* out_last_resync)
+static rmtBool GetVulkanSampleTimes(Sample* sample, rmtBool is_root)
 {
     Sample* child;
 
-    OpenGLSample* ogl_sample = (OpenGLSample*)sample;
+    VulkanSample* vk_sample = (VulkanSample*)sample;
 
     assert(sample != NULL);
-    if (ogl_sample->timestamp != NULL)
+    if (vk_sample->timestamp != NULL)
     {
-        assert(out_last_resync != NULL);
         #if (RMT_GPU_CPU_SYNC_SECONDS > 0)
-            if (*out_last_resync < ogl_sample->timestamp->cpu_timestamp)
+            Vulkan* vulkan = g_Remotery->vulkan;
+            if (vulkan->last_resync < vk_sample->timestamp->cpu_timestamp)
             {
-                //Convert from us to seconds.
-                rmtU64 time_diff = (ogl_sample->timestamp->cpu_timestamp - *out_last_resync) / 1000000ULL;
+                rmtU64 time_diff = (vk_sample->timestamp->cpu_timestamp - vulkan->last_resync) / 1000000000ULL;
                 if (time_diff > RMT_GPU_CPU_SYNC_SECONDS)
-                    SyncOpenGLCpuGpuTimes(out_first_timestamp, out_last_resync);
+                    SyncVulkanCpuGpuTimes(vulkan);
             }
         #endif
 
-        if (!OpenGLTimestamp_GetData(ogl_sample->timestamp, &sample->us_start, &sample->us_end, out_first_timestamp, out_last_resync))
+        if (!VulkanTimestamp_GetData(vk_sample->timestamp, is_root, &sample->ns_start, &sample->ns_end))
             return RMT_FALSE;
 
-        sample->us_length = sample->us_end - sample->us_start;
+        sample->ns_length = sample->ns_end - sample->ns_start;
     }
 
     // Get child sample times
     for (child = sample->first_child; child != NULL; child = child->next_sibling)
     {
-        if (!GetOpenGLSampleTimes(child, out_first_timestamp, out_last_resync))
+        if (!GetVulkanSampleTimes(child, RMT_FALSE))
             return RMT_FALSE;
     }
 
@@ -6761,25 +8993,25 @@ static rmtBool GetOpenGLSampleTimes(Sample* sample, rmtU64* out_first_timestamp,
 }
 
 
-static void UpdateOpenGLFrame(void)
+static void UpdateVulkanFrame(void)
 {
-    OpenGL* opengl;
+    Vulkan* vulkan;
 
     if (g_Remotery == NULL)
         return;
 
-    opengl = g_Remotery->opengl;
-    assert(opengl != NULL);
+    vulkan = g_Remotery->vulkan;
+    assert(vulkan != NULL);
 
-    rmt_BeginCPUSample(rmt_UpdateOpenGLFrame, 0);
+    rmt_BeginCPUSample(rmt_UpdateVulkanFrame, 0);
 
-    // Process all messages in the OpenGL queue
+    // Process all messages in the Vulkan queue
     while (1)
     {
         Msg_SampleTree* sample_tree;
         Sample* sample;
 
-        Message* message = rmtMessageQueue_PeekNextMessage(opengl->mq_to_opengl_main);
+        Message* message = rmtMessageQueue_PeekNextMessage(vulkan->mq_to_vulkan_main);
         if (message == NULL)
             break;
 
@@ -6787,53 +9019,53 @@ static void UpdateOpenGLFrame(void)
         assert(message->id == MsgID_SampleTree);
         sample_tree = (Msg_SampleTree*)message->payload;
         sample = sample_tree->root_sample;
-        assert(sample->type == SampleType_OpenGL);
+        assert(sample->type == SampleType_Vulkan);
 
-        // Retrieve timing of all OpenGL samples
+        // Retrieve timing of all Vulkan samples
         // If they aren't ready leave the message unconsumed, holding up later frames and maintaining order
-        if (!GetOpenGLSampleTimes(sample, &opengl->first_timestamp,&opengl->last_resync))
+        if (!GetVulkanSampleTimes(sample, RMT_TRUE))
             break;
 
         // Pass samples onto the remotery thread for sending to the viewer
         AddSampleTreeMessage(g_Remotery->mq_to_rmt_thread, sample, sample_tree->allocator, sample_tree->thread_name, message->thread_sampler);
-        rmtMessageQueue_ConsumeNextMessage(opengl->mq_to_opengl_main, message);
+        rmtMessageQueue_ConsumeNextMessage(vulkan->mq_to_vulkan_main, message);
     }
 
     rmt_EndCPUSample();
 }
 
 
-RMT_API void _rmt_EndOpenGLSample(void)
+RMT_API void _rmt_EndVulkanSample(void* command_buffer)
 {
     ThreadSampler* ts;
 
-    if (g_Remotery == NULL)
+    if (g_Remotery == NULL || g_Remotery->vulkan->query_pool == VK_NULL_HANDLE)
         return;
 
-    if (Remotery_GetThreadSampler(g_Remotery, &ts) == RMT_ERROR_NONE)
+    if (Remotery_GetThreadSampler(g_Remotery, &ts) == RMT_ERROR_NONE && ts->sample_trees[SampleType_Vulkan] != NULL)
     {
         // Close the timestamp
-        OpenGLSample* ogl_sample = (OpenGLSample*)ts->sample_trees[SampleType_OpenGL]->current_parent;
-        if (ogl_sample->base.recurse_depth > 0)
+        VulkanSample* vk_sample = (VulkanSample*)ts->sample_trees[SampleType_Vulkan]->current_parent;
+        if (vk_sample->base.recurse_depth > 0)
         {
-            ogl_sample->base.recurse_depth--;
+            vk_sample->base.recurse_depth--;
         }
         else
         {
-            if (ogl_sample->timestamp != NULL)
-                OpenGLTimestamp_End(ogl_sample->timestamp);
+            if (vk_sample->timestamp != NULL)
+                VulkanTimestamp_End(vk_sample->timestamp, (VkCommandBuffer)command_buffer);
 
             // Send to the update loop for ready-polling
-            if (ThreadSampler_Pop(ts, g_Remotery->opengl->mq_to_opengl_main, (Sample*)ogl_sample))
+            if (ThreadSampler_Pop(ts, g_Remotery->vulkan->mq_to_vulkan_main, (Sample*)vk_sample))
                 // Perform ready-polling on popping of the root sample
-                UpdateOpenGLFrame();
+                UpdateVulkanFrame();
         }
     }
 }
 
 
 
-#endif  // RMT_USE_OPENGL
+#endif  // RMT_USE_VULKAN
 
 
 
@@ -6917,11 +9149,11 @@ static void MetalTimestamp_Destructor(MetalTimestamp* stamp)
 }
 
 
-rmtU64 rmtMetal_usGetTime()
+rmtU64 rmtMetal_nsGetTime()
 {
     // Share the CPU timer for auto-sync
     assert(g_Remotery != NULL);
-    return usTimer_Get(&g_Remotery->timer);
+    return nsTimer_Get(&g_Remotery->timer);
 }
 
 
@@ -7060,10 +9292,10 @@ static rmtBool GetMetalSampleTimes(Sample* sample)
     assert(sample != NULL);
     if (metal_sample->timestamp != NULL)
     {
-        if (!MetalTimestamp_GetData(metal_sample->timestamp, &sample->us_start, &sample->us_end))
+        if (!MetalTimestamp_GetData(metal_sample->timestamp, &sample->ns_start, &sample->ns_end))
             return RMT_FALSE;
 
-        sample->us_length = sample->us_end - sample->us_start;
+        sample->ns_length = sample->ns_end - sample->ns_start;
     }
 
     // Get child sample times
@@ -78,6 +78,21 @@ documented just below this comment.
 #define RMT_USE_METAL 0
 #endif
 
+// Assuming Vulkan headers are setup, allow Vulkan GPU profiling (dynamically links the Vulkan loader if needed)
+#ifndef RMT_USE_VULKAN
+#define RMT_USE_VULKAN 0
+#endif
+
+// Allow writing messages to a capture file (rmtSettings::captureFilename) and replaying it (rmt_ReplayCapture)
+#ifndef RMT_USE_CAPTURE
+#define RMT_USE_CAPTURE !RMT_USE_TINYCRT
+#endif
+
+// Assuming zlib headers/libs are setup, compress capture files
+#ifndef RMT_USE_ZLIB
+#define RMT_USE_ZLIB 0
+#endif
+
 // Initially use POSIX thread names to name threads instead of Thread0, 1, ...
 #ifndef RMT_USE_POSIX_THREADNAMES
 #define RMT_USE_POSIX_THREADNAMES 0
@@ -93,11 +108,16 @@ documented just below this comment.
 // Time in seconds between each resync to compensate for drifting between GPU & CPU timers,
 // effects of power saving, etc. Resyncs can cause stutter, lag spikes, stalls.
 // Set to 0 for never.
-// Affects OpenGL & D3D11
+// Affects OpenGL, D3D11 & Vulkan
 #ifndef RMT_GPU_CPU_SYNC_SECONDS
 #define RMT_GPU_CPU_SYNC_SECONDS 30
 #endif
 
+// Number of Vulkan timestamp queries Remotery creates when bound. Each sample in flight uses two of them.
+#ifndef RMT_VULKAN_MAX_QUERIES
+#define RMT_VULKAN_MAX_QUERIES 4096
+#endif
+
 // Whether we should automatically resync if we detect a timer disjoint (e.g.
 // changed from AC power to battery, GPU is overheating, or throttling up/down
 // due to laptop savings events). Set it to 0 to avoid resync in such events.
@@ -173,6 +193,16 @@ documented just below this comment.
 #else
     #define IFDEF_RMT_USE_METAL(t, f) f
 #endif
+#if RMT_ENABLED && RMT_USE_VULKAN
+    #define IFDEF_RMT_USE_VULKAN(t, f) t
+#else
+    #define IFDEF_RMT_USE_VULKAN(t, f) f
+#endif
+#if RMT_ENABLED && RMT_USE_CAPTURE
+    #define IFDEF_RMT_USE_CAPTURE(t, f) t
+#else
+    #define IFDEF_RMT_USE_CAPTURE(t, f) f
+#endif
 
 
 // Public interface is written in terms of these macros to easily enable/disable itself
@@ -211,6 +241,11 @@ typedef int rmtS32;
 typedef long long rmtS64;
 
 
+// Floating point types
+typedef float rmtF32;
+typedef double rmtF64;
+
+
 // Const, null-terminated string pointer
 typedef const char* rmtPStr;
 
@@ -280,6 +315,17 @@ typedef enum rmtError
     // OpenGL error messages
     RMT_ERROR_OPENGL_ERROR,                     // Generic OpenGL error, no need to expose detail since app will need an OpenGL error callback registered
 
+    // Vulkan error messages
+    RMT_ERROR_VULKAN_ERROR,                     // Generic Vulkan error, e.g. the loader or a required function is missing
+    RMT_ERROR_VULKAN_NO_TIMESTAMPS,             // The queue family doesn't support timestamp queries
+    RMT_ERROR_VULKAN_OUT_OF_QUERIES,            // All RMT_VULKAN_MAX_QUERIES timestamp queries are in use
+
+    // Capture file errors
+    RMT_ERROR_CAPTURE_OPEN_FAIL,                // Can't open the capture file
+    RMT_ERROR_CAPTURE_WRITE_FAIL,               // Failed to write to the capture file
+    RMT_ERROR_CAPTURE_BAD_FILE,                 // Not a capture file, or it has no complete chunk
+    RMT_ERROR_CAPTURE_UNSUPPORTED_COMPRESSION,  // Capture file is compressed and Remotery was built without zlib
+
     RMT_ERROR_CUDA_UNKNOWN,
 } rmtError;
 
@@ -297,6 +343,78 @@ typedef enum rmtSampleFlags
 } rmtSampleFlags;
 
 
+// Types of value a property can store
+typedef enum rmtPropertyType
+{
+    RMT_PropertyType_Group,
+    RMT_PropertyType_Bool,
+    RMT_PropertyType_S32,
+    RMT_PropertyType_U32,
+    RMT_PropertyType_F32,
+    RMT_PropertyType_S64,
+    RMT_PropertyType_U64,
+    RMT_PropertyType_F64,
+} rmtPropertyType;
+
+
+typedef enum rmtPropertyFlags
+{
+    RMT_PropertyFlags_NoFlags = 0,
+
+    // Reset the value to its default after each snapshot, e.g. for counting events per frame
+    RMT_PropertyFlags_FrameReset = 1,
+} rmtPropertyFlags;
+
+
+// Value of a property, 8 bytes so that it can be modified with a single atomic operation
+typedef union rmtPropertyValue
+{
+    rmtBool Bool;
+    rmtS32 S32;
+    rmtU32 U32;
+    rmtF32 F32;
+    rmtS64 S64;
+    rmtU64 U64;
+    rmtF64 F64;
+
+#ifdef __cplusplus
+    static rmtPropertyValue MakeBool(rmtBool v) { rmtPropertyValue pv; pv.U64 = 0; pv.Bool = v; return pv; }
+    static rmtPropertyValue MakeS32(rmtS32 v) { rmtPropertyValue pv; pv.U64 = 0; pv.S32 = v; return pv; }
+    static rmtPropertyValue MakeU32(rmtU32 v) { rmtPropertyValue pv; pv.U64 = 0; pv.U32 = v; return pv; }
+    static rmtPropertyValue MakeF32(rmtF32 v) { rmtPropertyValue pv; pv.U64 = 0; pv.F32 = v; return pv; }
+    static rmtPropertyValue MakeS64(rmtS64 v) { rmtPropertyValue pv; pv.S64 = v; return pv; }
+    static rmtPropertyValue MakeU64(rmtU64 v) { rmtPropertyValue pv; pv.U64 = v; return pv; }
+    static rmtPropertyValue MakeF64(rmtF64 v) { rmtPropertyValue pv; pv.F64 = v; return pv; }
+#endif
+} rmtPropertyValue;
+
+
+// A named value that is sent to the viewer with each snapshot. Define with the rmt_PropertyDefine_* macros
+// rather than filling this in. The property registers itself with Remotery the first time it's modified.
+typedef struct rmtProperty
+{
+    // Non-zero once the property starts being added to the list of properties sent to the viewer
+    volatile rmtU32 initialised;
+
+    rmtPropertyType type;
+    rmtU32 flags;
+
+    volatile rmtPropertyValue value;
+    rmtPropertyValue default_value;
+
+    // Optional group this property is displayed under
+    struct rmtProperty* parent;
+
+    rmtPStr name;
+    rmtPStr description;
+
+    // Next registered property
+    struct rmtProperty* volatile next;
+
+    rmtU32 name_hash;
+} rmtProperty;
+
+
 /*
 ------------------------------------------------------------------------------------------------------------------------
 ------------------------------------------------------------------------------------------------------------------------
@@ -343,6 +461,87 @@ typedef enum rmtSampleFlags
 #define rmt_EndCPUSample()                                                          \
     RMT_OPTIONAL(RMT_ENABLED, _rmt_EndCPUSample())
 
+// Serve a capture file to the viewer as if it was live, starting 'start_ms' into the capture.
+// Each viewer that connects gets the capture from the start. Only returns if the capture can't be read.
+// Don't call while a global instance uses the same port.
+#define rmt_ReplayCapture(filename, start_ms)                                       \
+    RMT_OPTIONAL_RET(RMT_USE_CAPTURE, _rmt_ReplayCapture(filename, start_ms), RMT_ERROR_NONE)
+
+
+// Properties are defined once at global scope and can be modified from any thread. Pass NULL as the parent
+// for a top-level property, or the address of a group. Use rmt_PropertyExtern to modify them from other files.
+//
+//    rmt_PropertyDefine_Group(Renderer, "Renderer stats", NULL);
+//    rmt_PropertyDefine_U32(DrawCalls, 0, RMT_PropertyFlags_FrameReset, "Draw calls this frame", &Renderer);
+//    ...
+//    rmt_PropertyAdd_U32(DrawCalls, 1);
+//
+#ifdef __cplusplus
+#define _rmt_PropertyValue(type, v) rmtPropertyValue::Make##type(v)
+#else
+#define _rmt_PropertyValue(type, v) { .type = (v) }
+#endif
+
+#if RMT_ENABLED
+#define _rmt_PropertyDefine(type, name, default_value, flags, desc, parent)                 \
+    rmtProperty name = { RMT_FALSE, RMT_PropertyType_##type, flags,                         \
+        _rmt_PropertyValue(type, default_value), _rmt_PropertyValue(type, default_value),   \
+        parent, #name, desc, NULL, 0 }
+#define rmt_PropertyDefine_Group(name, desc, parent)                                        \
+    rmtProperty name = { RMT_FALSE, RMT_PropertyType_Group, RMT_PropertyFlags_NoFlags,     \
+        _rmt_PropertyValue(U64, 0), _rmt_PropertyValue(U64, 0), parent, #name, desc, NULL, 0 }
+#define rmt_PropertyExtern(name)                                                            \
+    extern rmtProperty name
+#else
+#define _rmt_PropertyDefine(type, name, default_value, flags, desc, parent)
+#define rmt_PropertyDefine_Group(name, desc, parent)
+#define rmt_PropertyExtern(name)
+#endif
+
+#define rmt_PropertyDefine_Bool(name, default_value, flags, desc, parent)                   \
+    _rmt_PropertyDefine(Bool, name, default_value, flags, desc, parent)
+#define rmt_PropertyDefine_S32(name, default_value, flags, desc, parent)                    \
+    _rmt_PropertyDefine(S32, name, default_value, flags, desc, parent)
+#define rmt_PropertyDefine_U32(name, default_value, flags, desc, parent)                    \
+    _rmt_PropertyDefine(U32, name, default_value, flags, desc, parent)
+#define rmt_PropertyDefine_F32(name, default_value, flags, desc, parent)                    \
+    _rmt_PropertyDefine(F32, name, default_value, flags, desc, parent)
+#define rmt_PropertyDefine_S64(name, default_value, flags, desc, parent)                    \
+    _rmt_PropertyDefine(S64, name, default_value, flags, desc, parent)
+#define rmt_PropertyDefine_U64(name, default_value, flags, desc, parent)                    \
+    _rmt_PropertyDefine(U64, name, default_value, flags, desc, parent)
+#define rmt_PropertyDefine_F64(name, default_value, flags, desc, parent)                    \
+    _rmt_PropertyDefine(F64, name, default_value, flags, desc, parent)
+
+// Atomically replace or add to the value of a property
+#define _rmt_PropertyModify(func, type, name, v)                                            \
+    RMT_OPTIONAL(RMT_ENABLED, {                                                             \
+        rmtPropertyValue rmt_property_value;                                                \
+        rmt_property_value.U64 = 0;                                                         \
+        rmt_property_value.type = (v);                                                      \
+        func(&name, rmt_property_value);                                                    \
+    })
+
+#define rmt_PropertySet_Bool(name, v)   _rmt_PropertyModify(_rmt_PropertySetValue, Bool, name, v)
+#define rmt_PropertySet_S32(name, v)    _rmt_PropertyModify(_rmt_PropertySetValue, S32, name, v)
+#define rmt_PropertySet_U32(name, v)    _rmt_PropertyModify(_rmt_PropertySetValue, U32, name, v)
+#define rmt_PropertySet_F32(name, v)    _rmt_PropertyModify(_rmt_PropertySetValue, F32, name, v)
+#define rmt_PropertySet_S64(name, v)    _rmt_PropertyModify(_rmt_PropertySetValue, S64, name, v)
+#define rmt_PropertySet_U64(name, v)    _rmt_PropertyModify(_rmt_PropertySetValue, U64, name, v)
+#define rmt_PropertySet_F64(name, v)    _rmt_PropertyModify(_rmt_PropertySetValue, F64, name, v)
+
+#define rmt_PropertyAdd_S32(name, v)    _rmt_PropertyModify(_rmt_PropertyAddValue, S32, name, v)
+#define rmt_PropertyAdd_U32(name, v)    _rmt_PropertyModify(_rmt_PropertyAddValue, U32, name, v)
+#define rmt_PropertyAdd_F32(name, v)    _rmt_PropertyModify(_rmt_PropertyAddValue, F32, name, v)
+#define rmt_PropertyAdd_S64(name, v)    _rmt_PropertyModify(_rmt_PropertyAddValue, S64, name, v)
+#define rmt_PropertyAdd_U64(name, v)    _rmt_PropertyModify(_rmt_PropertyAddValue, U64, name, v)
+#define rmt_PropertyAdd_F64(name, v)    _rmt_PropertyModify(_rmt_PropertyAddValue, F64, name, v)
+
+// Call once per frame, at the end of the frame, to send the value of all properties to the viewer
+// and reset those with RMT_PropertyFlags_FrameReset
+#define rmt_PropertySnapshotAll()                                                           \
+    RMT_OPTIONAL(RMT_ENABLED, _rmt_PropertySnapshotAll())
+
 
 // Callback function pointer types
 typedef void* (*rmtMallocPtr)(void* mm_context, rmtU32 size);
@@ -395,6 +594,16 @@ typedef struct rmtSettings
     void* input_handler_context;
 
     rmtPStr logFilename;
+
+    // If set, all messages sent to the viewer are also written to this file, even when no viewer
+    // is connected. Compressed if Remotery is built with RMT_USE_ZLIB. See rmt_ReplayCapture.
+    rmtPStr captureFilename;
+
+    // If non-zero, each thread records its CPU samples as begin/end events in a buffer of this many bytes
+    // and the Remotery thread builds the sample trees from them. This costs less per sample than building
+    // the trees on the sampled threads but the buffer must hold all the events of a thread between Remotery
+    // updates; if it fills up, samples are dropped. Rounded up to a power of two events of 16 bytes.
+    rmtU32 eventBufferSizeInBytes;
 } rmtSettings;
 
 
@@ -474,6 +683,52 @@ typedef struct rmtCUDABind
     RMT_OPTIONAL(RMT_USE_OPENGL, _rmt_EndOpenGLSample())
 
 
+// Structure to fill in when binding Vulkan to Remotery
+typedef struct rmtVulkanBind
+{
+    // Handles of the Vulkan objects that samples are recorded with
+    // Untyped so that the Vulkan headers are not required in this file
+    void* instance;
+    void* physical_device;
+    void* device;
+
+    // Queue family of the command buffers passed to rmt_BeginVulkanSample
+    rmtU32 queue_family_index;
+
+    // Set if the device was created with the hostQueryReset feature (Vulkan 1.2 or VK_EXT_host_query_reset).
+    // Otherwise queries are reset in the command buffer and samples can't begin inside a render pass, and
+    // binding submits one command buffer to the first queue of queue_family_index and waits for it.
+    rmtBool host_query_reset;
+
+    // vkGetInstanceProcAddr of the loader that created the instance. If NULL, the Vulkan loader is opened.
+    void* GetInstanceProcAddr;
+
+} rmtVulkanBind;
+
+
+// Call once after you've created your Vulkan device to bind it to Remotery. GPU times are calibrated
+// against the CPU if the device has VK_EXT_calibrated_timestamps (or the KHR version) enabled.
+#define rmt_BindVulkan(bind)                                                \
+    RMT_OPTIONAL(RMT_USE_VULKAN, _rmt_BindVulkan(bind))
+
+#define rmt_UnbindVulkan()                                                  \
+    RMT_OPTIONAL(RMT_USE_VULKAN, _rmt_UnbindVulkan())
+
+// Mark the beginning of a Vulkan sample in the specified command buffer
+#define rmt_BeginVulkanSample(name, command_buffer)                         \
+    RMT_OPTIONAL(RMT_USE_VULKAN, {                                          \
+        static rmtU32 rmt_sample_hash_##name = 0;                           \
+        _rmt_BeginVulkanSample(#name, &rmt_sample_hash_##name, command_buffer); \
+    })
+
+#define rmt_BeginVulkanSampleDynamic(namestr, command_buffer)               \
+    RMT_OPTIONAL(RMT_USE_VULKAN, _rmt_BeginVulkanSample(namestr, NULL, command_buffer))
+
+// Mark the end of a Vulkan sample in the specified command buffer
+#define rmt_EndVulkanSample(command_buffer)                                 \
+    RMT_OPTIONAL(RMT_USE_VULKAN, _rmt_EndVulkanSample(command_buffer))
+
+
 #define rmt_BindMetal(command_buffer)                                       \
     RMT_OPTIONAL(RMT_USE_METAL, _rmt_BindMetal(command_buffer));
 
@@ -555,6 +810,21 @@ struct rmt_EndOpenGLSampleOnScopeExit
 };
 #endif
 
+#if RMT_USE_VULKAN
+extern "C" RMT_API void _rmt_EndVulkanSample(void* command_buffer);
+struct rmt_EndVulkanSampleOnScopeExit
+{
+    rmt_EndVulkanSampleOnScopeExit(void* command_buffer) : command_buffer(command_buffer)
+    {
+    }
+    ~rmt_EndVulkanSampleOnScopeExit()
+    {
+        _rmt_EndVulkanSample(command_buffer);
+    }
+    void* command_buffer;
+};
+#endif
+
 #if RMT_USE_METAL
 extern "C" RMT_API void _rmt_EndMetalSample(void);
 struct rmt_EndMetalSampleOnScopeExit
@@ -583,6 +853,9 @@ struct rmt_EndMetalSampleOnScopeExit
 #define rmt_ScopedOpenGLSample(name)                                                                    \
         RMT_OPTIONAL(RMT_USE_OPENGL, rmt_BeginOpenGLSample(name));                                      \
         RMT_OPTIONAL(RMT_USE_OPENGL, rmt_EndOpenGLSampleOnScopeExit rmt_ScopedOpenGLSample##name);
+#define rmt_ScopedVulkanSample(name, command_buffer)                                                    \
+        RMT_OPTIONAL(RMT_USE_VULKAN, rmt_BeginVulkanSample(name, command_buffer));                      \
+        RMT_OPTIONAL(RMT_USE_VULKAN, rmt_EndVulkanSampleOnScopeExit rmt_ScopedVulkanSample##name(command_buffer));
 #define rmt_ScopedMetalSample(name)                                                                     \
         RMT_OPTIONAL(RMT_USE_METAL, rmt_BeginMetalSample(name));                                        \
         RMT_OPTIONAL(RMT_USE_METAL, rmt_EndMetalSampleOnScopeExit rmt_ScopedMetalSample##name);
@@ -616,6 +889,13 @@ RMT_API void _rmt_SetCurrentThreadName(rmtPStr thread_name);
 RMT_API void _rmt_LogText(rmtPStr text);
 RMT_API void _rmt_BeginCPUSample(rmtPStr name, rmtU32 flags, rmtU32* hash_cache);
 RMT_API void _rmt_EndCPUSample(void);
+RMT_API void _rmt_PropertySetValue(rmtProperty* property, rmtPropertyValue value);
+RMT_API void _rmt_PropertyAddValue(rmtProperty* property, rmtPropertyValue add_value);
+RMT_API void _rmt_PropertySnapshotAll(void);
+
+#if RMT_USE_CAPTURE
+RMT_API enum rmtError _rmt_ReplayCapture(rmtPStr filename, rmtU32 start_ms);
+#endif
 
 #if RMT_USE_CUDA
 RMT_API void _rmt_BindCUDA(const rmtCUDABind* bind);
@@ -637,6 +917,13 @@ RMT_API void _rmt_BeginOpenGLSample(rmtPStr name, rmtU32* hash_cache);
 RMT_API void _rmt_EndOpenGLSample(void);
 #endif
 
+#if RMT_USE_VULKAN
+RMT_API void _rmt_BindVulkan(const rmtVulkanBind* bind);
+RMT_API void _rmt_UnbindVulkan(void);
+RMT_API void _rmt_BeginVulkanSample(rmtPStr name, rmtU32* hash_cache, void* command_buffer);
+RMT_API void _rmt_EndVulkanSample(void* command_buffer);
+#endif
+
 #if RMT_USE_METAL
 RMT_API void _rmt_BeginMetalSample(rmtPStr name, rmtU32* hash_cache);
 RMT_API void _rmt_EndMetalSample(void);
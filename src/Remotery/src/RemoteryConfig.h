@@ -0,0 +1,8 @@
+
+#define RMT_USE_OPENGL 1
+#define RMT_USE_D3D11 0
+#define RMT_USE_METAL 0
+#define RMT_USE_VULKAN 1
+#define RMT_USE_ZLIB 1
+
+#define RMT_DLL
@@ -53,12 +53,12 @@ void _rmt_UnbindMetal()
 extern "C"
 {
 	// Needs to be in the same lib for this to work
-	unsigned long long rmtMetal_usGetTime();
+	unsigned long long rmtMetal_nsGetTime();
 }
 
 static void SetTimestamp(void* data)
 {
-    *((unsigned long long*)data) = rmtMetal_usGetTime();
+    *((unsigned long long*)data) = rmtMetal_nsGetTime();
 }
 
 
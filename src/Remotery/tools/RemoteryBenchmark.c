@@ -0,0 +1,134 @@
+//
+// Measures what a CPU sample costs the thread recording it, with samples built into trees as they're recorded
+// and with samples recorded as events in a per-thread buffer (rmtSettings::eventBufferSizeInBytes).
+// Each frame records nested begin/end pairs, and the best frame is reported so that the Remotery thread
+// processing the previous frame adds as little noise as possible.
+//
+//    RemoteryBenchmark [samples per frame] [frames]
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <time.h>
+    #include <unistd.h>
+#endif
+
+#include "../src/Remotery.h"
+
+
+static double GetTimeNs(void)
+{
+#if defined(_WIN32)
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (double)counter.QuadPart * 1e9 / (double)frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+#endif
+}
+
+
+static void SleepMs(int ms)
+{
+#if defined(_WIN32)
+    Sleep(ms);
+#else
+    usleep(ms * 1000);
+#endif
+}
+
+
+static rmtError Benchmark(const char* mode, rmtU32 event_buffer_size, int nb_samples, int nb_frames)
+{
+    Remotery* rmt;
+    rmtError error;
+    double best_ns = 1e30;
+    int frame, i;
+
+    // Room for the samples of a few frames, whichever way they're recorded
+    rmtSettings* settings = rmt_Settings();
+    settings->eventBufferSizeInBytes = event_buffer_size;
+    settings->messageQueueSizeInBytes = 8 * 1024 * 1024;
+    settings->reuse_open_port = RMT_TRUE;
+
+    error = rmt_CreateGlobalInstance(&rmt);
+    if (error != RMT_ERROR_NONE)
+        return error;
+
+    for (frame = 0; frame < nb_frames; frame++)
+    {
+        double time_ns = GetTimeNs();
+
+        // Half of the samples are aggregated into their parent, as hot loops usually are
+        rmt_BeginCPUSample(Frame, 0);
+        for (i = 0; i < nb_samples / 2; i++)
+        {
+            rmt_BeginCPUSample(Outer, 0);
+            rmt_BeginCPUSample(Inner, RMTSF_Aggregate);
+            rmt_EndCPUSample();
+            rmt_EndCPUSample();
+        }
+        rmt_EndCPUSample();
+
+        time_ns = (GetTimeNs() - time_ns) / (nb_samples / 2 * 2 + 1);
+        if (time_ns < best_ns)
+            best_ns = time_ns;
+
+        // Let the Remotery thread send the frame
+        SleepMs(20);
+    }
+
+    printf("%-7s %8.1f ns per sample\n", mode, best_ns);
+
+    rmt_DestroyGlobalInstance(rmt);
+    return RMT_ERROR_NONE;
+}
+
+
+int main(int argc, char* argv[])
+{
+    int nb_samples = 2000;
+    int nb_frames = 50;
+    rmtU32 event_buffer_size;
+    rmtError error;
+
+    if (argc > 3)
+    {
+        printf("Usage: %s [samples per frame] [frames]\n", argv[0]);
+        return 1;
+    }
+    if (argc > 1)
+        nb_samples = atoi(argv[1]);
+    if (argc > 2)
+        nb_frames = atoi(argv[2]);
+    if (nb_samples < 2 || nb_frames < 1)
+    {
+        printf("Usage: %s [samples per frame] [frames]\n", argv[0]);
+        return 1;
+    }
+
+    printf("%d samples per frame, best of %d frames\n", nb_samples, nb_frames);
+
+    error = Benchmark("tree", 0, nb_samples, nb_frames);
+    if (error == RMT_ERROR_NONE)
+    {
+        // Two 16-byte events per sample, for a few frames
+        event_buffer_size = (rmtU32)(nb_samples + 1) * 2 * 16 * 4;
+        error = Benchmark("events", event_buffer_size, nb_samples, nb_frames);
+    }
+
+    if (error != RMT_ERROR_NONE)
+    {
+        printf("Failed to create Remotery (error %d)\n", (int)error);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,39 @@
+//
+// Serves a capture written with rmtSettings::captureFilename to the Remotery viewer as if it was live.
+// Each viewer that connects is sent the capture again.
+//
+//    RemoteryReplay <capture file> [start seconds] [port]
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../src/Remotery.h"
+
+
+int main(int argc, char* argv[])
+{
+    rmtSettings* settings;
+    rmtError error;
+    rmtU32 start_ms = 0;
+
+    if (argc < 2 || argc > 4)
+    {
+        printf("Usage: %s <capture file> [start seconds] [port]\n", argv[0]);
+        return 1;
+    }
+
+    if (argc > 2)
+        start_ms = (rmtU32)(atof(argv[2]) * 1000.0);
+
+    settings = rmt_Settings();
+    settings->reuse_open_port = RMT_TRUE;
+    if (argc > 3)
+        settings->port = (rmtU16)atoi(argv[3]);
+
+    printf("Serving %s on port %d, open vis/index.html to view it\n", argv[1], settings->port);
+
+    error = rmt_ReplayCapture(argv[1], start_ms);
+    printf("Failed to replay %s (error %d)\n", argv[1], (int)error);
+    return 1;
+}
@@ -0,0 +1,550 @@
+//
+// Checks the Vulkan backend against whatever Vulkan driver the loader finds, which can be a software one such as
+// lavapipe or SwiftShader (point VK_ICD_FILENAMES at its ICD json). Each frame records nested Vulkan samples into
+// a command buffer and submits it, while the tool connects to its own Remotery server as a viewer would and checks
+// the Vulkan sample trees it's sent.
+//
+// Returns 0 if the samples arrived timed, 1 on failure and 77 if there's no Vulkan loader or device to test with.
+//
+//    RemoteryVulkanTest [port]
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #include <winsock2.h>
+    #include <windows.h>
+    #ifdef _MSC_VER
+        #pragma comment(lib, "ws2_32.lib")
+    #endif
+    typedef SOCKET TestSocket;
+    #define closesocket_ closesocket
+#else
+    #include <dlfcn.h>
+    #include <unistd.h>
+    #include <sys/socket.h>
+    #include <sys/time.h>
+    #include <netinet/in.h>
+    #include <arpa/inet.h>
+    typedef int TestSocket;
+    #define INVALID_SOCKET -1
+    #define closesocket_ close
+#endif
+
+#define VK_NO_PROTOTYPES
+#include <vulkan/vulkan.h>
+
+#include "../src/Remotery.h"
+
+
+#define SKIPPED 77
+#define NB_FRAMES 20
+
+
+static void SleepMs(int ms)
+{
+#if defined(_WIN32)
+    Sleep(ms);
+#else
+    usleep(ms * 1000);
+#endif
+}
+
+
+/*
+------------------------------------------------------------------------------------------------------------------------
+   Vulkan objects the samples are recorded with
+------------------------------------------------------------------------------------------------------------------------
+*/
+
+
+typedef struct
+{
+    void* loader;
+
+    PFN_vkGetInstanceProcAddr GetInstanceProcAddr;
+    PFN_vkDestroyInstance DestroyInstance;
+    PFN_vkDestroyDevice DestroyDevice;
+    PFN_vkGetDeviceQueue GetDeviceQueue;
+    PFN_vkCreateCommandPool CreateCommandPool;
+    PFN_vkDestroyCommandPool DestroyCommandPool;
+    PFN_vkAllocateCommandBuffers AllocateCommandBuffers;
+    PFN_vkResetCommandBuffer ResetCommandBuffer;
+    PFN_vkBeginCommandBuffer BeginCommandBuffer;
+    PFN_vkEndCommandBuffer EndCommandBuffer;
+    PFN_vkQueueSubmit QueueSubmit;
+    PFN_vkQueueWaitIdle QueueWaitIdle;
+    PFN_vkDeviceWaitIdle DeviceWaitIdle;
+
+    VkInstance instance;
+    VkPhysicalDevice physical_device;
+    VkDevice device;
+    rmtU32 queue_family_index;
+    VkQueue queue;
+    VkCommandPool command_pool;
+    VkCommandBuffer command_buffer;
+} TestVulkan;
+
+
+#define GET_INSTANCE_FUN(vk, name) (vk)->name = (PFN_vk##name)(vk)->GetInstanceProcAddr((vk)->instance, "vk" #name)
+
+
+// Returns SKIPPED if there's no Vulkan to test with
+static int TestVulkan_Create(TestVulkan* vk)
+{
+    PFN_vkCreateInstance CreateInstance;
+    PFN_vkEnumeratePhysicalDevices EnumeratePhysicalDevices;
+    PFN_vkGetPhysicalDeviceQueueFamilyProperties GetPhysicalDeviceQueueFamilyProperties;
+    PFN_vkCreateDevice CreateDevice;
+    VkApplicationInfo app_info;
+    VkInstanceCreateInfo instance_info;
+    VkPhysicalDevice physical_devices[16];
+    uint32_t nb_physical_devices = sizeof(physical_devices) / sizeof(physical_devices[0]);
+    float queue_priority = 1.0f;
+    VkDeviceQueueCreateInfo queue_info;
+    VkDeviceCreateInfo device_info;
+    VkCommandPoolCreateInfo pool_info;
+    VkCommandBufferAllocateInfo command_buffer_info;
+    uint32_t i, j;
+
+    memset(vk, 0, sizeof(*vk));
+
+    #if defined(_WIN32)
+        vk->loader = (void*)LoadLibraryA("vulkan-1.dll");
+        if (vk->loader != NULL)
+            vk->GetInstanceProcAddr = (PFN_vkGetInstanceProcAddr)GetProcAddress((HMODULE)vk->loader, "vkGetInstanceProcAddr");
+    #elif defined(__APPLE__)
+        vk->loader = dlopen("libvulkan.1.dylib", RTLD_NOW | RTLD_LOCAL);
+        if (vk->loader != NULL)
+            vk->GetInstanceProcAddr = (PFN_vkGetInstanceProcAddr)dlsym(vk->loader, "vkGetInstanceProcAddr");
+    #else
+        vk->loader = dlopen("libvulkan.so.1", RTLD_NOW | RTLD_LOCAL);
+        if (vk->loader != NULL)
+            vk->GetInstanceProcAddr = (PFN_vkGetInstanceProcAddr)dlsym(vk->loader, "vkGetInstanceProcAddr");
+    #endif
+    if (vk->GetInstanceProcAddr == NULL)
+    {
+        printf("No Vulkan loader\n");
+        return SKIPPED;
+    }
+
+    memset(&app_info, 0, sizeof(app_info));
+    app_info.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+    app_info.pApplicationName = "RemoteryVulkanTest";
+    app_info.apiVersion = VK_API_VERSION_1_0;
+    memset(&instance_info, 0, sizeof(instance_info));
+    instance_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+    instance_info.pApplicationInfo = &app_info;
+    CreateInstance = (PFN_vkCreateInstance)vk->GetInstanceProcAddr(NULL, "vkCreateInstance");
+    if (CreateInstance == NULL || CreateInstance(&instance_info, NULL, &vk->instance) != VK_SUCCESS)
+    {
+        printf("No Vulkan driver\n");
+        return SKIPPED;
+    }
+
+    GET_INSTANCE_FUN(vk, DestroyInstance);
+    GET_INSTANCE_FUN(vk, DestroyDevice);
+    GET_INSTANCE_FUN(vk, GetDeviceQueue);
+    GET_INSTANCE_FUN(vk, CreateCommandPool);
+    GET_INSTANCE_FUN(vk, DestroyCommandPool);
+    GET_INSTANCE_FUN(vk, AllocateCommandBuffers);
+    GET_INSTANCE_FUN(vk, ResetCommandBuffer);
+    GET_INSTANCE_FUN(vk, BeginCommandBuffer);
+    GET_INSTANCE_FUN(vk, EndCommandBuffer);
+    GET_INSTANCE_FUN(vk, QueueSubmit);
+    GET_INSTANCE_FUN(vk, QueueWaitIdle);
+    GET_INSTANCE_FUN(vk, DeviceWaitIdle);
+    EnumeratePhysicalDevices = (PFN_vkEnumeratePhysicalDevices)vk->GetInstanceProcAddr(vk->instance, "vkEnumeratePhysicalDevices");
+    GetPhysicalDeviceQueueFamilyProperties = (PFN_vkGetPhysicalDeviceQueueFamilyProperties)vk->GetInstanceProcAddr(vk->instance, "vkGetPhysicalDeviceQueueFamilyProperties");
+    CreateDevice = (PFN_vkCreateDevice)vk->GetInstanceProcAddr(vk->instance, "vkCreateDevice");
+
+    // Use the first queue family that can record timestamps
+    if (EnumeratePhysicalDevices(vk->instance, &nb_physical_devices, physical_devices) < 0)
+        nb_physical_devices = 0;
+    for (i = 0; i < nb_physical_devices && vk->physical_device == NULL; i++)
+    {
+        VkQueueFamilyProperties families[16];
+        uint32_t nb_families = sizeof(families) / sizeof(families[0]);
+        GetPhysicalDeviceQueueFamilyProperties(physical_devices[i], &nb_families, families);
+        for (j = 0; j < nb_families; j++)
+        {
+            if (families[j].timestampValidBits != 0 && (families[j].queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)) != 0)
+            {
+                vk->physical_device = physical_devices[i];
+                vk->queue_family_index = j;
+                break;
+            }
+        }
+    }
+    if (vk->physical_device == NULL)
+    {
+        printf("No Vulkan device with timestamps\n");
+        return SKIPPED;
+    }
+
+    memset(&queue_info, 0, sizeof(queue_info));
+    queue_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+    queue_info.queueFamilyIndex = vk->queue_family_index;
+    queue_info.queueCount = 1;
+    queue_info.pQueuePriorities = &queue_priority;
+    memset(&device_info, 0, sizeof(device_info));
+    device_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    device_info.queueCreateInfoCount = 1;
+    device_info.pQueueCreateInfos = &queue_info;
+    if (CreateDevice(vk->physical_device, &device_info, NULL, &vk->device) != VK_SUCCESS)
+    {
+        printf("Failed to create the Vulkan device\n");
+        return 1;
+    }
+    vk->GetDeviceQueue(vk->device, vk->queue_family_index, 0, &vk->queue);
+
+    memset(&pool_info, 0, sizeof(pool_info));
+    pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    pool_info.queueFamilyIndex = vk->queue_family_index;
+    memset(&command_buffer_info, 0, sizeof(command_buffer_info));
+    command_buffer_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    command_buffer_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    command_buffer_info.commandBufferCount = 1;
+    if (vk->CreateCommandPool(vk->device, &pool_info, NULL, &vk->command_pool) != VK_SUCCESS)
+    {
+        printf("Failed to create the command pool\n");
+        return 1;
+    }
+    command_buffer_info.commandPool = vk->command_pool;
+    if (vk->AllocateCommandBuffers(vk->device, &command_buffer_info, &vk->command_buffer) != VK_SUCCESS)
+    {
+        printf("Failed to allocate the command buffer\n");
+        return 1;
+    }
+
+    return 0;
+}
+
+
+static void TestVulkan_Destroy(TestVulkan* vk)
+{
+    if (vk->device != NULL)
+    {
+        vk->DeviceWaitIdle(vk->device);
+        if (vk->command_pool != VK_NULL_HANDLE)
+            vk->DestroyCommandPool(vk->device, vk->command_pool, NULL);
+        vk->DestroyDevice(vk->device, NULL);
+    }
+    if (vk->instance != NULL)
+        vk->DestroyInstance(vk->instance, NULL);
+
+    // The loader stays open as Remotery may still hold pointers into it
+}
+
+
+static int TestVulkan_RecordFrame(TestVulkan* vk)
+{
+    VkCommandBufferBeginInfo begin_info;
+    VkSubmitInfo submit_info;
+    int i;
+
+    memset(&begin_info, 0, sizeof(begin_info));
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    if (vk->ResetCommandBuffer(vk->command_buffer, 0) != VK_SUCCESS ||
+        vk->BeginCommandBuffer(vk->command_buffer, &begin_info) != VK_SUCCESS)
+        return 1;
+
+    // The previous frame's samples are read back when this frame's root sample ends
+    rmt_BeginVulkanSample(Frame, vk->command_buffer);
+    for (i = 0; i < 2; i++)
+    {
+        rmt_BeginVulkanSample(Pass, vk->command_buffer);
+        rmt_EndVulkanSample(vk->command_buffer);
+    }
+    rmt_EndVulkanSample(vk->command_buffer);
+
+    if (vk->EndCommandBuffer(vk->command_buffer) != VK_SUCCESS)
+        return 1;
+
+    memset(&submit_info, 0, sizeof(submit_info));
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &vk->command_buffer;
+    if (vk->QueueSubmit(vk->queue, 1, &submit_info, VK_NULL_HANDLE) != VK_SUCCESS ||
+        vk->QueueWaitIdle(vk->queue) != VK_SUCCESS)
+        return 1;
+
+    return 0;
+}
+
+
+/*
+------------------------------------------------------------------------------------------------------------------------
+   Minimal WebSocket client reading the messages Remotery sends to the viewer
+------------------------------------------------------------------------------------------------------------------------
+*/
+
+
+static TestSocket Viewer_Connect(rmtU16 port)
+{
+    static const char request[] =
+        "GET /rmt HTTP/1.1\r\n"
+        "Host: 127.0.0.1\r\n"
+        "Upgrade: websocket\r\n"
+        "Connection: Upgrade\r\n"
+        "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+        "Sec-WebSocket-Version: 13\r\n\r\n";
+    struct sockaddr_in addr;
+    TestSocket s;
+    char c;
+    int nb_line_ends = 0;
+
+    s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (s == INVALID_SOCKET)
+        return INVALID_SOCKET;
+
+    // Don't hang if Remotery stops sending
+    #if defined(_WIN32)
+    {
+        DWORD timeout_ms = 5000;
+        setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout_ms, sizeof(timeout_ms));
+    }
+    #else
+    {
+        struct timeval timeout;
+        timeout.tv_sec = 5;
+        timeout.tv_usec = 0;
+        setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    }
+    #endif
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(s, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+        send(s, request, (int)sizeof(request) - 1, 0) != (int)sizeof(request) - 1)
+    {
+        closesocket_(s);
+        return INVALID_SOCKET;
+    }
+
+    // Skip the handshake response, up to the empty line
+    while (nb_line_ends < 4 && recv(s, &c, 1, 0) == 1)
+        nb_line_ends = (c == (nb_line_ends & 1 ? '\n' : '\r')) ? nb_line_ends + 1 : (c == '\r' ? 1 : 0);
+    if (nb_line_ends < 4)
+    {
+        closesocket_(s);
+        return INVALID_SOCKET;
+    }
+
+    return s;
+}
+
+
+static int Viewer_Read(TestSocket s, rmtU8* data, rmtU32 length)
+{
+    while (length > 0)
+    {
+        int n = recv(s, (char*)data, (int)length, 0);
+        if (n <= 0)
+            return 0;
+        data += n;
+        length -= (rmtU32)n;
+    }
+    return 1;
+}
+
+
+// Reads the payload of the next WebSocket frame from the server, which aren't masked
+static rmtU32 Viewer_ReadMessage(TestSocket s, rmtU8* data, rmtU32 max_length)
+{
+    rmtU8 header[8];
+    rmtU32 length, i;
+
+    if (!Viewer_Read(s, header, 2))
+        return 0;
+    length = header[1] & 0x7F;
+    if (length == 126)
+    {
+        if (!Viewer_Read(s, header, 2))
+            return 0;
+        length = (header[0] << 8) | header[1];
+    }
+    else if (length == 127)
+    {
+        if (!Viewer_Read(s, header, 8))
+            return 0;
+        for (length = 0, i = 4; i < 8; i++)
+            length = (length << 8) | header[i];
+    }
+
+    if (length > max_length || !Viewer_Read(s, data, length))
+        return 0;
+    return length;
+}
+
+
+/*
+------------------------------------------------------------------------------------------------------------------------
+   Checks of the "SMPL" messages the Vulkan samples are sent in
+------------------------------------------------------------------------------------------------------------------------
+*/
+
+
+static rmtU32 ReadU32(const rmtU8* data)
+{
+    return data[0] | (data[1] << 8) | (data[2] << 16) | ((rmtU32)data[3] << 24);
+}
+
+
+static double ReadF64(const rmtU8* data)
+{
+    // Sent as doubles in host order for the viewer's DataView
+    double value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+
+// Returns the offset after the sample, or 0 if it isn't timed within its parent
+static rmtU32 CheckSample(const rmtU8* data, rmtU32 offset, rmtU32 length, double parent_start, double parent_end, rmtU32 depth)
+{
+    // name hash, id, colour, start, length, self, calls, recursion, children
+    const rmtU32 sample_size = 4 + 4 + 7 + 8 + 8 + 8 + 4 + 4 + 4;
+    double start, end;
+    rmtU32 i, nb_children;
+
+    if (offset + sample_size > length)
+        return 0;
+    start = ReadF64(data + offset + 15);
+    end = start + ReadF64(data + offset + 23);
+    nb_children = ReadU32(data + offset + sample_size - 4);
+    if (end < start || (depth > 0 && (start < parent_start || end > parent_end)))
+    {
+        printf("Vulkan sample at depth %u spans %.0f..%.0f ns outside its parent's %.0f..%.0f ns\n",
+            depth, start, end, parent_start, parent_end);
+        return 0;
+    }
+
+    // The frame holds two passes, and passes hold nothing
+    if (nb_children != (depth == 0 ? 2u : 0u))
+    {
+        printf("Vulkan sample at depth %u has %u children\n", depth, nb_children);
+        return 0;
+    }
+
+    offset += sample_size;
+    for (i = 0; i < nb_children && offset != 0; i++)
+        offset = CheckSample(data, offset, length, start, end, depth + 1);
+    return offset;
+}
+
+
+// Returns 1 for a good Vulkan sample tree, 0 for other messages and -1 for a bad Vulkan sample tree
+static int CheckMessage(const rmtU8* data, rmtU32 length)
+{
+    static const char vulkan_suffix[] = " (Vulkan)";
+    const rmtU32 suffix_length = sizeof(vulkan_suffix) - 1;
+    rmtU32 name_length;
+
+    // "SMPL", size, thread name, sample count, digest and the root sample
+    if (length < 12 || memcmp(data, "SMPL", 4) != 0)
+        return 0;
+    name_length = ReadU32(data + 8);
+    if (12 + name_length + 8 > length)
+        return -1;
+    if (name_length < suffix_length || memcmp(data + 12 + name_length - suffix_length, vulkan_suffix, suffix_length) != 0)
+        return 0;
+
+    return CheckSample(data, 12 + name_length + 8, length, 0, 0, 0) == length ? 1 : -1;
+}
+
+
+int main(int argc, char* argv[])
+{
+    static rmtU8 message[1024 * 1024];
+    rmtSettings* settings;
+    Remotery* rmt;
+    TestVulkan vk;
+    rmtVulkanBind bind;
+    TestSocket viewer;
+    rmtU32 length;
+    int result, frame, nb_trees = 0;
+
+    if (argc > 2)
+    {
+        printf("Usage: %s [port]\n", argv[0]);
+        return 1;
+    }
+
+    result = TestVulkan_Create(&vk);
+    if (result != 0)
+    {
+        TestVulkan_Destroy(&vk);
+        return result;
+    }
+
+    settings = rmt_Settings();
+    settings->reuse_open_port = RMT_TRUE;
+    if (argc > 1)
+        settings->port = (rmtU16)atoi(argv[1]);
+    if (rmt_CreateGlobalInstance(&rmt) != RMT_ERROR_NONE)
+    {
+        printf("Failed to create Remotery\n");
+        TestVulkan_Destroy(&vk);
+        return 1;
+    }
+
+    bind.instance = vk.instance;
+    bind.physical_device = vk.physical_device;
+    bind.device = vk.device;
+    bind.queue_family_index = vk.queue_family_index;
+    bind.host_query_reset = RMT_FALSE;
+    bind.GetInstanceProcAddr = (void*)vk.GetInstanceProcAddr;
+    rmt_BindVulkan(&bind);
+
+    // Samples are only sent once a viewer is connected
+    viewer = Viewer_Connect(settings->port);
+    if (viewer == INVALID_SOCKET)
+    {
+        printf("Failed to connect to Remotery on port %d\n", settings->port);
+        result = 1;
+    }
+    SleepMs(200);
+
+    for (frame = 0; frame < NB_FRAMES && result == 0; frame++)
+    {
+        if (TestVulkan_RecordFrame(&vk) != 0)
+        {
+            printf("Failed to record or submit frame %d\n", frame);
+            result = 1;
+        }
+    }
+
+    // Every frame but the last has been read back, look for them in what's been sent
+    while (result == 0 && nb_trees < NB_FRAMES - 1 && (length = Viewer_ReadMessage(viewer, message, sizeof(message))) != 0)
+    {
+        int check = CheckMessage(message, length);
+        if (check < 0)
+            result = 1;
+        else
+            nb_trees += check;
+    }
+    if (result == 0 && nb_trees < NB_FRAMES - 1)
+    {
+        printf("Only received %d of %d Vulkan sample trees\n", nb_trees, NB_FRAMES - 1);
+        result = 1;
+    }
+
+    // Unbinding waits for the Vulkan samples to be sent, which only happens while a viewer is connected
+    rmt_UnbindVulkan();
+    rmt_DestroyGlobalInstance(rmt);
+    if (viewer != INVALID_SOCKET)
+        closesocket_(viewer);
+    TestVulkan_Destroy(&vk);
+
+    if (result == 0)
+        printf("Received %d timed Vulkan sample trees\n", nb_trees);
+    return result;
+}
@@ -25,6 +25,13 @@ DataViewReader = (function ()
         return v;
     }
 
+    DataViewReader.prototype.GetFloat64 = function ()
+    {
+        var v = this.DataView.getFloat64(this.Offset, true);
+        this.Offset += 8;
+        return v;
+    }
+
     DataViewReader.prototype.GetStringOfLength = function (string_length)
     {
         var string = "";
@@ -0,0 +1,237 @@
+
+PropertyWindow = (function()
+{
+    var GRAPH_HEIGHT = 120;
+
+    // Number of snapshots kept for graphing each property
+    var MAX_NB_VALUES = 400;
+
+    var TYPE_GROUP = 0;
+    var TYPE_BOOL = 1;
+    var TYPE_F32 = 4;
+    var TYPE_F64 = 7;
+
+
+    function PropertyWindow(wm, offset)
+    {
+        this.XPos = 10 + offset * 410;
+        this.Window = wm.AddWindow("Properties", 100, 100, 100, 100);
+        this.Window.Show();
+        this.Visible = true;
+
+        // Graph of the selected property above a grid of all the latest values
+        this.GraphContainer = this.Window.AddControlNew(new WM.Container(0, 0, 380, GRAPH_HEIGHT));
+        this.CanvasNode = DOM.Node.AppendHTML(this.GraphContainer.Node, "<canvas class='PropertyGraphCanvas'></canvas>");
+        this.CanvasNode.width = 380;
+        this.CanvasNode.height = GRAPH_HEIGHT;
+        this.Ctx = this.CanvasNode.getContext("2d");
+
+        this.Grid = this.Window.AddControlNew(new WM.Grid(0, GRAPH_HEIGHT + 5, 380, "calc( 100% - " + (GRAPH_HEIGHT + 22) + "px )"));
+        var cell_data =
+        {
+            Name: "Properties",
+            Value: "Value",
+        };
+        var cell_classes =
+        {
+            Name: "PropertyTitleNameCell",
+            Value: "PropertyTitleValueCell",
+        };
+        this.RootRow = this.Grid.Rows.Add(cell_data, "GridGroup", cell_classes);
+        this.RootRow.Rows.AddIndex("_ID");
+
+        // Latest value and history of each property, indexed by name hash
+        this.Properties = { };
+        this.SelectedProperty = null;
+
+        // Snapshots can arrive at frame rate so only update the HTML periodically
+        this.Dirty = false;
+        window.setInterval(Bind(Update, this), 100);
+    }
+
+
+    PropertyWindow.prototype.SetXPos = function(xpos, top_window, bottom_window)
+    {
+        Anim.Animate(
+            Bind(AnimatedMove, this, top_window, bottom_window),
+            this.XPos, 10 + xpos * 410, 0.25);
+    }
+
+
+    function AnimatedMove(self, top_window, bottom_window, val)
+    {
+        self.XPos = val;
+        self.WindowResized(top_window, bottom_window);
+    }
+
+
+    PropertyWindow.prototype.WindowResized = function(top_window, bottom_window)
+    {
+        var top = top_window.Position[1] + top_window.Size[1] + 10;
+        this.Window.SetPosition(this.XPos, top_window.Position[1] + top_window.Size[1] + 10);
+        this.Window.SetSize(400, bottom_window.Position[1] - 10 - top);
+    }
+
+
+    PropertyWindow.prototype.OnPropertySnapshot = function(snapshot)
+    {
+        for (var i in snapshot.properties)
+        {
+            var snapshot_property = snapshot.properties[i];
+
+            // Add rows for new properties, after their parent group which is always sent first
+            var property = this.Properties[snapshot_property.name_hash];
+            if (property == undefined)
+            {
+                property = AddProperty(this, snapshot_property);
+                this.Properties[snapshot_property.name_hash] = property;
+            }
+
+            // Add to the history, discarding old values to keep memory-use constant
+            property.Values.push(snapshot_property.value);
+            if (property.Values.length > MAX_NB_VALUES)
+                property.Values.shift();
+        }
+
+        this.Dirty = true;
+    }
+
+
+    function AddProperty(self, snapshot_property)
+    {
+        var property = { };
+        property.Name = snapshot_property.name;
+        property.Type = snapshot_property.type;
+        property.Values = [ ];
+
+        // Indent below any parent
+        var parent = self.Properties[snapshot_property.parent_name_hash];
+        property.Depth = parent ? parent.Depth + 1 : 0;
+        var indent = "";
+        for (var i = 0; i < property.Depth; i++)
+            indent += "&nbsp;&nbsp;&nbsp;&nbsp;&nbsp;";
+        property.Indent = indent;
+
+        var cell_data =
+        {
+            _ID: snapshot_property.name_hash,
+            Name: indent + property.Name.string,
+            Value: "",
+        };
+        var cell_classes =
+        {
+            Name: "PropertyNameCell",
+            Value: "PropertyValueCell",
+        };
+        property.Row = self.RootRow.Rows.Add(cell_data, null, cell_classes);
+        property.RowName = property.Name.string;
+
+        // Graph the first property with a value until the user clicks on another
+        if (property.Type != TYPE_GROUP)
+        {
+            DOM.Event.AddHandler(property.Row.Node, "click", function() { SelectProperty(self, property); });
+            if (self.SelectedProperty == null)
+                self.SelectedProperty = property;
+        }
+
+        return property;
+    }
+
+
+    function SelectProperty(self, property)
+    {
+        self.SelectedProperty = property;
+        DrawGraph(self);
+    }
+
+
+    function FormatValue(type, value)
+    {
+        if (type == TYPE_GROUP)
+            return "";
+        if (type == TYPE_BOOL)
+            return value != 0 ? "true" : "false";
+        if (type == TYPE_F32 || type == TYPE_F64)
+            return value.toFixed(3);
+        return value.toString();
+    }
+
+
+    function Update(self)
+    {
+        if (!self.Dirty || !self.Visible)
+            return;
+        self.Dirty = false;
+
+        for (var i in self.Properties)
+        {
+            var property = self.Properties[i];
+
+            // Property name will change when it switches from hash ID to network-retrieved name
+            if (property.RowName != property.Name.string)
+            {
+                property.RowName = property.Name.string;
+                property.Row.CellNodes["Name"].innerHTML = property.Indent + property.Name.string;
+            }
+
+            if (property.Values.length > 0)
+                property.Row.CellNodes["Value"].innerHTML = FormatValue(property.Type, property.Values[property.Values.length - 1]);
+        }
+
+        DrawGraph(self);
+    }
+
+
+    function DrawGraph(self)
+    {
+        var ctx = self.Ctx;
+        var w = self.CanvasNode.width;
+        var h = self.CanvasNode.height;
+
+        ctx.fillStyle = "#222";
+        ctx.fillRect(0, 0, w, h);
+
+        var property = self.SelectedProperty;
+        if (property == null || property.Values.length == 0)
+            return;
+
+        // Scale to the range of the visible values, always including zero
+        var values = property.Values;
+        var min = 0;
+        var max = 0;
+        for (var i = 0; i < values.length; i++)
+        {
+            min = Math.min(min, values[i]);
+            max = Math.max(max, values[i]);
+        }
+        var range = max - min;
+        if (range == 0)
+            range = 1;
+
+        // Newest value on the right
+        var top = 14;
+        var bottom = h - 4;
+        var x_step = w / (MAX_NB_VALUES - 1);
+        var x = w - (values.length - 1) * x_step;
+        ctx.strokeStyle = "#7CF";
+        ctx.beginPath();
+        for (var i = 0; i < values.length; i++)
+        {
+            var y = bottom - (values[i] - min) / range * (bottom - top);
+            if (i == 0)
+                ctx.moveTo(x, y);
+            else
+                ctx.lineTo(x, y);
+            x += x_step;
+        }
+        ctx.stroke();
+
+        ctx.fillStyle = "#BBB";
+        ctx.font = "9px Verdana";
+        ctx.fillText(property.Name.string + ": " + FormatValue(property.Type, values[values.length - 1]), 4, 10);
+        ctx.fillText("max " + FormatValue(property.Type, max) + "  min " + FormatValue(property.Type, min), w / 2, 10);
+    }
+
+
+    return PropertyWindow;
+})();
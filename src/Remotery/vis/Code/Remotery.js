@@ -69,9 +69,11 @@ Remotery = (function()
         this.FrameHistory = { };
         this.SelectedFrames = { };
         this.NameMap = { };
+        this.PropertyWindow = null;
 
         this.Server.AddMessageHandler("SMPL", Bind(OnSamples, this));
         this.Server.AddMessageHandler("SSMP", Bind(OnSampleName, this));
+        this.Server.AddMessageHandler("PSNP", Bind(OnPropertySnapshot, this));
 
         // Kick-off the auto-connect loop
         AutoConnect(this);
@@ -147,35 +149,47 @@ Remotery = (function()
     }
 
 
-    function DecodeSample(self, data_view_reader)
+    function GetName(self, name_hash)
     {
-        var sample = {};
-
-        // Get name hash and lookup name it map
-        sample.name_hash = data_view_reader.GetUInt32();
-        sample.name = self.NameMap[sample.name_hash];
+        // Lookup name in the map
+        var name = self.NameMap[name_hash];
 
         // If the name doesn't exist in the map yet, request it from the server
-        if (sample.name == undefined)
+        if (name == undefined)
         {
             // Meanwhile, store the hash as the name
-            sample.name = { "string": sample.name_hash };
-            self.NameMap[sample.name_hash] = sample.name;
-            self.Server.Send("GSMP" + sample.name_hash);
+            name = { "string": name_hash };
+            self.NameMap[name_hash] = name;
+            self.Server.Send("GSMP" + name_hash);
         }
 
+        return name;
+    }
+
+
+    function DecodeSample(self, data_view_reader)
+    {
+        var sample = {};
+
+        // Get name hash and lookup name it map
+        sample.name_hash = data_view_reader.GetUInt32();
+        sample.name = GetName(self, sample.name_hash);
+
         // Get the rest of the sample data
         sample.id = data_view_reader.GetUInt32();
         sample.colour = data_view_reader.GetStringOfLength(7);
-        sample.us_start = data_view_reader.GetUInt64();
-        sample.us_length = data_view_reader.GetUInt64();
-        sample.us_self = data_view_reader.GetUInt64();
+        sample.ns_start = data_view_reader.GetUInt64();
+        sample.ns_length = data_view_reader.GetUInt64();
+        sample.ns_self = data_view_reader.GetUInt64();
         sample.call_count = data_view_reader.GetUInt32();
         sample.recurse_depth = data_view_reader.GetUInt32();
 
-        // Calculate dependent properties
-        sample.ms_length = (sample.us_length / 1000.0).toFixed(3);
-        sample.ms_self = (sample.us_self / 1000.0).toFixed(3);
+        // Calculate dependent properties, keeping sub-microsecond precision
+        sample.us_start = sample.ns_start / 1000.0;
+        sample.us_length = sample.ns_length / 1000.0;
+        sample.us_self = sample.ns_self / 1000.0;
+        sample.ms_length = (sample.ns_length / 1000000.0).toFixed(6);
+        sample.ms_self = (sample.ns_self / 1000000.0).toFixed(6);
 
         // Recurse into children
         sample.children = [];
@@ -241,7 +255,7 @@ Remotery = (function()
             self.SampleWindows[name] = new SampleWindow(self.WindowManager, name, self.NbSampleWindows);
             self.SampleWindows[name].WindowResized(self.TimelineWindow.Window, self.Console.Window);
             self.NbSampleWindows++;
-            MoveSampleWindows(this);
+            MoveSampleWindows(self);
         }
 
         // Set on the window and timeline
@@ -250,13 +264,62 @@ Remotery = (function()
     }
 
 
+    function DecodePropertySnapshot(self, data_view_reader)
+    {
+        var snapshot = { };
+        snapshot.ns_time = data_view_reader.GetUInt64();
+        snapshot.frame_index = data_view_reader.GetUInt32();
+        snapshot.properties = [ ];
+
+        // Properties are in registration order, with groups before their children
+        var nb_properties = data_view_reader.GetUInt32();
+        for (var i = 0; i < nb_properties; i++)
+        {
+            var property = { };
+            property.name_hash = data_view_reader.GetUInt32();
+            property.name = GetName(self, property.name_hash);
+            property.parent_name_hash = data_view_reader.GetUInt32();
+            property.type = data_view_reader.GetUInt32();
+            property.value = data_view_reader.GetFloat64();
+            snapshot.properties.push(property);
+        }
+
+        return snapshot;
+    }
+
+
+    function OnPropertySnapshot(self, socket, data_view)
+    {
+        // Discard any new values while paused
+        if (self.Settings.IsPaused)
+            return;
+
+        var snapshot = DecodePropertySnapshot(self, new DataViewReader(data_view, 8));
+
+        // Create the property window on-demand, placed after the sample windows
+        if (self.PropertyWindow == null)
+        {
+            self.PropertyWindow = new PropertyWindow(self.WindowManager, self.NbSampleWindows);
+            self.PropertyWindow.WindowResized(self.TimelineWindow.Window, self.Console.Window);
+            MoveSampleWindows(self);
+        }
+
+        self.PropertyWindow.OnPropertySnapshot(snapshot);
+    }
+
+
     function OnSampleName(self, socket, data_view)
     {
         // Add any names sent by the server to the local map
         var data_view_reader = new DataViewReader(data_view, 4);
         var name_hash = data_view_reader.GetUInt32();
         var name = data_view_reader.GetString();
-        self.NameMap[name_hash].string = name;
+
+        // Replayed captures send names before they're requested
+        if (self.NameMap[name_hash] == undefined)
+            self.NameMap[name_hash] = { "string": name };
+        else
+            self.NameMap[name_hash].string = name;
     }
 
 
@@ -279,6 +342,9 @@ Remotery = (function()
             if (sample_window.Visible)
                 sample_window.SetXPos(xpos++, self.TimelineWindow.Window, self.Console.Window);
         }
+
+        if (self.PropertyWindow != null)
+            self.PropertyWindow.SetXPos(xpos, self.TimelineWindow.Window, self.Console.Window);
     }
 
 
@@ -331,6 +397,8 @@ Remotery = (function()
         self.TimelineWindow.WindowResized(w, h, self.TitleWindow.Window);
         for (var i in self.SampleWindows)
             self.SampleWindows[i].WindowResized(self.TimelineWindow.Window, self.Console.Window);
+        if (self.PropertyWindow != null)
+            self.PropertyWindow.WindowResized(self.TimelineWindow.Window, self.Console.Window);
     }
 
 
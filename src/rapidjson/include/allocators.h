@@ -139,6 +139,7 @@ class MemoryPoolAllocator {
 
     struct SharedData {
         ChunkHeader *chunkHead;  //!< Head of the chunk linked-list. Only the head chunk serves allocation.
+        ChunkHeader *spareHead;  //!< Head of the chunks kept by Reset() for reuse.
         BaseAllocator* ownBaseAllocator; //!< base allocator created by this object.
         size_t refcount;
         bool ownBuffer;
@@ -184,6 +185,7 @@ public:
         shared_->chunkHead->capacity = 0;
         shared_->chunkHead->size = 0;
         shared_->chunkHead->next = 0;
+        shared_->spareHead = 0;
         shared_->ownBuffer = true;
         shared_->refcount = 1;
     }
@@ -208,6 +210,7 @@ public:
         shared_->chunkHead->capacity = size - SIZEOF_SHARED_DATA - SIZEOF_CHUNK_HEADER;
         shared_->chunkHead->size = 0;
         shared_->chunkHead->next = 0;
+        shared_->spareHead = 0;
         shared_->ownBaseAllocator = 0;
         shared_->ownBuffer = false;
         shared_->refcount = 1;
@@ -285,6 +288,45 @@ public:
             baseAllocator_->Free(c);
         }
         shared_->chunkHead->size = 0;
+        FreeSpareChunks();
+    }
+
+    //! Empties all memory chunks but keeps them for the following allocations.
+    /*! Like Clear(), this invalidates every block allocated so far, so the
+        values using them (e.g. a GenericDocument) must be gone. The chunks
+        after the first/user one are handed out again before any new chunk
+        is allocated, so a pool that is reset per parsed message stops
+        calling the base allocator once it has seen the largest message.
+
+        \param coalesce If more than one chunk is kept, replace them by a
+            single chunk of the size used since the last Clear() or Reset().
+    */
+    void Reset(bool coalesce = false) RAPIDJSON_NOEXCEPT {
+        RAPIDJSON_NOEXCEPT_ASSERT(shared_->refcount > 0);
+        size_t used = 0;
+        for (;;) {
+            ChunkHeader* c = shared_->chunkHead;
+            if (!c->next) {
+                break;
+            }
+            shared_->chunkHead = c->next;
+            used += c->size;
+            c->size = 0;
+            c->next = shared_->spareHead;
+            shared_->spareHead = c;
+        }
+        shared_->chunkHead->size = 0;
+
+        if (coalesce && shared_->spareHead && shared_->spareHead->next) {
+            FreeSpareChunks();
+            const size_t capacity = used > chunk_capacity_ ? used : chunk_capacity_;
+            if (ChunkHeader* chunk = static_cast<ChunkHeader*>(baseAllocator_->Malloc(SIZEOF_CHUNK_HEADER + capacity))) {
+                chunk->capacity = capacity;
+                chunk->size = 0;
+                chunk->next = 0;
+                shared_->spareHead = chunk;
+            }
+        }
     }
 
     //! Computes the total capacity of allocated memory chunks.
@@ -295,6 +337,8 @@ public:
         size_t capacity = 0;
         for (ChunkHeader* c = shared_->chunkHead; c != 0; c = c->next)
             capacity += c->capacity;
+        for (ChunkHeader* c = shared_->spareHead; c != 0; c = c->next)
+            capacity += c->capacity;
         return capacity;
     }
 
@@ -388,6 +432,17 @@ private:
         \return true if success.
     */
     bool AddChunk(size_t capacity) {
+        // The first chunk kept by Reset() that is large enough
+        for (ChunkHeader** spare = &shared_->spareHead; *spare != 0; spare = &(*spare)->next) {
+            if ((*spare)->capacity >= capacity) {
+                ChunkHeader* chunk = *spare;
+                *spare = chunk->next;
+                chunk->next = shared_->chunkHead;
+                shared_->chunkHead = chunk;
+                return true;
+            }
+        }
+
         if (!baseAllocator_)
             shared_->ownBaseAllocator = baseAllocator_ = RAPIDJSON_NEW(BaseAllocator)();
         if (ChunkHeader* chunk = static_cast<ChunkHeader*>(baseAllocator_->Malloc(SIZEOF_CHUNK_HEADER + capacity))) {
@@ -401,6 +456,14 @@ private:
             return false;
     }
 
+    //! Deallocates the chunks kept by Reset().
+    void FreeSpareChunks() RAPIDJSON_NOEXCEPT {
+        while (ChunkHeader* c = shared_->spareHead) {
+            shared_->spareHead = c->next;
+            baseAllocator_->Free(c);
+        }
+    }
+
     static inline void* AlignBuffer(void* buf, size_t &size)
     {
         RAPIDJSON_NOEXCEPT_ASSERT(buf != 0);
@@ -420,6 +483,58 @@ private:
     SharedData *shared_;        //!< The shared data of the allocator
 };
 
+#if RAPIDJSON_HAS_CXX11
+///////////////////////////////////////////////////////////////////////////////
+// ThreadLocalMemoryPool
+
+//! MemoryPoolAllocator pair owned by the calling thread.
+/*! For servers that parse one message at a time per thread: the document
+    values and the parsing stack live in two pools of the thread, which
+    are rewound with Reset() once the document is done, so after the
+    largest message no memory is requested from BaseAllocator anymore.
+
+\code
+typedef ThreadLocalMemoryPool<> Pool;
+typedef GenericDocument<UTF8<>, Pool::AllocatorType, Pool::AllocatorType> PoolDocument;
+
+void OnMessage(const char* json) {
+    {
+        PoolDocument d(&Pool::GetAllocator(), 1024, &Pool::GetStackAllocator());
+        d.Parse(json);
+        // ...
+    }
+    Pool::Reset(true);
+}
+\endcode
+
+    \tparam BaseAllocator the allocator type for allocating memory chunks. Default is CrtAllocator.
+    \note requires C++11 thread_local
+*/
+template <typename BaseAllocator = CrtAllocator>
+class ThreadLocalMemoryPool {
+public:
+    typedef MemoryPoolAllocator<BaseAllocator> AllocatorType;
+
+    //! Pool of the calling thread for document values.
+    static AllocatorType& GetAllocator() {
+        static thread_local AllocatorType allocator;
+        return allocator;
+    }
+
+    //! Pool of the calling thread for the parsing stack.
+    static AllocatorType& GetStackAllocator() {
+        static thread_local AllocatorType allocator;
+        return allocator;
+    }
+
+    //! Rewinds both pools of the calling thread. \see MemoryPoolAllocator::Reset()
+    static void Reset(bool coalesce = false) RAPIDJSON_NOEXCEPT {
+        GetAllocator().Reset(coalesce);
+        GetStackAllocator().Reset(coalesce);
+    }
+};
+#endif // RAPIDJSON_HAS_CXX11
+
 namespace internal {
     template<typename, typename = void>
     struct IsRefCounted :
@@ -0,0 +1,183 @@
+// Tencent is pleased to support the open source community by making RapidJSON available.
+//
+// Copyright (C) 2015 THL A29 Limited, a Tencent company, and Milo Yip.
+//
+// Licensed under the MIT License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef RAPIDJSON_ASYNCFILEWRITESTREAM_H_
+#define RAPIDJSON_ASYNCFILEWRITESTREAM_H_
+
+#include "stream.h"
+#include <cstdio>
+
+#if RAPIDJSON_HAS_CXX11
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#ifdef __clang__
+RAPIDJSON_DIAG_PUSH
+RAPIDJSON_DIAG_OFF(unreachable-code)
+#endif
+
+RAPIDJSON_NAMESPACE_BEGIN
+
+//! Wrapper of C file stream for output, writing with fwrite() on a background thread.
+/*!
+    Like FileWriteStream, but the user-supplied buffer is split in two
+    halves. When one half is full it is handed to a background thread to be
+    written, and the writer goes on filling the other half; it only waits
+    when that half is still being written. So formatting and file I/O overlap.
+
+    Flush() hands over the current half and waits until everything has been
+    written, so like FileWriteStream::Flush() all output is in the \c FILE
+    when it returns. The destructor flushes.
+
+    \note implements Stream concept
+    \note Requires C++11 (\c RAPIDJSON_HAS_CXX11).
+*/
+class AsyncFileWriteStream {
+public:
+    typedef char Ch;    //!< Character type. Only support char.
+
+    //! Constructor.
+    /*!
+        \param fp File pointer opened for write. Only the background thread writes to it until Flush() returns.
+        \param buffer user-supplied buffer, used as two halves.
+        \param bufferSize size of buffer in bytes. Must >=2 bytes.
+    */
+    AsyncFileWriteStream(std::FILE* fp, char* buffer, size_t bufferSize) :
+        fp_(fp), buffer_(buffer), half_(bufferSize / 2), current_(buffer), bufferEnd_(buffer + half_),
+        pending_(), pendingSize_(), stop_(false), thread_(&AsyncFileWriteStream::Run, this)
+    {
+        RAPIDJSON_ASSERT(fp_ != 0);
+        RAPIDJSON_ASSERT(bufferSize >= 2);
+    }
+
+    //! Destructor.
+    ~AsyncFileWriteStream() {
+        Flush();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cond_.notify_all();
+        thread_.join();
+    }
+
+    void Put(char c) {
+        if (current_ >= bufferEnd_)
+            Submit();
+
+        *current_++ = c;
+    }
+
+    void PutN(char c, size_t n) {
+        size_t avail = static_cast<size_t>(bufferEnd_ - current_);
+        while (n > avail) {
+            std::memset(current_, c, avail);
+            current_ += avail;
+            Submit();
+            n -= avail;
+            avail = static_cast<size_t>(bufferEnd_ - current_);
+        }
+
+        if (n > 0) {
+            std::memset(current_, c, n);
+            current_ += n;
+        }
+    }
+
+    void Flush() {
+        Submit();
+        std::unique_lock<std::mutex> lock(mutex_);
+        cond_.wait(lock, [this] { return pendingSize_ == 0; });
+    }
+
+    // Not implemented
+    char Peek() const { RAPIDJSON_ASSERT(false); return 0; }
+    char Take() { RAPIDJSON_ASSERT(false); return 0; }
+    size_t Tell() const { RAPIDJSON_ASSERT(false); return 0; }
+    char* PutBegin() { RAPIDJSON_ASSERT(false); return 0; }
+    size_t PutEnd(char*) { RAPIDJSON_ASSERT(false); return 0; }
+
+private:
+    //! Hands the current half to the thread and switches to the other one.
+    void Submit() {
+        char* begin = bufferEnd_ - half_;
+        if (current_ == begin)
+            return;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cond_.wait(lock, [this] { return pendingSize_ == 0; });
+            pending_ = begin;
+            pendingSize_ = static_cast<size_t>(current_ - begin);
+        }
+        cond_.notify_all();
+
+        begin = begin == buffer_ ? buffer_ + half_ : buffer_;
+        current_ = begin;
+        bufferEnd_ = begin + half_;
+    }
+
+    void Run() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            cond_.wait(lock, [this] { return pendingSize_ != 0 || stop_; });
+            if (pendingSize_ == 0)
+                return;
+
+            lock.unlock();
+            size_t result = std::fwrite(pending_, 1, pendingSize_, fp_);
+            if (result < pendingSize_) {
+                // failure deliberately ignored at this time, as in FileWriteStream
+            }
+            lock.lock();
+
+            pendingSize_ = 0;
+            cond_.notify_all();
+        }
+    }
+
+    // Prohibit copy constructor & assignment operator.
+    AsyncFileWriteStream(const AsyncFileWriteStream&);
+    AsyncFileWriteStream& operator=(const AsyncFileWriteStream&);
+
+    std::FILE* fp_;
+    char *buffer_;
+    size_t half_;
+    char *current_;
+    char *bufferEnd_;           //!< End of the half being filled.
+
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    const char* pending_;       //!< Half being written by the thread.
+    size_t pendingSize_;        //!< Bytes of pending_, 0 when the thread is idle.
+    bool stop_;
+    std::thread thread_;        //!< Last, so it starts after the other members.
+};
+
+//! Implement specialized version of PutN() with memset() for better performance.
+template<>
+inline void PutN(AsyncFileWriteStream& stream, char c, size_t n) {
+    stream.PutN(c, n);
+}
+
+RAPIDJSON_NAMESPACE_END
+
+#ifdef __clang__
+RAPIDJSON_DIAG_POP
+#endif
+
+#endif // RAPIDJSON_HAS_CXX11
+
+#endif // RAPIDJSON_ASYNCFILEWRITESTREAM_H_
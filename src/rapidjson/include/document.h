@@ -20,6 +20,7 @@
 #include "reader.h"
 #include "internal/meta.h"
 #include "internal/strfunc.h"
+#include "internal/intern.h"
 #include "memorystream.h"
 #include "encodedstream.h"
 #include <new>      // placement new
@@ -2124,6 +2125,8 @@ private:
         struct Less {
             bool operator()(const Data& s1, const Data& s2) const {
                 SizeType n1 = DataStringLength(s1), n2 = DataStringLength(s2);
+                if (n1 == n2 && DataString(s1) == DataString(s2))
+                    return false; // same (e.g. interned) string
                 int cmp = std::memcmp(DataString(s1), DataString(s2), sizeof(Ch) * (n1 < n2 ? n1 : n2));
                 return cmp < 0 || (cmp == 0 && n1 < n2);
             }
@@ -2263,7 +2266,194 @@ private:
         }
     }
 
-#else // !RAPIDJSON_USE_MEMBERSMAP
+#elif RAPIDJSON_USE_MEMBERSHASH
+
+    //
+    // Layout of the members' array, re(al)located according to the needed capacity:
+    //
+    //    {MembersHash*}<>{Member[capacity]}
+    //
+    // The hash table is a separate block {MembersHash}<>{MembersHashSlot[mask + 1]}
+    // with linear probing, created once the object has RAPIDJSON_MEMBERSHASH_THRESHOLD
+    // members and regrown (rebuilt) when it gets more than 3/4 full.
+    //
+
+    struct MembersHashSlot {
+        SizeType hash;
+        SizeType index; // member index + 1, or 0 for an empty slot
+    };
+    struct MembersHash {
+        SizeType mask;  // number of slots - 1
+        SizeType count; // used slots
+    };
+
+    static RAPIDJSON_FORCEINLINE size_t GetMembersLayoutSize(SizeType capacity) {
+        return RAPIDJSON_ALIGN(sizeof(MembersHash*)) + capacity * sizeof(Member);
+    }
+
+    static RAPIDJSON_FORCEINLINE MembersHash* &GetMembersHash(Member* members) {
+        RAPIDJSON_ASSERT(members != 0);
+        return *reinterpret_cast<MembersHash**>(reinterpret_cast<uintptr_t>(members) -
+                                                RAPIDJSON_ALIGN(sizeof(MembersHash*)));
+    }
+
+    static RAPIDJSON_FORCEINLINE MembersHashSlot* GetMembersHashSlots(MembersHash* hash) {
+        return reinterpret_cast<MembersHashSlot*>(reinterpret_cast<uintptr_t>(hash) +
+                                                  RAPIDJSON_ALIGN(sizeof(MembersHash)));
+    }
+
+    static SizeType HashMemberName(const Ch* str, SizeType length) {
+        // FNV-1a over the bytes of the string
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(str);
+        size_t n = length * sizeof(Ch);
+        uint32_t h = 2166136261u;
+        for (size_t i = 0; i < n; i++)
+            h = (h ^ p[i]) * 16777619u;
+        return static_cast<SizeType>(h);
+    }
+
+    static void InsertMembersHash(MembersHash* hash, SizeType h, SizeType index) {
+        MembersHashSlot* slots = GetMembersHashSlots(hash);
+        SizeType i = h & hash->mask;
+        while (slots[i].index)
+            i = (i + 1) & hash->mask;
+        slots[i].hash = h;
+        slots[i].index = index + 1;
+        ++hash->count;
+    }
+
+    static SizeType FindMembersHashSlot(MembersHash* hash, Member* members, SizeType index) {
+        MembersHashSlot* slots = GetMembersHashSlots(hash);
+        SizeType i = HashMemberName(members[index].name.GetString(), members[index].name.GetStringLength()) & hash->mask;
+        while (slots[i].index != index + 1) {
+            RAPIDJSON_ASSERT(slots[i].index != 0); // stale index (renamed member?)
+            i = (i + 1) & hash->mask;
+        }
+        return i;
+    }
+
+    // Empty slot i, moving later entries of its probe sequence back so no lookup stops early.
+    static void EraseMembersHashSlot(MembersHash* hash, SizeType i) {
+        MembersHashSlot* slots = GetMembersHashSlots(hash);
+        for (SizeType j = (i + 1) & hash->mask; slots[j].index; j = (j + 1) & hash->mask) {
+            SizeType k = slots[j].hash & hash->mask;
+            if (i <= j ? (i < k && k <= j) : (i < k || k <= j))
+                continue; // already between its home slot and i
+            slots[i] = slots[j];
+            i = j;
+        }
+        slots[i].index = 0;
+        --hash->count;
+    }
+
+    void FillMembersHash(MembersHash* hash) {
+        Member* members = GetMembersPointer();
+        std::memset(static_cast<void*>(GetMembersHashSlots(hash)), 0,
+                    (static_cast<size_t>(hash->mask) + 1) * sizeof(MembersHashSlot));
+        hash->count = 0;
+        for (SizeType i = 0; i < data_.o.size; i++)
+            InsertMembersHash(hash, HashMemberName(members[i].name.GetString(), members[i].name.GetStringLength()), i);
+    }
+
+    void DoBuildMembersHash(Allocator& allocator) {
+        MembersHash* &hash = GetMembersHash(GetMembersPointer());
+        SizeType slots = 16;
+        while (slots < data_.o.size * 2)
+            slots <<= 1;
+        Allocator::Free(hash);
+        hash = static_cast<MembersHash*>(allocator.Malloc(RAPIDJSON_ALIGN(sizeof(MembersHash)) +
+                                                          slots * sizeof(MembersHashSlot)));
+        hash->mask = slots - 1;
+        FillMembersHash(hash);
+    }
+
+    void DoAddMembersHash(SizeType index, Allocator& allocator) {
+        MembersHash* hash = GetMembersHash(GetMembersPointer());
+        if (!hash ? data_.o.size >= RAPIDJSON_MEMBERSHASH_THRESHOLD
+                  : (hash->count + 1) * 4 > (hash->mask + 1) * 3)
+            DoBuildMembersHash(allocator);
+        else if (hash)
+        {
+            const GenericValue& name = GetMembersPointer()[index].name;
+            InsertMembersHash(hash, HashMemberName(name.GetString(), name.GetStringLength()), index);
+        }
+    }
+
+    // Drop member index from the table, the last member is about to take its place.
+    void DoRemoveMembersHash(SizeType index) {
+        Member* members = GetMembersPointer();
+        if (MembersHash* hash = GetMembersHash(members)) {
+            SizeType last = data_.o.size - 1;
+            EraseMembersHashSlot(hash, FindMembersHashSlot(hash, members, index));
+            if (index != last)
+                GetMembersHashSlots(hash)[FindMembersHashSlot(hash, members, last)].index = index + 1;
+        }
+    }
+
+    RAPIDJSON_FORCEINLINE Member* DoAllocMembers(SizeType capacity, Allocator& allocator) {
+        MembersHash** base = static_cast<MembersHash**>(allocator.Malloc(GetMembersLayoutSize(capacity)));
+        *base = 0;
+        return reinterpret_cast<Member*>(reinterpret_cast<uintptr_t>(base) + RAPIDJSON_ALIGN(sizeof(MembersHash*)));
+    }
+
+    void DoReserveMembers(SizeType newCapacity, Allocator& allocator) {
+        ObjectData& o = data_.o;
+        if (newCapacity > o.capacity) {
+            Member* oldMembers = GetMembersPointer();
+            if (!oldMembers) {
+                SetMembersPointer(DoAllocMembers(newCapacity, allocator));
+            }
+            else {
+                void* base = allocator.Realloc(&GetMembersHash(oldMembers), GetMembersLayoutSize(o.capacity),
+                                               GetMembersLayoutSize(newCapacity));
+                SetMembersPointer(reinterpret_cast<Member*>(reinterpret_cast<uintptr_t>(base) +
+                                                            RAPIDJSON_ALIGN(sizeof(MembersHash*))));
+            }
+            o.capacity = newCapacity;
+        }
+    }
+
+    template <typename SourceAllocator>
+    MemberIterator DoFindMember(const GenericValue<Encoding, SourceAllocator>& name) {
+        Member* members = GetMembersPointer();
+        if (MembersHash* hash = members ? GetMembersHash(members) : 0) {
+            MembersHashSlot* slots = GetMembersHashSlots(hash);
+            SizeType h = HashMemberName(name.GetString(), name.GetStringLength());
+            for (SizeType i = h & hash->mask; slots[i].index; i = (i + 1) & hash->mask)
+                if (slots[i].hash == h && name.StringEqual(members[slots[i].index - 1].name))
+                    return MemberIterator(&members[slots[i].index - 1]);
+            return MemberEnd();
+        }
+        MemberIterator member = MemberBegin();
+        for ( ; member != MemberEnd(); ++member)
+            if (name.StringEqual(member->name))
+                break;
+        return member;
+    }
+
+    void DoClearMembers() {
+        if (Member* members = GetMembersPointer()) {
+            for (SizeType i = 0; i < data_.o.size; i++)
+                members[i].~Member();
+            data_.o.size = 0;
+            if (MembersHash* hash = GetMembersHash(members))
+                FillMembersHash(hash);
+        }
+    }
+
+    void DoFreeMembers() {
+        if (Member* members = GetMembersPointer()) {
+            for (SizeType i = 0; i < data_.o.size; i++)
+                members[i].~Member();
+            if (Allocator::kNeedFree) { // Shortcut by Allocator's trait
+                MembersHash** base = &GetMembersHash(members);
+                Allocator::Free(*base);
+                Allocator::Free(base);
+            }
+        }
+    }
+
+#else // !RAPIDJSON_USE_MEMBERSMAP && !RAPIDJSON_USE_MEMBERSHASH
 
     RAPIDJSON_FORCEINLINE Member* DoAllocMembers(SizeType capacity, Allocator& allocator) {
         return Malloc<Member>(allocator, capacity);
@@ -2299,7 +2489,7 @@ private:
         Allocator::Free(GetMembersPointer());
     }
 
-#endif // !RAPIDJSON_USE_MEMBERSMAP
+#endif // !RAPIDJSON_USE_MEMBERSMAP && !RAPIDJSON_USE_MEMBERSHASH
 
     void DoAddMember(GenericValue& name, GenericValue& value, Allocator& allocator) {
         ObjectData& o = data_.o;
@@ -2315,6 +2505,9 @@ private:
         new (&mit[o.size]) MapIterator(map->insert(MapPair(m->name.data_, o.size)));
 #endif
         ++o.size;
+#if RAPIDJSON_USE_MEMBERSHASH
+        DoAddMembersHash(o.size - 1, allocator);
+#endif
     }
 
     MemberIterator DoRemoveMember(MemberIterator m) {
@@ -2325,6 +2518,8 @@ private:
         MapIterator* mit = GetMapIterators(map);
         SizeType mpos = static_cast<SizeType>(&*m - members);
         map->erase(DropMapIterator(mit[mpos]));
+#elif RAPIDJSON_USE_MEMBERSHASH
+        DoRemoveMembersHash(static_cast<SizeType>(&*m - members));
 #endif
         MemberIterator last(members + (o.size - 1));
         if (o.size > 1 && m != last) {
@@ -2372,6 +2567,10 @@ private:
                      static_cast<size_t>(end - last) * sizeof(Member));
 #endif
         o.size -= static_cast<SizeType>(last - first);
+#if RAPIDJSON_USE_MEMBERSHASH
+        if (MembersHash* hash = GetMembersPointer() ? GetMembersHash(GetMembersPointer()) : 0)
+            FillMembersHash(hash); // indices behind the erased range have shifted
+#endif
         return pos;
     }
 
@@ -2396,6 +2595,10 @@ private:
         }
         data_.o.size = data_.o.capacity = count;
         SetMembersPointer(lm);
+#if RAPIDJSON_USE_MEMBERSHASH
+        if (count && count >= RAPIDJSON_MEMBERSHASH_THRESHOLD)
+            DoBuildMembersHash(allocator);
+#endif
     }
 
     // Initialize this value as array with initial data, without calling destructor.
@@ -2429,6 +2632,10 @@ private:
         else
             SetMembersPointer(0);
         data_.o.size = data_.o.capacity = count;
+#if RAPIDJSON_USE_MEMBERSHASH
+        if (count && count >= RAPIDJSON_MEMBERSHASH_THRESHOLD)
+            DoBuildMembersHash(allocator);
+#endif
     }
 
     //! Initialize this value as constant string, without calling destructor.
@@ -2512,7 +2719,8 @@ public:
         \param stackAllocator   Optional allocator for allocating memory for stack.
     */
     explicit GenericDocument(Type type, Allocator* allocator = 0, size_t stackCapacity = kDefaultStackCapacity, StackAllocator* stackAllocator = 0) :
-        GenericValue<Encoding, Allocator>(type),  allocator_(allocator), ownAllocator_(0), stack_(stackAllocator, stackCapacity), parseResult_()
+        GenericValue<Encoding, Allocator>(type),  allocator_(allocator), ownAllocator_(0), stack_(stackAllocator, stackCapacity), parseResult_(),
+        keys_(stackAllocator), internKeys_(false)
     {
         if (!allocator_)
             ownAllocator_ = allocator_ = RAPIDJSON_NEW(Allocator)();
@@ -2525,7 +2733,8 @@ public:
         \param stackAllocator   Optional allocator for allocating memory for stack.
     */
     GenericDocument(Allocator* allocator = 0, size_t stackCapacity = kDefaultStackCapacity, StackAllocator* stackAllocator = 0) : 
-        allocator_(allocator), ownAllocator_(0), stack_(stackAllocator, stackCapacity), parseResult_()
+        allocator_(allocator), ownAllocator_(0), stack_(stackAllocator, stackCapacity), parseResult_(),
+        keys_(stackAllocator), internKeys_(false)
     {
         if (!allocator_)
             ownAllocator_ = allocator_ = RAPIDJSON_NEW(Allocator)();
@@ -2538,7 +2747,9 @@ public:
           allocator_(rhs.allocator_),
           ownAllocator_(rhs.ownAllocator_),
           stack_(std::move(rhs.stack_)),
-          parseResult_(rhs.parseResult_)
+          parseResult_(rhs.parseResult_),
+          keys_(std::move(rhs.keys_)),
+          internKeys_(rhs.internKeys_)
     {
         rhs.allocator_ = 0;
         rhs.ownAllocator_ = 0;
@@ -2554,6 +2765,7 @@ public:
         if (ownAllocator_) {
             ValueType::SetNull();
         }
+        ClearInternedKeys();
         Destroy();
     }
 
@@ -2566,12 +2778,15 @@ public:
         ValueType::operator=(std::forward<ValueType>(rhs));
 
         // Calling the destructor here would prematurely call stack_'s destructor
+        ClearInternedKeys();
         Destroy();
 
         allocator_ = rhs.allocator_;
         ownAllocator_ = rhs.ownAllocator_;
         stack_ = std::move(rhs.stack_);
         parseResult_ = rhs.parseResult_;
+        keys_ = std::move(rhs.keys_);
+        internKeys_ = rhs.internKeys_;
 
         rhs.allocator_ = 0;
         rhs.ownAllocator_ = 0;
@@ -2593,6 +2808,8 @@ public:
         internal::Swap(allocator_, rhs.allocator_);
         internal::Swap(ownAllocator_, rhs.ownAllocator_);
         internal::Swap(parseResult_, rhs.parseResult_);
+        keys_.Swap(rhs.keys_);
+        internal::Swap(internKeys_, rhs.internKeys_);
         return *this;
     }
 
@@ -2801,6 +3018,48 @@ public:
     //! Get the capacity of stack in bytes.
     size_t GetStackCapacity() const { return stack_.GetCapacity(); }
 
+    //!@name Member name interning
+    //!@{
+
+    //! Set whether the names of members parsed from now on are interned.
+    /*! An interned name is a constant string pointing to the only copy of
+        that name in the document, allocated by GetAllocator(). Repetitive
+        documents (e.g. arrays of objects with the same keys) then store each
+        name once, and names can be found by pointer: a name from
+        GetInternedKey() is equal to a member name as soon as their pointers
+        are, see FindMember().
+
+        The copies stay in the document until it is destroyed or
+        ClearInternedKeys() is called, so parsing again reuses them. Like
+        strings parsed in situ, the names are references: values copied out
+        of the document with GenericValue::CopyFrom() need \c copyConstStrings
+        to outlive it.
+    */
+    GenericDocument& SetInternKeys(bool internKeys) { internKeys_ = internKeys; return *this; }
+
+    //! Whether member names are interned. \see SetInternKeys()
+    bool GetInternKeys() const { return internKeys_; }
+
+    //! Interned copy of a member name, or null if no member with this name was parsed.
+    const Ch* GetInternedKey(const Ch* name, SizeType length) const { return keys_.Find(name, length); }
+
+    //! Interned copy of a null-terminated member name, or null.
+    const Ch* GetInternedKey(const Ch* name) const { return GetInternedKey(name, internal::StrLen(name)); }
+
+    //! Number of interned member names.
+    SizeType GetInternedKeyCount() const { return keys_.GetCount(); }
+
+    //! Forget the interned names.
+    /*! Must be called before the allocator is cleared while interning is
+        used. Values still pointing to interned names must be gone if the
+        allocator frees memory (e.g. CrtAllocator).
+    */
+    void ClearInternedKeys() {
+        if (allocator_)
+            keys_.template Clear<Allocator>();
+    }
+    //!@}
+
 private:
     // clear stack on any exit from ParseStream, e.g. due to exception
     struct ClearStackOnExit {
@@ -2844,7 +3103,13 @@ public:
 
     bool StartObject() { new (stack_.template Push<ValueType>()) ValueType(kObjectType); return true; }
     
-    bool Key(const Ch* str, SizeType length, bool copy) { return String(str, length, copy); }
+    bool Key(const Ch* str, SizeType length, bool copy) {
+        if (internKeys_) {
+            new (stack_.template Push<ValueType>()) ValueType(StringRef(keys_.Intern(str, length, GetAllocator()), length));
+            return true;
+        }
+        return String(str, length, copy);
+    }
 
     bool EndObject(SizeType memberCount) {
         typename ValueType::Member* members = stack_.template Pop<typename ValueType::Member>(memberCount);
@@ -2884,6 +3149,8 @@ private:
     Allocator* ownAllocator_;
     internal::Stack<StackAllocator> stack_;
     ParseResult parseResult_;
+    internal::InternTable<Encoding, StackAllocator> keys_;  //!< Interned member names.
+    bool internKeys_;
 };
 
 //! GenericDocument with UTF8 encoding
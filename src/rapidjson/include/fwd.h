@@ -68,6 +68,14 @@ class FileReadStream;
 
 class FileWriteStream;
 
+// asyncfilewritestream.h
+
+class AsyncFileWriteStream;
+
+// memorymappedfile.h
+
+class MemoryMappedFile;
+
 // memorybuffer.h
 
 template <typename Allocator>
@@ -89,6 +97,13 @@ class GenericReader;
 
 typedef GenericReader<UTF8<char>, UTF8<char>, CrtAllocator> Reader;
 
+// recordreader.h
+
+template <typename Encoding, typename StackAllocator>
+class GenericRecordReader;
+
+typedef GenericRecordReader<UTF8<char>, CrtAllocator> RecordReader;
+
 // writer.h
 
 template<typename OutputStream, typename SourceEncoding, typename TargetEncoding, typename StackAllocator, unsigned writeFlags>
@@ -120,6 +135,28 @@ class GenericDocument;
 
 typedef GenericDocument<UTF8<char>, MemoryPoolAllocator<CrtAllocator>, CrtAllocator> Document;
 
+// lazydocument.h
+
+template <typename Encoding, typename Allocator, typename StackAllocator>
+class GenericLazyValue;
+
+typedef GenericLazyValue<UTF8<char>, MemoryPoolAllocator<CrtAllocator>, CrtAllocator> LazyValue;
+
+template <typename Encoding, typename Allocator, typename StackAllocator>
+class GenericLazyDocument;
+
+typedef GenericLazyDocument<UTF8<char>, MemoryPoolAllocator<CrtAllocator>, CrtAllocator> LazyDocument;
+
+// msgpack.h
+
+template<typename OutputStream, typename StackAllocator>
+class MsgPackWriter;
+
+template <typename StackAllocator>
+class GenericMsgPackReader;
+
+typedef GenericMsgPackReader<CrtAllocator> MsgPackReader;
+
 // pointer.h
 
 template <typename ValueType, typename Allocator>
@@ -127,6 +164,16 @@ class GenericPointer;
 
 typedef GenericPointer<Value, CrtAllocator> Pointer;
 
+template <typename ValueType, typename Allocator>
+class GenericPointerSet;
+
+typedef GenericPointerSet<Value, CrtAllocator> PointerSet;
+
+template <typename PointerSetType, typename StackAllocator>
+class GenericPointerSetExtractor;
+
+typedef GenericPointerSetExtractor<PointerSet, CrtAllocator> PointerSetExtractor;
+
 // schema.h
 
 template <typename SchemaDocumentType>
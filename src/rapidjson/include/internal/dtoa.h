@@ -22,6 +22,7 @@
 #include "itoa.h" // GetDigitsLut()
 #include "diyfp.h"
 #include "ieee754.h"
+#include "schubfach.h"
 
 RAPIDJSON_NAMESPACE_BEGIN
 namespace internal {
@@ -217,7 +218,11 @@ inline char* Prettify(char* buffer, int length, int k, int maxDecimalPlaces) {
     }
 }
 
-inline char* dtoa(double value, char* buffer, int maxDecimalPlaces = 324) {
+//! Writes a double in its short decimal form.
+/*! \param shortest Use Schubfach, which always finds the shortest digits that
+        round-trip, instead of Grisu2, which occasionally emits more.
+*/
+inline char* dtoa(double value, char* buffer, int maxDecimalPlaces = 324, bool shortest = false) {
     RAPIDJSON_ASSERT(maxDecimalPlaces >= 1);
     Double d(value);
     if (d.IsZero()) {
@@ -234,7 +239,10 @@ inline char* dtoa(double value, char* buffer, int maxDecimalPlaces = 324) {
             value = -value;
         }
         int length, K;
-        Grisu2(value, buffer, &length, &K);
+        if (shortest)
+            Schubfach(value, buffer, &length, &K);
+        else
+            Grisu2(value, buffer, &length, &K);
         return Prettify(buffer, length, K, maxDecimalPlaces);
     }
 }
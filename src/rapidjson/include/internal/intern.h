@@ -0,0 +1,158 @@
+// Tencent is pleased to support the open source community by making RapidJSON available.
+//
+// Copyright (C) 2015 THL A29 Limited, a Tencent company, and Milo Yip.
+//
+// Licensed under the MIT License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef RAPIDJSON_INTERNAL_INTERN_H_
+#define RAPIDJSON_INTERNAL_INTERN_H_
+
+#include "stack.h"
+#include "swap.h"
+
+RAPIDJSON_NAMESPACE_BEGIN
+namespace internal {
+
+///////////////////////////////////////////////////////////////////////////////
+// InternTable
+
+//! Set of strings with one null-terminated copy of each.
+/*! Used by GenericDocument to intern member names. The copies are allocated
+    by the caller's allocator, so they live as long as the values pointing
+    to them; the table itself (open addressing with linear probing over
+    indices of an append-only list) uses \c Allocator.
+*/
+template <typename Encoding, typename Allocator>
+class InternTable {
+public:
+    typedef typename Encoding::Ch Ch;
+
+    InternTable(Allocator* allocator) : entries_(allocator, kDefaultCapacity * sizeof(Entry)), slots_(allocator, kDefaultCapacity * 2 * sizeof(SizeType)), mask_() {}
+
+#if RAPIDJSON_HAS_CXX11_RVALUE_REFS
+    InternTable(InternTable&& rhs) : entries_(std::move(rhs.entries_)), slots_(std::move(rhs.slots_)), mask_(rhs.mask_) {
+        rhs.mask_ = 0;
+    }
+
+    InternTable& operator=(InternTable&& rhs) {
+        entries_ = std::move(rhs.entries_);
+        slots_ = std::move(rhs.slots_);
+        mask_ = rhs.mask_;
+        rhs.mask_ = 0;
+        return *this;
+    }
+#endif
+
+    void Swap(InternTable& rhs) RAPIDJSON_NOEXCEPT {
+        entries_.Swap(rhs.entries_);
+        slots_.Swap(rhs.slots_);
+        internal::Swap(mask_, rhs.mask_);
+    }
+
+    //! The copy of a string, allocated with \c allocator when it is new.
+    template <typename StringAllocator>
+    const Ch* Intern(const Ch* str, SizeType length, StringAllocator& allocator) {
+        const SizeType h = Hash(str, length);
+        SizeType i = Lookup(str, length, h);
+        if (i != kNotFound)
+            return entries_.template Bottom<Entry>()[i].str;
+
+        if (!mask_ || (GetCount() + 1) * 2 > mask_ + 1)
+            Rehash(mask_ ? (mask_ + 1) * 2 : kDefaultCapacity * 2);
+
+        Ch* s = static_cast<Ch*>(allocator.Malloc((length + 1) * sizeof(Ch)));
+        std::memcpy(s, str, length * sizeof(Ch));
+        s[length] = '\0';
+        Entry* e = entries_.template Push<Entry>();
+        e->str = s;
+        e->length = length;
+        e->hash = h;
+        Insert(h, GetCount());
+        return s;
+    }
+
+    //! The copy of a string, or null if it was not interned.
+    const Ch* Find(const Ch* str, SizeType length) const {
+        const SizeType i = Lookup(str, length, Hash(str, length));
+        return i != kNotFound ? entries_.template Bottom<Entry>()[i].str : 0;
+    }
+
+    //! Number of strings.
+    SizeType GetCount() const { return static_cast<SizeType>(entries_.GetSize() / sizeof(Entry)); }
+
+    //! Forgets all strings, freeing the copies if \c StringAllocator (which made them) needs it.
+    template <typename StringAllocator>
+    void Clear() {
+        if (StringAllocator::kNeedFree)
+            for (const Entry* e = entries_.template Bottom<Entry>(); e != entries_.template End<Entry>(); ++e)
+                StringAllocator::Free(const_cast<Ch*>(e->str));
+        entries_.Clear();
+        slots_.Clear();
+        mask_ = 0;
+    }
+
+private:
+    static const size_t kDefaultCapacity = 32;
+    static const SizeType kNotFound = ~SizeType(0);
+
+    struct Entry {
+        const Ch* str;
+        SizeType length;
+        SizeType hash;
+    };
+
+    static SizeType Hash(const Ch* str, SizeType length) {
+        uint32_t h = 2166136261u;   // FNV-1a
+        for (SizeType i = 0; i < length; i++)
+            h = (h ^ static_cast<uint32_t>(str[i])) * 16777619u;
+        return static_cast<SizeType>(h);
+    }
+
+    SizeType Lookup(const Ch* str, SizeType length, SizeType h) const {
+        if (!mask_)
+            return kNotFound;
+        const SizeType* slots = slots_.template Bottom<SizeType>();
+        const Entry* entries = entries_.template Bottom<Entry>();
+        for (SizeType i = h & mask_; slots[i]; i = (i + 1) & mask_) {
+            const Entry& e = entries[slots[i] - 1];
+            if (e.hash == h && e.length == length && std::memcmp(e.str, str, length * sizeof(Ch)) == 0)
+                return slots[i] - 1;
+        }
+        return kNotFound;
+    }
+
+    //! Adds the index of an entry; slots hold index + 1, 0 is empty.
+    void Insert(SizeType h, SizeType index) {
+        SizeType* slots = slots_.template Bottom<SizeType>();
+        SizeType i = h & mask_;
+        while (slots[i])
+            i = (i + 1) & mask_;
+        slots[i] = index;
+    }
+
+    void Rehash(SizeType capacity) {
+        slots_.Clear();
+        std::memset(slots_.template Push<SizeType>(capacity), 0, capacity * sizeof(SizeType));
+        mask_ = capacity - 1;
+        const Entry* entries = entries_.template Bottom<Entry>();
+        for (SizeType i = 0; i < GetCount(); i++)
+            Insert(entries[i].hash, i + 1);
+    }
+
+    Stack<Allocator> entries_;  //!< Interned strings in order (Entry).
+    Stack<Allocator> slots_;    //!< Hash table (SizeType).
+    SizeType mask_;             //!< Capacity of slots_ - 1, or 0 if empty.
+};
+
+} // namespace internal
+RAPIDJSON_NAMESPACE_END
+
+#endif // RAPIDJSON_INTERNAL_INTERN_H_
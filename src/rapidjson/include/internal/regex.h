@@ -37,6 +37,11 @@ RAPIDJSON_DIAG_OFF(effc++)
 #define RAPIDJSON_REGEX_VERBOSE 0
 #endif
 
+//! Maximum number of DFA states cached by a GenericRegexSearch (0 disables the DFA).
+#ifndef RAPIDJSON_REGEX_DFA_MAX_STATES
+#define RAPIDJSON_REGEX_DFA_MAX_STATES 128
+#endif
+
 RAPIDJSON_NAMESPACE_BEGIN
 namespace internal {
 
@@ -602,6 +607,20 @@ private:
     bool anchorEnd_;
 };
 
+//! Matcher of a GenericRegex.
+/*!
+    The NFA of the regex is simulated over state sets. Each distinct state
+    set met is also turned into a DFA state on first use (lazy subset
+    construction), and the transitions of DFA states on codepoints below
+    \c kDfaTableSize are cached in a table, so after warming up most
+    characters cost one table lookup. The DFA is only started once the
+    search object has stepped \c kDfaWarmupSteps codepoints through the NFA,
+    so that short-lived search objects do not pay for it. At most \c RAPIDJSON_REGEX_DFA_MAX_STATES
+    DFA states are kept; when they are used up the search goes on with the NFA.
+
+    The cache belongs to the search object, so keep one GenericRegexSearch
+    per regex (and per thread) to reuse it across calls.
+*/
 template <typename RegexType, typename Allocator = CrtAllocator>
 class GenericRegexSearch {
 public:
@@ -610,7 +629,8 @@ public:
 
     GenericRegexSearch(const RegexType& regex, Allocator* allocator = 0) : 
         regex_(regex), allocator_(allocator), ownAllocator_(0),
-        state0_(allocator, 0), state1_(allocator, 0), stateSet_()
+        state0_(allocator, 0), state1_(allocator, 0), stateSet_(),
+        dfaStates_(allocator, 0), dfaSets_(allocator, 0), dfaNext_(allocator, 0), nfaSteps_()
     {
         RAPIDJSON_ASSERT(regex_.IsValid());
         if (!allocator_)
@@ -618,6 +638,8 @@ public:
         stateSet_ = static_cast<uint32_t*>(allocator_->Malloc(GetStateSetSize()));
         state0_.template Reserve<SizeType>(regex_.stateCount_);
         state1_.template Reserve<SizeType>(regex_.stateCount_);
+        dfaStart_[0] = dfaStart_[1] = kRegexInvalidState;
+        dfaStartMatched_[0] = dfaStartMatched_[1] = false;
     }
 
     ~GenericRegexSearch() {
@@ -645,44 +667,161 @@ public:
         return Search(is);
     }
 
+    //! Number of DFA states built so far.
+    SizeType GetDfaStateCount() const { return static_cast<SizeType>(dfaStates_.GetSize() / sizeof(DfaState)); }
+
 private:
     typedef typename RegexType::State State;
     typedef typename RegexType::Range Range;
 
+    static const unsigned kDfaTableSize = 128;      //!< Codepoints with cached transitions
+    static const size_t kDfaWarmupSteps = 256;      //!< NFA steps before the DFA is used
+
+    struct DfaState {
+        SizeType setBegin;  //!< Index of the first NFA state in dfaSets_
+        SizeType setCount;  //!< Number of NFA states, 0 for the dead state
+        uint32_t hash;
+        bool anchorBegin;   //!< Whether the root is not added again on each step
+    };
+
     template <typename InputStream>
     bool SearchWithAnchoring(InputStream& is, bool anchorBegin, bool anchorEnd) {
         DecodedStream<InputStream, Encoding> ds(is);
 
-        state0_.Clear();
-        Stack<Allocator> *current = &state0_, *next = &state1_;
-        const size_t stateSetSize = GetStateSetSize();
-        std::memset(stateSet_, 0, stateSetSize);
+        const unsigned mode = anchorBegin ? 1u : 0u;
+        if (dfaStart_[mode] == kRegexInvalidState) {
+            state0_.Clear();
+            std::memset(stateSet_, 0, GetStateSetSize());
+            bool matched = AddState(state0_, regex_.root_);
+            if (nfaSteps_ < kDfaWarmupSteps || (dfaStart_[mode] = AddDfaState(state0_, anchorBegin)) == kRegexInvalidState)
+                return Simulate(ds, &state0_, &state1_, matched, anchorBegin, anchorEnd);
+            dfaStartMatched_[mode] = matched;
+        }
 
-        bool matched = AddState(*current, regex_.root_);
+        SizeType d = dfaStart_[mode];
+        bool matched = dfaStartMatched_[mode];
         unsigned codepoint;
-        while (!current->Empty() && (codepoint = ds.Take()) != 0) {
-            std::memset(stateSet_, 0, stateSetSize);
-            next->Clear();
-            matched = false;
-            for (const SizeType* s = current->template Bottom<SizeType>(); s != current->template End<SizeType>(); ++s) {
-                const State& sr = regex_.GetState(*s);
-                if (sr.codepoint == codepoint ||
-                    sr.codepoint == RegexType::kAnyCharacterClass || 
-                    (sr.codepoint == RegexType::kRangeCharacterClass && MatchRange(sr.rangeStart, codepoint)))
-                {
-                    matched = AddState(*next, sr.out) || matched;
+        while (GetDfaState(d).setCount != 0 && (codepoint = ds.Take()) != 0) {
+            SizeType next = codepoint < kDfaTableSize ? dfaNext_.template Bottom<SizeType>()[d * kDfaTableSize + codepoint] : kRegexInvalidState;
+            if (next == kRegexInvalidState) {
+                next = DfaTransition(d, codepoint, &matched);
+                if (next == kRegexInvalidState) {
+                    // Out of DFA states, go on with the NFA from the states in state1_
                     if (!anchorEnd && matched)
                         return true;
+                    return Simulate(ds, &state1_, &state0_, matched, anchorBegin, anchorEnd);
                 }
-                if (!anchorBegin)
-                    AddState(*next, regex_.root_);
             }
+            matched = (next & 1) != 0;
+            if (!anchorEnd && matched)
+                return true;
+            d = next >> 1;
+        }
+
+        return matched;
+    }
+
+    template <typename InputStream>
+    bool Simulate(DecodedStream<InputStream, Encoding>& ds, Stack<Allocator>* current, Stack<Allocator>* next, bool matched, bool anchorBegin, bool anchorEnd) {
+        unsigned codepoint;
+        while (!current->Empty() && (codepoint = ds.Take()) != 0) {
+            ++nfaSteps_;
+            matched = Step(*current, *next, codepoint, anchorBegin);
+            if (!anchorEnd && matched)
+                return true;
             internal::Swap(current, next);
         }
 
         return matched;
     }
 
+    //! Advances the NFA states of \c current over \c codepoint into \c next.
+    /*! \return Whether a match state was reached by the codepoint.
+    */
+    bool Step(const Stack<Allocator>& current, Stack<Allocator>& next, unsigned codepoint, bool anchorBegin) {
+        std::memset(stateSet_, 0, GetStateSetSize());
+        next.Clear();
+        bool matched = false;
+        for (const SizeType* s = current.template Bottom<SizeType>(); s != current.template End<SizeType>(); ++s) {
+            const State& sr = regex_.GetState(*s);
+            if (sr.codepoint == codepoint ||
+                sr.codepoint == RegexType::kAnyCharacterClass || 
+                (sr.codepoint == RegexType::kRangeCharacterClass && MatchRange(sr.rangeStart, codepoint)))
+            {
+                matched = AddState(next, sr.out) || matched;
+            }
+            if (!anchorBegin)
+                AddState(next, regex_.root_);
+        }
+        return matched;
+    }
+
+    //! Computes (and caches for small codepoints) the transition of DFA state \c d.
+    /*! \return The target DFA state shifted left by one, ORed with whether a
+            match state was reached, or kRegexInvalidState when the DFA is
+            full; then state1_ holds the next NFA states and \c matched is set.
+    */
+    SizeType DfaTransition(SizeType d, unsigned codepoint, bool* matched) {
+        const DfaState& state = GetDfaState(d);
+        const bool anchorBegin = state.anchorBegin;
+        state0_.Clear();
+        std::memcpy(state0_.template Push<SizeType>(state.setCount), dfaSets_.template Bottom<SizeType>() + state.setBegin, state.setCount * sizeof(SizeType));
+
+        *matched = Step(state0_, state1_, codepoint, anchorBegin);
+        const SizeType target = AddDfaState(state1_, anchorBegin);
+        if (target == kRegexInvalidState)
+            return kRegexInvalidState;
+
+        const SizeType next = (target << 1) | (*matched ? 1u : 0u);
+        if (codepoint < kDfaTableSize)
+            dfaNext_.template Bottom<SizeType>()[d * kDfaTableSize + codepoint] = next;
+        return next;
+    }
+
+    //! Finds or adds the DFA state of a set of NFA states.
+    /*! \return kRegexInvalidState if it is new and the DFA is full.
+    */
+    SizeType AddDfaState(Stack<Allocator>& set, bool anchorBegin) {
+        // Sort the set so that equal sets compare equal
+        SizeType* begin = set.template Bottom<SizeType>();
+        const SizeType count = static_cast<SizeType>(set.GetSize() / sizeof(SizeType));
+        for (SizeType i = 1; i < count; i++) {
+            const SizeType v = begin[i];
+            SizeType j = i;
+            for (; j > 0 && begin[j - 1] > v; j--)
+                begin[j] = begin[j - 1];
+            begin[j] = v;
+        }
+
+        uint32_t hash = anchorBegin ? 1u : 0u;
+        for (SizeType i = 0; i < count; i++)
+            hash = (hash ^ begin[i]) * 16777619u;
+
+        const SizeType stateCount = GetDfaStateCount();
+        const DfaState* states = dfaStates_.template Bottom<DfaState>();
+        for (SizeType i = 0; i < stateCount; i++)
+            if (states[i].hash == hash && states[i].setCount == count && states[i].anchorBegin == anchorBegin &&
+                std::memcmp(dfaSets_.template Bottom<SizeType>() + states[i].setBegin, begin, count * sizeof(SizeType)) == 0)
+                return i;
+
+        if (stateCount >= RAPIDJSON_REGEX_DFA_MAX_STATES)
+            return kRegexInvalidState;
+
+        DfaState* s = dfaStates_.template Push<DfaState>();
+        s->setBegin = static_cast<SizeType>(dfaSets_.GetSize() / sizeof(SizeType));
+        s->setCount = count;
+        s->hash = hash;
+        s->anchorBegin = anchorBegin;
+        std::memcpy(dfaSets_.template Push<SizeType>(count), begin, count * sizeof(SizeType));
+        std::memset(dfaNext_.template Push<SizeType>(kDfaTableSize), 0xFF, kDfaTableSize * sizeof(SizeType));
+        return stateCount;
+    }
+
+    const DfaState& GetDfaState(SizeType index) const {
+        RAPIDJSON_ASSERT(index < GetDfaStateCount());
+        return dfaStates_.template Bottom<DfaState>()[index];
+    }
+
     size_t GetStateSetSize() const {
         return (regex_.stateCount_ + 31) / 32 * 4;
     }
@@ -720,6 +859,12 @@ private:
     Stack<Allocator> state0_;
     Stack<Allocator> state1_;
     uint32_t* stateSet_;
+    Stack<Allocator> dfaStates_;    //!< DfaState
+    Stack<Allocator> dfaSets_;      //!< SizeType, NFA states of the DFA states
+    Stack<Allocator> dfaNext_;      //!< SizeType, kDfaTableSize transitions per DFA state
+    SizeType dfaStart_[2];          //!< Start DFA state without/with anchorBegin
+    bool dfaStartMatched_[2];
+    size_t nfaSteps_;               //!< Codepoints stepped through the NFA
 };
 
 typedef GenericRegex<UTF8<> > Regex;
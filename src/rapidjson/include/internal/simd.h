@@ -0,0 +1,349 @@
+// Tencent is pleased to support the open source community by making RapidJSON available.
+//
+// Copyright (C) 2015 THL A29 Limited, a Tencent company, and Milo Yip.
+//
+// Licensed under the MIT License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef RAPIDJSON_INTERNAL_SIMD_H_
+#define RAPIDJSON_INTERNAL_SIMD_H_
+
+#include "../rapidjson.h"
+
+#ifdef RAPIDJSON_SIMD_WIDE
+
+#if defined(_MSC_VER) && !defined(UNDER_CE)
+#include <intrin.h>
+#pragma intrinsic(_BitScanForward)
+#endif
+#include <immintrin.h>
+
+// With RAPIDJSON_SIMD_DISPATCH the AVX2 kernels are compiled for that
+// target only and picked at run time, the rest of the code stays SSE2.
+// MSVC accepts AVX2 intrinsics without /arch:AVX2, so no attribute is needed.
+#if defined(RAPIDJSON_SIMD_DISPATCH) && !defined(RAPIDJSON_AVX2) && !defined(RAPIDJSON_AVX512) && !defined(_MSC_VER)
+#define RAPIDJSON_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define RAPIDJSON_TARGET_AVX2
+#endif
+
+RAPIDJSON_NAMESPACE_BEGIN
+namespace internal {
+
+//! Index of the lowest set bit of a non-zero mask.
+inline uint32_t SimdCtz(uint64_t x) {
+    RAPIDJSON_ASSERT(x != 0);
+#if defined(_MSC_VER) && !defined(UNDER_CE)
+    unsigned long r;
+    if (static_cast<uint32_t>(x)) {
+        _BitScanForward(&r, static_cast<uint32_t>(x));
+        return static_cast<uint32_t>(r);
+    }
+    _BitScanForward(&r, static_cast<uint32_t>(x >> 32));
+    return 32 + static_cast<uint32_t>(r);
+#else
+    return static_cast<uint32_t>(__builtin_ctzll(x));
+#endif
+}
+
+inline bool SimdIsWhitespace(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+//! A character that ends a run of unescaped string content: '"', '\\' or a control character.
+inline bool SimdIsSpecial(char c) {
+    return c == '\"' || c == '\\' || static_cast<unsigned char>(c) < 0x20;
+}
+
+template <size_t N>
+inline const char* SimdAlignUp(const char* p) {
+    return reinterpret_cast<const char*>((reinterpret_cast<size_t>(p) + (N - 1)) & static_cast<size_t>(~(N - 1)));
+}
+
+// The unbounded kernels run on null-terminated input: they go byte by byte up
+// to the block alignment and then only do aligned loads, which never cross a
+// page boundary. The bounded kernels use unaligned loads inside [p, end).
+
+#ifdef RAPIDJSON_AVX512
+
+inline uint64_t NonWhitespaceMaskAVX512(__m512i s) {
+    const __mmask64 m =
+        _mm512_cmpeq_epi8_mask(s, _mm512_set1_epi8(' ')) |
+        _mm512_cmpeq_epi8_mask(s, _mm512_set1_epi8('\n')) |
+        _mm512_cmpeq_epi8_mask(s, _mm512_set1_epi8('\r')) |
+        _mm512_cmpeq_epi8_mask(s, _mm512_set1_epi8('\t'));
+    return ~static_cast<uint64_t>(m);
+}
+
+inline uint64_t SpecialMaskAVX512(__m512i s) {
+    const __mmask64 m =
+        _mm512_cmpeq_epi8_mask(s, _mm512_set1_epi8('\"')) |
+        _mm512_cmpeq_epi8_mask(s, _mm512_set1_epi8('\\')) |
+        _mm512_cmple_epu8_mask(s, _mm512_set1_epi8(0x1F));
+    return static_cast<uint64_t>(m);
+}
+
+inline const char* SkipWhitespaceAVX512(const char* p) {
+    for (const char* nextAligned = SimdAlignUp<64>(p); p != nextAligned; ++p)
+        if (!SimdIsWhitespace(*p))
+            return p;
+    for (;; p += 64) {
+        const uint64_t r = NonWhitespaceMaskAVX512(_mm512_load_si512(reinterpret_cast<const void*>(p)));
+        if (r != 0)
+            return p + SimdCtz(r);
+    }
+}
+
+inline const char* SkipWhitespaceAVX512(const char* p, const char* end) {
+    if (p != end && !SimdIsWhitespace(*p))
+        return p;
+    for (; end - p >= 64; p += 64) {
+        const uint64_t r = NonWhitespaceMaskAVX512(_mm512_loadu_si512(reinterpret_cast<const void*>(p)));
+        if (r != 0)
+            return p + SimdCtz(r);
+    }
+    while (p != end && SimdIsWhitespace(*p))
+        ++p;
+    return p;
+}
+
+inline const char* ScanUnescapedAVX512(const char* p) {
+    for (const char* nextAligned = SimdAlignUp<64>(p); p != nextAligned; ++p)
+        if (SimdIsSpecial(*p))
+            return p;
+    for (;; p += 64) {
+        const uint64_t r = SpecialMaskAVX512(_mm512_load_si512(reinterpret_cast<const void*>(p)));
+        if (r != 0)
+            return p + SimdCtz(r);
+    }
+}
+
+inline const char* ScanUnescapedAVX512(const char* p, const char* end) {
+    for (; end - p >= 64; p += 64) {
+        const uint64_t r = SpecialMaskAVX512(_mm512_loadu_si512(reinterpret_cast<const void*>(p)));
+        if (r != 0)
+            return p + SimdCtz(r);
+    }
+    while (p != end && !SimdIsSpecial(*p))
+        ++p;
+    return p;
+}
+
+#else // AVX2, built in or dispatched
+
+RAPIDJSON_TARGET_AVX2 inline uint64_t NonWhitespaceMaskAVX2(__m256i s) {
+    __m256i x = _mm256_cmpeq_epi8(s, _mm256_set1_epi8(' '));
+    x = _mm256_or_si256(x, _mm256_cmpeq_epi8(s, _mm256_set1_epi8('\n')));
+    x = _mm256_or_si256(x, _mm256_cmpeq_epi8(s, _mm256_set1_epi8('\r')));
+    x = _mm256_or_si256(x, _mm256_cmpeq_epi8(s, _mm256_set1_epi8('\t')));
+    return static_cast<uint32_t>(~_mm256_movemask_epi8(x));
+}
+
+RAPIDJSON_TARGET_AVX2 inline uint64_t SpecialMaskAVX2(__m256i s) {
+    const __m256i sp = _mm256_set1_epi8(0x1F);
+    __m256i x = _mm256_cmpeq_epi8(s, _mm256_set1_epi8('\"'));
+    x = _mm256_or_si256(x, _mm256_cmpeq_epi8(s, _mm256_set1_epi8('\\')));
+    x = _mm256_or_si256(x, _mm256_cmpeq_epi8(_mm256_max_epu8(s, sp), sp)); // s <= 0x1F
+    return static_cast<uint32_t>(_mm256_movemask_epi8(x));
+}
+
+RAPIDJSON_TARGET_AVX2 inline const char* SkipWhitespaceAVX2(const char* p) {
+    for (const char* nextAligned = SimdAlignUp<32>(p); p != nextAligned; ++p)
+        if (!SimdIsWhitespace(*p))
+            return p;
+    for (;; p += 32) {
+        const uint64_t r = NonWhitespaceMaskAVX2(_mm256_load_si256(reinterpret_cast<const __m256i *>(p)));
+        if (r != 0)
+            return p + SimdCtz(r);
+    }
+}
+
+RAPIDJSON_TARGET_AVX2 inline const char* SkipWhitespaceAVX2(const char* p, const char* end) {
+    if (p != end && !SimdIsWhitespace(*p))
+        return p;
+    for (; end - p >= 32; p += 32) {
+        const uint64_t r = NonWhitespaceMaskAVX2(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)));
+        if (r != 0)
+            return p + SimdCtz(r);
+    }
+    while (p != end && SimdIsWhitespace(*p))
+        ++p;
+    return p;
+}
+
+RAPIDJSON_TARGET_AVX2 inline const char* ScanUnescapedAVX2(const char* p) {
+    for (const char* nextAligned = SimdAlignUp<32>(p); p != nextAligned; ++p)
+        if (SimdIsSpecial(*p))
+            return p;
+    for (;; p += 32) {
+        const uint64_t r = SpecialMaskAVX2(_mm256_load_si256(reinterpret_cast<const __m256i *>(p)));
+        if (r != 0)
+            return p + SimdCtz(r);
+    }
+}
+
+RAPIDJSON_TARGET_AVX2 inline const char* ScanUnescapedAVX2(const char* p, const char* end) {
+    for (; end - p >= 32; p += 32) {
+        const uint64_t r = SpecialMaskAVX2(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)));
+        if (r != 0)
+            return p + SimdCtz(r);
+    }
+    while (p != end && !SimdIsSpecial(*p))
+        ++p;
+    return p;
+}
+
+#if !defined(RAPIDJSON_AVX2)
+
+// SSE2 fallbacks of the dispatched build, for CPUs without AVX2.
+
+inline uint64_t NonWhitespaceMaskSSE2(__m128i s) {
+    __m128i x = _mm_cmpeq_epi8(s, _mm_set1_epi8(' '));
+    x = _mm_or_si128(x, _mm_cmpeq_epi8(s, _mm_set1_epi8('\n')));
+    x = _mm_or_si128(x, _mm_cmpeq_epi8(s, _mm_set1_epi8('\r')));
+    x = _mm_or_si128(x, _mm_cmpeq_epi8(s, _mm_set1_epi8('\t')));
+    return static_cast<uint16_t>(~_mm_movemask_epi8(x));
+}
+
+inline uint64_t SpecialMaskSSE2(__m128i s) {
+    const __m128i sp = _mm_set1_epi8(0x1F);
+    __m128i x = _mm_cmpeq_epi8(s, _mm_set1_epi8('\"'));
+    x = _mm_or_si128(x, _mm_cmpeq_epi8(s, _mm_set1_epi8('\\')));
+    x = _mm_or_si128(x, _mm_cmpeq_epi8(_mm_max_epu8(s, sp), sp));
+    return static_cast<uint16_t>(_mm_movemask_epi8(x));
+}
+
+inline const char* SkipWhitespaceSSE2(const char* p) {
+    for (const char* nextAligned = SimdAlignUp<16>(p); p != nextAligned; ++p)
+        if (!SimdIsWhitespace(*p))
+            return p;
+    for (;; p += 16) {
+        const uint64_t r = NonWhitespaceMaskSSE2(_mm_load_si128(reinterpret_cast<const __m128i *>(p)));
+        if (r != 0)
+            return p + SimdCtz(r);
+    }
+}
+
+inline const char* SkipWhitespaceSSE2(const char* p, const char* end) {
+    if (p != end && !SimdIsWhitespace(*p))
+        return p;
+    for (; end - p >= 16; p += 16) {
+        const uint64_t r = NonWhitespaceMaskSSE2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+        if (r != 0)
+            return p + SimdCtz(r);
+    }
+    while (p != end && SimdIsWhitespace(*p))
+        ++p;
+    return p;
+}
+
+inline const char* ScanUnescapedSSE2(const char* p) {
+    for (const char* nextAligned = SimdAlignUp<16>(p); p != nextAligned; ++p)
+        if (SimdIsSpecial(*p))
+            return p;
+    for (;; p += 16) {
+        const uint64_t r = SpecialMaskSSE2(_mm_load_si128(reinterpret_cast<const __m128i *>(p)));
+        if (r != 0)
+            return p + SimdCtz(r);
+    }
+}
+
+inline const char* ScanUnescapedSSE2(const char* p, const char* end) {
+    for (; end - p >= 16; p += 16) {
+        const uint64_t r = SpecialMaskSSE2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+        if (r != 0)
+            return p + SimdCtz(r);
+    }
+    while (p != end && !SimdIsSpecial(*p))
+        ++p;
+    return p;
+}
+
+inline bool SimdCpuHasAVX2() {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+    __cpuid(info, 1);
+    if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0) // OSXSAVE, AVX
+        return false;
+    if ((_xgetbv(0) & 6) != 6) // XMM and YMM state saved by the OS
+        return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+
+//! Whether the dispatched build runs the AVX2 kernels, probed once.
+inline bool SimdUseAVX2() {
+    static const bool useAVX2 = SimdCpuHasAVX2();
+    return useAVX2;
+}
+
+#endif // !RAPIDJSON_AVX2
+#endif // RAPIDJSON_AVX512
+
+///////////////////////////////////////////////////////////////////////////////
+// Entry points used by Reader and Writer
+
+//! Returns the first non-whitespace character of a null-terminated string.
+inline const char* SimdSkipWhitespace(const char* p) {
+#if defined(RAPIDJSON_AVX512)
+    return SkipWhitespaceAVX512(p);
+#elif defined(RAPIDJSON_AVX2)
+    return SkipWhitespaceAVX2(p);
+#else
+    return SimdUseAVX2() ? SkipWhitespaceAVX2(p) : SkipWhitespaceSSE2(p);
+#endif
+}
+
+//! Returns the first non-whitespace character in [p, end), or end.
+inline const char* SimdSkipWhitespace(const char* p, const char* end) {
+#if defined(RAPIDJSON_AVX512)
+    return SkipWhitespaceAVX512(p, end);
+#elif defined(RAPIDJSON_AVX2)
+    return SkipWhitespaceAVX2(p, end);
+#else
+    return SimdUseAVX2() ? SkipWhitespaceAVX2(p, end) : SkipWhitespaceSSE2(p, end);
+#endif
+}
+
+//! Returns the first '"', '\\' or control character of a null-terminated string.
+inline const char* SimdScanUnescaped(const char* p) {
+#if defined(RAPIDJSON_AVX512)
+    return ScanUnescapedAVX512(p);
+#elif defined(RAPIDJSON_AVX2)
+    return ScanUnescapedAVX2(p);
+#else
+    return SimdUseAVX2() ? ScanUnescapedAVX2(p) : ScanUnescapedSSE2(p);
+#endif
+}
+
+//! Returns the first '"', '\\' or control character in [p, end), or end.
+inline const char* SimdScanUnescaped(const char* p, const char* end) {
+#if defined(RAPIDJSON_AVX512)
+    return ScanUnescapedAVX512(p, end);
+#elif defined(RAPIDJSON_AVX2)
+    return ScanUnescapedAVX2(p, end);
+#else
+    return SimdUseAVX2() ? ScanUnescapedAVX2(p, end) : ScanUnescapedSSE2(p, end);
+#endif
+}
+
+} // namespace internal
+RAPIDJSON_NAMESPACE_END
+
+#endif // RAPIDJSON_SIMD_WIDE
+
+#endif // RAPIDJSON_INTERNAL_SIMD_H_
@@ -18,6 +18,7 @@
 #include "ieee754.h"
 #include "biginteger.h"
 #include "diyfp.h"
+#include "eisellemire.h"
 #include "pow10.h"
 #include <climits>
 #include <limits>
@@ -127,6 +128,28 @@ inline bool StrtodFast(double d, int p, double* result) {
         return false;
 }
 
+// Eisel-Lemire on the first 19 digits. Any further digits are non-zero, so
+// the value lies strictly between w and w + 1 in the last kept digit, and the
+// result is known if both ends round to the same double.
+template<typename Ch>
+inline bool StrtodEiselLemire(const Ch* decimals, int dLen, int dExp, double* result) {
+    const int n = dLen < 19 ? dLen : 19;
+    uint64_t w = 0;
+    for (int i = 0; i < n; i++)
+        w = w * 10u + static_cast<unsigned>(decimals[i] - Ch('0'));
+
+    if (n == dLen)
+        return EiselLemire(w, dExp, result);
+
+    double lower, upper;
+    const int q = dExp + (dLen - n);
+    if (!EiselLemire(w, q, &lower) || !EiselLemire(w + 1, q, &upper) ||
+        Double(lower).Uint64Value() != Double(upper).Uint64Value())
+        return false;
+    *result = lower;
+    return true;
+}
+
 // Compute an approximation and see if it is within 1/2 ULP
 template<typename Ch>
 inline bool StrtodDiyFp(const Ch* decimals, int dLen, int dExp, double* result) {
@@ -280,6 +303,9 @@ inline double StrtodFullPrecision(double d, int p, const Ch* decimals, size_t le
     if (dLen + dExp > 309)
         return std::numeric_limits<double>::infinity();
 
+    if (StrtodEiselLemire(decimals, dLen, dExp, &result))
+        return result;
+
     if (StrtodDiyFp(decimals, dLen, dExp, &result))
         return result;
 
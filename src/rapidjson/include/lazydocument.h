@@ -0,0 +1,1066 @@
+// Tencent is pleased to support the open source community by making RapidJSON available.
+//
+// Copyright (C) 2015 THL A29 Limited, a Tencent company, and Milo Yip.
+//
+// Licensed under the MIT License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef RAPIDJSON_LAZYDOCUMENT_H_
+#define RAPIDJSON_LAZYDOCUMENT_H_
+
+/*! \file lazydocument.h */
+
+#include "document.h"
+
+#ifdef __GNUC__
+RAPIDJSON_DIAG_PUSH
+RAPIDJSON_DIAG_OFF(effc++)
+#endif
+
+RAPIDJSON_NAMESPACE_BEGIN
+
+template <typename Encoding, typename Allocator, typename StackAllocator>
+class GenericLazyDocument;
+
+template <typename Encoding, typename Allocator, typename StackAllocator>
+class GenericLazyValueIterator;
+
+template <typename Encoding, typename Allocator, typename StackAllocator>
+class GenericLazyMemberIterator;
+
+namespace internal {
+
+///////////////////////////////////////////////////////////////////////////////
+// LazyTapeEntry
+
+//! Token of the tape of a GenericLazyDocument.
+/*! Every value of the text has one entry, objects and arrays have a second
+    one for their closing bracket, and object members are their name entry
+    followed by their value. The type is the \ref Type of the value, or
+    \c kEndType for a closing bracket, and the payload depends on it:
+    - object and array: index of the closing entry, so the value can be skipped,
+    - closing entry: number of members or elements,
+    - string: length of the text between the quotes, and \c kEscapedFlag if
+      that text is not the string itself (escapes, or too long for the field),
+    - others: zero.
+*/
+struct LazyTapeEntry {
+    static const uint32_t kTypeShift = 29;
+    static const uint32_t kPayloadMask = 0x1FFFFFFFu;
+    static const uint32_t kEndType = 7;
+    static const uint32_t kEscapedFlag = 0x10000000u;
+    static const uint32_t kLengthMask = 0x0FFFFFFFu;
+
+    uint32_t offset;    //!< Offset of the token (opening quote of a string) in the text.
+    uint32_t info;      //!< Type in the top 3 bits, payload below.
+
+    uint32_t GetType() const { return info >> kTypeShift; }
+    uint32_t GetPayload() const { return info & kPayloadMask; }
+};
+
+//! Input stream over the rest of a text that may not be null-terminated.
+/*! Used to hand single values of a GenericLazyDocument to GenericReader.
+    \note implements Stream concept
+*/
+template <typename Encoding>
+struct LazySpanStream {
+    typedef typename Encoding::Ch Ch;
+
+    LazySpanStream(const Ch* src, const Ch* end) : src_(src), head_(src), end_(end) {}
+
+    Ch Peek() const { return src_ == end_ ? '\0' : *src_; }
+    Ch Take() { return src_ == end_ ? '\0' : *src_++; }
+    size_t Tell() const { return static_cast<size_t>(src_ - head_); }
+
+    Ch* PutBegin() { RAPIDJSON_ASSERT(false); return 0; }
+    void Put(Ch) { RAPIDJSON_ASSERT(false); }
+    void Flush() { RAPIDJSON_ASSERT(false); }
+    size_t PutEnd(Ch*) { RAPIDJSON_ASSERT(false); return 0; }
+
+    const Ch* src_;     //!< Current read position.
+    const Ch* head_;    //!< Original head of the span.
+    const Ch* end_;     //!< End of the text.
+};
+
+//! SAX handler keeping the number of a single-value parse.
+template <typename Encoding, typename Allocator>
+struct LazyNumberHandler : BaseReaderHandler<Encoding, LazyNumberHandler<Encoding, Allocator> > {
+    explicit LazyNumberHandler(GenericValue<Encoding, Allocator>& value) : value_(value) {}
+
+    bool Default() { return false; }
+    bool Int(int i) { value_.SetInt(i); return true; }
+    bool Uint(unsigned u) { value_.SetUint(u); return true; }
+    bool Int64(int64_t i) { value_.SetInt64(i); return true; }
+    bool Uint64(uint64_t u) { value_.SetUint64(u); return true; }
+    bool Double(double d) { value_.SetDouble(d); return true; }
+
+    GenericValue<Encoding, Allocator>& value_;
+};
+
+//! SAX handler copying the string of a single-value parse into an allocator.
+template <typename Encoding, typename Allocator>
+struct LazyStringHandler : BaseReaderHandler<Encoding, LazyStringHandler<Encoding, Allocator> > {
+    typedef typename Encoding::Ch Ch;
+
+    explicit LazyStringHandler(Allocator& allocator) : allocator_(allocator), str_(0), length_(0) {}
+
+    bool Default() { return false; }
+    bool String(const Ch* str, SizeType length, bool) {
+        Ch* s = static_cast<Ch*>(allocator_.Malloc((length + 1) * sizeof(Ch)));
+        std::memcpy(s, str, length * sizeof(Ch));
+        s[length] = '\0';
+        str_ = s;
+        length_ = length;
+        return true;
+    }
+
+    Allocator& allocator_;
+    const Ch* str_;
+    SizeType length_;
+};
+
+//! SAX handler passing the string of a single-value parse on as an object key.
+template <typename Encoding, typename Handler>
+struct LazyKeyHandler : BaseReaderHandler<Encoding, LazyKeyHandler<Encoding, Handler> > {
+    typedef typename Encoding::Ch Ch;
+
+    explicit LazyKeyHandler(Handler& handler) : handler_(handler) {}
+
+    bool Default() { return false; }
+    bool String(const Ch* str, SizeType length, bool copy) { return handler_.Key(str, length, copy); }
+
+    Handler& handler_;
+};
+
+//! Returns the first '"', '\\' or control character in [p, end), or end.
+template <typename Ch>
+inline const Ch* LazyScanUnescaped(const Ch* p, const Ch* end) {
+    while (p != end && *p != '\"' && *p != '\\' && static_cast<unsigned>(*p) >= 0x20)
+        ++p;
+    return p;
+}
+
+#if defined(RAPIDJSON_SIMD_WIDE)
+inline const char* LazyScanUnescaped(const char* p, const char* end) {
+    return SimdScanUnescaped(p, end);
+}
+#endif
+
+} // namespace internal
+
+///////////////////////////////////////////////////////////////////////////////
+// GenericLazyValue
+
+//! Read-only handle to a value of a GenericLazyDocument.
+/*! Mirrors the query API of GenericValue. A handle is two words and is
+    passed by value. Strings are decoded into the allocator of the document
+    the first time GetString() or GetStringLength() needs them, and numbers
+    are converted on every call of the number getters.
+
+    \tparam Encoding    Encoding of the value. (Even non-string values need to have the same encoding in a document)
+    \tparam Allocator   Allocator for the decoded strings.
+    \tparam StackAllocator Allocator for the tape and the parsing stack.
+    \note A handle is valid as long as its document and the text it parsed,
+        and until the document parses another text.
+*/
+template <typename Encoding, typename Allocator = RAPIDJSON_DEFAULT_ALLOCATOR, typename StackAllocator = RAPIDJSON_DEFAULT_STACK_ALLOCATOR >
+class GenericLazyValue {
+    typedef internal::LazyTapeEntry Entry;
+
+public:
+    typedef typename Encoding::Ch Ch;                                                       //!< Character type derived from Encoding.
+    typedef Encoding EncodingType;                                                          //!< Encoding type from template parameter.
+    typedef GenericLazyDocument<Encoding, Allocator, StackAllocator> DocumentType;          //!< Document of the value.
+    typedef GenericLazyValue<Encoding, Allocator, StackAllocator> ValueType;                //!< Value type of itself.
+    typedef GenericLazyValueIterator<Encoding, Allocator, StackAllocator> ValueIterator;    //!< Forward iterator over array elements.
+    typedef ValueIterator ConstValueIterator;                                               //!< Same as ValueIterator, values are read-only.
+    typedef GenericLazyMemberIterator<Encoding, Allocator, StackAllocator> MemberIterator;  //!< Forward iterator over object members.
+    typedef MemberIterator ConstMemberIterator;                                             //!< Same as MemberIterator, members are read-only.
+
+    //! Default constructor (singular value)
+    /*! \note All operations are undefined on such values.
+    */
+    GenericLazyValue() : doc_(0), index_(0) {}
+
+    //!@name Type
+    //@{
+
+    Type GetType() const { return static_cast<Type>(GetEntry().GetType()); }
+    bool IsNull()   const { return GetType() == kNullType; }
+    bool IsFalse()  const { return GetType() == kFalseType; }
+    bool IsTrue()   const { return GetType() == kTrueType; }
+    bool IsBool()   const { return GetType() == kFalseType || GetType() == kTrueType; }
+    bool IsObject() const { return GetType() == kObjectType; }
+    bool IsArray()  const { return GetType() == kArrayType; }
+    bool IsNumber() const { return GetType() == kNumberType; }
+    bool IsString() const { return GetType() == kStringType; }
+
+    // Checks of the number kind convert the number, see GetDouble().
+    bool IsInt()    const { NumberType n; return IsNumber() && GetNumber(n).IsInt(); }
+    bool IsUint()   const { NumberType n; return IsNumber() && GetNumber(n).IsUint(); }
+    bool IsInt64()  const { NumberType n; return IsNumber() && GetNumber(n).IsInt64(); }
+    bool IsUint64() const { NumberType n; return IsNumber() && GetNumber(n).IsUint64(); }
+    bool IsDouble() const { NumberType n; return IsNumber() && GetNumber(n).IsDouble(); }
+
+    //@}
+
+    //!@name Bool
+    //@{
+
+    bool GetBool() const { RAPIDJSON_ASSERT(IsBool()); return GetType() == kTrueType; }
+
+    //@}
+
+    //!@name Object
+    //@{
+
+    //! Get the number of members in the object.
+    SizeType MemberCount() const { RAPIDJSON_ASSERT(IsObject()); return doc_->GetEntry(GetEntry().GetPayload()).GetPayload(); }
+
+    //! Check whether the object is empty.
+    bool ObjectEmpty() const { return MemberCount() == 0; }
+
+    //! Get a value from an object associated with the name.
+    /*! \pre IsObject() == true
+        \tparam T Either \c Ch or \c const \c Ch (template used for disambiguation with \ref operator[](SizeType))
+        \note Looks up the members in order, like every FindMember().
+    */
+    template <typename T>
+    RAPIDJSON_DISABLEIF_RETURN((internal::NotExpr<internal::IsSame<typename internal::RemoveConst<T>::Type, Ch> >),(GenericLazyValue)) operator[](T* name) const {
+        return Lookup(name, internal::StrLen(name));
+    }
+
+#if RAPIDJSON_HAS_STDSTRING
+    //! Get a value from an object associated with name (string object).
+    GenericLazyValue operator[](const std::basic_string<Ch>& name) const { return Lookup(name.data(), static_cast<SizeType>(name.size())); }
+#endif
+
+    //! Const member iterator
+    /*! \pre IsObject() == true */
+    MemberIterator MemberBegin() const { RAPIDJSON_ASSERT(IsObject()); return MemberIterator(doc_, index_ + 1); }
+    //! Const \em past-the-end member iterator
+    /*! \pre IsObject() == true */
+    MemberIterator MemberEnd() const { RAPIDJSON_ASSERT(IsObject()); return MemberIterator(doc_, GetEntry().GetPayload()); }
+
+    //! Check whether a member exists in the object.
+    bool HasMember(const Ch* name) const { return FindMember(name) != MemberEnd(); }
+
+#if RAPIDJSON_HAS_STDSTRING
+    //! Check whether a member exists in the object with string object.
+    bool HasMember(const std::basic_string<Ch>& name) const { return FindMember(name) != MemberEnd(); }
+#endif
+
+    //! Find member by name.
+    /*! \return Iterator to member, if it exists. Otherwise returns \ref MemberEnd().
+        \note Names without escapes are compared to the text directly, the
+            others are decoded first.
+    */
+    MemberIterator FindMember(const Ch* name) const { return FindMember(name, internal::StrLen(name)); }
+
+#if RAPIDJSON_HAS_STDSTRING
+    //! Find member by string object name.
+    MemberIterator FindMember(const std::basic_string<Ch>& name) const { return FindMember(name.data(), static_cast<SizeType>(name.size())); }
+#endif
+
+    //@}
+
+    //!@name Array
+    //@{
+
+    //! Get the number of elements in array.
+    SizeType Size() const { RAPIDJSON_ASSERT(IsArray()); return doc_->GetEntry(GetEntry().GetPayload()).GetPayload(); }
+
+    //! Check whether the array is empty.
+    bool Empty() const { return Size() == 0; }
+
+    //! Get an element from array by index.
+    /*! \pre IsArray() == true
+        \param index Zero-based index of element.
+        \note Steps over the elements before it, iterate with Begin() to read them in order.
+    */
+    GenericLazyValue operator[](SizeType index) const {
+        RAPIDJSON_ASSERT(index < Size());
+        SizeType i = index_ + 1;
+        for (; index > 0; --index)
+            i = doc_->NextIndex(i);
+        return GenericLazyValue(doc_, i);
+    }
+
+    //! Element iterator
+    /*! \pre IsArray() == true */
+    ValueIterator Begin() const { RAPIDJSON_ASSERT(IsArray()); return ValueIterator(GenericLazyValue(doc_, index_ + 1)); }
+    //! \em Past-the-end element iterator
+    /*! \pre IsArray() == true */
+    ValueIterator End() const { RAPIDJSON_ASSERT(IsArray()); return ValueIterator(GenericLazyValue(doc_, GetEntry().GetPayload())); }
+
+    //@}
+
+    //!@name Number
+    //@{
+
+    int GetInt() const          { NumberType n; return GetNumber(n).GetInt(); }
+    unsigned GetUint() const    { NumberType n; return GetNumber(n).GetUint(); }
+    int64_t GetInt64() const    { NumberType n; return GetNumber(n).GetInt64(); }
+    uint64_t GetUint64() const  { NumberType n; return GetNumber(n).GetUint64(); }
+
+    double GetDouble() const    { NumberType n; return GetNumber(n).GetDouble(); }
+    float GetFloat() const      { return static_cast<float>(GetDouble()); }
+
+    //@}
+
+    //!@name String
+    //@{
+
+    //! Get the decoded, null-terminated string.
+    const Ch* GetString() const { RAPIDJSON_ASSERT(IsString()); return doc_->DecodeString(index_).str; }
+
+    //! Get the length of string.
+    /*! Since rapidjson permits "\\u0000" in the json string, strlen(v.GetString()) may not equal to v.GetStringLength().
+    */
+    SizeType GetStringLength() const {
+        RAPIDJSON_ASSERT(IsString());
+        const Entry& e = GetEntry();
+        if (!(e.info & Entry::kEscapedFlag))
+            return e.info & Entry::kLengthMask;
+        return doc_->DecodeString(index_).length;
+    }
+
+    //@}
+
+    //! Generate events of this value to a Handler.
+    /*! Emits the same events as GenericValue::Accept() of the value
+        GenericDocument would have parsed.
+        \tparam Handler type of handler.
+        \param handler An object implementing concept Handler.
+        \note The handler must not read values of the same document.
+    */
+    template <typename Handler>
+    bool Accept(Handler& handler) const {
+        switch (GetType()) {
+        case kNullType:     return handler.Null();
+        case kFalseType:    return handler.Bool(false);
+        case kTrueType:     return handler.Bool(true);
+
+        case kObjectType:
+            if (RAPIDJSON_UNLIKELY(!handler.StartObject()))
+                return false;
+            for (MemberIterator m = MemberBegin(); m != MemberEnd(); ++m) {
+                internal::LazyKeyHandler<Encoding, Handler> keyHandler(handler);
+                if (RAPIDJSON_UNLIKELY(!doc_->ParseString(m->name.index_, keyHandler)))
+                    return false;
+                if (RAPIDJSON_UNLIKELY(!m->value.Accept(handler)))
+                    return false;
+            }
+            return handler.EndObject(MemberCount());
+
+        case kArrayType:
+            if (RAPIDJSON_UNLIKELY(!handler.StartArray()))
+                return false;
+            for (ValueIterator v = Begin(); v != End(); ++v)
+                if (RAPIDJSON_UNLIKELY(!v->Accept(handler)))
+                    return false;
+            return handler.EndArray(Size());
+
+        case kStringType:
+            return doc_->ParseString(index_, handler);
+
+        default:
+            RAPIDJSON_ASSERT(GetType() == kNumberType);
+            NumberType n;
+            GetNumber(n);
+            if (n.IsDouble()) return handler.Double(n.GetDouble());
+            else if (n.IsInt()) return handler.Int(n.GetInt());
+            else if (n.IsUint()) return handler.Uint(n.GetUint());
+            else if (n.IsInt64()) return handler.Int64(n.GetInt64());
+            else return handler.Uint64(n.GetUint64());
+        }
+    }
+
+protected:
+    friend class GenericLazyDocument<Encoding, Allocator, StackAllocator>;
+    friend class GenericLazyValueIterator<Encoding, Allocator, StackAllocator>;
+    friend class GenericLazyMemberIterator<Encoding, Allocator, StackAllocator>;
+    typedef GenericValue<Encoding, Allocator> NumberType;
+
+    GenericLazyValue(const DocumentType* doc, SizeType index) : doc_(doc), index_(index) {}
+
+    const Entry& GetEntry() const { RAPIDJSON_ASSERT(doc_ != 0); return doc_->GetEntry(index_); }
+
+    const NumberType& GetNumber(NumberType& n) const {
+        RAPIDJSON_ASSERT(IsNumber());
+        doc_->ParseNumber(index_, n);
+        return n;
+    }
+
+    GenericLazyValue Lookup(const Ch* name, SizeType length) const {
+        MemberIterator m = FindMember(name, length);
+        if (m != MemberEnd())
+            return m->value;
+        RAPIDJSON_ASSERT(false);    // see above note
+        return doc_->GetNullValue();
+    }
+
+    MemberIterator FindMember(const Ch* name, SizeType length) const {
+        RAPIDJSON_ASSERT(IsObject());
+        RAPIDJSON_ASSERT(name);
+        MemberIterator m = MemberBegin();
+        for (const MemberIterator end = MemberEnd(); m != end; ++m)
+            if (doc_->NameEquals(m->name.index_, name, length))
+                break;
+        return m;
+    }
+
+    const DocumentType* doc_;   //!< Document with the tape.
+    SizeType index_;            //!< Tape entry of the value.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// GenericLazyMember
+
+//! Name-value pair in a JSON object of a GenericLazyDocument.
+template <typename Encoding, typename Allocator = RAPIDJSON_DEFAULT_ALLOCATOR, typename StackAllocator = RAPIDJSON_DEFAULT_STACK_ALLOCATOR >
+struct GenericLazyMember {
+    GenericLazyValue<Encoding, Allocator, StackAllocator> name;     //!< name of member (must be a string)
+    GenericLazyValue<Encoding, Allocator, StackAllocator> value;    //!< value of member.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// GenericLazyValueIterator
+
+//! Forward iterator over the elements of an array of a GenericLazyDocument.
+template <typename Encoding, typename Allocator, typename StackAllocator>
+class GenericLazyValueIterator {
+    friend class GenericLazyValue<Encoding, Allocator, StackAllocator>;
+    typedef GenericLazyValue<Encoding, Allocator, StackAllocator> PlainType;
+
+public:
+    /** \name std::iterator_traits support */
+    //@{
+    typedef PlainType       value_type;
+    typedef const PlainType* pointer;
+    typedef const PlainType& reference;
+    typedef std::ptrdiff_t  difference_type;
+    typedef std::forward_iterator_tag iterator_category;
+    //@}
+
+    //! Default constructor (singular value)
+    GenericLazyValueIterator() : value_() {}
+
+    GenericLazyValueIterator& operator++() { value_.index_ = value_.doc_->NextIndex(value_.index_); return *this; }
+    GenericLazyValueIterator operator++(int) { GenericLazyValueIterator old(*this); ++*this; return old; }
+
+    bool operator==(const GenericLazyValueIterator& that) const { return value_.index_ == that.value_.index_; }
+    bool operator!=(const GenericLazyValueIterator& that) const { return value_.index_ != that.value_.index_; }
+
+    reference operator*() const { return value_; }
+    pointer   operator->() const { return &value_; }
+
+private:
+    explicit GenericLazyValueIterator(const PlainType& value) : value_(value) {}
+
+    PlainType value_;   //!< Current element.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// GenericLazyMemberIterator
+
+//! Forward iterator over the members of an object of a GenericLazyDocument.
+template <typename Encoding, typename Allocator, typename StackAllocator>
+class GenericLazyMemberIterator {
+    friend class GenericLazyValue<Encoding, Allocator, StackAllocator>;
+    typedef GenericLazyValue<Encoding, Allocator, StackAllocator> ValueType;
+    typedef GenericLazyMember<Encoding, Allocator, StackAllocator> PlainType;
+    typedef typename ValueType::DocumentType DocumentType;
+
+public:
+    /** \name std::iterator_traits support */
+    //@{
+    typedef PlainType       value_type;
+    typedef const PlainType* pointer;
+    typedef const PlainType& reference;
+    typedef std::ptrdiff_t  difference_type;
+    typedef std::forward_iterator_tag iterator_category;
+    //@}
+
+    //! Default constructor (singular value)
+    GenericLazyMemberIterator() : member_() {}
+
+    GenericLazyMemberIterator& operator++() { Set(member_.value.doc_->NextIndex(member_.value.index_)); return *this; }
+    GenericLazyMemberIterator operator++(int) { GenericLazyMemberIterator old(*this); ++*this; return old; }
+
+    bool operator==(const GenericLazyMemberIterator& that) const { return member_.name.index_ == that.member_.name.index_; }
+    bool operator!=(const GenericLazyMemberIterator& that) const { return member_.name.index_ != that.member_.name.index_; }
+
+    reference operator*() const { return member_; }
+    pointer   operator->() const { return &member_; }
+
+private:
+    GenericLazyMemberIterator(const DocumentType* doc, SizeType index) : member_() {
+        member_.name.doc_ = member_.value.doc_ = doc;
+        Set(index);
+    }
+
+    void Set(SizeType index) {
+        member_.name.index_ = index;
+        member_.value.index_ = index + 1;
+    }
+
+    PlainType member_;  //!< Current member.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// GenericLazyDocument
+
+//! A read-only document that converts its values only when they are read.
+/*! The text is read once to check its syntax and to build a tape of
+    8-byte entries, one per value (and one per closing bracket), that
+    points into the text and records where each object and array ends.
+    Nothing else is converted: the handles returned by the GenericValue
+    style queries walk the tape, compare member names with the text, and
+    decode strings and numbers when they are read. For reading a few fields
+    of a large text this needs a fraction of the time and memory of
+    GenericDocument.
+
+    The text is not copied, it must stay unchanged as long as the document
+    or its values are used. Values are found by stepping over the ones
+    before them, so for repeated reads of many members or elements a
+    GenericDocument is the better choice.
+
+    \tparam Encoding Encoding of the text and of the decoded strings.
+    \tparam Allocator Allocator for the decoded strings.
+    \tparam StackAllocator Allocator for the tape and the parsing stack.
+    \note Texts of 4 GiB or more, or with more than 2^29 values, fail with
+        kParseErrorTermination. Of the \ref ParseFlag "parse flags" only
+        kParseStopWhenDoneFlag and kParseFullPrecisionFlag are supported.
+    \note Reading a value may update the caches of the document, a document
+        must not be read from several threads at once.
+*/
+template <typename Encoding, typename Allocator = RAPIDJSON_DEFAULT_ALLOCATOR, typename StackAllocator = RAPIDJSON_DEFAULT_STACK_ALLOCATOR >
+class GenericLazyDocument : public GenericLazyValue<Encoding, Allocator, StackAllocator> {
+    typedef internal::LazyTapeEntry Entry;
+
+public:
+    typedef typename Encoding::Ch Ch;                                           //!< Character type derived from Encoding.
+    typedef GenericLazyValue<Encoding, Allocator, StackAllocator> ValueType;    //!< Value type of the document.
+    typedef Allocator AllocatorType;                                            //!< Allocator type from template parameter.
+    typedef StackAllocator StackAllocatorType;                                  //!< StackAllocator type from template parameter.
+
+    //! Constructor
+    /*! Creates an empty document which type is Null.
+        \param allocator        Optional allocator for the decoded strings.
+        \param stackCapacity    Optional initial capacity of the tape in bytes.
+        \param stackAllocator   Optional allocator for the tape and the parsing stack.
+    */
+    GenericLazyDocument(Allocator* allocator = 0, size_t stackCapacity = kDefaultStackCapacity, StackAllocator* stackAllocator = 0) :
+        ValueType(), allocator_(allocator), ownAllocator_(0), tape_(stackAllocator, stackCapacity), stack_(stackAllocator, kDefaultStackCapacity),
+        reader_(stackAllocator), text_(0), textEnd_(0), fullPrecision_(false), strings_(0), stringCapacity_(0), stringCount_(0), parseResult_()
+    {
+        if (!allocator_)
+            ownAllocator_ = allocator_ = RAPIDJSON_NEW(Allocator)();
+        this->doc_ = this;
+        Reset();
+    }
+
+    ~GenericLazyDocument() {
+        Allocator::Free(strings_);
+        RAPIDJSON_DELETE(ownAllocator_);
+    }
+
+    //!@name Parse from read-only string
+    //!@{
+
+    //! Index JSON text of a given length.
+    /*! \tparam parseFlags Combination of \ref ParseFlag, see the class notes.
+        \param str Text to read, which must outlive the document.
+        \param length Length of \c str in code units, it need not be null-terminated.
+        \return The document itself for fluent API.
+    */
+    template <unsigned parseFlags>
+    GenericLazyDocument& Parse(const Ch* str, size_t length) {
+        RAPIDJSON_ASSERT(str != 0 || length == 0);
+        Reset();
+        text_ = str;
+        textEnd_ = str + length;
+        fullPrecision_ = (parseFlags & kParseFullPrecisionFlag) != 0;
+        parseResult_ = Build((parseFlags & kParseStopWhenDoneFlag) != 0);
+        if (parseResult_.IsError())
+            Reset();
+        return *this;
+    }
+
+    //! Index null-terminated JSON text.
+    template <unsigned parseFlags>
+    GenericLazyDocument& Parse(const Ch* str) {
+        return Parse<parseFlags>(str, internal::StrLen(str));
+    }
+
+    //! Index JSON text of a given length (with \ref kParseDefaultFlags)
+    GenericLazyDocument& Parse(const Ch* str, size_t length) {
+        return Parse<kParseDefaultFlags>(str, length);
+    }
+
+    //! Index null-terminated JSON text (with \ref kParseDefaultFlags)
+    GenericLazyDocument& Parse(const Ch* str) {
+        return Parse<kParseDefaultFlags>(str);
+    }
+
+#if RAPIDJSON_HAS_STDSTRING
+    //! Index JSON text from a std::basic_string, which must outlive the document.
+    template <unsigned parseFlags>
+    GenericLazyDocument& Parse(const std::basic_string<Ch>& str) {
+        return Parse<parseFlags>(str.data(), str.size());
+    }
+
+    GenericLazyDocument& Parse(const std::basic_string<Ch>& str) {
+        return Parse<kParseDefaultFlags>(str);
+    }
+#endif // RAPIDJSON_HAS_STDSTRING
+
+    //!@}
+
+    //!@name Handling parse errors
+    //!@{
+
+    //! Whether a parse error has occurred in the last parsing.
+    bool HasParseError() const { return parseResult_.IsError(); }
+
+    //! Get the \ref ParseErrorCode of last parsing.
+    ParseErrorCode GetParseError() const { return parseResult_.Code(); }
+
+    //! Get the position of last parsing error in input, 0 otherwise.
+    size_t GetErrorOffset() const { return parseResult_.Offset(); }
+
+    //! Implicit conversion to get the last parse result
+    operator ParseResult() const { return parseResult_; }
+    //!@}
+
+    //! Get the allocator of the decoded strings.
+    Allocator& GetAllocator() {
+        RAPIDJSON_ASSERT(allocator_);
+        return *allocator_;
+    }
+
+    //! Get the number of tape entries, two more than the tokens of the text.
+    size_t GetTapeSize() const { return tape_.GetSize() / sizeof(Entry); }
+
+private:
+    friend class GenericLazyValue<Encoding, Allocator, StackAllocator>;
+    friend class GenericLazyValueIterator<Encoding, Allocator, StackAllocator>;
+    friend class GenericLazyMemberIterator<Encoding, Allocator, StackAllocator>;
+    typedef GenericValue<Encoding, Allocator> NumberType;
+
+    //! Decoded string of a tape entry.
+    struct String {
+        SizeType index;     //!< Tape entry plus one, zero if unused.
+        SizeType length;
+        const Ch* str;
+    };
+
+    //! Open object or array while building the tape.
+    struct Container {
+        SizeType index;
+        SizeType count;
+        bool object;
+    };
+
+    //! Prohibit copying
+    GenericLazyDocument(const GenericLazyDocument&);
+    //! Prohibit assignment
+    GenericLazyDocument& operator=(const GenericLazyDocument&);
+
+    //! Makes the document the null value, dropping the decoded strings.
+    void Reset() {
+        tape_.Clear();
+        stack_.Clear();
+        PushEntry(kNullType, 0, 0);     // root
+        PushEntry(kNullType, 0, 0);     // GetNullValue()
+        text_ = textEnd_ = 0;
+        if (stringCount_ > 0) {
+            std::memset(strings_, 0, stringCapacity_ * sizeof(String));
+            stringCount_ = 0;
+        }
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+    // Tape
+
+    const Entry& GetEntry(SizeType index) const {
+        RAPIDJSON_ASSERT(index < GetTapeSize());
+        return tape_.template Bottom<Entry>()[index];
+    }
+
+    //! Index of the value after the one at \c index.
+    SizeType NextIndex(SizeType index) const {
+        const Entry& e = GetEntry(index);
+        const uint32_t type = e.GetType();
+        return (type == kObjectType || type == kArrayType) ? e.GetPayload() + 1 : index + 1;
+    }
+
+    //! Value returned for missing members.
+    ValueType GetNullValue() const { return ValueType(this, static_cast<SizeType>(GetTapeSize() - 1)); }
+
+    void PushEntry(uint32_t type, size_t offset, uint32_t payload) {
+        Entry* e = tape_.template Push<Entry>();
+        e->offset = static_cast<uint32_t>(offset);
+        e->info = (type << Entry::kTypeShift) | payload;
+    }
+
+    size_t Offset(const Ch* p) const { return static_cast<size_t>(p - text_); }
+
+    const Ch* SkipWhitespace(const Ch* p) const {
+        while (p != textEnd_ && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t'))
+            ++p;
+        return p;
+    }
+
+    //! Checks the text and builds the tape, between the root and null entries of Reset().
+    ParseResult Build(bool stopWhenDone) {
+        if (static_cast<size_t>(textEnd_ - text_) > 0xFFFFFFFFu)
+            return ParseResult(kParseErrorTermination, 0);
+        tape_.template Pop<Entry>(2);
+        tape_.template Reserve<Entry>(static_cast<size_t>(textEnd_ - text_) / 8 + 2);
+
+        const Ch* p = SkipWhitespace(text_);
+        if (p == textEnd_)
+            return ParseResult(kParseErrorDocumentEmpty, Offset(p));
+
+        for (;;) {
+            // A value, or a member of a new object
+            if (p == textEnd_)
+                return ParseResult(kParseErrorValueInvalid, Offset(p));
+            const Ch c = *p;
+            if (c == '{' || c == '[') {
+                const uint32_t type = c == '{' ? kObjectType : kArrayType;
+                Container* container = stack_.template Push<Container>();
+                container->index = static_cast<SizeType>(GetTapeSize());
+                container->count = 0;
+                container->object = type == kObjectType;
+                PushEntry(type, Offset(p), 0);
+                p = SkipWhitespace(p + 1);
+                if (p == textEnd_ || *p != (c == '{' ? '}' : ']')) {
+                    if (type == kObjectType) {
+                        ParseResult result = ScanName(p);
+                        if (result.IsError())
+                            return result;
+                    }
+                    continue;
+                }
+                ParseResult result = CloseContainer(p++);
+                if (result.IsError())
+                    return result;
+            }
+            else {
+                ParseResult result = ScanScalar(p);
+                if (result.IsError())
+                    return result;
+            }
+
+            // After a value: separators and closing brackets
+            bool more = false;
+            while (!stack_.Empty() && !more) {
+                Container* container = stack_.template Top<Container>();
+                const bool object = container->object;
+                p = SkipWhitespace(p);
+                if (p != textEnd_ && *p == ',') {
+                    container->count++;
+                    p = SkipWhitespace(p + 1);
+                    if (object) {
+                        ParseResult result = ScanName(p);
+                        if (result.IsError())
+                            return result;
+                    }
+                    more = true;
+                }
+                else if (p != textEnd_ && *p == (object ? '}' : ']')) {
+                    container->count++;
+                    ParseResult result = CloseContainer(p++);
+                    if (result.IsError())
+                        return result;
+                }
+                else
+                    return ParseResult(object ? kParseErrorObjectMissCommaOrCurlyBracket : kParseErrorArrayMissCommaOrSquareBracket, Offset(p));
+            }
+            if (!more)
+                break;
+        }
+
+        if (!stopWhenDone) {
+            p = SkipWhitespace(p);
+            if (p != textEnd_)
+                return ParseResult(kParseErrorDocumentRootNotSingular, Offset(p));
+        }
+        PushEntry(kNullType, 0, 0);
+        return ParseResult();
+    }
+
+    //! Links the innermost container with its closing entry at \c p.
+    ParseResult CloseContainer(const Ch* p) {
+        const Container* container = stack_.template Pop<Container>(1);
+        const size_t end = GetTapeSize();
+        if (end > Entry::kPayloadMask)
+            return ParseResult(kParseErrorTermination, Offset(p));
+        tape_.template Bottom<Entry>()[container->index].info |= static_cast<uint32_t>(end);
+        PushEntry(Entry::kEndType, Offset(p), container->count);
+        return ParseResult();
+    }
+
+    //! Scans a member name, the colon and the whitespace up to the value.
+    ParseResult ScanName(const Ch*& p) {
+        if (p == textEnd_ || *p != '\"')
+            return ParseResult(kParseErrorObjectMissName, Offset(p));
+        ParseResult result = ScanString(p);
+        if (result.IsError())
+            return result;
+        p = SkipWhitespace(p);
+        if (p == textEnd_ || *p != ':')
+            return ParseResult(kParseErrorObjectMissColon, Offset(p));
+        p = SkipWhitespace(p + 1);
+        return ParseResult();
+    }
+
+    RAPIDJSON_FORCEINLINE ParseResult ScanScalar(const Ch*& p) {
+        switch (*p) {
+            case '\"': return ScanString(p);
+            case 'n': return ScanLiteral(p, "null", kNullType);
+            case 't': return ScanLiteral(p, "true", kTrueType);
+            case 'f': return ScanLiteral(p, "false", kFalseType);
+            default: return ScanNumber(p);
+        }
+    }
+
+    ParseResult ScanLiteral(const Ch*& p, const char* literal, Type type) {
+        const Ch* start = p;
+        for (++p, ++literal; *literal; ++p, ++literal)
+            if (p == textEnd_ || *p != static_cast<Ch>(*literal))
+                return ParseResult(kParseErrorValueInvalid, Offset(p));
+        PushEntry(type, Offset(start), 0);
+        return ParseResult();
+    }
+
+    static bool IsDigit(Ch c) { return c >= '0' && c <= '9'; }
+
+    RAPIDJSON_FORCEINLINE ParseResult ScanNumber(const Ch*& p) {
+        const Ch* start = p;
+        if (*p == '-')
+            ++p;
+        const Ch* integer = p;
+        if (p != textEnd_ && *p == '0')
+            integer = ++p;
+        else if (p != textEnd_ && *p >= '1' && *p <= '9')
+            while (++p != textEnd_ && IsDigit(*p)) {}
+        else
+            return ParseResult(kParseErrorValueInvalid, Offset(p));
+        size_t magnitude = static_cast<size_t>(p - integer);
+
+        if (p != textEnd_ && *p == '.') {
+            if (++p == textEnd_ || !IsDigit(*p))
+                return ParseResult(kParseErrorNumberMissFraction, Offset(p));
+            while (++p != textEnd_ && IsDigit(*p)) {}
+        }
+        if (p != textEnd_ && (*p == 'e' || *p == 'E')) {
+            const bool negative = ++p != textEnd_ && *p == '-';
+            if (p != textEnd_ && (*p == '+' || *p == '-'))
+                ++p;
+            if (p == textEnd_ || !IsDigit(*p))
+                return ParseResult(kParseErrorNumberMissExponent, Offset(p));
+            size_t exp = 0;
+            for (; p != textEnd_ && IsDigit(*p); ++p)
+                if (exp < 1000)
+                    exp = exp * 10 + static_cast<size_t>(*p - '0');
+            if (!negative)
+                magnitude += exp;
+        }
+        PushEntry(kNumberType, Offset(start), 0);
+
+        // Below 1e300 the number fits a double, beyond let GenericReader check it
+        if (magnitude > 300) {
+            NumberType n;
+            internal::LazySpanStream<Encoding> is(start, textEnd_);
+            internal::LazyNumberHandler<Encoding, Allocator> handler(n);
+            ParseResult result = fullPrecision_ ?
+                reader_.template Parse<kParseStopWhenDoneFlag | kParseFullPrecisionFlag>(is, handler) :
+                reader_.template Parse<kParseStopWhenDoneFlag>(is, handler);
+            if (result.IsError())
+                return ParseResult(result.Code(), Offset(start) + result.Offset());
+        }
+        return ParseResult();
+    }
+
+    //! Reads 4 hex digits of a \\u escape, \c p is after the 'u'.
+    bool ScanHex4(const Ch*& p, unsigned* codepoint) const {
+        *codepoint = 0;
+        for (int i = 0; i < 4; i++, ++p) {
+            if (p == textEnd_)
+                return false;
+            const Ch c = *p;
+            *codepoint <<= 4;
+            if (c >= '0' && c <= '9')
+                *codepoint += static_cast<unsigned>(c - '0');
+            else if (c >= 'A' && c <= 'F')
+                *codepoint += static_cast<unsigned>(c - 'A' + 10);
+            else if (c >= 'a' && c <= 'f')
+                *codepoint += static_cast<unsigned>(c - 'a' + 10);
+            else
+                return false;
+        }
+        return true;
+    }
+
+    //! Checks a string like GenericReader does, without decoding it.
+    RAPIDJSON_FORCEINLINE ParseResult ScanString(const Ch*& p) {
+        const Ch* start = p++;
+        bool escaped = false;
+        for (;;) {
+            p = internal::LazyScanUnescaped(p, textEnd_);
+            if (p == textEnd_)
+                return ParseResult(kParseErrorStringMissQuotationMark, Offset(p));
+            const Ch c = *p;
+            if (c == '\"')
+                break;
+            if (c != '\\')
+                return ParseResult(c == '\0' ? kParseErrorStringMissQuotationMark : kParseErrorStringInvalidEncoding, Offset(p));
+
+            escaped = true;
+            const Ch* escape = p++;
+            const Ch e = p != textEnd_ ? *p : '\0';
+            if (e == '\"' || e == '\\' || e == '/' || e == 'b' || e == 'f' || e == 'n' || e == 'r' || e == 't')
+                ++p;
+            else if (e == 'u') {
+                unsigned codepoint;
+                if (!ScanHex4(++p, &codepoint))
+                    return ParseResult(kParseErrorStringUnicodeEscapeInvalidHex, Offset(escape));
+                if (codepoint >= 0xD800 && codepoint <= 0xDFFF) {
+                    if (codepoint > 0xDBFF || p == textEnd_ || *p != '\\' || ++p == textEnd_ || *p != 'u')
+                        return ParseResult(kParseErrorStringUnicodeSurrogateInvalid, Offset(escape));
+                    if (!ScanHex4(++p, &codepoint))
+                        return ParseResult(kParseErrorStringUnicodeEscapeInvalidHex, Offset(escape));
+                    if (codepoint < 0xDC00 || codepoint > 0xDFFF)
+                        return ParseResult(kParseErrorStringUnicodeSurrogateInvalid, Offset(escape));
+                }
+            }
+            else
+                return ParseResult(kParseErrorStringEscapeInvalid, Offset(escape));
+        }
+
+        const size_t length = static_cast<size_t>(p - start - 1);
+        ++p;
+        PushEntry(kStringType, Offset(start),
+            (escaped || length >= Entry::kLengthMask) ? Entry::kEscapedFlag | Entry::kLengthMask : static_cast<uint32_t>(length));
+        return ParseResult();
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+    // Values
+
+    //! Sends the string at \c index to a handler through GenericReader.
+    template <typename Handler>
+    bool ParseString(SizeType index, Handler& handler) const {
+        internal::LazySpanStream<Encoding> is(text_ + GetEntry(index).offset, textEnd_);
+        return !reader_.template Parse<kParseStopWhenDoneFlag>(is, handler).IsError();
+    }
+
+    void ParseNumber(SizeType index, NumberType& n) const {
+        internal::LazySpanStream<Encoding> is(text_ + GetEntry(index).offset, textEnd_);
+        internal::LazyNumberHandler<Encoding, Allocator> handler(n);
+        const bool ok = fullPrecision_ ?
+            !reader_.template Parse<kParseStopWhenDoneFlag | kParseFullPrecisionFlag>(is, handler).IsError() :
+            !reader_.template Parse<kParseStopWhenDoneFlag>(is, handler).IsError();
+        RAPIDJSON_ASSERT(ok);   // the number was checked by Build()
+        (void)ok;
+    }
+
+    //! Whether the member name at \c index equals name[0, length).
+    bool NameEquals(SizeType index, const Ch* name, SizeType length) const {
+        const Entry& e = GetEntry(index);
+        if (!(e.info & Entry::kEscapedFlag))
+            return (e.info & Entry::kLengthMask) == length && std::memcmp(text_ + e.offset + 1, name, length * sizeof(Ch)) == 0;
+        const String& s = DecodeString(index);
+        return s.length == length && std::memcmp(s.str, name, length * sizeof(Ch)) == 0;
+    }
+
+    //! The decoded string at \c index, decoded and cached on first use.
+    const String& DecodeString(SizeType index) const {
+        if (stringCount_ * 2 >= stringCapacity_)
+            GrowStrings();
+        const SizeType mask = stringCapacity_ - 1;
+        SizeType slot = (index * 0x9E3779B1u) & mask;
+        while (strings_[slot].index != 0) {
+            if (strings_[slot].index == index + 1)
+                return strings_[slot];
+            slot = (slot + 1) & mask;
+        }
+
+        String& s = strings_[slot];
+        const Entry& e = GetEntry(index);
+        if (!(e.info & Entry::kEscapedFlag)) {
+            const SizeType length = e.info & Entry::kLengthMask;
+            Ch* str = static_cast<Ch*>(allocator_->Malloc((length + 1) * sizeof(Ch)));
+            std::memcpy(str, text_ + e.offset + 1, length * sizeof(Ch));
+            str[length] = '\0';
+            s.str = str;
+            s.length = length;
+        }
+        else {
+            internal::LazyStringHandler<Encoding, Allocator> handler(*allocator_);
+            bool ok = ParseString(index, handler);
+            RAPIDJSON_ASSERT(ok);   // the string was checked by Build()
+            (void)ok;
+            s.str = handler.str_;
+            s.length = handler.length_;
+        }
+        s.index = index + 1;
+        stringCount_++;
+        return s;
+    }
+
+    void GrowStrings() const {
+        const SizeType capacity = stringCapacity_ ? stringCapacity_ * 2 : 16;
+        String* strings = static_cast<String*>(allocator_->Malloc(capacity * sizeof(String)));
+        std::memset(strings, 0, capacity * sizeof(String));
+        for (SizeType i = 0; i < stringCapacity_; i++) {
+            if (strings_[i].index == 0)
+                continue;
+            SizeType slot = ((strings_[i].index - 1) * 0x9E3779B1u) & (capacity - 1);
+            while (strings[slot].index != 0)
+                slot = (slot + 1) & (capacity - 1);
+            strings[slot] = strings_[i];
+        }
+        Allocator::Free(strings_);
+        strings_ = strings;
+        stringCapacity_ = capacity;
+    }
+
+    static const size_t kDefaultStackCapacity = 1024;
+    Allocator* allocator_;
+    Allocator* ownAllocator_;
+    internal::Stack<StackAllocator> tape_;
+    internal::Stack<StackAllocator> stack_;
+    mutable GenericReader<Encoding, Encoding, StackAllocator> reader_;
+    const Ch* text_;
+    const Ch* textEnd_;
+    bool fullPrecision_;
+    mutable String* strings_;           //!< Open-addressing table of the decoded strings.
+    mutable SizeType stringCapacity_;
+    mutable SizeType stringCount_;
+    ParseResult parseResult_;
+};
+
+//! GenericLazyDocument with UTF8 encoding
+typedef GenericLazyDocument<UTF8<> > LazyDocument;
+//! GenericLazyValue with UTF8 encoding
+typedef GenericLazyValue<UTF8<> > LazyValue;
+
+RAPIDJSON_NAMESPACE_END
+
+#ifdef __GNUC__
+RAPIDJSON_DIAG_POP
+#endif
+
+#endif // RAPIDJSON_LAZYDOCUMENT_H_
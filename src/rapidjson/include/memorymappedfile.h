@@ -0,0 +1,225 @@
+// Tencent is pleased to support the open source community by making RapidJSON available.
+//
+// Copyright (C) 2015 THL A29 Limited, a Tencent company, and Milo Yip.
+//
+// Licensed under the MIT License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef RAPIDJSON_MEMORYMAPPEDFILE_H_
+#define RAPIDJSON_MEMORYMAPPEDFILE_H_
+
+#include "stream.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+RAPIDJSON_NAMESPACE_BEGIN
+
+//! File mapped into memory for input.
+/*!
+    Maps a whole file instead of reading it with \c fread() in small blocks,
+    so the parser reads the page cache directly. The mapped text is always
+    followed by a '\\0', so it is used through the ordinary string streams:
+    GetStream() for \c Parse() and GetInsituStream() (or GetInsituString()
+    with \c ParseInsitu()) for in situ parsing. This keeps the optimizations
+    the reader has for GenericStringStream and GenericInsituStringStream.
+
+    \code
+    MemoryMappedFile file("big.json", MemoryMappedFile::kCopyOnWrite);
+    if (file.IsOpen())
+        d.ParseInsitu(file.GetInsituString());
+    \endcode
+
+    With \c kCopyOnWrite the mapping is private: the pages written by in situ
+    parsing are copied, and the file itself never changes. Strings parsed in
+    situ point into the mapping, so the file object must outlive them.
+
+    On POSIX the terminator comes from an anonymous page placed after the
+    file. On Windows, a file whose size is a multiple of the page size (or
+    is empty) has no room for it, and is read into an allocated buffer instead.
+
+    \note Only UTF-8 (char) is supported.
+*/
+class MemoryMappedFile {
+public:
+    typedef char Ch;    //!< Character type (byte).
+
+    //! Access to the mapped text.
+    enum Mode {
+        kReadOnly,      //!< Read only, for Parse().
+        kCopyOnWrite    //!< Writable private copy, for ParseInsitu().
+    };
+
+    //! Constructor.
+    /*!
+        \param filename Name of the file to map.
+        \param mode Access to the mapped text.
+        \note Check IsOpen() for failure.
+    */
+    explicit MemoryMappedFile(const char* filename, Mode mode = kReadOnly) : data_(), size_(), mode_(mode), length_()
+#ifdef _WIN32
+        , mapping_(), buffer_()
+#endif
+    {
+        RAPIDJSON_ASSERT(filename != 0);
+        Open(filename);
+    }
+
+    //! Destructor.
+    ~MemoryMappedFile() {
+        Close();
+    }
+
+    //! Whether the file was mapped.
+    bool IsOpen() const { return data_ != 0; }
+
+    //! Mode given to the constructor.
+    Mode GetMode() const { return mode_; }
+
+    //! Size of the file in bytes.
+    size_t GetSize() const { return size_; }
+
+    //! The text of the file, terminated by '\\0'.
+    const Ch* GetString() const { return data_; }
+
+    //! The writable text of the file, terminated by '\\0'. Requires \c kCopyOnWrite.
+    Ch* GetInsituString() {
+        RAPIDJSON_ASSERT(mode_ == kCopyOnWrite);
+        return data_;
+    }
+
+    //! Stream of the text for Parse().
+    StringStream GetStream() const {
+        RAPIDJSON_ASSERT(IsOpen());
+        return StringStream(data_);
+    }
+
+    //! Stream of the text for ParseInsitu(). Requires \c kCopyOnWrite.
+    InsituStringStream GetInsituStream() {
+        RAPIDJSON_ASSERT(IsOpen());
+        return InsituStringStream(GetInsituString());
+    }
+
+private:
+#ifdef _WIN32
+    void Open(const char* filename) {
+        HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+        if (file == INVALID_HANDLE_VALUE)
+            return;
+
+        LARGE_INTEGER size;
+        if (GetFileSizeEx(file, &size) && static_cast<unsigned long long>(size.QuadPart) < static_cast<size_t>(-1)) {
+            size_ = static_cast<size_t>(size.QuadPart);
+            SYSTEM_INFO info;
+            GetSystemInfo(&info);
+            if (size_ % info.dwPageSize != 0) {
+                // The rest of the last page is zero.
+                mapping_ = CreateFileMappingA(file, 0, mode_ == kCopyOnWrite ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, 0);
+                if (mapping_) {
+                    data_ = static_cast<Ch*>(MapViewOfFile(mapping_, mode_ == kCopyOnWrite ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0));
+                    if (!data_) {
+                        CloseHandle(mapping_);
+                        mapping_ = 0;
+                    }
+                }
+            }
+            else
+                Read(file);
+        }
+        CloseHandle(file);
+    }
+
+    void Read(HANDLE file) {
+        buffer_ = static_cast<Ch*>(std::malloc(size_ + 1));
+        if (!buffer_)
+            return;
+        size_t count = 0;
+        while (count < size_) {
+            DWORD n = 0;
+            const DWORD chunk = size_ - count < 0x40000000u ? static_cast<DWORD>(size_ - count) : 0x40000000u;
+            if (!ReadFile(file, buffer_ + count, chunk, &n, 0) || n == 0)
+                break;
+            count += n;
+        }
+        if (count != size_) {
+            std::free(buffer_);
+            buffer_ = 0;
+            return;
+        }
+        buffer_[size_] = '\0';
+        data_ = buffer_;
+    }
+
+    void Close() {
+        if (mapping_) {
+            UnmapViewOfFile(data_);
+            CloseHandle(mapping_);
+        }
+        std::free(buffer_);
+    }
+#else
+    void Open(const char* filename) {
+        const int fd = open(filename, O_RDONLY);
+        if (fd < 0)
+            return;
+
+        struct stat st;
+        if (fstat(fd, &st) == 0 && static_cast<unsigned long long>(st.st_size) < static_cast<size_t>(-1) / 2) {
+            size_ = static_cast<size_t>(st.st_size);
+            const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+            length_ = (size_ + 1 + page - 1) / page * page;
+            const int prot = mode_ == kCopyOnWrite ? PROT_READ | PROT_WRITE : PROT_READ;
+
+            // Reserve room for the file and the terminator with zero pages,
+            // then map the file over the start of it.
+            void* base = mmap(0, length_, prot, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (base != MAP_FAILED) {
+                if (size_ == 0 || mmap(base, size_, prot, MAP_PRIVATE | MAP_FIXED, fd, 0) != MAP_FAILED) {
+                    data_ = static_cast<Ch*>(base);
+#ifdef MADV_SEQUENTIAL
+                    madvise(base, length_, MADV_SEQUENTIAL);
+#endif
+                }
+                else
+                    munmap(base, length_);
+            }
+        }
+        close(fd);
+    }
+
+    void Close() {
+        if (data_)
+            munmap(data_, length_);
+    }
+#endif
+
+    // Prohibit copy constructor & assignment operator.
+    MemoryMappedFile(const MemoryMappedFile&);
+    MemoryMappedFile& operator=(const MemoryMappedFile&);
+
+    Ch* data_;
+    size_t size_;
+    Mode mode_;
+    size_t length_;     //!< Length of the mapping (POSIX).
+#ifdef _WIN32
+    HANDLE mapping_;
+    Ch* buffer_;        //!< Copy of a file without room for the terminator.
+#endif
+};
+
+RAPIDJSON_NAMESPACE_END
+
+#endif // RAPIDJSON_MEMORYMAPPEDFILE_H_
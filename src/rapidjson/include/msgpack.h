@@ -0,0 +1,736 @@
+// Tencent is pleased to support the open source community by making RapidJSON available.
+//
+// Copyright (C) 2015 THL A29 Limited, a Tencent company, and Milo Yip.
+//
+// Licensed under the MIT License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef RAPIDJSON_MSGPACK_H_
+#define RAPIDJSON_MSGPACK_H_
+
+/*! \file msgpack.h
+    MessagePack (https://msgpack.org) reader and writer speaking the SAX
+    Handler interface, so that for instance a GenericDocument can be written
+    with Accept(MsgPackWriter) and read back with Populate(MsgPackGenerator).
+*/
+
+#include "fwd.h"
+#include "reader.h"
+#include "memorystream.h"
+#include "internal/stack.h"
+#include "internal/strfunc.h"
+
+#ifdef __clang__
+RAPIDJSON_DIAG_PUSH
+RAPIDJSON_DIAG_OFF(c++98-compat)
+#endif
+
+RAPIDJSON_NAMESPACE_BEGIN
+
+namespace internal {
+
+//! Writes a run of bytes to a stream, in one copy for the buffers.
+template <typename OutputStream>
+inline void PutBytes(OutputStream& os, const char* s, size_t n) {
+    PutReserve(os, n);
+    for (size_t i = 0; i < n; i++)
+        PutUnsafe(os, s[i]);
+}
+
+template <typename Allocator>
+inline void PutBytes(GenericStringBuffer<UTF8<>, Allocator>& os, const char* s, size_t n) {
+    if (n)
+        std::memcpy(os.Push(n), s, n);
+}
+
+template <typename Allocator>
+inline void PutBytes(GenericMemoryBuffer<Allocator>& os, const char* s, size_t n) {
+    if (n)
+        std::memcpy(os.Push(n), s, n);
+}
+
+} // namespace internal
+
+///////////////////////////////////////////////////////////////////////////////
+// MsgPackWriter
+
+//! MessagePack writer.
+/*! Writes the SAX events of one root value as MessagePack:
+    - \c Null() and \c Bool() as nil, false and true,
+    - integers in their shortest int or uint form,
+    - \c Double() as float 64,
+    - \c RawNumber() as the number its text parses to,
+    - \c String() and \c Key() as str,
+    - objects as map and arrays as array.
+
+    The element count of a map or array header is only known at
+    \c EndObject() or \c EndArray(), so the contents of the root container
+    are gathered in an internal buffer and written to the stream, each
+    header in its shortest form, when the root value is complete.
+
+    \tparam OutputStream Type of output byte stream, its \c Ch must be \c char.
+    \tparam StackAllocator Type of allocator for the internal buffers.
+    \note implements Handler concept
+*/
+template<typename OutputStream, typename StackAllocator = CrtAllocator>
+class MsgPackWriter {
+public:
+    typedef char Ch;
+
+    static const size_t kDefaultLevelDepth = 32;
+
+    //! Constructor
+    /*! \param os Output stream.
+        \param stackAllocator User supplied allocator. If it is null, it will create a private one.
+        \param levelDepth Initial capacity of the level stack.
+    */
+    explicit
+    MsgPackWriter(OutputStream& os, StackAllocator* stackAllocator = 0, size_t levelDepth = kDefaultLevelDepth) :
+        os_(&os), buffer_(stackAllocator, kDefaultBufferCapacity), headers_(stackAllocator, levelDepth * sizeof(Header)),
+        level_stack_(stackAllocator, levelDepth * sizeof(Level)), hasRoot_(false) {}
+
+    explicit
+    MsgPackWriter(StackAllocator* allocator = 0, size_t levelDepth = kDefaultLevelDepth) :
+        os_(0), buffer_(allocator, kDefaultBufferCapacity), headers_(allocator, levelDepth * sizeof(Header)),
+        level_stack_(allocator, levelDepth * sizeof(Level)), hasRoot_(false) {}
+
+    //! Reset the writer with a new stream.
+    /*! This function resets the writer with a new stream and default settings,
+        in order to make a MsgPackWriter object reusable for output multiple values.
+    */
+    void Reset(OutputStream& os) {
+        os_ = &os;
+        hasRoot_ = false;
+        buffer_.Clear();
+        headers_.Clear();
+        level_stack_.Clear();
+    }
+
+    //! Checks whether the output is a complete value.
+    bool IsComplete() const {
+        return hasRoot_ && level_stack_.Empty();
+    }
+
+    /*!@name Implementation of Handler
+        \see Handler
+    */
+    //@{
+
+    bool Null()                 { Prefix(kNullType);   return EndValue(PutByte(0xC0)); }
+    bool Bool(bool b)           { Prefix(b ? kTrueType : kFalseType); return EndValue(PutByte(b ? 0xC3 : 0xC2)); }
+    bool Int(int i)             { Prefix(kNumberType); return EndValue(WriteInt64(i)); }
+    bool Uint(unsigned u)       { Prefix(kNumberType); return EndValue(WriteUint64(u)); }
+    bool Int64(int64_t i64)     { Prefix(kNumberType); return EndValue(WriteInt64(i64)); }
+    bool Uint64(uint64_t u64)   { Prefix(kNumberType); return EndValue(WriteUint64(u64)); }
+    bool Double(double d)       { Prefix(kNumberType); return EndValue(WriteDouble(d)); }
+
+    //! Writes the number the text parses to, as GenericReader with kParseFullPrecisionFlag reads it.
+    bool RawNumber(const Ch* str, SizeType length, bool copy = false) {
+        RAPIDJSON_ASSERT(str != 0);
+        (void)copy;
+        Prefix(kNumberType);
+        MemoryStream is(str, length);
+        GenericReader<UTF8<>, UTF8<>, StackAllocator> reader;
+        NumberHandler handler(*this);
+        const bool ok = !reader.template Parse<kParseFullPrecisionFlag | kParseStopWhenDoneFlag>(is, handler).IsError() &&
+            is.Tell() == length;
+        return EndValue(ok);
+    }
+
+    bool String(const Ch* str, SizeType length, bool copy = false) {
+        RAPIDJSON_ASSERT(str != 0);
+        (void)copy;
+        Prefix(kStringType);
+        return EndValue(WriteString(str, length));
+    }
+
+    bool StartObject() {
+        Prefix(kObjectType);
+        StartContainer(false);
+        return true;
+    }
+
+    bool Key(const Ch* str, SizeType length, bool copy = false) { return String(str, length, copy); }
+
+    bool EndObject(SizeType memberCount = 0) {
+        (void)memberCount;
+        RAPIDJSON_ASSERT(level_stack_.GetSize() >= sizeof(Level));                     // not inside an Object
+        RAPIDJSON_ASSERT(!level_stack_.template Top<Level>()->inArray);                 // currently inside an Array, not Object
+        RAPIDJSON_ASSERT(0 == level_stack_.template Top<Level>()->valueCount % 2);      // Object has a Key without a Value
+        return EndContainer(level_stack_.template Top<Level>()->valueCount / 2);
+    }
+
+    bool StartArray() {
+        Prefix(kArrayType);
+        StartContainer(true);
+        return true;
+    }
+
+    bool EndArray(SizeType elementCount = 0) {
+        (void)elementCount;
+        RAPIDJSON_ASSERT(level_stack_.GetSize() >= sizeof(Level));
+        RAPIDJSON_ASSERT(level_stack_.template Top<Level>()->inArray);
+        return EndContainer(level_stack_.template Top<Level>()->valueCount);
+    }
+    //@}
+
+    /*! @name Convenience extensions */
+    //@{
+
+    //! Simpler but slower overload.
+    bool String(const Ch* const& str) { return String(str, internal::StrLen(str)); }
+    bool Key(const Ch* const& str) { return Key(str, internal::StrLen(str)); }
+
+    //@}
+
+protected:
+    //! Information for each nested level
+    struct Level {
+        Level(bool inArray_, size_t header_) : valueCount(0), header(header_), inArray(inArray_) {}
+        size_t valueCount;  //!< number of values in this level
+        size_t header;      //!< index of the header of this level in headers_
+        bool inArray;       //!< true if in array, otherwise in object
+    };
+
+    //! Map or array header to insert in the buffer when writing it out.
+    struct Header {
+        size_t offset;      //!< offset of the contents in buffer_
+        size_t count;       //!< number of elements (members for a map)
+        bool isArray;
+    };
+
+    //! Receives the number parsed by RawNumber(), anything else is an error.
+    struct NumberHandler : BaseReaderHandler<UTF8<>, NumberHandler> {
+        explicit NumberHandler(MsgPackWriter& w) : writer(w) {}
+        bool Default() { return false; }
+        bool Int(int i) { return writer.WriteInt64(i); }
+        bool Uint(unsigned u) { return writer.WriteUint64(u); }
+        bool Int64(int64_t i) { return writer.WriteInt64(i); }
+        bool Uint64(uint64_t u) { return writer.WriteUint64(u); }
+        bool Double(double d) { return writer.WriteDouble(d); }
+
+        MsgPackWriter& writer;
+    };
+
+    static const size_t kDefaultBufferCapacity = 256;
+
+    void Prefix(Type type) {
+        (void)type;
+        if (RAPIDJSON_LIKELY(level_stack_.GetSize() != 0)) { // this value is not at root
+            Level* level = level_stack_.template Top<Level>();
+            if (!level->inArray && level->valueCount % 2 == 0)
+                RAPIDJSON_ASSERT(type == kStringType);  // if it's in object, then even number should be a name
+            level->valueCount++;
+        }
+        else {
+            RAPIDJSON_ASSERT(!hasRoot_);    // Should only has one and only one root.
+            hasRoot_ = true;
+        }
+    }
+
+    //! Flushes the stream after a root value.
+    bool EndValue(bool ret) {
+        if (RAPIDJSON_UNLIKELY(level_stack_.Empty()))   // end of json text
+            os_->Flush();
+        return ret;
+    }
+
+    bool WriteUint64(uint64_t u) {
+        if (u < 0x80)
+            return PutByte(static_cast<unsigned>(u));           // positive fixint
+        else if (u <= 0xFFu)
+            return WriteHeader(0xCC, u, 1);
+        else if (u <= 0xFFFFu)
+            return WriteHeader(0xCD, u, 2);
+        else if (u <= 0xFFFFFFFFu)
+            return WriteHeader(0xCE, u, 4);
+        else
+            return WriteHeader(0xCF, u, 8);
+    }
+
+    bool WriteInt64(int64_t i) {
+        if (i >= 0)
+            return WriteUint64(static_cast<uint64_t>(i));
+        const uint64_t u = static_cast<uint64_t>(i);
+        if (i >= -32)
+            return PutByte(static_cast<unsigned>(u & 0xFF));    // negative fixint
+        else if (i >= -128)
+            return WriteHeader(0xD0, u, 1);
+        else if (i >= -32768)
+            return WriteHeader(0xD1, u, 2);
+        else if (i >= -2147483647 - 1)
+            return WriteHeader(0xD2, u, 4);
+        else
+            return WriteHeader(0xD3, u, 8);
+    }
+
+    bool WriteDouble(double d) {
+        union { double d; uint64_t u; } v;
+        v.d = d;
+        return WriteHeader(0xCB, v.u, 8);
+    }
+
+    bool WriteString(const Ch* str, SizeType length) {
+        if (length < 32)
+            PutByte(0xA0 | length);                             // fixstr
+        else if (length <= 0xFFu)
+            WriteHeader(0xD9, length, 1);
+        else if (length <= 0xFFFFu)
+            WriteHeader(0xDA, length, 2);
+        else
+            WriteHeader(0xDB, length, 4);
+        Put(str, length);
+        return true;
+    }
+
+    //! Writes a type byte followed by the \c size low bytes of \c value in big endian.
+    bool WriteHeader(unsigned type, uint64_t value, unsigned size) {
+        char b[9];
+        b[0] = static_cast<char>(type);
+        for (unsigned i = 0; i < size; i++)
+            b[size - i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+        Put(b, size + 1);
+        return true;
+    }
+
+    bool PutByte(unsigned c) {
+        const char b = static_cast<char>(c);
+        Put(&b, 1);
+        return true;
+    }
+
+    //! Appends to the buffer inside a container, or writes the root scalar directly.
+    void Put(const char* s, size_t n) {
+        if (level_stack_.Empty())
+            internal::PutBytes(*os_, s, n);
+        else
+            std::memcpy(buffer_.template Push<char>(n), s, n);
+    }
+
+    void StartContainer(bool inArray) {
+        Header* h = headers_.template Push<Header>();
+        h->offset = buffer_.GetSize();
+        h->count = 0;
+        h->isArray = inArray;
+        new (level_stack_.template Push<Level>()) Level(inArray, headers_.GetSize() / sizeof(Header) - 1);
+    }
+
+    bool EndContainer(size_t count) {
+        Level* level = level_stack_.template Pop<Level>(1);
+        headers_.template Bottom<Header>()[level->header].count = count;
+        if (RAPIDJSON_UNLIKELY(level_stack_.Empty()))   // end of json text
+            WriteBuffer();
+        return true;
+    }
+
+    //! Writes out the buffer of the root container with its headers.
+    void WriteBuffer() {
+        const char* contents = buffer_.template Bottom<char>();
+        const Header* h = headers_.template Bottom<Header>();
+        const Header* end = headers_.template End<Header>();
+        size_t offset = 0;
+        for (; h != end; ++h) {
+            internal::PutBytes(*os_, contents + offset, h->offset - offset);
+            offset = h->offset;
+
+            char b[5];
+            unsigned size;
+            if (h->count < 16) {
+                b[0] = static_cast<char>((h->isArray ? 0x90 : 0x80) | h->count);   // fixarray, fixmap
+                size = 1;
+            }
+            else if (h->count <= 0xFFFFu) {
+                b[0] = static_cast<char>(h->isArray ? 0xDC : 0xDE);
+                b[1] = static_cast<char>(h->count >> 8);
+                b[2] = static_cast<char>(h->count & 0xFF);
+                size = 3;
+            }
+            else {
+                b[0] = static_cast<char>(h->isArray ? 0xDD : 0xDF);
+                for (unsigned i = 0; i < 4; i++)
+                    b[4 - i] = static_cast<char>((h->count >> (8 * i)) & 0xFF);
+                size = 5;
+            }
+            internal::PutBytes(*os_, b, size);
+        }
+        internal::PutBytes(*os_, contents + offset, buffer_.GetSize() - offset);
+        os_->Flush();
+
+        buffer_.Clear();
+        headers_.Clear();
+    }
+
+    OutputStream* os_;
+    internal::Stack<StackAllocator> buffer_;        //!< contents of the root container (char)
+    internal::Stack<StackAllocator> headers_;       //!< container headers of buffer_ in order (Header)
+    internal::Stack<StackAllocator> level_stack_;   //!< open containers (Level)
+    bool hasRoot_;
+
+private:
+    // Prohibit copy constructor & assignment operator.
+    MsgPackWriter(const MsgPackWriter&);
+    MsgPackWriter& operator=(const MsgPackWriter&);
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// GenericMsgPackReader
+
+//! MessagePack reader.
+/*! Parses one MessagePack value from a memory buffer and sends the same
+    events as GenericReader would for the equivalent JSON:
+    - nil, false and true as \c Null() and \c Bool(),
+    - integers as \c Uint() or \c Int() when they fit in 32 bits, otherwise
+      \c Uint64() or \c Int64() (non-negative values always as unsigned),
+    - float 32 and float 64 as \c Double(),
+    - str as \c String(), or \c Key() for map keys, which must be str,
+    - map and array as \c StartObject() ... \c EndObject(count) and
+      \c StartArray() ... \c EndArray(count).
+
+    bin and ext values have no JSON equivalent and fail with
+    \c kParseErrorValueInvalid.
+
+    Parse() hands strings over null-terminated in an internal buffer
+    (\c copy is \c true). ParseInsitu() moves each string over its own
+    header and terminates it in place, so they are references into the
+    input buffer (\c copy is \c false), like \c kParseInsituFlag.
+
+    Supported flags are \c kParseStopWhenDoneFlag (trailing bytes are left,
+    see GetParsedLength()) and \c kParseValidateEncodingFlag (str must be
+    valid UTF-8).
+
+    \tparam StackAllocator Allocator type for the string buffer.
+*/
+template <typename StackAllocator = CrtAllocator>
+class GenericMsgPackReader {
+public:
+    typedef char Ch;
+
+    //! Constructor.
+    /*! \param stackAllocator Optional allocator for allocating the string buffer.
+        \param stackCapacity stack capacity in bytes for storing a single decoded string.
+    */
+    GenericMsgPackReader(StackAllocator* stackAllocator = 0, size_t stackCapacity = kDefaultStackCapacity) :
+        stack_(stackAllocator, stackCapacity), parseResult_(), begin_(), src_(), end_() {}
+
+    //! Parse a MessagePack value.
+    /*! \tparam parseFlags Combination of \ref ParseFlag.
+        \param data Buffer holding the value.
+        \param length Size of the buffer in bytes.
+        \param handler The handler to receive events.
+        \return Whether the parsing is successful.
+    */
+    template <unsigned parseFlags, typename Handler>
+    ParseResult Parse(const void* data, size_t length, Handler& handler) {
+        return ParseBuffer<parseFlags & ~static_cast<unsigned>(kParseInsituFlag)>(static_cast<const char*>(data), length, handler);
+    }
+
+    //! Parse a MessagePack value with default flags.
+    template <typename Handler>
+    ParseResult Parse(const void* data, size_t length, Handler& handler) {
+        return Parse<kParseDefaultFlags>(data, length, handler);
+    }
+
+    //! Parse a MessagePack value, passing strings as references into the (modified) buffer.
+    template <unsigned parseFlags, typename Handler>
+    ParseResult ParseInsitu(void* data, size_t length, Handler& handler) {
+        return ParseBuffer<parseFlags | kParseInsituFlag>(static_cast<const char*>(data), length, handler);
+    }
+
+    //! Parse a MessagePack value in place with default flags.
+    template <typename Handler>
+    ParseResult ParseInsitu(void* data, size_t length, Handler& handler) {
+        return ParseInsitu<kParseDefaultFlags>(data, length, handler);
+    }
+
+    //! Whether a parse error has occurred in the last parsing.
+    bool HasParseError() const { return parseResult_.IsError(); }
+
+    //! Get the \ref ParseErrorCode of last parsing.
+    ParseErrorCode GetParseErrorCode() const { return parseResult_.Code(); }
+
+    //! Get the position of last parsing error in input, 0 otherwise.
+    size_t GetErrorOffset() const { return parseResult_.Offset(); }
+
+    //! Number of bytes read by the last successful parsing.
+    size_t GetParsedLength() const { return static_cast<size_t>(src_ - begin_); }
+
+protected:
+    void SetParseError(ParseErrorCode code, size_t offset) { parseResult_.Set(code, offset); }
+
+private:
+    // Prohibit copy constructor & assignment operator.
+    GenericMsgPackReader(const GenericMsgPackReader&);
+    GenericMsgPackReader& operator=(const GenericMsgPackReader&);
+
+    static const size_t kDefaultStackCapacity = 256;    //!< Default stack capacity in bytes for storing a single decoded string.
+
+    // Discards the string buffer on exit.
+    struct ClearStackOnExit {
+        explicit ClearStackOnExit(GenericMsgPackReader& r) : r_(r) {}
+        ~ClearStackOnExit() { r_.stack_.Clear(); }
+    private:
+        GenericMsgPackReader& r_;
+        ClearStackOnExit(const ClearStackOnExit&);
+        ClearStackOnExit& operator=(const ClearStackOnExit&);
+    };
+
+    // Discards bytes written by UTF8::Validate().
+    struct NullStream {
+        typedef char Ch;
+        void Put(char) {}
+    };
+
+    template <unsigned parseFlags, typename Handler>
+    ParseResult ParseBuffer(const char* data, size_t length, Handler& handler) {
+        parseResult_.Clear();
+        ClearStackOnExit scope(*this);
+        begin_ = src_ = data;
+        end_ = data + length;
+
+        if (RAPIDJSON_UNLIKELY(length == 0)) {
+            RAPIDJSON_PARSE_ERROR_NORETURN(kParseErrorDocumentEmpty, 0);
+            return parseResult_;
+        }
+
+        ParseValue<parseFlags>(handler);
+        RAPIDJSON_PARSE_ERROR_EARLY_RETURN(parseResult_);
+
+        if (!(parseFlags & kParseStopWhenDoneFlag) && RAPIDJSON_UNLIKELY(src_ != end_))
+            RAPIDJSON_PARSE_ERROR_NORETURN(kParseErrorDocumentRootNotSingular, Tell());
+
+        return parseResult_;
+    }
+
+    size_t Tell() const { return static_cast<size_t>(src_ - begin_); }
+
+    //! Reads a big endian unsigned integer of \c size bytes, false if the buffer is too short.
+    bool Read(unsigned size, uint64_t* value) {
+        if (RAPIDJSON_UNLIKELY(static_cast<size_t>(end_ - src_) < size))
+            return false;
+        uint64_t v = 0;
+        for (unsigned i = 0; i < size; i++)
+            v = (v << 8) | static_cast<unsigned char>(src_[i]);
+        src_ += size;
+        *value = v;
+        return true;
+    }
+
+    static bool IsStringType(unsigned char c) {
+        return (c >= 0xA0 && c <= 0xBF) || (c >= 0xD9 && c <= 0xDB);
+    }
+
+    // Parse any MessagePack value
+    template<unsigned parseFlags, typename Handler>
+    void ParseValue(Handler& handler, bool isKey = false) {
+        const size_t start = Tell();
+        if (RAPIDJSON_UNLIKELY(src_ == end_))
+            RAPIDJSON_PARSE_ERROR(kParseErrorValueInvalid, start);
+
+        const unsigned char c = static_cast<unsigned char>(*src_++);
+        bool ok = true;
+        uint64_t v = 0;
+        if (c <= 0x7F)
+            ok = handler.Uint(c);                                                       // positive fixint
+        else if (c <= 0x8F)
+            ParseObject<parseFlags>(handler, c & 0x0F);                                 // fixmap
+        else if (c <= 0x9F)
+            ParseArray<parseFlags>(handler, c & 0x0F);                                  // fixarray
+        else if (c <= 0xBF)
+            ParseString<parseFlags>(handler, start, c & 0x1F, isKey);                   // fixstr
+        else if (c >= 0xE0)
+            ok = handler.Int(static_cast<int>(c) - 256);                                // negative fixint
+        else {
+            static const unsigned char kSize[32] = {
+                0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 4, 8, 1, 2, 4, 8,                         // C0-CF
+                1, 2, 4, 8, 0, 0, 0, 0, 0, 1, 2, 4, 2, 4, 2, 4                          // D0-DF
+            };
+            const unsigned size = kSize[c - 0xC0];
+            if (RAPIDJSON_UNLIKELY(!Read(size, &v)))
+                RAPIDJSON_PARSE_ERROR(kParseErrorValueInvalid, start);
+
+            switch (c) {
+                case 0xC0: ok = handler.Null(); break;
+                case 0xC2: ok = handler.Bool(false); break;
+                case 0xC3: ok = handler.Bool(true); break;
+                case 0xCA: { union { uint32_t u; float f; } f; f.u = static_cast<uint32_t>(v); ok = handler.Double(static_cast<double>(f.f)); } break;
+                case 0xCB: { union { uint64_t u; double d; } d; d.u = v; ok = handler.Double(d.d); } break;
+                case 0xCC: case 0xCD: case 0xCE: case 0xCF:
+                    ok = HandleUint64(handler, v); break;
+                case 0xD0: ok = HandleInt64(handler, static_cast<int64_t>(static_cast<int8_t>(v))); break;
+                case 0xD1: ok = HandleInt64(handler, static_cast<int64_t>(static_cast<int16_t>(v))); break;
+                case 0xD2: ok = HandleInt64(handler, static_cast<int64_t>(static_cast<int32_t>(v))); break;
+                case 0xD3: ok = HandleInt64(handler, static_cast<int64_t>(v)); break;
+                case 0xD9: case 0xDA: case 0xDB:
+                    ParseString<parseFlags>(handler, start, static_cast<SizeType>(v), isKey); break;
+                case 0xDC: case 0xDD:
+                    ParseArray<parseFlags>(handler, static_cast<SizeType>(v)); break;
+                case 0xDE: case 0xDF:
+                    ParseObject<parseFlags>(handler, static_cast<SizeType>(v)); break;
+                default:    // never used, bin, ext
+                    RAPIDJSON_PARSE_ERROR(kParseErrorValueInvalid, start);
+            }
+        }
+
+        if (RAPIDJSON_UNLIKELY(!ok))
+            RAPIDJSON_PARSE_ERROR(kParseErrorTermination, start);
+    }
+
+    template <typename Handler>
+    static bool HandleUint64(Handler& handler, uint64_t u) {
+        return u <= 0xFFFFFFFFu ? handler.Uint(static_cast<unsigned>(u)) : handler.Uint64(u);
+    }
+
+    template <typename Handler>
+    static bool HandleInt64(Handler& handler, int64_t i) {
+        if (i >= 0)
+            return HandleUint64(handler, static_cast<uint64_t>(i));
+        return i >= -2147483647 - 1 ? handler.Int(static_cast<int>(i)) : handler.Int64(i);
+    }
+
+    template<unsigned parseFlags, typename Handler>
+    void ParseString(Handler& handler, size_t start, SizeType length, bool isKey) {
+        if (RAPIDJSON_UNLIKELY(static_cast<size_t>(end_ - src_) < length))
+            RAPIDJSON_PARSE_ERROR(kParseErrorStringMissQuotationMark, start);
+
+        if (parseFlags & kParseValidateEncodingFlag) {
+            MemoryStream is(src_, length);
+            NullStream os;
+            while (is.Tell() < length)
+                if (RAPIDJSON_UNLIKELY(!UTF8<>::Validate(is, os)))
+                    RAPIDJSON_PARSE_ERROR(kParseErrorStringInvalidEncoding, Tell() + is.Tell());
+        }
+
+        const char* str;
+        if (parseFlags & kParseInsituFlag) {
+            // The header is at least one byte, room for the terminator
+            char* dst = const_cast<char*>(begin_ + start);
+            std::memmove(dst, src_, length);
+            dst[length] = '\0';
+            str = dst;
+        }
+        else {
+            char* dst = stack_.template Push<char>(static_cast<size_t>(length) + 1);
+            std::memcpy(dst, src_, length);
+            dst[length] = '\0';
+            str = dst;
+        }
+        src_ += length;
+
+        const bool copy = !(parseFlags & kParseInsituFlag);
+        const bool ok = isKey ? handler.Key(str, length, copy) : handler.String(str, length, copy);
+        if (!(parseFlags & kParseInsituFlag))
+            stack_.template Pop<char>(static_cast<size_t>(length) + 1);
+        if (RAPIDJSON_UNLIKELY(!ok))
+            RAPIDJSON_PARSE_ERROR(kParseErrorTermination, start);
+    }
+
+    template<unsigned parseFlags, typename Handler>
+    void ParseObject(Handler& handler, SizeType memberCount) {
+        if (RAPIDJSON_UNLIKELY(!handler.StartObject()))
+            RAPIDJSON_PARSE_ERROR(kParseErrorTermination, Tell());
+
+        for (SizeType i = 0; i < memberCount; i++) {
+            if (RAPIDJSON_UNLIKELY(src_ == end_))
+                RAPIDJSON_PARSE_ERROR(kParseErrorObjectMissCommaOrCurlyBracket, Tell());
+            if (RAPIDJSON_UNLIKELY(!IsStringType(static_cast<unsigned char>(*src_))))
+                RAPIDJSON_PARSE_ERROR(kParseErrorObjectMissName, Tell());
+            ParseValue<parseFlags>(handler, true);
+            RAPIDJSON_PARSE_ERROR_EARLY_RETURN_VOID;
+
+            if (RAPIDJSON_UNLIKELY(src_ == end_))
+                RAPIDJSON_PARSE_ERROR(kParseErrorObjectMissColon, Tell());
+            ParseValue<parseFlags>(handler);
+            RAPIDJSON_PARSE_ERROR_EARLY_RETURN_VOID;
+        }
+
+        if (RAPIDJSON_UNLIKELY(!handler.EndObject(memberCount)))
+            RAPIDJSON_PARSE_ERROR(kParseErrorTermination, Tell());
+    }
+
+    template<unsigned parseFlags, typename Handler>
+    void ParseArray(Handler& handler, SizeType elementCount) {
+        if (RAPIDJSON_UNLIKELY(!handler.StartArray()))
+            RAPIDJSON_PARSE_ERROR(kParseErrorTermination, Tell());
+
+        for (SizeType i = 0; i < elementCount; i++) {
+            if (RAPIDJSON_UNLIKELY(src_ == end_))
+                RAPIDJSON_PARSE_ERROR(kParseErrorArrayMissCommaOrSquareBracket, Tell());
+            ParseValue<parseFlags>(handler);
+            RAPIDJSON_PARSE_ERROR_EARLY_RETURN_VOID;
+        }
+
+        if (RAPIDJSON_UNLIKELY(!handler.EndArray(elementCount)))
+            RAPIDJSON_PARSE_ERROR(kParseErrorTermination, Tell());
+    }
+
+    internal::Stack<StackAllocator> stack_;  //!< A stack for storing the decoded string temporarily.
+    ParseResult parseResult_;
+    const char* begin_;
+    const char* src_;
+    const char* end_;
+};
+
+//! MessagePack reader with the default allocator.
+typedef GenericMsgPackReader<CrtAllocator> MsgPackReader;
+
+///////////////////////////////////////////////////////////////////////////////
+// MsgPackGenerator
+
+//! A helper class for reading MessagePack into a GenericDocument.
+/*! This helper class is a functor, designed as a parameter of \ref GenericDocument::Populate().
+    \code
+    MsgPackGenerator<> generator(data, size);
+    document.Populate(generator);
+    if (generator.GetParseResult().IsError()) ...
+    \endcode
+    Constructed from a non-const buffer with \c kParseInsituFlag, strings are
+    parsed in place and the document refers to them.
+
+    \tparam parseFlags Combination of \ref ParseFlag.
+    \tparam StackAllocator Allocator type for the reader's string buffer.
+*/
+template <unsigned parseFlags = kParseDefaultFlags, typename StackAllocator = CrtAllocator>
+class MsgPackGenerator {
+public:
+    MsgPackGenerator(const void* data, size_t length) : data_(data), insitu_(), length_(length), parsedLength_(), parseResult_() {
+        RAPIDJSON_ASSERT(!(parseFlags & kParseInsituFlag)); // Insitu needs a mutable buffer
+    }
+
+    MsgPackGenerator(void* data, size_t length) : data_(data), insitu_(data), length_(length), parsedLength_(), parseResult_() {}
+
+    template <typename Handler>
+    bool operator()(Handler& handler) {
+        GenericMsgPackReader<StackAllocator> reader;
+        if (parseFlags & kParseInsituFlag)
+            parseResult_ = reader.template ParseInsitu<parseFlags>(insitu_, length_, handler);
+        else
+            parseResult_ = reader.template Parse<parseFlags>(data_, length_, handler);
+        parsedLength_ = reader.GetParsedLength();
+        return !parseResult_.IsError();
+    }
+
+    const ParseResult& GetParseResult() const { return parseResult_; }
+    size_t GetParsedLength() const { return parsedLength_; }
+
+private:
+    const void* data_;
+    void* insitu_;
+    size_t length_;
+    size_t parsedLength_;
+    ParseResult parseResult_;
+};
+
+RAPIDJSON_NAMESPACE_END
+
+#ifdef __clang__
+RAPIDJSON_DIAG_POP
+#endif
+
+#endif // RAPIDJSON_MSGPACK_H_
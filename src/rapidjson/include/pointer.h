@@ -1176,6 +1176,596 @@ private:
 //! GenericPointer for Value (UTF-8, default allocator).
 typedef GenericPointer<Value> Pointer;
 
+///////////////////////////////////////////////////////////////////////////////
+// GenericPointerSet
+
+//! A compiled set of JSON Pointers resolved together.
+/*!
+    Evaluating many pointers one by one walks the common part of their paths
+    again for every pointer, and looks up every object member with
+    \c FindMember(). A pointer set copies the tokens of the added pointers,
+    sorts the pointers and merges their common prefixes into a trie, so that
+    Get() resolves all of them in one traversal of the document.
+
+    Every member step remembers the index at which it found its member last
+    time, and tries that member first. When the same pointers are evaluated
+    against many documents of the same shape, most steps are then a single
+    name comparison.
+
+    The trie is also used by GenericPointerSetExtractor to extract the values
+    from SAX events, without building the DOM of the whole document.
+
+    \code
+    PointerSet set;
+    SizeType id = set.Add(Pointer("/foo/0"));
+    ...
+    Value* values[N];
+    set.Get(d, values);         // values[id] is d["foo"][0] or null.
+    \endcode
+
+    \note Get() updates the cached member indices, so a pointer set must not
+    be used by several threads at the same time. When an object has members
+    with the same name, the cached member may be a later one than the one
+    found by GenericPointer::Get().
+
+    \tparam ValueType The value type of the DOM tree. E.g. GenericValue<UTF8<> >
+    \tparam Allocator The allocator type of the pointer set.
+*/
+template <typename ValueType_, typename Allocator = CrtAllocator>
+class GenericPointerSet {
+public:
+    typedef ValueType_ ValueType;                           //!< Value type of the DOM
+    typedef typename ValueType::EncodingType EncodingType;  //!< Encoding type from Value
+    typedef typename ValueType::Ch Ch;                      //!< Character type from Value
+    typedef GenericPointer<ValueType, Allocator> PointerType;
+
+    //! Constructor.
+    /*! \param allocator Allocator of the tokens and the trie. If null, a default one is created.
+    */
+    GenericPointerSet(Allocator* allocator = 0) :
+        ownAllocator_(allocator ? 0 : RAPIDJSON_NEW(Allocator)()),
+        allocator_(allocator ? allocator : ownAllocator_),
+        entries_(allocator_, kDefaultStackCapacity),
+        tokens_(allocator_, kDefaultStackCapacity),
+        names_(allocator_, kDefaultStackCapacity),
+        order_(allocator_, kDefaultStackCapacity),
+        nodes_(allocator_, kDefaultStackCapacity),
+        compiled_(false) {}
+
+    //! Destructor.
+    ~GenericPointerSet() {
+        RAPIDJSON_DELETE(ownAllocator_);
+    }
+
+    //! Adds a pointer to the set.
+    /*! The tokens are copied, so \c pointer can be destroyed afterwards.
+        \param pointer A valid pointer.
+        \return Index of the pointer in the results of Get() and the extractor.
+    */
+    SizeType Add(const PointerType& pointer) {
+        RAPIDJSON_ASSERT(pointer.IsValid());
+        Entry* e = entries_.template Push<Entry>();
+        e->tokenBegin = static_cast<SizeType>(tokens_.GetSize() / sizeof(StoredToken));
+        e->tokenCount = static_cast<SizeType>(pointer.GetTokenCount());
+        for (const typename PointerType::Token* t = pointer.GetTokens(); t != pointer.GetTokens() + pointer.GetTokenCount(); ++t) {
+            StoredToken* s = tokens_.template Push<StoredToken>();
+            s->name = static_cast<SizeType>(names_.GetSize() / sizeof(Ch));
+            s->length = t->length;
+            s->index = t->index;
+            if (t->length)
+                std::memcpy(names_.template Push<Ch>(t->length), t->name, t->length * sizeof(Ch));
+        }
+        compiled_ = false;
+        return GetPointerCount() - 1;
+    }
+
+    //! Number of pointers added.
+    SizeType GetPointerCount() const { return static_cast<SizeType>(entries_.GetSize() / sizeof(Entry)); }
+
+    //! Builds the trie.
+    /*! Done by Get() and by the extractor when pointers were added since
+        the last time, so it only needs to be called explicitly to do that
+        work up front.
+    */
+    void Compile() {
+        if (compiled_)
+            return;
+
+        const SizeType count = GetPointerCount();
+        order_.Clear();
+        if (count) {
+            SizeType* order = order_.template Push<SizeType>(count * 2);   // the second half is merge space
+            for (SizeType i = 0; i < count; i++)
+                order[i] = i;
+            Sort(order, order + count, count);
+            order_.template Pop<SizeType>(count);
+        }
+
+        nodes_.Clear();
+        Node* root = nodes_.template Push<Node>();
+        root->name = root->length = 0;
+        root->index = kPointerInvalidIndex;
+        Build(0, 0, count, 0);
+        compiled_ = true;
+    }
+
+    //! Resolves all pointers in a DOM sub-tree.
+    /*!
+        \param root Root value of a DOM sub-tree to be resolved.
+        \param values Receives GetPointerCount() results: the value of each
+            pointer, or null if it cannot be resolved (see GenericPointer::Get()).
+        \return Number of pointers resolved.
+    */
+    SizeType Get(ValueType& root, ValueType** values) {
+        Compile();
+        for (SizeType i = 0; i < GetPointerCount(); i++)
+            values[i] = 0;
+        return Resolve(0, root, values);
+    }
+
+    //! Resolves all pointers in a const DOM sub-tree.
+    SizeType Get(const ValueType& root, const ValueType** values) {
+        return Get(const_cast<ValueType&>(root), const_cast<ValueType**>(values));
+    }
+
+private:
+    template <typename, typename> friend class GenericPointerSetExtractor;
+
+    static const size_t kDefaultStackCapacity = 256;
+    static const SizeType kNoNode = ~SizeType(0);
+
+    //! A pointer added, as a range of tokens_.
+    struct Entry {
+        SizeType tokenBegin;
+        SizeType tokenCount;
+    };
+
+    //! A copied token; \c name is an offset in names_.
+    struct StoredToken {
+        SizeType name;
+        SizeType length;
+        SizeType index;
+    };
+
+    //! A trie node. The children of a node are contiguous in nodes_, sorted
+    //! by length and name, and the pointers ending at it are contiguous in order_.
+    struct Node {
+        SizeType name;          //!< Offset of the token name in names_.
+        SizeType length;
+        SizeType index;         //!< Array index of the token, or kPointerInvalidIndex.
+        SizeType childBegin;
+        SizeType childCount;
+        SizeType slotBegin;
+        SizeType slotCount;
+        SizeType member;        //!< Index of the member found last time.
+    };
+
+    const Ch* Name(SizeType offset) const { return names_.template Bottom<Ch>() + offset; }
+    const StoredToken& TokenAt(SizeType pointer, SizeType depth) const {
+        return tokens_.template Bottom<StoredToken>()[entries_.template Bottom<Entry>()[pointer].tokenBegin + depth];
+    }
+    SizeType TokenCount(SizeType pointer) const { return entries_.template Bottom<Entry>()[pointer].tokenCount; }
+    Node& NodeAt(SizeType node) { return nodes_.template Bottom<Node>()[node]; }
+    const SizeType* Order() const { return order_.template Bottom<SizeType>(); }
+
+    //! Orders names by length, then by code units.
+    int CompareName(SizeType name, SizeType length, const Ch* str, SizeType strLength) const {
+        if (length != strLength)
+            return length < strLength ? -1 : 1;
+        const Ch* s = Name(name);
+        for (SizeType i = 0; i < length; i++)
+            if (s[i] != str[i])
+                return s[i] < str[i] ? -1 : 1;
+        return 0;
+    }
+
+    //! Orders pointers token by token; a prefix comes first.
+    int ComparePointer(SizeType a, SizeType b) const {
+        const SizeType na = TokenCount(a), nb = TokenCount(b);
+        for (SizeType i = 0; i < na && i < nb; i++) {
+            const StoredToken& ta = TokenAt(a, i);
+            const StoredToken& tb = TokenAt(b, i);
+            if (int c = CompareName(ta.name, ta.length, Name(tb.name), tb.length))
+                return c;
+        }
+        return na == nb ? 0 : (na < nb ? -1 : 1);
+    }
+
+    //! Stable merge sort of [begin, end), using temp[0, end - begin).
+    void Sort(SizeType* begin, SizeType* end, SizeType count) {
+        SizeType* temp = end;
+        for (SizeType width = 1; width < count; width *= 2) {
+            for (SizeType lo = 0; lo < count; lo += 2 * width) {
+                const SizeType mid = lo + width < count ? lo + width : count;
+                const SizeType hi = mid + width < count ? mid + width : count;
+                SizeType i = lo, j = mid, k = lo;
+                while (i < mid && j < hi)
+                    temp[k++] = ComparePointer(begin[j], begin[i]) < 0 ? begin[j++] : begin[i++];
+                while (i < mid)
+                    temp[k++] = begin[i++];
+                while (j < hi)
+                    temp[k++] = begin[j++];
+            }
+            std::memcpy(begin, temp, count * sizeof(SizeType));
+        }
+    }
+
+    //! Builds the node for the sorted pointers order_[begin, end), which share their first \c depth tokens.
+    void Build(SizeType node, SizeType begin, SizeType end, SizeType depth) {
+        SizeType i = begin;
+        while (i < end && TokenCount(Order()[i]) == depth)
+            i++;
+        NodeAt(node).slotBegin = begin;
+        NodeAt(node).slotCount = i - begin;
+        NodeAt(node).member = 0;
+
+        SizeType groupCount = 0;
+        for (SizeType j = i; j < end; j++)
+            if (j == i || ComparePointerToken(Order()[j - 1], Order()[j], depth) != 0)
+                groupCount++;
+
+        const SizeType childBegin = static_cast<SizeType>(nodes_.GetSize() / sizeof(Node));
+        if (groupCount)
+            nodes_.template Push<Node>(groupCount);
+        NodeAt(node).childBegin = childBegin;
+        NodeAt(node).childCount = groupCount;
+
+        SizeType child = childBegin;
+        while (i < end) {
+            SizeType j = i + 1;
+            while (j < end && ComparePointerToken(Order()[i], Order()[j], depth) == 0)
+                j++;
+            const StoredToken& t = TokenAt(Order()[i], depth);
+            NodeAt(child).name = t.name;
+            NodeAt(child).length = t.length;
+            NodeAt(child).index = t.index;
+            Build(child++, i, j, depth + 1);
+            i = j;
+        }
+    }
+
+    int ComparePointerToken(SizeType a, SizeType b, SizeType depth) const {
+        const StoredToken& ta = TokenAt(a, depth);
+        const StoredToken& tb = TokenAt(b, depth);
+        return CompareName(ta.name, ta.length, Name(tb.name), tb.length);
+    }
+
+    //! Child of \c node with the given name, or kNoNode.
+    SizeType FindChild(SizeType node, const Ch* str, SizeType length) {
+        SizeType lo = NodeAt(node).childBegin, hi = lo + NodeAt(node).childCount;
+        while (lo < hi) {
+            const SizeType mid = lo + (hi - lo) / 2;
+            const int c = CompareName(NodeAt(mid).name, NodeAt(mid).length, str, length);
+            if (c == 0)
+                return mid;
+            if (c < 0)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        return kNoNode;
+    }
+
+    //! Child of \c node with the given array index, or kNoNode.
+    SizeType FindChild(SizeType node, SizeType index) {
+        const SizeType begin = NodeAt(node).childBegin;
+        for (SizeType c = begin; c != begin + NodeAt(node).childCount; c++)
+            if (NodeAt(c).index == index)
+                return c;
+        return kNoNode;
+    }
+
+    SizeType Resolve(SizeType node, ValueType& v, ValueType** values) {
+        const Node& n = NodeAt(node);
+        for (SizeType i = n.slotBegin; i != n.slotBegin + n.slotCount; i++)
+            values[Order()[i]] = &v;
+        SizeType resolved = n.slotCount;
+
+        switch (v.GetType()) {
+        case kObjectType:
+            for (SizeType c = n.childBegin; c != n.childBegin + n.childCount; c++) {
+                Node& child = NodeAt(c);
+                const Ch* name = Name(child.name);
+                typename ValueType::MemberIterator m = v.MemberBegin();
+                if (child.member < v.MemberCount())
+                    m += child.member;
+                if (m == v.MemberEnd() ||
+                    m->name.GetStringLength() != child.length ||
+                    (child.length && std::memcmp(m->name.GetString(), name, child.length * sizeof(Ch)) != 0)) {
+                    m = v.FindMember(GenericValue<EncodingType>(GenericStringRef<Ch>(name, child.length)));
+                    if (m == v.MemberEnd())
+                        continue;
+                    child.member = static_cast<SizeType>(m - v.MemberBegin());
+                }
+                resolved += Resolve(c, m->value, values);
+            }
+            break;
+        case kArrayType:
+            for (SizeType c = n.childBegin; c != n.childBegin + n.childCount; c++) {
+                const SizeType index = NodeAt(c).index;
+                if (index != kPointerInvalidIndex && index < v.Size())
+                    resolved += Resolve(c, v[index], values);
+            }
+            break;
+        default:
+            break;
+        }
+        return resolved;
+    }
+
+    GenericPointerSet(const GenericPointerSet&);
+    GenericPointerSet& operator=(const GenericPointerSet&);
+
+    Allocator* ownAllocator_;
+    Allocator* allocator_;
+    internal::Stack<Allocator> entries_;    //!< Added pointers (Entry).
+    internal::Stack<Allocator> tokens_;     //!< Tokens of all pointers (StoredToken).
+    internal::Stack<Allocator> names_;      //!< Token names (Ch).
+    internal::Stack<Allocator> order_;      //!< Pointers in trie order (SizeType).
+    internal::Stack<Allocator> nodes_;      //!< Trie, root first (Node).
+    bool compiled_;
+};
+
+//! GenericPointerSet for Value (UTF-8, default allocator).
+typedef GenericPointerSet<Value> PointerSet;
+
+///////////////////////////////////////////////////////////////////////////////
+// GenericPointerSetExtractor
+
+//! SAX handler that extracts the values of a GenericPointerSet.
+/*!
+    Follows the trie of the pointer set while receiving the events of a
+    document, and only builds the values the pointers point at. Everything
+    else is skipped, so a few values can be taken out of a large document
+    without parsing it into a DOM first.
+
+    \code
+    Value values[N];
+    PointerSetExtractor extractor(set, values, allocator);
+    reader.Parse(is, extractor);
+    if (extractor.IsFound(id))
+        ... values[id] ...
+    \endcode
+
+    A value that contains the value of another pointer is built once and
+    copied. As with GenericPointer::Get(), only the first of the members of
+    an object with the same name is followed.
+
+    \tparam PointerSetType Type of the pointer set, e.g. GenericPointerSet<Value>.
+    \tparam StackAllocator Allocator type of the internal stacks.
+*/
+template <typename PointerSetType, typename StackAllocator = CrtAllocator>
+class GenericPointerSetExtractor {
+public:
+    typedef typename PointerSetType::ValueType ValueType;
+    typedef typename ValueType::Ch Ch;
+    typedef typename ValueType::AllocatorType AllocatorType;
+
+    //! Constructor.
+    /*!
+        \param pointerSet The pointers to extract. It must not change while the extractor is used.
+        \param values Receives the values of the GetPointerCount() pointers.
+            Values of pointers that are not found are left unchanged.
+        \param allocator Allocator of the extracted values.
+        \param stackAllocator Allocator of the internal stacks. If null, a default one is created.
+    */
+    GenericPointerSetExtractor(PointerSetType& pointerSet, ValueType* values, AllocatorType& allocator, StackAllocator* stackAllocator = 0) :
+        set_(pointerSet), values_(values), allocator_(allocator),
+        frames_(stackAllocator, kDefaultStackCapacity), stack_(stackAllocator, kDefaultStackCapacity),
+        found_(stackAllocator, kDefaultStackCapacity), seen_(stackAllocator, kDefaultStackCapacity),
+        foundCount_(), captureDepth_(), objectCount_()
+    {
+        set_.Compile();
+        if (set_.GetPointerCount())
+            std::memset(found_.template Push<bool>(set_.GetPointerCount()), 0, set_.GetPointerCount() * sizeof(bool));
+        const size_t nodeCount = set_.nodes_.GetSize() / sizeof(Node);
+        std::memset(seen_.template Push<size_t>(nodeCount), 0, nodeCount * sizeof(size_t));
+    }
+
+    //! Destructor.
+    ~GenericPointerSetExtractor() {
+        ClearStack();
+    }
+
+    //! Prepares for the next document.
+    void Reset(ValueType* values) {
+        ClearStack();
+        frames_.Clear();
+        values_ = values;
+        if (set_.GetPointerCount())
+            std::memset(found_.template Bottom<bool>(), 0, set_.GetPointerCount() * sizeof(bool));
+        foundCount_ = 0;
+        captureDepth_ = 0;
+    }
+
+    //! Whether the pointer with the given index was found.
+    bool IsFound(SizeType pointer) const { return found_.template Bottom<bool>()[pointer]; }
+
+    //! Number of pointers found.
+    SizeType GetFoundCount() const { return foundCount_; }
+
+    //!@name Implementation of Handler
+    //@{
+    bool Null() { const SizeType n = BeginValue(); if (Capturing(n)) { new (stack_.template Push<ValueType>()) ValueType(); EndValue(n); } return true; }
+    bool Bool(bool b) { const SizeType n = BeginValue(); if (Capturing(n)) { new (stack_.template Push<ValueType>()) ValueType(b); EndValue(n); } return true; }
+    bool Int(int i) { const SizeType n = BeginValue(); if (Capturing(n)) { new (stack_.template Push<ValueType>()) ValueType(i); EndValue(n); } return true; }
+    bool Uint(unsigned i) { const SizeType n = BeginValue(); if (Capturing(n)) { new (stack_.template Push<ValueType>()) ValueType(i); EndValue(n); } return true; }
+    bool Int64(int64_t i) { const SizeType n = BeginValue(); if (Capturing(n)) { new (stack_.template Push<ValueType>()) ValueType(i); EndValue(n); } return true; }
+    bool Uint64(uint64_t i) { const SizeType n = BeginValue(); if (Capturing(n)) { new (stack_.template Push<ValueType>()) ValueType(i); EndValue(n); } return true; }
+    bool Double(double d) { const SizeType n = BeginValue(); if (Capturing(n)) { new (stack_.template Push<ValueType>()) ValueType(d); EndValue(n); } return true; }
+    bool RawNumber(const Ch* str, SizeType length, bool copy) { return String(str, length, copy); }
+
+    bool String(const Ch* str, SizeType length, bool copy) {
+        const SizeType n = BeginValue();
+        if (Capturing(n)) {
+            PushString(str, length, copy);
+            EndValue(n);
+        }
+        return true;
+    }
+
+    bool StartObject() { return StartContainer(kObjectType); }
+
+    bool Key(const Ch* str, SizeType length, bool copy) {
+        Frame* f = frames_.template Top<Frame>();
+        if (f->capture)
+            PushString(str, length, copy);
+        if (f->node != kNoNode) {
+            f->child = set_.FindChild(f->node, str, length);
+            if (f->child != kNoNode) {
+                size_t& seen = seen_.template Bottom<size_t>()[f->child];
+                if (seen == f->object)
+                    f->child = kNoNode;     // a later member with the same name
+                else
+                    seen = f->object;
+            }
+        }
+        return true;
+    }
+
+    bool EndObject(SizeType memberCount) {
+        const Frame f = *frames_.template Pop<Frame>(1);
+        if (f.capture) {
+            ValueType* members = stack_.template Pop<ValueType>(memberCount * 2);
+            ValueType& o = *stack_.template Top<ValueType>();
+            o.MemberReserve(memberCount, allocator_);
+            for (SizeType i = 0; i < memberCount; i++)
+                o.AddMember(members[i * 2], members[i * 2 + 1], allocator_);
+            captureDepth_--;
+            EndValue(f.node);
+        }
+        return true;
+    }
+
+    bool StartArray() { return StartContainer(kArrayType); }
+
+    bool EndArray(SizeType elementCount) {
+        const Frame f = *frames_.template Pop<Frame>(1);
+        if (f.capture) {
+            ValueType* elements = stack_.template Pop<ValueType>(elementCount);
+            ValueType& a = *stack_.template Top<ValueType>();
+            a.Reserve(elementCount, allocator_);
+            for (SizeType i = 0; i < elementCount; i++)
+                a.PushBack(elements[i], allocator_);
+            captureDepth_--;
+            EndValue(f.node);
+        }
+        return true;
+    }
+    //@}
+
+private:
+    typedef typename PointerSetType::Node Node;
+    static const size_t kDefaultStackCapacity = 256;
+    static const SizeType kNoNode = PointerSetType::kNoNode;
+
+    //! An open object or array.
+    struct Frame {
+        SizeType node;      //!< Trie node of the container, or kNoNode.
+        SizeType child;     //!< Trie node of the current member of an object.
+        SizeType index;     //!< Index of the next element of an array.
+        size_t object;      //!< Serial number of an object, for the members seen.
+        bool array;
+        bool capture;       //!< The container is being built.
+    };
+
+    //! Trie node of the value that starts.
+    SizeType BeginValue() {
+        if (frames_.Empty())
+            return 0;
+        Frame* f = frames_.template Top<Frame>();
+        if (f->node == kNoNode)
+            return kNoNode;
+        if (f->array)
+            return set_.FindChild(f->node, f->index++);
+        return f->child;
+    }
+
+    //! Whether the pointers ending at \c node still wait for a value.
+    bool Wanted(SizeType node) {
+        if (node == kNoNode)
+            return false;
+        const Node& n = set_.NodeAt(node);
+        return n.slotCount != 0 && !found_.template Bottom<bool>()[set_.Order()[n.slotBegin]];
+    }
+
+    bool Capturing(SizeType node) { return captureDepth_ != 0 || Wanted(node); }
+
+    bool StartContainer(Type type) {
+        const SizeType node = BeginValue();
+        Frame* f = frames_.template Push<Frame>();
+        f->node = node != kNoNode && set_.NodeAt(node).childCount != 0 ? node : kNoNode;
+        f->child = kNoNode;
+        f->index = 0;
+        f->object = type == kObjectType ? ++objectCount_ : 0;
+        f->array = type == kArrayType;
+        f->capture = Capturing(node);
+        if (f->capture) {
+            if (f->node == kNoNode)
+                f->node = node;     // still needed by EndValue()
+            new (stack_.template Push<ValueType>()) ValueType(type);
+            captureDepth_++;
+        }
+        return true;
+    }
+
+    void PushString(const Ch* str, SizeType length, bool copy) {
+        if (copy)
+            new (stack_.template Push<ValueType>()) ValueType(str, length, allocator_);
+        else
+            new (stack_.template Push<ValueType>()) ValueType(str, length);
+    }
+
+    //! Stores the value on top of the stack if \c node wants it. It stays
+    //! on the stack while it is a part of another value being built.
+    void EndValue(SizeType node) {
+        if (!Wanted(node)) {
+            if (captureDepth_ == 0)
+                stack_.template Pop<ValueType>(1)->~ValueType();
+            return;
+        }
+        const Node& n = set_.NodeAt(node);
+        ValueType* v = stack_.template Top<ValueType>();
+        bool* found = found_.template Bottom<bool>();
+        for (SizeType i = n.slotBegin; i != n.slotBegin + n.slotCount; i++) {
+            const SizeType pointer = set_.Order()[i];
+            if (i + 1 == n.slotBegin + n.slotCount && captureDepth_ == 0)
+                values_[pointer] = *v;
+            else
+                values_[pointer].CopyFrom(*v, allocator_);
+            found[pointer] = true;
+            foundCount_++;
+        }
+        if (captureDepth_ == 0)
+            stack_.template Pop<ValueType>(1);
+    }
+
+    void ClearStack() {
+        if (AllocatorType::kNeedFree)
+            while (stack_.GetSize() > 0)
+                (stack_.template Pop<ValueType>(1))->~ValueType();
+        else
+            stack_.Clear();
+    }
+
+    GenericPointerSetExtractor(const GenericPointerSetExtractor&);
+    GenericPointerSetExtractor& operator=(const GenericPointerSetExtractor&);
+
+    PointerSetType& set_;
+    ValueType* values_;
+    AllocatorType& allocator_;
+    internal::Stack<StackAllocator> frames_;    //!< Open containers (Frame).
+    internal::Stack<StackAllocator> stack_;     //!< Values being built (ValueType).
+    internal::Stack<StackAllocator> found_;     //!< Found flags of the pointers (bool).
+    internal::Stack<StackAllocator> seen_;      //!< Last object in which each trie node was a member (size_t).
+    SizeType foundCount_;
+    SizeType captureDepth_;                     //!< Number of containers being built.
+    size_t objectCount_;
+};
+
+//! GenericPointerSetExtractor for PointerSet.
+typedef GenericPointerSetExtractor<PointerSet> PointerSetExtractor;
+
 //!@name Helper functions for GenericPointer
 //@{
 
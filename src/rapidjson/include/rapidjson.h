@@ -180,6 +180,43 @@
 #define RAPIDJSON_USE_MEMBERSMAP 0 // not by default
 #endif
 
+///////////////////////////////////////////////////////////////////////////////
+// RAPIDJSON_USE_MEMBERSHASH
+
+/*! \def RAPIDJSON_USE_MEMBERSHASH
+    \ingroup RAPIDJSON_CONFIG
+    \brief Enable a flat hash index for object member lookup
+
+    By defining this preprocessor symbol to \c 1, a \ref rapidjson::GenericValue
+    object gets an open-addressing hash table of its member names, allocated
+    from the value's allocator, once it holds \ref RAPIDJSON_MEMBERSHASH_THRESHOLD
+    members. \c FindMember is then constant time on average, and smaller objects
+    keep the linear scan. Unlike \ref RAPIDJSON_USE_MEMBERSMAP this costs no
+    allocation per member. The two options are mutually exclusive.
+
+    \note The index is built by the calls that add members (including parsing),
+    so const lookups never modify a value. Changing member names in place, or
+    reordering the members through iterators, leaves the index stale.
+
+    \hideinitializer
+*/
+#ifndef RAPIDJSON_USE_MEMBERSHASH
+#define RAPIDJSON_USE_MEMBERSHASH 0 // not by default
+#endif
+
+/*! \def RAPIDJSON_MEMBERSHASH_THRESHOLD
+    \ingroup RAPIDJSON_CONFIG
+    \brief Number of members from which an object is indexed with
+    \ref RAPIDJSON_USE_MEMBERSHASH (default: 32).
+*/
+#ifndef RAPIDJSON_MEMBERSHASH_THRESHOLD
+#define RAPIDJSON_MEMBERSHASH_THRESHOLD 32
+#endif
+
+#if RAPIDJSON_USE_MEMBERSMAP && RAPIDJSON_USE_MEMBERSHASH
+#error "RAPIDJSON_USE_MEMBERSMAP and RAPIDJSON_USE_MEMBERSHASH are mutually exclusive"
+#endif
+
 ///////////////////////////////////////////////////////////////////////////////
 // RAPIDJSON_NO_INT64DEFINE
 
@@ -351,7 +388,7 @@
 #endif
 
 ///////////////////////////////////////////////////////////////////////////////
-// RAPIDJSON_SSE2/RAPIDJSON_SSE42/RAPIDJSON_NEON/RAPIDJSON_SIMD
+// RAPIDJSON_SSE2/RAPIDJSON_SSE42/RAPIDJSON_NEON/RAPIDJSON_AVX2/RAPIDJSON_AVX512/RAPIDJSON_SIMD
 
 /*! \def RAPIDJSON_SIMD
     \ingroup RAPIDJSON_CONFIG
@@ -376,9 +413,36 @@
 
     \c RAPIDJSON_SSE42 takes precedence over SSE2, if both are defined.
 
+    The whitespace and string scanning of the Reader and the string output
+    of Writer<StringBuffer> also have wider variants, testing 32 or 64
+    characters at once:
+    \code
+    // Enable AVX2 optimization (compile with -mavx2 or /arch:AVX2).
+    #define RAPIDJSON_AVX2
+
+    // Enable AVX-512BW optimization (compile with -mavx512bw or /arch:AVX512).
+    #define RAPIDJSON_AVX512
+
+    // Build SSE2 code but run the AVX2 scanning where the CPU supports it.
+    #define RAPIDJSON_SIMD_DISPATCH
+    \endcode
+
+    \c RAPIDJSON_AVX512 takes precedence over AVX2, and both take precedence
+    over the dispatched build. \c RAPIDJSON_SIMD_DISPATCH is for x86 and
+    x86-64 with GCC, Clang or Visual C++; it checks the CPU once and then
+    costs one predictable branch per scan. Any of the three implies SSE2
+    for the remaining code and defines \c RAPIDJSON_SIMD_WIDE.
+
     If any of these symbols is defined, RapidJSON defines the macro
     \c RAPIDJSON_SIMD to indicate the availability of the optimized code.
 */
+#if defined(RAPIDJSON_AVX512) || defined(RAPIDJSON_AVX2) || defined(RAPIDJSON_SIMD_DISPATCH)
+#define RAPIDJSON_SIMD_WIDE
+#if !defined(RAPIDJSON_SSE2) && !defined(RAPIDJSON_SSE42)
+#define RAPIDJSON_SSE2
+#endif
+#endif
+
 #if defined(RAPIDJSON_SSE2) || defined(RAPIDJSON_SSE42) \
     || defined(RAPIDJSON_NEON) || defined(RAPIDJSON_DOXYGEN_RUNNING)
 #define RAPIDJSON_SIMD
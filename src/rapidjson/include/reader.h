@@ -22,6 +22,7 @@
 #include "encodedstream.h"
 #include "internal/clzll.h"
 #include "internal/meta.h"
+#include "internal/simd.h"
 #include "internal/stack.h"
 #include "internal/strtod.h"
 #include <limits>
@@ -278,7 +279,17 @@ inline const char* SkipWhitespace(const char* p, const char* end) {
     return p;
 }
 
-#ifdef RAPIDJSON_SSE42
+#if defined(RAPIDJSON_SIMD_WIDE)
+//! Skip whitespace with AVX2 or AVX-512BW instructions, testing 32 or 64 characters at once.
+inline const char *SkipWhitespace_SIMD(const char* p) {
+    return internal::SimdSkipWhitespace(p);
+}
+
+inline const char *SkipWhitespace_SIMD(const char* p, const char* end) {
+    return internal::SimdSkipWhitespace(p, end);
+}
+
+#elif defined(RAPIDJSON_SSE42)
 //! Skip whitespace with SSE 4.2 pcmpistrm instruction, testing 16 8-byte characters at once.
 inline const char *SkipWhitespace_SIMD(const char* p) {
     // Fast return for single non-whitespace
@@ -1072,7 +1083,39 @@ private:
             // Do nothing for generic version
     }
 
-#if defined(RAPIDJSON_SSE2) || defined(RAPIDJSON_SSE42)
+#if defined(RAPIDJSON_SIMD_WIDE)
+    // StringStream -> StackStream<char>
+    static RAPIDJSON_FORCEINLINE void ScanCopyUnescapedString(StringStream& is, StackStream<char>& os) {
+        const char* p = is.src_;
+        const char* q = internal::SimdScanUnescaped(p);
+        if (q != p)
+            std::memcpy(os.Push(static_cast<SizeType>(q - p)), p, static_cast<size_t>(q - p));
+        is.src_ = q;
+    }
+
+    // InsituStringStream -> InsituStringStream
+    static RAPIDJSON_FORCEINLINE void ScanCopyUnescapedString(InsituStringStream& is, InsituStringStream& os) {
+        RAPIDJSON_ASSERT(&is == &os);
+        (void)os;
+
+        if (is.src_ == is.dst_) {
+            SkipUnescapedString(is);
+            return;
+        }
+
+        const char* q = internal::SimdScanUnescaped(is.src_);
+        const size_t length = static_cast<size_t>(q - is.src_);
+        std::memmove(is.dst_, is.src_, length);
+        is.src_ += length;
+        is.dst_ += length;
+    }
+
+    // When read/write pointers are the same for insitu stream, just skip unescaped characters
+    static RAPIDJSON_FORCEINLINE void SkipUnescapedString(InsituStringStream& is) {
+        RAPIDJSON_ASSERT(is.src_ == is.dst_);
+        is.src_ = is.dst_ = const_cast<char*>(internal::SimdScanUnescaped(is.src_));
+    }
+#elif defined(RAPIDJSON_SSE2) || defined(RAPIDJSON_SSE42)
     // StringStream -> StackStream<char>
     static RAPIDJSON_FORCEINLINE void ScanCopyUnescapedString(StringStream& is, StackStream<char>& os) {
         const char* p = is.src_;
@@ -0,0 +1,423 @@
+// Tencent is pleased to support the open source community by making RapidJSON available.
+//
+// Copyright (C) 2015 THL A29 Limited, a Tencent company, and Milo Yip.
+//
+// Licensed under the MIT License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef RAPIDJSON_RECORDREADER_H_
+#define RAPIDJSON_RECORDREADER_H_
+
+#include "document.h"
+
+#if RAPIDJSON_HAS_CXX11
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+RAPIDJSON_NAMESPACE_BEGIN
+
+///////////////////////////////////////////////////////////////////////////////
+// GenericRecordReader
+
+//! Parses a sequence of JSON values (JSON Lines) on several threads.
+/*!
+    The input is cut into chunks of about \c chunkSize code units, always at
+    a record boundary. Each thread copies a chunk, parses its values one
+    after the other, and keeps the results until they are delivered. The
+    results are delivered on the calling thread, in input order, chunk by
+    chunk.
+
+    Two formats of input are supported:
+    - \c kLines: one value per line. Chunks are cut after a line feed and
+      every non-blank line is parsed as a JSON text of its own, so a record
+      is never more or less than a line (a valid JSON text never has a raw
+      line feed inside a string). A record that fails to parse takes the
+      rest of its line.
+    - \c kConcatenated: values separated by whitespace, which may span
+      lines (e.g. pretty-printed), parsed as with \c kParseStopWhenDoneFlag.
+      The chunks are cut by a scan that follows strings, escapes and
+      nesting, at whitespace outside of any value. A record that fails to
+      parse takes the rest of its chunk.
+
+    ParseDocuments() builds a DOM for every record. Each thread has its own
+    document and MemoryPoolAllocator, which is Reset() for every chunk.
+    ParseHandlers() sends the SAX events to one handler per thread.
+
+    \code
+    RecordReader reader;
+    reader.ParseDocuments<kParseDefaultFlags, Document>(json, length,
+        [](const RecordReader::Record& r, Value& v) { ...; return true; });
+    \endcode
+
+    \tparam Encoding Encoding of the input and of the documents.
+    \tparam StackAllocator Allocator of the chunk copies and of the parsing stacks.
+    \note The input must be terminated by a null character, e.g. the text of
+    a MemoryMappedFile. Requires C++11 (\c RAPIDJSON_HAS_CXX11).
+*/
+template <typename Encoding = UTF8<>, typename StackAllocator = CrtAllocator>
+class GenericRecordReader {
+public:
+    typedef typename Encoding::Ch Ch;   //!< Character type of the input.
+
+    //! Format of the input.
+    enum Format {
+        kLines,         //!< One value per line (JSON Lines, NDJSON).
+        kConcatenated   //!< Values separated by any whitespace.
+    };
+
+    //! A parsed record.
+    struct Record {
+        size_t index;       //!< Index of the record in the input.
+        size_t offset;      //!< Offset of the record in the input.
+        size_t length;      //!< Length of the record, or of the text skipped after an error.
+        ParseResult result; //!< Parse result; the error offset is relative to the input.
+    };
+
+    static const size_t kDefaultChunkSize = 1 << 20;
+
+    //! Constructor.
+    /*!
+        \param threadCount Number of threads; 0 for the number of hardware threads.
+        \param chunkSize Approximate number of code units parsed by a thread at a time.
+        \param format Format of the input.
+    */
+    GenericRecordReader(unsigned threadCount = 0, size_t chunkSize = kDefaultChunkSize, Format format = kLines) :
+        threadCount_(threadCount ? threadCount : std::thread::hardware_concurrency()),
+        chunkSize_(chunkSize ? chunkSize : 1), format_(format)
+    {
+        if (threadCount_ == 0)
+            threadCount_ = 1;
+    }
+
+    //! Number of threads, i.e. of documents or handlers in use.
+    unsigned GetThreadCount() const { return threadCount_; }
+
+    //! Parses every record into a DOM.
+    /*!
+        \tparam parseFlags Combination of \ref ParseFlag. With \c kParseInsituFlag,
+            the chunk copies are parsed in situ.
+        \tparam DocumentType GenericDocument with a MemoryPoolAllocator.
+        \param json Input text, with json[length] == '\\0'.
+        \param length Length of the input in code units.
+        \param consumer Called as <tt>bool consumer(const Record&, DocumentType::ValueType&)</tt>
+            for every record, in order, on the calling thread. The value is null
+            if the record has an error. It belongs to the thread's allocator
+            and is only valid during the call. Returning false stops parsing.
+        \return Number of records delivered.
+    */
+    template <unsigned parseFlags, typename DocumentType, typename Consumer>
+    size_t ParseDocuments(const Ch* json, size_t length, Consumer consumer) {
+        internal::Stack<StackAllocator> targets(0, threadCount_ * sizeof(DocumentTarget<DocumentType>));
+        for (unsigned i = 0; i < threadCount_; i++)
+            new (targets.template Push<DocumentTarget<DocumentType> >()) DocumentTarget<DocumentType>();
+        const size_t count = Run<parseFlags>(json, length, targets.template Bottom<DocumentTarget<DocumentType> >(), consumer);
+        for (unsigned i = 0; i < threadCount_; i++)
+            targets.template Bottom<DocumentTarget<DocumentType> >()[i].~DocumentTarget<DocumentType>();
+        return count;
+    }
+
+    //! Parses every record into SAX handlers.
+    /*!
+        \tparam parseFlags Combination of \ref ParseFlag. With \c kParseInsituFlag,
+            the chunk copies are parsed in situ.
+        \param json Input text, with json[length] == '\\0'.
+        \param length Length of the input in code units.
+        \param handlers GetThreadCount() handlers; each one only receives events on one thread.
+        \param consumer Called as <tt>bool consumer(Handler&, const Record*, size_t count)</tt>
+            for every chunk, in order, on the calling thread, with the handler
+            that received the events of the chunk's records. The handler is not
+            used by its thread during the call. Returning false stops parsing.
+        \return Number of records delivered.
+    */
+    template <unsigned parseFlags, typename Handler, typename Consumer>
+    size_t ParseHandlers(const Ch* json, size_t length, Handler* handlers, Consumer consumer) {
+        internal::Stack<StackAllocator> targets(0, threadCount_ * sizeof(HandlerTarget<Handler>));
+        for (unsigned i = 0; i < threadCount_; i++)
+            new (targets.template Push<HandlerTarget<Handler> >()) HandlerTarget<Handler>(handlers[i]);
+        const size_t count = Run<parseFlags>(json, length, targets.template Bottom<HandlerTarget<Handler> >(), consumer);
+        for (unsigned i = 0; i < threadCount_; i++)
+            targets.template Bottom<HandlerTarget<Handler> >()[i].~HandlerTarget<Handler>();
+        return count;
+    }
+
+private:
+    //! Parses records into a per-thread document, and keeps their root values.
+    template <typename DocumentType>
+    struct DocumentTarget {
+        typedef typename DocumentType::ValueType ValueType;
+        typedef typename DocumentType::AllocatorType AllocatorType;
+
+        DocumentTarget() : allocator(), document(&allocator), values(0, 256 * sizeof(ValueType)) {}
+        ~DocumentTarget() { Clear(); }
+
+        void Clear() {
+            if (AllocatorType::kNeedFree)
+                while (values.GetSize() > 0)
+                    values.template Pop<ValueType>(1)->~ValueType();
+            else
+                values.Clear();
+            allocator.Reset();
+        }
+
+        template <unsigned parseFlags, typename InputStream>
+        ParseResult ParseRecord(InputStream& is) {
+            document.template ParseStream<parseFlags, Encoding>(is);
+            ValueType* v = new (values.template Push<ValueType>()) ValueType();
+            if (!document.HasParseError())
+                v->Swap(static_cast<ValueType&>(document));
+            return ParseResult(document.GetParseError(), document.GetErrorOffset());
+        }
+
+        template <typename Consumer>
+        bool Deliver(Consumer& consumer, const Record* records, size_t count, size_t& delivered) {
+            ValueType* v = values.template Bottom<ValueType>();
+            for (delivered = 0; delivered < count; delivered++)
+                if (!consumer(records[delivered], v[delivered])) {
+                    delivered++;
+                    return false;
+                }
+            return true;
+        }
+
+        AllocatorType allocator;
+        DocumentType document;
+        internal::Stack<StackAllocator> values;     //!< Root values of the chunk (ValueType).
+    };
+
+    //! Sends the events of the records to a per-thread handler.
+    template <typename Handler>
+    struct HandlerTarget {
+        HandlerTarget(Handler& h) : handler(h), reader() {}
+
+        void Clear() {}
+
+        template <unsigned parseFlags, typename InputStream>
+        ParseResult ParseRecord(InputStream& is) {
+            return reader.template Parse<parseFlags>(is, handler);
+        }
+
+        template <typename Consumer>
+        bool Deliver(Consumer& consumer, const Record* records, size_t count, size_t& delivered) {
+            delivered = count;
+            return consumer(handler, records, count);
+        }
+
+        Handler& handler;
+        GenericReader<Encoding, Encoding, StackAllocator> reader;
+    };
+
+    //! Work of one thread: a chunk copy and the records parsed from it.
+    struct Slot {
+        enum State { kIdle, kAssigned, kDone };
+
+        Slot() : buffer(0, 0), records(0, 256 * sizeof(Record)), begin(), end(), state(kIdle) {}
+
+        internal::Stack<StackAllocator> buffer;     //!< Copy of the chunk (Ch).
+        internal::Stack<StackAllocator> records;    //!< Records of the chunk (Record).
+        size_t begin;
+        size_t end;
+        State state;
+    };
+
+    //! Cuts the chunk starting at \c begin, returns its end.
+    size_t Split(const Ch* json, size_t length, size_t begin) const {
+        if (length - begin <= chunkSize_)
+            return length;
+        size_t p = begin + chunkSize_;
+        if (format_ == kLines) {
+            while (p < length && json[p] != '\n')
+                p++;
+            return p < length ? p + 1 : length;
+        }
+
+        bool inString = false;
+        size_t depth = 0;
+        for (p = begin; p < length; p++) {
+            const Ch c = json[p];
+            if (inString) {
+                if (c == '\\')
+                    p++;
+                else if (c == '"')
+                    inString = false;
+            }
+            else if (c == '"')
+                inString = true;
+            else if (c == '{' || c == '[')
+                depth++;
+            else if (c == '}' || c == ']') {
+                if (depth)
+                    depth--;
+            }
+            else if (depth == 0 && p >= begin + chunkSize_ && (c == ' ' || c == '\n' || c == '\r' || c == '\t'))
+                return p + 1;
+        }
+        return length;
+    }
+
+    //! Parses the records of a chunk (on a worker thread).
+    template <unsigned parseFlags, typename Target>
+    void ParseChunk(const Ch* json, Slot& slot, Target& target) {
+        typedef typename internal::SelectIfCond<(parseFlags & kParseInsituFlag) != 0,
+            GenericInsituStringStream<Encoding>, GenericStringStream<Encoding> >::Type StreamType;
+
+        const size_t length = slot.end - slot.begin;
+        slot.buffer.Clear();
+        Ch* buffer = slot.buffer.template Push<Ch>(length + 1);
+        std::memcpy(buffer, json + slot.begin, length * sizeof(Ch));
+        buffer[length] = '\0';
+
+        slot.records.Clear();
+        target.Clear();
+        StreamType is(buffer);
+        for (size_t begin = 0; begin < length; ) {
+            // A line is parsed as a text of its own, so that records cannot
+            // go past it. Its end is found first, before a parse in situ
+            // can turn escaped line feeds into raw ones.
+            size_t end = length;
+            if (format_ == kLines) {
+                end = begin;
+                while (end < length && buffer[end] != '\n')
+                    end++;
+                buffer[end] = '\0';
+            }
+
+            is.src_ = buffer + begin;
+            for (;;) {
+                SkipWhitespace(is);
+                const size_t start = is.Tell();
+                if (start >= end)
+                    break;
+
+                Record* r = slot.records.template Push<Record>();
+                r->offset = slot.begin + start;
+                // A line must hold one value, concatenated values follow each other
+                const ParseResult result = format_ == kLines ?
+                    target.template ParseRecord<parseFlags & ~unsigned(kParseStopWhenDoneFlag)>(is) :
+                    target.template ParseRecord<parseFlags | kParseStopWhenDoneFlag>(is);
+                if (result) {
+                    r->length = is.Tell() - start;
+                    r->result = result;
+                    continue;
+                }
+
+                // Skip the rest of the line (or of the chunk)
+                r->result = ParseResult(result.Code(), slot.begin + result.Offset());
+                r->length = end - start;
+                break;
+            }
+            begin = end + 1;
+        }
+    }
+
+    template <unsigned parseFlags, typename Target, typename Consumer>
+    size_t Run(const Ch* json, size_t length, Target* targets, Consumer& consumer) {
+        RAPIDJSON_ASSERT(json != 0);
+        RAPIDJSON_ASSERT(json[length] == '\0');
+
+        internal::Stack<StackAllocator> slotStack(0, threadCount_ * sizeof(Slot));
+        for (unsigned i = 0; i < threadCount_; i++)
+            new (slotStack.template Push<Slot>()) Slot();
+        Slot* slots = slotStack.template Bottom<Slot>();
+
+        std::mutex mutex;
+        std::condition_variable cond;
+        bool stop = false;
+
+        internal::Stack<StackAllocator> threadStack(0, threadCount_ * sizeof(std::thread));
+        for (unsigned i = 0; i < threadCount_; i++) {
+            Slot* slot = &slots[i];
+            Target* target = &targets[i];
+            new (threadStack.template Push<std::thread>()) std::thread([this, json, slot, target, &mutex, &cond, &stop]() {
+                std::unique_lock<std::mutex> lock(mutex);
+                for (;;) {
+                    cond.wait(lock, [slot, &stop] { return slot->state == Slot::kAssigned || stop; });
+                    if (slot->state != Slot::kAssigned)
+                        return;
+                    lock.unlock();
+                    this->template ParseChunk<parseFlags>(json, *slot, *target);
+                    lock.lock();
+                    slot->state = Slot::kDone;
+                    cond.notify_all();
+                }
+            });
+        }
+
+        // Chunk k goes to thread k % threadCount_, so the results are
+        // delivered by waiting for the threads in turn.
+        size_t next = 0, assigned = 0, recordCount = 0;
+        bool more = true;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (unsigned i = 0; i < threadCount_ && next < length; i++, assigned++) {
+                slots[i].begin = next;
+                slots[i].end = next = Split(json, length, next);
+                slots[i].state = Slot::kAssigned;
+            }
+        }
+        cond.notify_all();
+
+        for (size_t k = 0; k < assigned; k++) {
+            const unsigned i = static_cast<unsigned>(k % threadCount_);
+            Slot& slot = slots[i];
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cond.wait(lock, [&] { return slot.state == Slot::kDone; });
+            }
+
+            if (more) {
+                const size_t count = slot.records.GetSize() / sizeof(Record);
+                Record* records = slot.records.template Bottom<Record>();
+                for (size_t j = 0; j < count; j++)
+                    records[j].index = recordCount + j;
+                size_t delivered;
+                more = targets[i].Deliver(consumer, records, count, delivered);
+                recordCount += delivered;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                slot.state = Slot::kIdle;
+                if (more && next < length) {
+                    slot.begin = next;
+                    slot.end = next = Split(json, length, next);
+                    slot.state = Slot::kAssigned;
+                    assigned++;
+                }
+            }
+            cond.notify_all();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+        cond.notify_all();
+        for (unsigned i = 0; i < threadCount_; i++) {
+            threadStack.template Bottom<std::thread>()[i].join();
+            threadStack.template Bottom<std::thread>()[i].~thread();
+            slots[i].~Slot();
+        }
+        return recordCount;
+    }
+
+    unsigned threadCount_;
+    size_t chunkSize_;
+    Format format_;
+};
+
+//! GenericRecordReader for UTF-8 input.
+typedef GenericRecordReader<UTF8<> > RecordReader;
+
+RAPIDJSON_NAMESPACE_END
+
+#endif // RAPIDJSON_HAS_CXX11
+
+#endif // RAPIDJSON_RECORDREADER_H_
@@ -261,6 +261,9 @@ public:
     virtual void DestroryHasher(void* hasher) = 0;
     virtual void* MallocState(size_t size) = 0;
     virtual void FreeState(void* p) = 0;
+#if RAPIDJSON_SCHEMA_USE_INTERNALREGEX
+    virtual bool IsPatternMatch(const typename SchemaType::RegexType* pattern, const typename SchemaType::Ch* str, SizeType length) = 0;
+#endif
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -382,6 +385,8 @@ public:
 
     bool IsValid() const { return stack_.GetSize() == sizeof(uint64_t); }
 
+    void Clear() { stack_.Clear(); }
+
     uint64_t GetHashCode() const {
         RAPIDJSON_ASSERT(IsValid());
         return *stack_.template Top<uint64_t>();
@@ -527,6 +532,13 @@ public:
     typedef GenericValue<EncodingType, AllocatorType> SValue;
     typedef IValidationErrorHandler<Schema> ErrorHandler;
     typedef GenericUri<ValueType, AllocatorType> UriType;
+#if RAPIDJSON_SCHEMA_USE_INTERNALREGEX
+    typedef internal::GenericRegex<EncodingType, AllocatorType> RegexType;
+#elif RAPIDJSON_SCHEMA_USE_STDREGEX
+    typedef std::basic_regex<Ch> RegexType;
+#else
+    typedef char RegexType;
+#endif
     friend class GenericSchemaDocument<ValueType, AllocatorType>;
 
     Schema(SchemaDocumentType* schemaDocument, const PointerType& p, const ValueType& value, const ValueType& document, AllocatorType* allocator, const UriType& id = UriType()) :
@@ -1071,7 +1083,7 @@ public:
             }
         }
 
-        if (pattern_ && !IsPatternMatch(pattern_, str, length)) {
+        if (pattern_ && !IsPatternMatch(context, pattern_, str, length)) {
             context.error_handler.DoesNotMatch(str, length);
             RAPIDJSON_INVALID_KEYWORD_RETURN(kValidateErrorPattern);
         }
@@ -1107,7 +1119,7 @@ public:
         if (patternProperties_) {
             context.patternPropertiesSchemaCount = 0;
             for (SizeType i = 0; i < patternPropertyCount_; i++)
-                if (patternProperties_[i].pattern && IsPatternMatch(patternProperties_[i].pattern, str, len)) {
+                if (patternProperties_[i].pattern && IsPatternMatch(context, patternProperties_[i].pattern, str, len)) {
                     context.patternPropertiesSchemas[context.patternPropertiesSchemaCount++] = patternProperties_[i].schema;
                     context.valueSchema = typeless_;
                 }
@@ -1338,14 +1350,6 @@ private:
         kTotalSchemaType
     };
 
-#if RAPIDJSON_SCHEMA_USE_INTERNALREGEX
-        typedef internal::GenericRegex<EncodingType, AllocatorType> RegexType;
-#elif RAPIDJSON_SCHEMA_USE_STDREGEX
-        typedef std::basic_regex<Ch> RegexType;
-#else
-        typedef char RegexType;
-#endif
-
     struct SchemaArray {
         SchemaArray() : schemas(), count() {}
         ~SchemaArray() { AllocatorType::Free(schemas); }
@@ -1411,9 +1415,9 @@ private:
         return 0;
     }
 
-    static bool IsPatternMatch(const RegexType* pattern, const Ch *str, SizeType) {
-        GenericRegexSearch<RegexType> rs(*pattern);
-        return rs.Search(str);
+    // The validator keeps a GenericRegexSearch, and so its DFA, per pattern.
+    static bool IsPatternMatch(Context& context, const RegexType* pattern, const Ch *str, SizeType length) {
+        return context.factory.IsPatternMatch(pattern, str, length);
     }
 #elif RAPIDJSON_SCHEMA_USE_STDREGEX
     template <typename ValueType>
@@ -1431,7 +1435,7 @@ private:
         return 0;
     }
 
-    static bool IsPatternMatch(const RegexType* pattern, const Ch *str, SizeType length) {
+    static bool IsPatternMatch(Context&, const RegexType* pattern, const Ch *str, SizeType length) {
         std::match_results<const Ch*> r;
         return std::regex_search(str, str + length, r, *pattern);
     }
@@ -1441,7 +1445,7 @@ private:
         return 0;
     }
 
-    static bool IsPatternMatch(const RegexType*, const Ch *, SizeType) { return true; }
+    static bool IsPatternMatch(Context&, const RegexType*, const Ch *, SizeType) { return true; }
 #endif // RAPIDJSON_SCHEMA_USE_STDREGEX
 
     void AddType(const ValueType& type) {
@@ -2426,6 +2430,12 @@ typedef IGenericRemoteSchemaDocumentProvider<SchemaDocument> IRemoteSchemaDocume
     The default output handler does nothing.
     It can be reused multiple times by calling \c Reset().
 
+    The sub-validators and hashers created while validating are returned to
+    free lists when done with, and a GenericRegexSearch is kept for each
+    pattern, so a validator reused with \c Reset() stops allocating once it
+    has seen its largest document. They all live in the state allocator:
+    call \c ClearCache() before clearing a shared state allocator.
+
     \tparam SchemaDocumentType Type of schema document.
     \tparam OutputHandler Type of output handler. Default handler does nothing.
     \tparam StateAllocator Allocator for storing the internal validation states.
@@ -2461,11 +2471,15 @@ public:
         size_t documentStackCapacity = kDefaultDocumentStackCapacity)
         :
         schemaDocument_(&schemaDocument),
-        root_(schemaDocument.GetRoot()),
+        root_(&schemaDocument.GetRoot()),
         stateAllocator_(allocator),
         ownStateAllocator_(0),
         schemaStack_(allocator, schemaStackCapacity),
         documentStack_(allocator, documentStackCapacity),
+        cacheOwner_(),
+        freeValidators_(allocator, 0),
+        freeHashers_(allocator, 0),
+        patternSearches_(allocator, 0),
         outputHandler_(0),
         error_(kObjectType),
         currentError_(),
@@ -2475,6 +2489,7 @@ public:
         depth_(0)
     {
         RAPIDJSON_SCHEMA_PRINT(Method, "GenericSchemaValidator::GenericSchemaValidator");
+        cacheOwner_ = this;
     }
 
     //! Constructor with output handler.
@@ -2492,11 +2507,15 @@ public:
         size_t documentStackCapacity = kDefaultDocumentStackCapacity)
         :
         schemaDocument_(&schemaDocument),
-        root_(schemaDocument.GetRoot()),
+        root_(&schemaDocument.GetRoot()),
         stateAllocator_(allocator),
         ownStateAllocator_(0),
         schemaStack_(allocator, schemaStackCapacity),
         documentStack_(allocator, documentStackCapacity),
+        cacheOwner_(),
+        freeValidators_(allocator, 0),
+        freeHashers_(allocator, 0),
+        patternSearches_(allocator, 0),
         outputHandler_(&outputHandler),
         error_(kObjectType),
         currentError_(),
@@ -2506,15 +2525,19 @@ public:
         depth_(0)
     {
         RAPIDJSON_SCHEMA_PRINT(Method, "GenericSchemaValidator::GenericSchemaValidator (output handler)");
+        cacheOwner_ = this;
     }
 
     //! Destructor.
     ~GenericSchemaValidator() {
         Reset();
+        ClearCache();
         RAPIDJSON_DELETE(ownStateAllocator_);
     }
 
     //! Reset the internal states.
+    /*! The stacks, pooled sub-validators, hashers and pattern DFAs are kept.
+    */
     void Reset() {
         while (!schemaStack_.Empty())
             PopSchema();
@@ -2522,6 +2545,27 @@ public:
         ResetError();
     }
 
+    //! Free the pooled sub-validators, hashers and pattern DFAs.
+    void ClearCache() {
+        while (!freeValidators_.Empty()) {
+            GenericSchemaValidator* v = *freeValidators_.template Pop<GenericSchemaValidator*>(1);
+            v->~GenericSchemaValidator();
+            StateAllocator::Free(v);
+        }
+        while (!freeHashers_.Empty()) {
+            HasherType* h = *freeHashers_.template Pop<HasherType*>(1);
+            h->~HasherType();
+            StateAllocator::Free(h);
+        }
+#if RAPIDJSON_SCHEMA_USE_INTERNALREGEX
+        while (!patternSearches_.Empty()) {
+            PatternSearch* p = patternSearches_.template Pop<PatternSearch>(1);
+            p->search->~RegexSearchType();
+            StateAllocator::Free(p->search);
+        }
+#endif
+    }
+
     //! Reset the error state.
     void ResetError() {
         error_.SetObject();
@@ -2898,20 +2942,29 @@ public:
     virtual ISchemaValidator* CreateSchemaValidator(const SchemaType& root, const bool inheritContinueOnErrors) {
         *documentStack_.template Push<Ch>() = '\0';
         documentStack_.template Pop<Ch>(1);
-        ISchemaValidator* sv = new (GetStateAllocator().Malloc(sizeof(GenericSchemaValidator))) GenericSchemaValidator(*schemaDocument_, root, documentStack_.template Bottom<char>(), documentStack_.GetSize(),
-        depth_ + 1,
-        &GetStateAllocator());
+        GenericSchemaValidator* sv;
+        if (!cacheOwner_->freeValidators_.Empty()) {
+            sv = *cacheOwner_->freeValidators_.template Pop<GenericSchemaValidator*>(1);
+            sv->Reuse(root, documentStack_.template Bottom<char>(), documentStack_.GetSize(), depth_ + 1);
+        }
+        else
+            sv = new (GetStateAllocator().Malloc(sizeof(GenericSchemaValidator))) GenericSchemaValidator(*schemaDocument_, root, documentStack_.template Bottom<char>(), documentStack_.GetSize(),
+            depth_ + 1,
+            cacheOwner_,
+            &GetStateAllocator());
         sv->SetValidateFlags(inheritContinueOnErrors ? GetValidateFlags() : GetValidateFlags() & ~static_cast<unsigned>(kValidateContinueOnErrorFlag));
         return sv;
     }
 
     virtual void DestroySchemaValidator(ISchemaValidator* validator) {
         GenericSchemaValidator* v = static_cast<GenericSchemaValidator*>(validator);
-        v->~GenericSchemaValidator();
-        StateAllocator::Free(v);
+        v->Reset();
+        *cacheOwner_->freeValidators_.template Push<GenericSchemaValidator*>() = v;
     }
 
     virtual void* CreateHasher() {
+        if (!cacheOwner_->freeHashers_.Empty())
+            return *cacheOwner_->freeHashers_.template Pop<HasherType*>(1);
         return new (GetStateAllocator().Malloc(sizeof(HasherType))) HasherType(&GetStateAllocator());
     }
 
@@ -2921,8 +2974,8 @@ public:
 
     virtual void DestroryHasher(void* hasher) {
         HasherType* h = static_cast<HasherType*>(hasher);
-        h->~HasherType();
-        StateAllocator::Free(h);
+        h->Clear();
+        *cacheOwner_->freeHashers_.template Push<HasherType*>() = h;
     }
 
     virtual void* MallocState(size_t size) {
@@ -2932,28 +2985,47 @@ public:
     virtual void FreeState(void* p) {
         StateAllocator::Free(p);
     }
+
+#if RAPIDJSON_SCHEMA_USE_INTERNALREGEX
+    virtual bool IsPatternMatch(const typename SchemaType::RegexType* pattern, const Ch* str, SizeType) {
+        return GetPatternSearch(pattern).Search(str);
+    }
+#endif
     // End of implementation of ISchemaStateFactory<SchemaType>
 
 private:
     typedef typename SchemaType::Context Context;
     typedef GenericValue<UTF8<>, StateAllocator> HashCodeArray;
     typedef internal::Hasher<EncodingType, StateAllocator> HasherType;
+#if RAPIDJSON_SCHEMA_USE_INTERNALREGEX
+    typedef internal::GenericRegexSearch<typename SchemaType::RegexType, StateAllocator> RegexSearchType;
+
+    struct PatternSearch {
+        const typename SchemaType::RegexType* pattern;
+        RegexSearchType* search;
+    };
+#endif
 
     GenericSchemaValidator( 
         const SchemaDocumentType& schemaDocument,
         const SchemaType& root,
         const char* basePath, size_t basePathSize,
         unsigned depth,
+        GenericSchemaValidator* cacheOwner,
         StateAllocator* allocator = 0,
         size_t schemaStackCapacity = kDefaultSchemaStackCapacity,
         size_t documentStackCapacity = kDefaultDocumentStackCapacity)
         :
         schemaDocument_(&schemaDocument),
-        root_(root),
+        root_(&root),
         stateAllocator_(allocator),
         ownStateAllocator_(0),
         schemaStack_(allocator, schemaStackCapacity),
         documentStack_(allocator, documentStackCapacity),
+        cacheOwner_(cacheOwner),
+        freeValidators_(allocator, 0),
+        freeHashers_(allocator, 0),
+        patternSearches_(allocator, 0),
         outputHandler_(0),
         error_(kObjectType),
         currentError_(),
@@ -2973,6 +3045,29 @@ private:
         return *stateAllocator_;
     }
 
+    //! Prepares a pooled sub-validator, already reset, for another schema.
+    void Reuse(const SchemaType& root, const char* basePath, size_t basePathSize, unsigned depth) {
+        RAPIDJSON_SCHEMA_PRINT(Method, "GenericSchemaValidator::Reuse", basePath && basePathSize ? basePath : "");
+        root_ = &root;
+        depth_ = depth;
+        if (basePath && basePathSize)
+            memcpy(documentStack_.template Push<char>(basePathSize), basePath, basePathSize);
+    }
+
+#if RAPIDJSON_SCHEMA_USE_INTERNALREGEX
+    RegexSearchType& GetPatternSearch(const typename SchemaType::RegexType* pattern) {
+        internal::Stack<StateAllocator>& searches = cacheOwner_->patternSearches_;
+        for (PatternSearch* p = searches.template Bottom<PatternSearch>(); p != searches.template End<PatternSearch>(); ++p)
+            if (p->pattern == pattern)
+                return *p->search;
+
+        PatternSearch* p = searches.template Push<PatternSearch>();
+        p->pattern = pattern;
+        p->search = new (GetStateAllocator().Malloc(sizeof(RegexSearchType))) RegexSearchType(*pattern, &GetStateAllocator());
+        return *p->search;
+    }
+#endif
+
     bool GetContinueOnErrors() const {
         return flags_ & kValidateContinueOnErrorFlag;
     }
@@ -2980,7 +3075,7 @@ private:
     bool BeginValue() {
         RAPIDJSON_SCHEMA_PRINT(Method, "GenericSchemaValidator::BeginValue");
         if (schemaStack_.Empty())
-            PushSchema(root_);
+            PushSchema(*root_);
         else {
             if (CurrentContext().inArray)
                 internal::TokenHelper<internal::Stack<StateAllocator>, Ch>::AppendIndexToken(documentStack_, CurrentContext().arrayElementIndex);
@@ -3161,11 +3256,15 @@ private:
     static const size_t kDefaultSchemaStackCapacity = 1024;
     static const size_t kDefaultDocumentStackCapacity = 256;
     const SchemaDocumentType* schemaDocument_;
-    const SchemaType& root_;
+    const SchemaType* root_;
     StateAllocator* stateAllocator_;
     StateAllocator* ownStateAllocator_;
     internal::Stack<StateAllocator> schemaStack_;    //!< stack to store the current path of schema (BaseSchemaType *)
     internal::Stack<StateAllocator> documentStack_;  //!< stack to store the current path of validating document (Ch)
+    GenericSchemaValidator* cacheOwner_;             //!< validator holding the pools, the top level one
+    internal::Stack<StateAllocator> freeValidators_; //!< pooled sub-validators (GenericSchemaValidator *)
+    internal::Stack<StateAllocator> freeHashers_;    //!< pooled hashers (HasherType *)
+    internal::Stack<StateAllocator> patternSearches_; //!< cached pattern matchers (PatternSearch)
     OutputHandler* outputHandler_;
     ValueType error_;
     ValueType currentError_;
@@ -18,6 +18,7 @@
 #include "stream.h"
 #include "internal/clzll.h"
 #include "internal/meta.h"
+#include "internal/simd.h"
 #include "internal/stack.h"
 #include "internal/strfunc.h"
 #include "internal/dtoa.h"
@@ -68,6 +69,7 @@ enum WriteFlag {
     kWriteValidateEncodingFlag = 1, //!< Validate encoding of JSON strings.
     kWriteNanAndInfFlag = 2,        //!< Allow writing of Infinity, -Infinity and NaN.
     kWriteNanAndInfNullFlag = 4,    //!< Allow writing of Infinity, -Infinity and NaN as null.
+    kWriteShortestDoubleFlag = 8,   //!< Always write the shortest digits of a double that read back to the same value (Schubfach instead of Grisu2).
     kWriteDefaultFlags = RAPIDJSON_WRITE_DEFAULT_FLAGS  //!< Default write flags. Can be customized by defining RAPIDJSON_WRITE_DEFAULT_FLAGS
 };
 
@@ -373,7 +375,7 @@ protected:
         }
 
         char buffer[25];
-        char* end = internal::dtoa(d, buffer, maxDecimalPlaces_);
+        char* end = internal::dtoa(d, buffer, maxDecimalPlaces_, (writeFlags & kWriteShortestDoubleFlag) != 0);
         PutReserve(*os_, static_cast<size_t>(end - buffer));
         for (char* p = buffer; p != end; ++p)
             PutUnsafe(*os_, static_cast<typename OutputStream::Ch>(*p));
@@ -576,12 +578,30 @@ inline bool Writer<StringBuffer>::WriteDouble(double d) {
     }
     
     char *buffer = os_->Push(25);
-    char* end = internal::dtoa(d, buffer, maxDecimalPlaces_);
+    char* end = internal::dtoa(d, buffer, maxDecimalPlaces_, (kWriteDefaultFlags & kWriteShortestDoubleFlag) != 0);
     os_->Pop(static_cast<size_t>(25 - (end - buffer)));
     return true;
 }
 
-#if defined(RAPIDJSON_SSE2) || defined(RAPIDJSON_SSE42)
+#if defined(RAPIDJSON_SIMD_WIDE)
+template<>
+inline bool Writer<StringBuffer>::ScanWriteUnescapedString(StringStream& is, size_t length) {
+    if (length < 16)
+        return RAPIDJSON_LIKELY(is.Tell() < length);
+
+    if (!RAPIDJSON_LIKELY(is.Tell() < length))
+        return false;
+
+    // WriteString() has reserved room for the whole escaped string
+    const char* p = is.src_;
+    const char* q = internal::SimdScanUnescaped(p, is.head_ + length);
+    if (q != p)
+        std::memcpy(os_->PushUnsafe(static_cast<size_t>(q - p)), p, static_cast<size_t>(q - p));
+
+    is.src_ = q;
+    return RAPIDJSON_LIKELY(is.Tell() < length);
+}
+#elif defined(RAPIDJSON_SSE2) || defined(RAPIDJSON_SSE42)
 template<>
 inline bool Writer<StringBuffer>::ScanWriteUnescapedString(StringStream& is, size_t length) {
     if (length < 16)
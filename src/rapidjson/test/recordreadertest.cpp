@@ -0,0 +1,138 @@
+// Tencent is pleased to support the open source community by making RapidJSON available.
+//
+// Copyright (C) 2015 THL A29 Limited, a Tencent company, and Milo Yip.
+//
+// Licensed under the MIT License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+// Checks that GenericRecordReader delivers the same records whatever the
+// chunk size, the number of threads and in situ parsing.
+
+#include "recordreader.h"
+#include "stringbuffer.h"
+#include "writer.h"
+
+#include <cstdio>
+#include <string>
+
+#if RAPIDJSON_HAS_CXX11
+
+using namespace rapidjson;
+
+namespace {
+
+unsigned failures = 0;
+
+// One line per record: offset, length, error and value.
+template <unsigned parseFlags>
+std::string Parse(const std::string& json, unsigned threads, size_t chunkSize, RecordReader::Format format) {
+    std::string text = json;
+    std::string out;
+    RecordReader reader(threads, chunkSize, format);
+    reader.ParseDocuments<parseFlags, Document>(&text[0], text.size(),
+        [&out](const RecordReader::Record& r, Value& v) {
+            char buffer[64];
+            std::sprintf(buffer, "%u %u %d %u ", unsigned(r.offset), unsigned(r.length), int(r.result.Code()), unsigned(r.result.Offset()));
+            out += buffer;
+            StringBuffer sb;
+            Writer<StringBuffer> writer(sb);
+            v.Accept(writer);
+            out += sb.GetString();
+            out += '\n';
+            return true;
+        });
+    return out;
+}
+
+void Check(const std::string& json, RecordReader::Format format, const char* expected = 0) {
+    const std::string reference = Parse<kParseDefaultFlags>(json, 1, json.size() + 1, format);
+    if (expected && reference != expected) {
+        if (++failures <= 10)
+            std::printf("input:\n%s\nexpected:\n%s\ngot:\n%s\n", json.c_str(), expected, reference.c_str());
+        return;
+    }
+
+    static const size_t chunkSizes[] = { 1, 3, 8, 32 };
+    for (unsigned threads = 1; threads <= 3; threads++)
+        for (size_t i = 0; i < sizeof(chunkSizes) / sizeof(chunkSizes[0]); i++) {
+            const std::string records = Parse<kParseDefaultFlags>(json, threads, chunkSizes[i], format);
+            const std::string insitu = Parse<kParseInsituFlag>(json, threads, chunkSizes[i], format);
+            if ((records != reference || insitu != reference) && ++failures <= 10)
+                std::printf("input:\n%s\nwith %u threads, chunks of %u:\n%s\nin situ:\n%s\nexpected:\n%s\n",
+                    json.c_str(), threads, unsigned(chunkSizes[i]), records.c_str(), insitu.c_str(), reference.c_str());
+        }
+}
+
+unsigned Random() {
+    static unsigned state = 2463534242u;
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+} // namespace
+
+int main() {
+    // A value may not continue on the next line
+    Check("{\"a\":\n1}\n{\"b\":2}\n", RecordReader::kLines,
+        "0 5 3 5 null\n"            // {"a":   missing value
+        "6 2 2 7 null\n"            // 1}      not a single value
+        "9 7 0 0 {\"b\":2}\n");
+
+    // An escaped line feed decoded in situ does not end the line
+    Check("{\"a\":\"x\\ny\" oops}\n{\"b\":1}\n", RecordReader::kLines,
+        "0 17 6 12 null\n"
+        "18 7 0 0 {\"b\":1}\n");
+
+    // Blank lines and CR LF
+    Check("\n  [1, 2]\r\n\r\n\"s\\n\"\n", RecordReader::kLines,
+        "3 7 0 0 [1,2]\n"
+        "13 5 0 0 \"s\\n\"\n");
+
+    // Random lines of values and broken values
+    static const char* const tokens[] = {
+        "{\"a\":1}", "[1,[2,{}]]", "\"x\\ny\"", "3.5", "true", "{\"s\":\"{[\\\"\"}",
+        "{\"a\":", "oops", "1}", "]", "{\"x\":\"y\\nz\" bad}", "\"open"
+    };
+    static const char* const separators[] = { " ", "\n", "\r\n", "\n\n", "\t" };
+    for (int i = 0; i < 1000; i++) {
+        std::string json;
+        const unsigned n = 1 + Random() % 8;
+        for (unsigned j = 0; j < n; j++) {
+            json += tokens[Random() % (sizeof(tokens) / sizeof(tokens[0]))];
+            json += separators[Random() % (sizeof(separators) / sizeof(separators[0]))];
+        }
+        Check(json, RecordReader::kLines);
+    }
+
+    // Concatenated values may span lines
+    for (int i = 0; i < 300; i++) {
+        std::string json;
+        const unsigned n = 1 + Random() % 8;
+        for (unsigned j = 0; j < n; j++) {
+            json += tokens[Random() % 6];
+            json += separators[Random() % (sizeof(separators) / sizeof(separators[0]))];
+        }
+        Check(json, RecordReader::kConcatenated);
+    }
+
+    std::printf("%u failures\n", failures);
+    return failures == 0 ? 0 : 1;
+}
+
+#else
+
+int main() {
+    std::printf("GenericRecordReader needs C++11\n");
+    return 0;
+}
+
+#endif
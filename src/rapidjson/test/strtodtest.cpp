@@ -0,0 +1,187 @@
+// Tencent is pleased to support the open source community by making RapidJSON available.
+//
+// Copyright (C) 2015 THL A29 Limited, a Tencent company, and Milo Yip.
+//
+// Licensed under the MIT License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+// Checks the Eisel-Lemire fast path of StrtodFullPrecision against the
+// StrtodDiyFp/StrtodBigInteger path it was added in front of, and that
+// doubles written with 17 digits read back with kParseFullPrecisionFlag.
+
+#include "document.h"
+#include "internal/strtod.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+using namespace rapidjson;
+using namespace rapidjson::internal;
+
+namespace {
+
+unsigned failures = 0;
+unsigned long decided = 0, checked = 0;
+
+void Fail(const char* what, const char* decimals, int dLen, int dExp, double expected, double actual) {
+    if (++failures <= 20)
+        std::printf("%s: %.*se%d: expected %.17g, got %.17g\n", what, dLen, decimals, dExp, expected, actual);
+}
+
+// The implementation before Eisel-Lemire.
+double Reference(const char* decimals, int dLen, int dExp) {
+    double result;
+    if (StrtodDiyFp(decimals, dLen, dExp, &result))
+        return result;
+    return StrtodBigInteger(result, decimals, dLen, dExp);
+}
+
+// decimals (no leading zero) * 10^dExp, inside the range StrtodFullPrecision hands on
+void Check(const char* decimals, int dLen, int dExp) {
+    while (dLen > 1 && decimals[dLen - 1] == '0') {
+        dLen--;
+        dExp++;
+    }
+    if (dLen + dExp <= -324 || dLen + dExp > 309)
+        return;
+
+    checked++;
+    double result;
+    if (!StrtodEiselLemire(decimals, dLen, dExp, &result))
+        return;
+    decided++;
+    const double expected = Reference(decimals, dLen, dExp);
+    if (Double(result).Uint64Value() != Double(expected).Uint64Value())
+        Fail("StrtodEiselLemire", decimals, dLen, dExp, expected, result);
+}
+
+void CheckUint64(uint64_t w, int dExp) {
+    char buffer[24];
+    const int n = std::sprintf(buffer, "%llu", static_cast<unsigned long long>(w));
+    Check(buffer, n, dExp);
+}
+
+// Exact decimal digits of m * 2^e, as decimals * 10^dExp.
+int ExactDecimals(uint64_t m, int e, std::vector<char>& decimals) {
+    std::vector<uint32_t> n;  // base 1e9, least significant first
+    n.push_back(static_cast<uint32_t>(m % 1000000000u));
+    n.push_back(static_cast<uint32_t>(m / 1000000000u % 1000000000u));
+    n.push_back(static_cast<uint32_t>(m / 1000000000u / 1000000000u));
+    // m * 2^e = m * 5^-e / 10^-e for e < 0
+    for (int i = e < 0 ? -e : e; i > 0;) {
+        // 5^13 or 2^29 at a time, so that the products stay below 2^64
+        const int k = e < 0 ? (i < 13 ? i : 13) : (i < 29 ? i : 29);
+        uint64_t factor = 1;
+        for (int j = 0; j < k; j++)
+            factor *= e < 0 ? 5 : 2;
+        i -= k;
+        uint64_t carry = 0;
+        for (size_t j = 0; j < n.size(); j++) {
+            const uint64_t v = uint64_t(n[j]) * factor + carry;
+            n[j] = static_cast<uint32_t>(v % 1000000000u);
+            carry = v / 1000000000u;
+        }
+        if (carry)
+            n.push_back(static_cast<uint32_t>(carry));
+    }
+    while (n.size() > 1 && n.back() == 0)
+        n.pop_back();
+
+    char buffer[16];
+    decimals.clear();
+    std::sprintf(buffer, "%u", n.back());
+    decimals.insert(decimals.end(), buffer, buffer + std::strlen(buffer));
+    for (size_t j = n.size() - 1; j-- > 0;) {
+        std::sprintf(buffer, "%09u", n[j]);
+        decimals.insert(decimals.end(), buffer, buffer + 9);
+    }
+    return e < 0 ? e : 0;
+}
+
+// The double and the points halfway to its neighbours, digit for digit.
+void CheckDouble(double d) {
+    const Double v(d);
+    if (v.IsZero() || v.IsInf() || v.IsNan())
+        return;
+    std::vector<char> decimals;
+    const uint64_t m = v.Significand() | (v.IsNormal() ? RAPIDJSON_UINT64_C2(0x100000, 0) : 0);
+    const int e = v.IsNormal() ? static_cast<int>((v.Uint64Value() >> 52) & 0x7FF) - 1075 : -1074;
+    const uint64_t points[3] = { m * 2, m * 2 - 1, m * 2 + 1 };
+    for (int i = 0; i < 3; i++) {
+        const int dExp = ExactDecimals(points[i], e - 1, decimals);
+        const int dLen = static_cast<int>(decimals.size());
+        // Whole when it fits in the 768 digits kept by StrtodFullPrecision, else truncated
+        Check(&decimals[0], dLen < 768 ? dLen : 768, dExp + (dLen < 768 ? 0 : dLen - 768));
+        // The first 20 and 25 digits round-trip too when the value is not a halfway point
+        if (i == 0) {
+            Check(&decimals[0], dLen < 20 ? dLen : 20, dExp + (dLen < 20 ? 0 : dLen - 20));
+            Check(&decimals[0], dLen < 25 ? dLen : 25, dExp + (dLen < 25 ? 0 : dLen - 25));
+        }
+    }
+
+    // Round trip through the reader with 17 digits
+    char json[32];
+    std::sprintf(json, "%.17g", d);
+    Document doc;
+    doc.Parse<kParseFullPrecisionFlag>(json);
+    if (doc.HasParseError() || !doc.IsNumber() || Double(doc.GetDouble()).Uint64Value() != v.Uint64Value())
+        Fail("Parse", json, static_cast<int>(std::strlen(json)), 0, d, doc.IsNumber() ? doc.GetDouble() : 0.0);
+}
+
+uint64_t Random() {
+    static uint64_t state = RAPIDJSON_UINT64_C2(0x9E3779B9, 0x7F4A7C15);
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+} // namespace
+
+int main() {
+    // Every significand up to 4 digits at every decimal exponent
+    for (int q = -342; q <= 308; q++)
+        for (uint64_t w = 1; w < 10000; w++)
+            if (w % 10)
+                CheckUint64(w, q);
+
+    // Significands at the 19 and 20 digit boundaries, and the largest ones
+    for (int q = -342; q <= 308; q++) {
+        CheckUint64(RAPIDJSON_UINT64_C2(0x8AC72304, 0x89E7FFFF), q);   // 10^19 - 1
+        CheckUint64(RAPIDJSON_UINT64_C2(0x8AC72304, 0x89E80000), q);   // 10^19
+        CheckUint64(RAPIDJSON_UINT64_C2(0xFFFFFFFF, 0xFFFFFFFF), q);
+        Check("99999999999999999999", 20, q);
+        Check("10000000000000000001", 20, q);
+    }
+
+    // Every binary exponent with edge significands, and their halfway points
+    for (uint64_t e = 0; e < 0x7FF; e++) {
+        const uint64_t significands[5] = {
+            0, 1, RAPIDJSON_UINT64_C2(0x80000, 0), RAPIDJSON_UINT64_C2(0xFFFFF, 0xFFFFFFFE), RAPIDJSON_UINT64_C2(0xFFFFF, 0xFFFFFFFF) };
+        for (int i = 0; i < 5; i++)
+            CheckDouble(Double(e << 52 | significands[i]).Value());
+    }
+
+    // Random doubles, and random 17 to 19 digit strings
+    for (int i = 0; i < 100000; i++) {
+        if (i % 4 == 0)
+            CheckDouble(Double(Random() & RAPIDJSON_UINT64_C2(0x7FFFFFFF, 0xFFFFFFFF)).Value());
+        char buffer[24];
+        const int dLen = 17 + static_cast<int>(Random() % 3);
+        buffer[0] = static_cast<char>('1' + Random() % 9);
+        for (int j = 1; j < dLen; j++)
+            buffer[j] = static_cast<char>('0' + Random() % 10);
+        Check(buffer, dLen, static_cast<int>(Random() % 651) - 342);
+    }
+
+    std::printf("%lu inputs, %lu decided by Eisel-Lemire, %u failures\n", checked, decided, failures);
+    return failures == 0 && decided > checked / 2 ? 0 : 1;
+}
@@ -166,6 +166,25 @@
 #define COPY 1      /* copy input directly */
 #define GZIP 2      /* decompress a gzip stream */
 
+/* size of the inflate window saved with each random access point */
+#define GZ_WINSIZE 32768U
+
+/* random access point into a gzip stream, see gzindex.c */
+typedef struct {
+    z_off64_t out;          /* offset in uncompressed data */
+    z_off64_t in;           /* offset in input file of first full byte */
+    int bits;               /* number of bits (1-7) from byte at in-1, or 0 */
+    unsigned char window[GZ_WINSIZE];   /* preceding 32K of uncompressed data */
+} gz_point;
+
+/* list of access points, in increasing order of out */
+typedef struct {
+    unsigned have;          /* number of access points in list */
+    unsigned size;          /* number of access points allocated */
+    z_off64_t length;       /* length of the input file, to validate a load */
+    gz_point *list;         /* allocated list */
+} gz_index;
+
 /* internal gzip file state data structure */
 typedef struct {
         /* exposed contents for gzgetc() macro */
@@ -187,6 +206,8 @@ typedef struct {
     z_off64_t start;        /* where the gzip data started, for rewinding */
     int eof;                /* true if end of input file reached */
     int past;               /* true if read requested past end */
+    unsigned trail;         /* gzip trailer bytes to discard after a jump */
+    gz_index *index;        /* random access points, or NULL if none built */
         /* just for writing */
     int level;              /* compression level */
     int strategy;           /* compression strategy */
@@ -207,6 +228,9 @@ void ZLIB_INTERNAL gz_error OF((gz_statep, int, const char *));
 #if defined UNDER_CE
 char ZLIB_INTERNAL *gz_strwinerror OF((DWORD error));
 #endif
+gz_point ZLIB_INTERNAL *gz_index_find OF((gz_index *, z_off64_t));
+void ZLIB_INTERNAL gz_index_free OF((gz_index *));
+int ZLIB_INTERNAL gz_jump OF((gz_statep, gz_point *));
 
 /* GT_OFF(x), where x is an unsigned value, is true if x > maximum z_off64_t
    value -- needed when comparing unsigned to z_off64_t, which is signed
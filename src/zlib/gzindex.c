@@ -0,0 +1,490 @@
+/* gzindex.c -- random access index for reading gzip files
+ * Copyright (C) 2005, 2012, 2018 Mark Adler (examples/zran.c)
+ * For conditions of distribution and use, see copyright notice in zlib.h
+ */
+
+#include "gzguts.h"
+
+#if defined(_WIN32) && !defined(__BORLANDC__)
+#  define LSEEK _lseeki64
+#else
+#if defined(_LARGEFILE64_SOURCE) && _LFS64_LARGEFILE-0
+#  define LSEEK lseek64
+#else
+#  define LSEEK lseek
+#endif
+#endif
+
+/* sidecar file layout: magic, version, input file length and number of
+   points, then for each point out, in, bits and the window -- all integers
+   are stored little-endian */
+#define GZIDX_MAGIC "gzix"
+#define GZIDX_VERSION 1
+#define GZIDX_HEAD 20
+#define GZIDX_POINT 17
+
+/* Local functions */
+local int gz_index_add OF((gz_index *, int, z_off64_t, z_off64_t, unsigned,
+                           unsigned char *));
+local int gz_index_read OF((int, unsigned char *, unsigned, unsigned *));
+local z_off64_t gz_index_length OF((gz_statep));
+local void gz_put4 OF((unsigned char *, unsigned long));
+local void gz_put8 OF((unsigned char *, z_off64_t));
+local unsigned long gz_get4 OF((const unsigned char *));
+local z_off64_t gz_get8 OF((const unsigned char *));
+
+/* Free an index and its list of access points. */
+void ZLIB_INTERNAL gz_index_free(index)
+    gz_index *index;
+{
+    if (index != NULL) {
+        free(index->list);
+        free(index);
+    }
+}
+
+/* Return the last access point at or before uncompressed offset pos, or NULL
+   if there is none. */
+gz_point ZLIB_INTERNAL *gz_index_find(index, pos)
+    gz_index *index;
+    z_off64_t pos;
+{
+    unsigned lo, hi, mid;
+
+    /* binary search for the first point past pos */
+    lo = 0;
+    hi = index->have;
+    while (lo < hi) {
+        mid = lo + ((hi - lo) >> 1);
+        if (index->list[mid].out <= pos)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo ? index->list + lo - 1 : NULL;
+}
+
+/* Restart decompression of state at access point point, so that the next
+   data decompressed is at point->out in the uncompressed stream.  The point
+   lies inside a raw deflate stream, so gz_look() discards the gzip trailer
+   that follows it before looking for another gzip member.  Return -1 on
+   error, 0 on success. */
+int ZLIB_INTERNAL gz_jump(state, point)
+    gz_statep state;
+    gz_point *point;
+{
+    int ret;
+    unsigned char c;
+    z_streamp strm = &(state->strm);
+
+    /* make sure the buffers and inflate state are allocated */
+    if (state->size == 0)
+        (void)gzdirect((gzFile)state);
+    if (state->size == 0)
+        return -1;
+    if (state->direct) {
+        gz_error(state, Z_DATA_ERROR, "index does not match file");
+        return -1;
+    }
+
+    /* go to the first byte holding data of the access point */
+    if (LSEEK(state->fd, point->in - (point->bits ? 1 : 0), SEEK_SET) == -1) {
+        gz_error(state, Z_ERRNO, zstrerror());
+        return -1;
+    }
+    state->x.have = 0;
+    state->eof = 0;
+    state->past = 0;
+    state->seek = 0;
+    gz_error(state, Z_OK, NULL);
+    strm->avail_in = 0;
+
+    /* prime a raw inflate with the partial byte and the window */
+    (void)inflateReset2(strm, -15);
+    if (point->bits) {
+        ret = read(state->fd, &c, 1);
+        if (ret != 1) {
+            gz_error(state, ret == -1 ? Z_ERRNO : Z_DATA_ERROR,
+                     ret == -1 ? zstrerror() : "unexpected end of file");
+            return -1;
+        }
+        (void)inflatePrime(strm, point->bits, c >> (8 - point->bits));
+    }
+    (void)inflateSetDictionary(strm, point->window, GZ_WINSIZE);
+    state->how = GZIP;
+    state->trail = 8;
+    state->x.pos = point->out;
+    return 0;
+}
+
+/* Append an access point to index.  window is the circular output buffer,
+   and left is the number of bytes at its end not yet written.  Return -1 if
+   out of memory, otherwise 0. */
+local int gz_index_add(index, bits, in, out, left, window)
+    gz_index *index;
+    int bits;
+    z_off64_t in;
+    z_off64_t out;
+    unsigned left;
+    unsigned char *window;
+{
+    unsigned size;
+    gz_point *next;
+
+    /* grow the list if needed */
+    if (index->have == index->size) {
+        size = index->size ? index->size << 1 : 8;
+        next = (gz_point *)realloc(index->list, sizeof(gz_point) * size);
+        if (next == NULL)
+            return -1;
+        index->list = next;
+        index->size = size;
+    }
+
+    /* fill in the entry, unrolling the circular window */
+    next = index->list + index->have;
+    next->bits = bits;
+    next->in = in;
+    next->out = out;
+    if (left)
+        memcpy(next->window, window + GZ_WINSIZE - left, left);
+    if (left < GZ_WINSIZE)
+        memcpy(next->window + left, window, GZ_WINSIZE - left);
+    index->have++;
+    return 0;
+}
+
+/* Read up to len bytes from fd into buf, looping like gz_load() does, and
+   set *have to the number read.  Return -1 on a read error, otherwise 0. */
+local int gz_index_read(fd, buf, len, have)
+    int fd;
+    unsigned char *buf;
+    unsigned len;
+    unsigned *have;
+{
+    int ret;
+
+    *have = 0;
+    do {
+        ret = read(fd, buf + *have, len - *have);
+        if (ret <= 0)
+            break;
+        *have += (unsigned)ret;
+    } while (*have < len);
+    return ret < 0 ? -1 : 0;
+}
+
+/* Return the length of the input file of state without changing its current
+   position, or -1 on error. */
+local z_off64_t gz_index_length(state)
+    gz_statep state;
+{
+    z_off64_t cur, end;
+
+    cur = LSEEK(state->fd, 0, SEEK_CUR);
+    if (cur == -1)
+        return -1;
+    end = LSEEK(state->fd, 0, SEEK_END);
+    if (LSEEK(state->fd, cur, SEEK_SET) == -1)
+        return -1;
+    return end;
+}
+
+/* -- see zlib.h -- */
+int ZEXPORT gzbuildindex(file, span)
+    gzFile file;
+    z_off_t span;
+{
+    int ret;
+    unsigned got;
+    z_off64_t totin, totout, last;
+    unsigned char *input, *window;
+    z_stream strm;
+    gz_index *index;
+    gz_statep state;
+
+    /* get internal structure and check integrity */
+    if (file == NULL)
+        return Z_STREAM_ERROR;
+    state = (gz_statep)file;
+    if (state->mode != GZ_READ || span <= 0 ||
+            (state->err != Z_OK && state->err != Z_BUF_ERROR))
+        return Z_STREAM_ERROR;
+
+    /* drop any previous index -- none is needed when copying directly */
+    gz_index_free(state->index);
+    state->index = NULL;
+    if (gzdirect(file))
+        return Z_OK;
+
+    /* allocate the index, work buffers and a separate inflate state */
+    index = (gz_index *)malloc(sizeof(gz_index));
+    input = (unsigned char *)malloc(state->want);
+    window = (unsigned char *)calloc(GZ_WINSIZE, 1);
+    strm.zalloc = Z_NULL;
+    strm.zfree = Z_NULL;
+    strm.opaque = Z_NULL;
+    strm.avail_in = 0;
+    strm.next_in = Z_NULL;
+    if (index == NULL || input == NULL || window == NULL ||
+            inflateInit2(&strm, 15 + 32) != Z_OK) {
+        free(window);
+        free(input);
+        free(index);
+        return Z_MEM_ERROR;
+    }
+    index->have = 0;
+    index->size = 0;
+    index->list = NULL;
+
+    /* decompress the whole input once, stopping at each deflate block
+       boundary to decide whether to record an access point there */
+    ret = LSEEK(state->fd, state->start, SEEK_SET) == -1 ? Z_ERRNO : Z_OK;
+    totin = totout = last = 0;
+    strm.avail_out = 0;
+    while (ret == Z_OK) {
+        if (strm.avail_in == 0) {
+            if (gz_index_read(state->fd, input, state->want, &got) == -1) {
+                ret = Z_ERRNO;
+                break;
+            }
+            if (got == 0) {
+                ret = Z_DATA_ERROR;     /* unexpected end of file */
+                break;
+            }
+            strm.avail_in = got;
+            strm.next_in = input;
+        }
+        if (strm.avail_out == 0) {
+            strm.avail_out = GZ_WINSIZE;
+            strm.next_out = window;
+        }
+
+        /* inflate until the end of a header, a block or the stream */
+        totin += strm.avail_in;
+        totout += strm.avail_out;
+        ret = inflate(&strm, Z_BLOCK);
+        totin -= strm.avail_in;
+        totout -= strm.avail_out;
+        if (ret == Z_NEED_DICT || ret == Z_STREAM_ERROR)
+            ret = Z_DATA_ERROR;
+        if (ret == Z_BUF_ERROR)
+            ret = Z_OK;
+        if (ret == Z_MEM_ERROR || ret == Z_DATA_ERROR)
+            break;
+
+        /* at the end of a gzip member, look for another one, ignoring
+           trailing garbage as gzread() does */
+        if (ret == Z_STREAM_END) {
+            if (strm.avail_in < 2) {
+                if (strm.avail_in)
+                    input[0] = *strm.next_in;
+                if (gz_index_read(state->fd, input + strm.avail_in,
+                                  state->want - strm.avail_in, &got) == -1) {
+                    ret = Z_ERRNO;
+                    break;
+                }
+                strm.avail_in += got;
+                strm.next_in = input;
+            }
+            if (strm.avail_in < 2 ||
+                    strm.next_in[0] != 31 || strm.next_in[1] != 139)
+                break;
+            (void)inflateReset(&strm);
+            ret = Z_OK;
+            continue;
+        }
+
+        /* add an access point at the first block boundary past span */
+        if ((strm.data_type & 128) && !(strm.data_type & 64) &&
+                (totout == 0 || totout - last > span)) {
+            if (gz_index_add(index, strm.data_type & 7, state->start + totin,
+                             totout, strm.avail_out, window) == -1) {
+                ret = Z_MEM_ERROR;
+                break;
+            }
+            last = totout;
+        }
+    }
+    (void)inflateEnd(&strm);
+    free(window);
+    free(input);
+
+    /* attach the index on success, then start reading over */
+    if (ret == Z_STREAM_END) {
+        index->length = gz_index_length(state);
+        state->index = index;
+        ret = Z_OK;
+    }
+    else
+        gz_index_free(index);
+    if (gzrewind(file) == -1 && ret == Z_OK)
+        ret = Z_ERRNO;
+    return ret;
+}
+
+/* -- see zlib.h -- */
+int ZEXPORT gzsaveindex(file, path)
+    gzFile file;
+    const char *path;
+{
+    int ret;
+    unsigned n;
+    unsigned char head[GZIDX_HEAD];
+    gz_point *point;
+    gz_statep state;
+    FILE *out;
+
+    /* get internal structure and check that there is an index */
+    if (file == NULL || path == NULL)
+        return Z_STREAM_ERROR;
+    state = (gz_statep)file;
+    if (state->mode != GZ_READ || state->index == NULL)
+        return Z_STREAM_ERROR;
+
+    /* write the header and then each access point */
+    out = fopen(path, "wb");
+    if (out == NULL)
+        return Z_ERRNO;
+    memcpy(head, GZIDX_MAGIC, 4);
+    gz_put4(head + 4, GZIDX_VERSION);
+    gz_put8(head + 8, state->index->length);
+    gz_put4(head + 16, state->index->have);
+    ret = fwrite(head, 1, GZIDX_HEAD, out) == GZIDX_HEAD ? Z_OK : Z_ERRNO;
+    point = state->index->list;
+    for (n = 0; ret == Z_OK && n < state->index->have; n++, point++) {
+        gz_put8(head, point->out);
+        gz_put8(head + 8, point->in);
+        head[16] = (unsigned char)point->bits;
+        if (fwrite(head, 1, GZIDX_POINT, out) != GZIDX_POINT ||
+                fwrite(point->window, 1, GZ_WINSIZE, out) != GZ_WINSIZE)
+            ret = Z_ERRNO;
+    }
+    if (fclose(out) != 0)
+        ret = Z_ERRNO;
+    return ret;
+}
+
+/* -- see zlib.h -- */
+int ZEXPORT gzloadindex(file, path)
+    gzFile file;
+    const char *path;
+{
+    int ret;
+    unsigned long have;
+    unsigned char head[GZIDX_HEAD];
+    gz_point *point;
+    gz_index *index;
+    gz_statep state;
+    FILE *in;
+
+    /* get internal structure and check integrity */
+    if (file == NULL || path == NULL)
+        return Z_STREAM_ERROR;
+    state = (gz_statep)file;
+    if (state->mode != GZ_READ)
+        return Z_STREAM_ERROR;
+
+    /* read and check the header against the input file */
+    in = fopen(path, "rb");
+    if (in == NULL)
+        return Z_ERRNO;
+    if (fread(head, 1, GZIDX_HEAD, in) != GZIDX_HEAD) {
+        ret = ferror(in) ? Z_ERRNO : Z_DATA_ERROR;
+        fclose(in);
+        return ret;
+    }
+    have = gz_get4(head + 16);
+    if (memcmp(head, GZIDX_MAGIC, 4) != 0 ||
+            gz_get4(head + 4) != GZIDX_VERSION ||
+            gz_get8(head + 8) != gz_index_length(state) ||
+            have > ((unsigned)-1 >> 1) / sizeof(gz_point)) {
+        fclose(in);
+        return Z_DATA_ERROR;
+    }
+
+    /* allocate the index with room for all of the points */
+    index = (gz_index *)malloc(sizeof(gz_index));
+    if (index == NULL) {
+        fclose(in);
+        return Z_MEM_ERROR;
+    }
+    index->length = gz_get8(head + 8);
+    index->have = 0;
+    index->size = (unsigned)have;
+    index->list = NULL;
+    if (have &&
+            (index->list = (gz_point *)malloc(sizeof(gz_point) * have)) == NULL) {
+        gz_index_free(index);
+        fclose(in);
+        return Z_MEM_ERROR;
+    }
+
+    /* read the access points, checking that they are in order */
+    ret = Z_OK;
+    for (point = index->list; index->have < have; index->have++, point++) {
+        if (fread(head, 1, GZIDX_POINT, in) != GZIDX_POINT ||
+                fread(point->window, 1, GZ_WINSIZE, in) != GZ_WINSIZE) {
+            ret = ferror(in) ? Z_ERRNO : Z_DATA_ERROR;
+            break;
+        }
+        point->out = gz_get8(head);
+        point->in = gz_get8(head + 8);
+        point->bits = head[16];
+        if (point->bits > 7 || point->in < 0 || point->in > index->length ||
+                (index->have && point->out <= point[-1].out)) {
+            ret = Z_DATA_ERROR;
+            break;
+        }
+    }
+    fclose(in);
+    if (ret != Z_OK) {
+        gz_index_free(index);
+        return ret;
+    }
+
+    /* replace any previous index */
+    gz_index_free(state->index);
+    state->index = index;
+    return Z_OK;
+}
+
+/* Store the low 32 bits of val at buf, little-endian. */
+local void gz_put4(buf, val)
+    unsigned char *buf;
+    unsigned long val;
+{
+    int n;
+
+    for (n = 0; n < 4; n++, val >>= 8)
+        buf[n] = (unsigned char)(val & 0xff);
+}
+
+/* Store the 64-bit offset val at buf, little-endian. */
+local void gz_put8(buf, val)
+    unsigned char *buf;
+    z_off64_t val;
+{
+    gz_put4(buf, (unsigned long)(val & 0xffffffffUL));
+    gz_put4(buf + 4, sizeof(val) > 4 ? (unsigned long)((val >> 16) >> 16) : 0);
+}
+
+/* Return the 32-bit little-endian value at buf. */
+local unsigned long gz_get4(buf)
+    const unsigned char *buf;
+{
+    return (unsigned long)buf[0] | ((unsigned long)buf[1] << 8) |
+           ((unsigned long)buf[2] << 16) | ((unsigned long)buf[3] << 24);
+}
+
+/* Return the 64-bit little-endian offset at buf. */
+local z_off64_t gz_get8(buf)
+    const unsigned char *buf;
+{
+    z_off64_t val;
+
+    val = (z_off64_t)gz_get4(buf + 4);
+    if (sizeof(val) == 4 && val)
+        return -1;                          /* does not fit */
+    return (((val << 16) << 16)) | (z_off64_t)gz_get4(buf);
+}
@@ -80,6 +80,7 @@ local void gz_reset(state)
         state->eof = 0;             /* not at end of file */
         state->past = 0;            /* have not read past end yet */
         state->how = LOOK;          /* look for gzip header */
+        state->trail = 0;           /* no gzip trailer to discard */
     }
     else                            /* for writing ... */
         state->reset = 0;           /* no deflateReset pending */
@@ -116,6 +117,7 @@ local gzFile gz_open(path, fd, mode)
     state->size = 0;            /* no buffers allocated yet */
     state->want = GZBUFSIZE;    /* requested buffer size */
     state->msg = NULL;          /* no error message yet */
+    state->index = NULL;        /* no random access index yet */
 
     /* interpret mode */
     state->mode = GZ_NONE;
@@ -372,6 +374,7 @@ z_off64_t ZEXPORT gzseek64(file, offset, whence)
 {
     unsigned n;
     z_off64_t ret;
+    gz_point *point;
     gz_statep state;
 
     /* get internal structure and check integrity */
@@ -412,6 +415,20 @@ z_off64_t ZEXPORT gzseek64(file, offset, whence)
         return state->x.pos;
     }
 
+    /* if reading with an index, restart from the nearest access point at or
+       before the target unless the target is already buffered or closer */
+    if (state->mode == GZ_READ && state->index != NULL &&
+            state->x.pos + offset >= 0) {
+        point = gz_index_find(state->index, state->x.pos + offset);
+        if (point != NULL && (offset < 0 ||
+                point->out > state->x.pos + (z_off64_t)state->x.have)) {
+            offset += state->x.pos;
+            if (gz_jump(state, point) == -1)
+                return -1;
+            offset -= state->x.pos;
+        }
+    }
+
     /* calculate skip amount, rewinding if needed for back seek when reading */
     if (offset < 0) {
         if (state->mode != GZ_READ)         /* writing -- can't go backwards */
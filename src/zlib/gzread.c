@@ -91,6 +91,7 @@ local int gz_avail(state)
 local int gz_look(state)
     gz_statep state;
 {
+    unsigned n;
     z_streamp strm = &(state->strm);
 
     /* allocate read buffers and inflate memory */
@@ -121,6 +122,21 @@ local int gz_look(state)
         }
     }
 
+    /* after a jump to an index access point (see gzindex.c), the raw deflate
+       data is followed by the gzip trailer, which inflate did not consume */
+    while (state->trail) {
+        if (strm->avail_in == 0) {
+            if (gz_avail(state) == -1)
+                return -1;
+            if (strm->avail_in == 0)
+                return 0;
+        }
+        n = strm->avail_in < state->trail ? strm->avail_in : state->trail;
+        strm->next_in += n;
+        strm->avail_in -= n;
+        state->trail -= n;
+    }
+
     /* get at least the magic bytes in the input buffer */
     if (strm->avail_in < 2) {
         if (gz_avail(state) == -1)
@@ -138,7 +154,7 @@ local int gz_look(state)
        single byte is sufficient indication that it is not a gzip file) */
     if (strm->avail_in > 1 &&
             strm->next_in[0] == 31 && strm->next_in[1] == 139) {
-        inflateReset(strm);
+        inflateReset2(strm, 15 + 16);
         state->how = GZIP;
         state->direct = 0;
         return 0;
@@ -641,6 +657,7 @@ int ZEXPORT gzclose_r(file)
         free(state->out);
         free(state->in);
     }
+    gz_index_free(state->index);
     err = state->err == Z_BUF_ERROR ? Z_BUF_ERROR : Z_OK;
     gz_error(state, Z_OK, NULL);
     free(state->path);
@@ -65,9 +65,13 @@
 #  define get_crc_table         z_get_crc_table
 #  ifndef Z_SOLO
 #    define gz_error              z_gz_error
+#    define gz_index_find         z_gz_index_find
+#    define gz_index_free         z_gz_index_free
 #    define gz_intmax             z_gz_intmax
+#    define gz_jump               z_gz_jump
 #    define gz_strwinerror        z_gz_strwinerror
 #    define gzbuffer              z_gzbuffer
+#    define gzbuildindex          z_gzbuildindex
 #    define gzclearerr            z_gzclearerr
 #    define gzclose               z_gzclose
 #    define gzclose_r             z_gzclose_r
@@ -82,6 +86,7 @@
 #    define gzgetc                z_gzgetc
 #    define gzgetc_               z_gzgetc_
 #    define gzgets                z_gzgets
+#    define gzloadindex           z_gzloadindex
 #    define gzoffset              z_gzoffset
 #    define gzoffset64            z_gzoffset64
 #    define gzopen                z_gzopen
@@ -94,6 +99,7 @@
 #    define gzputs                z_gzputs
 #    define gzread                z_gzread
 #    define gzrewind              z_gzrewind
+#    define gzsaveindex           z_gzsaveindex
 #    define gzseek                z_gzseek
 #    define gzseek64              z_gzseek64
 #    define gzsetparams           z_gzsetparams
@@ -1554,7 +1554,8 @@ ZEXTERN z_off_t ZEXPORT gzseek OF((gzFile file,
    the value SEEK_END is not supported.
 
      If the file is opened for reading, this function is emulated but can be
-   extremely slow.  If the file is opened for writing, only forward seeks are
+   extremely slow, unless an index was attached with gzbuildindex() or
+   gzloadindex() (see below).  If the file is opened for writing, only forward seeks are
    supported; gzseek then compresses a sequence of zeroes up to the new
    starting position.
 
@@ -1592,6 +1593,48 @@ ZEXTERN z_off_t ZEXPORT gzoffset OF((gzFile file));
    be used for a progress indicator.  On error, gzoffset() returns -1.
 */
 
+ZEXTERN int ZEXPORT gzbuildindex OF((gzFile file, z_off_t span));
+/*
+     Decompress the whole of file once and record a random access point
+   roughly every span bytes of uncompressed data.  Each access point holds
+   the compressed bit offset of a deflate block boundary and the 32K of
+   uncompressed data that precede it, so an index costs about 32K of memory
+   per point.  Once an index is present, gzseek() on file restarts inflation
+   from the nearest access point at or before the requested position instead
+   of decompressing and discarding everything before it, and backward seeks
+   no longer rewind to the start of the file.  Concatenated gzip streams are
+   supported.  span must be positive; a few megabytes is a reasonable choice
+   for large files.
+
+     gzbuildindex is supported only for reading.  It replaces any index
+   already attached to file, and leaves file positioned as after gzrewind().
+   An index is not needed for a file that is being copied directly (see
+   gzdirect() below), for which gzbuildindex returns Z_OK without building
+   one.  gzbuildindex returns Z_OK on success, Z_STREAM_ERROR if file is not
+   valid or not open for reading, Z_DATA_ERROR if the compressed data is
+   invalid, Z_MEM_ERROR if out of memory, or Z_ERRNO on a read error.
+*/
+
+ZEXTERN int ZEXPORT gzsaveindex OF((gzFile file, const char *path));
+/*
+     Write the index attached to file by gzbuildindex() or gzloadindex() to
+   the sidecar file path, so that later opens of the same gzip file can use
+   gzloadindex() instead of building the index again.  gzsaveindex returns
+   Z_OK on success, Z_STREAM_ERROR if file is not valid or has no index, or
+   Z_ERRNO if path could not be written.
+*/
+
+ZEXTERN int ZEXPORT gzloadindex OF((gzFile file, const char *path));
+/*
+     Read an index written by gzsaveindex() from path and attach it to file,
+   replacing any index already attached.  The index is rejected with
+   Z_DATA_ERROR if path is not a gzip index or was built for a file of a
+   different length.  gzloadindex is supported only for reading and does not
+   change the current position.  It returns Z_OK on success, Z_STREAM_ERROR if
+   file is not valid or not open for reading, Z_MEM_ERROR if out of memory, or
+   Z_ERRNO if path could not be read.
+*/
+
 ZEXTERN int ZEXPORT gzeof OF((gzFile file));
 /*
      Return true (1) if the end-of-file indicator for file has been set while
@@ -0,0 +1,173 @@
+/*
+ * writes archives with zzip_writer and reads them back with zzip_mem_disk,
+ * including a zip64 entry (whose local and central zip64 extra blocks hold
+ * different fields) and a hand-made central directory with a partial
+ * zip64 block. Returns non-zero if any check fails.
+ *
+ *          use under the restrictions of the
+ *          Lesser GNU General Public License
+ *          or alternatively the restrictions
+ *          of the Mozilla Public License 1.1
+ */
+
+#include <zzip/writer.h>
+#include <zzip/memdisk.h>
+#include <zzip/fetch.h>
+#include <zzip/format.h>
+
+#include <zlib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TEST_ZIP "zzipwritertest.zip"
+
+static int failures;
+
+#define check(_X_) do { if (! (_X_)) { \
+    fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #_X_); \
+    failures++; } } while (0)
+
+static char data[50000];
+
+/* the entry must be there with the given size and content */
+static void
+check_entry(ZZIP_MEM_DISK * dir, char *name, const char *expect,
+            zzip_size_t len)
+{
+    ZZIP_MEM_ENTRY *entry = zzip_mem_disk_findfile(dir, name, 0, 0);
+    ZZIP_MEM_DISK_FILE *file;
+    char *got;
+
+    check(entry != 0);
+    if (! entry)
+        return;
+    check(zzip_mem_entry_usize(entry) == (zzip_off_t) len);
+
+    got = malloc(len + 1);
+    file = zzip_mem_entry_fopen(dir, entry);
+    check(file != 0);
+    if (file)
+    {
+        check(zzip_mem_disk_fread(got, 1, len + 1, file) == len);
+        check(memcmp(got, expect, len) == 0);
+        zzip_mem_disk_fclose(file);
+    }
+    free(got);
+}
+
+static void
+test_writer_roundtrip(void)
+{
+    ZZIP_WRITER *writer = zzip_writer_open(TEST_ZIP, 2);
+    ZZIP_MEM_DISK *dir;
+    zzip_size_t i;
+
+    check(writer != 0);
+    if (! writer)
+        return;
+    check(zzip_writer_add(writer, "deflated.txt", data, sizeof(data),
+                          ZZIP_WRITER_DEFLATED) == 0);
+    check(zzip_writer_add(writer, "stored.bin", data, 1000,
+                          ZZIP_WRITER_STORED | ZZIP_WRITER_ALIGN) == 0);
+
+    /* a local zip64 block with usize and csize only, none in the central
+     * directory as the entry stays below 4 GiB */
+    check(zzip_writer_begin(writer, "zip64.txt",
+                            ZZIP_WRITER_DEFLATED | ZZIP_WRITER_ZIP64) == 0);
+    for (i = 0; i < sizeof(data); i += 5000)
+        check(zzip_writer_write(writer, data + i, 5000) == 5000);
+    check(zzip_writer_end(writer) == 0);
+    check(zzip_writer_close(writer) == 0);
+
+    dir = zzip_mem_disk_open(TEST_ZIP);
+    check(dir != 0);
+    if (dir)
+    {
+        check_entry(dir, "deflated.txt", data, sizeof(data));
+        check_entry(dir, "stored.bin", data, 1000);
+        check_entry(dir, "zip64.txt", data, sizeof(data));
+        zzip_mem_disk_close(dir);
+    }
+    remove(TEST_ZIP);
+}
+
+/* a stored entry whose central record has usize in a zip64 block but
+ * csize, offset and diskstart in the 32-bit fields */
+static void
+test_partial_zip64(void)
+{
+    static const char content[] = "zip64 usize only";
+    zzip_byte_t zip[256];
+    zzip_byte_t *p = zip;
+    zzip_byte_t *central;
+    ZZIP_MEM_DISK *dir;
+    ZZIP_MEM_ENTRY *entry;
+    zzip_size_t len = sizeof(content) - 1;
+
+    memset(zip, 0, sizeof(zip));
+    __zzip_set32(p + 0, ZZIP_FILE_HEADER_MAGIC);
+    __zzip_set16(p + 4, 45);
+    __zzip_set32(p + 14, crc32(0, (const Bytef *) content, len));
+    __zzip_set32(p + 18, len);
+    __zzip_set32(p + 22, len);
+    __zzip_set16(p + 26, 1);
+    p += zzip_file_header_headerlength;
+    *p++ = 'a';
+    memcpy(p, content, len);
+    p += len;
+
+    central = p;
+    __zzip_set32(p + 0, ZZIP_DISK_ENTRY_MAGIC);
+    __zzip_set16(p + 4, 45);
+    __zzip_set16(p + 6, 45);
+    __zzip_set32(p + 16, crc32(0, (const Bytef *) content, len));
+    __zzip_set32(p + 20, len);
+    __zzip_set32(p + 24, 0xFFFFFFFF);
+    __zzip_set16(p + 28, 1);
+    __zzip_set16(p + 30, 12);
+    p += zzip_disk_entry_headerlength;
+    *p++ = 'a';
+    __zzip_set16(p + 0, 0x0001);
+    __zzip_set16(p + 2, 8);
+    __zzip_set64(p + 4, len);
+    p += 12;
+
+    __zzip_set32(p + 0, ZZIP_DISK_TRAILER_MAGIC);
+    __zzip_set16(p + 8, 1);
+    __zzip_set16(p + 10, 1);
+    __zzip_set32(p + 12, p - central);
+    __zzip_set32(p + 16, central - zip);
+    p += zzip_disk_trailer_headerlength;
+
+    dir = zzip_mem_disk_buffer((char *) zip, p - zip);
+    check(dir != 0);
+    if (! dir)
+        return;
+    entry = zzip_mem_disk_findfile(dir, "a", 0, 0);
+    check(entry != 0);
+    if (entry)
+    {
+        check(zzip_mem_entry_usize(entry) == (zzip_off_t) len);
+        check(zzip_mem_entry_csize(entry) == (zzip_off_t) len);
+        check(entry->zz_offset == 0);
+        check(entry->zz_diskstart == 0);
+    }
+    check_entry(dir, "a", content, len);
+    zzip_mem_disk_close(dir);
+}
+
+int
+main(void)
+{
+    size_t i;
+    for (i = 0; i < sizeof(data); i++)
+        data[i] = "zzip writer test "[i % 17] + (i / 4096) % 3;
+
+    test_writer_roundtrip();
+    test_partial_zip64();
+
+    if (failures)
+        fprintf(stderr, "%d checks failed\n", failures);
+    return failures ? 1 : 0;
+}
@@ -201,6 +201,10 @@
 #  define _zzip_write  write
 #  endif
 
+#if ! defined _zzip_pread && ! defined _MSC_VER && ! defined _WIN32
+#  define _zzip_pread  pread
+#endif
+
 #      if 0
 #  ifndef _zzip_stat
 #  define _zzip_stat  stat
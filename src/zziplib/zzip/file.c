@@ -23,6 +23,7 @@
 
 #include <zzip/format.h>
 #include <zzip/fetch.h>
+#include <zzip/hash.h>
 #include <zzip/__debug.h>
 
 #if 0
@@ -35,6 +36,147 @@
 #define tells(fd) seeks(fd,0,SEEK_CUR)
 #endif
 
+/*
+ * inflate checkpoints: at a deflate block boundary every "span" bytes we
+ * remember the compressed position, the bit offset within that byte and
+ * the 32K window, so that zzip_seek can restart the inflate stream there
+ * instead of reading from the start of the file (like zlib's zran.c).
+ */
+#ifndef ZZIP_SEEKPOINT_SPAN
+#define ZZIP_SEEKPOINT_SPAN (1024*1024)
+#endif
+
+struct zzip_seekpoint
+{
+    zzip_off_t out;             /* uncompressed offset */
+    zzip_off_t in;              /* compressed offset of the next full byte */
+    int bits;                   /* unused bits in the byte before "in" */
+    unsigned dictlen;
+    unsigned char window[ZZIP_32K];
+};
+
+struct zzip_seekpoints
+{
+    zzip_off_t span;
+    int count;
+    int size;
+    struct zzip_seekpoint *point;       /* ordered by out */
+};
+
+static struct zzip_seekpoints *
+zzip_seekpoints_new(zzip_off_t span)
+{
+    struct zzip_seekpoints *sp = calloc(1, sizeof(*sp));
+    if (sp)
+        sp->span = span > 0 ? span : ZZIP_SEEKPOINT_SPAN;
+    return sp;
+}
+
+static void
+zzip_seekpoints_free(struct zzip_seekpoints *sp)
+{
+    if (sp->point)
+        free(sp->point);
+    free(sp);
+}
+
+/* called after inflate(Z_BLOCK) - the list is just an accelerator, so
+ * running out of memory only means there will be no further checkpoints */
+static void
+zzip_seekpoints_add(ZZIP_FILE * fp)
+{
+    struct zzip_seekpoints *sp = fp->seekpoints;
+    struct zzip_seekpoint *point;
+    zzip_off_t out = fp->usize - fp->restlen;
+    zzip_off_t last = sp->count ? sp->point[sp->count - 1].out : 0;
+
+    /* only at the end of a block that is not the last one */
+    if ((fp->d_stream.data_type & 192) != 128 || out < last + sp->span)
+        return;
+
+    if (sp->count == sp->size)
+    {
+        int size = sp->size ? sp->size * 2 : 8;
+        point = realloc(sp->point, size * sizeof(*point));
+        if (! point)
+            return;
+        sp->point = point;
+        sp->size = size;
+    }
+
+    point = &sp->point[sp->count];
+    point->out = out;
+    point->in = fp->csize - fp->crestlen - fp->d_stream.avail_in;
+    point->bits = fp->d_stream.data_type & 7;
+    point->dictlen = ZZIP_32K;
+    if (inflateGetDictionary(&fp->d_stream, point->window,
+                             &point->dictlen) == Z_OK)
+        sp->count++;
+}
+
+/* the last checkpoint at or before the uncompressed offset, or null */
+static struct zzip_seekpoint *
+zzip_seekpoints_find(struct zzip_seekpoints *sp, zzip_off_t offset)
+{
+    int lo = 0, hi = sp->count;
+
+    while (lo < hi)
+    {
+        int mid = lo + (hi - lo) / 2;
+        if (sp->point[mid].out <= offset)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo ? &sp->point[lo - 1] : 0;
+}
+
+static int zzip_file_saveoffset(ZZIP_FILE * fp);
+
+/* restart the inflate stream of fp at the given checkpoint */
+static int
+zzip_seekpoints_jump(ZZIP_FILE * fp, struct zzip_seekpoint *point)
+{
+    ZZIP_DIR *dir = fp->dir;
+    zzip_off_t in = point->in - (point->bits ? 1 : 0);
+
+    if (fp->threaded)
+    {
+        fp->offset = fp->dataoffset + in;
+    } else
+    {
+        if (dir->currentfp != fp)
+        {
+            if (zzip_file_saveoffset(dir->currentfp) < 0)
+                { dir->errcode = ZZIP_DIR_SEEK; return -1; }
+            else
+                { dir->currentfp = fp; }
+        }
+
+        if (fp->io->fd.seeks(dir->fd, fp->dataoffset + in, SEEK_SET) < 0)
+            { dir->errcode = ZZIP_DIR_SEEK; return -1; }
+    }
+
+    if (inflateReset(&fp->d_stream) != Z_OK)
+        { dir->errcode = ZZIP_CORRUPTED; return -1; }
+    fp->d_stream.avail_in = 0;
+    fp->crestlen = fp->csize - in;
+
+    if (point->bits)
+    {
+        unsigned char c;
+        if ((fp->threaded ? fp->io->fd.pread(dir->fd, &c, 1, fp->offset++)
+                          : fp->io->fd.read(dir->fd, &c, 1)) != 1)
+            { dir->errcode = ZZIP_DIR_READ; return -1; }
+        fp->crestlen--;
+        inflatePrime(&fp->d_stream, point->bits, c >> (8 - point->bits));
+    }
+    inflateSetDictionary(&fp->d_stream, point->window, point->dictlen);
+
+    fp->restlen = fp->usize - point->out;
+    return 0;
+}
+
 /**
  * the direct function of => zzip_close(fp). it will cleanup the
  * inflate-portion of => zlib and free the structure given.
@@ -49,11 +191,13 @@ zzip_file_close(ZZIP_FILE * fp)
 {
     auto int self;
     ZZIP_DIR *dir = fp->dir;
+    long refcount;
 
     if (fp->method)
         inflateEnd(&fp->d_stream);      /* inflateEnd() can be called many times */
 
-    if (dir->cache.locked == NULL)
+    /* threaded files do not share the dir cache */
+    if (! fp->threaded && dir->cache.locked == NULL)
         dir->cache.locked = &self;
 
     if (fp->buf32k)
@@ -67,7 +211,10 @@ zzip_file_close(ZZIP_FILE * fp)
     if (dir->currentfp == fp)
         dir->currentfp = NULL;
 
-    dir->refcount--;
+    if (fp->seekpoints)
+        zzip_seekpoints_free(fp->seekpoints);
+
+    refcount = _zzip_atomic_dec(&dir->refcount);
     /* ease to notice possible dangling reference errors */
     memset(fp, 0, sizeof(*fp));
 
@@ -79,7 +226,7 @@ zzip_file_close(ZZIP_FILE * fp)
     if (dir->cache.locked == &self)
         dir->cache.locked = NULL;
 
-    if (! dir->refcount)
+    if (! refcount)
         return zzip_dir_close(dir);
     else
         return 0;
@@ -140,7 +287,9 @@ dirsep_basename(zzip_char_t* name)
 
 #if defined strcasecmp
 #define dirsep_strcasecmp strcasecmp
+#define DIRSEP_HASH_CASELESS ZZIP_HASH_CASELESS
 #else
+#define DIRSEP_HASH_CASELESS (ZZIP_HASH_CASELESS|ZZIP_HASH_DIRSEP)
 static int
 dirsep_strcasecmp(zzip_char_t * s1, zzip_char_t * s2)
 {
@@ -176,6 +325,12 @@ static int zzip_inflate_init(ZZIP_FILE *, struct zzip_dir_hdr *);
  * Note: the zlib supports 2..15 bit windowsize, hence we provide a 32k
  *       memchunk here... just to be safe.
  *
+ * With the ZZIP_THREADED o_mode (and a plugin io providing pread) the
+ * file keeps its own offset into the archive and reads with pread instead
+ * of sharing the seek position of the dir's fd. Such files can be opened,
+ * read and closed in different threads concurrently; a single ZZIP_FILE
+ * must still be used by one thread at a time.
+ *
  * On error it returns null and sets errcode in the ZZIP_DIR.
  */
 ZZIP_FILE *
@@ -185,6 +340,7 @@ zzip_file_open(ZZIP_DIR * dir, zzip_char_t * name, int o_mode)
     zzip_error_t err = 0;
     struct zzip_file *fp = 0;
     struct zzip_dir_hdr *hdr = dir->hdr0;
+    int threaded;
     int (*filename_strcmp) (zzip_char_t *, zzip_char_t *);
     zzip_char_t* (*filename_basename)(zzip_char_t*);
 
@@ -200,6 +356,14 @@ zzip_file_open(ZZIP_DIR * dir, zzip_char_t * name, int o_mode)
 
     if (o_mode & ZZIP_NOPATHS)
         name = filename_basename(name);
+    else if (dir->hash)
+    {
+        /* jump to the first matching entry, the loop below verifies it */
+        hdr = __zzip_hash_find(dir->hash, name, (o_mode & ZZIP_CASELESS)
+                               ? DIRSEP_HASH_CASELESS : 0);
+        if (! hdr)
+            { dir->errcode = ZZIP_ENOENT; return NULL; }
+    }
 
     while (1)
     {
@@ -222,7 +386,11 @@ zzip_file_open(ZZIP_DIR * dir, zzip_char_t * name, int o_mode)
                 { err = ZZIP_UNSUPP_COMPR; goto error; }
             }
 
-            if (dir->cache.locked == NULL)
+            /* with positional reads every file keeps its own offset, and
+             * the only shared state left is the refcount (and the cache) */
+            threaded = (o_mode & ZZIP_THREADED) && dir->io->fd.pread;
+
+            if (! threaded && dir->cache.locked == NULL)
                 dir->cache.locked = &self;
 
             if (dir->cache.locked == &self && dir->cache.fp)
@@ -238,7 +406,8 @@ zzip_file_open(ZZIP_DIR * dir, zzip_char_t * name, int o_mode)
 
             fp->dir = dir;
             fp->io = dir->io;
-            dir->refcount++;
+            fp->threaded = threaded;
+            _zzip_atomic_inc(&dir->refcount);
 
             if (dir->cache.locked == &self && dir->cache.buf32k)
             {
@@ -258,14 +427,17 @@ zzip_file_open(ZZIP_DIR * dir, zzip_char_t * name, int o_mode)
              * file to read...
              */
 
-            if (zzip_file_saveoffset(dir->currentfp) < 0)
-                { err = ZZIP_DIR_SEEK; goto error; }
-
             fp->offset = hdr->d_off;
-            dir->currentfp = fp;
+            if (! threaded)
+            {
+                if (zzip_file_saveoffset(dir->currentfp) < 0)
+                    { err = ZZIP_DIR_SEEK; goto error; }
 
-            if (dir->io->fd.seeks(dir->fd, hdr->d_off, SEEK_SET) < 0)
-                { err = ZZIP_DIR_SEEK; goto error; }
+                dir->currentfp = fp;
+
+                if (dir->io->fd.seeks(dir->fd, hdr->d_off, SEEK_SET) < 0)
+                    { err = ZZIP_DIR_SEEK; goto error; }
+            }
 
             {
                 /* skip local header - should test tons of other info,
@@ -273,7 +445,11 @@ zzip_file_open(ZZIP_DIR * dir, zzip_char_t * name, int o_mode)
                 zzip_ssize_t dataoff;
                 struct zzip_file_header *p = (void *) fp->buf32k;
 
-                dataoff = dir->io->fd.read(dir->fd, (void *) p, sizeof(*p));
+                if (threaded)
+                    dataoff = dir->io->fd.pread(dir->fd, (void *) p,
+                                                sizeof(*p), hdr->d_off);
+                else
+                    dataoff = dir->io->fd.read(dir->fd, (void *) p, sizeof(*p));
                 if (dataoff < (zzip_ssize_t) sizeof(*p))
                     { err = ZZIP_DIR_READ;  goto error; }
                 if (! zzip_file_header_check_magic(p))   /* PK\3\4 */
@@ -281,10 +457,17 @@ zzip_file_open(ZZIP_DIR * dir, zzip_char_t * name, int o_mode)
 
                 dataoff = zzip_file_header_sizeof_tail(p);
 
-                if (dir->io->fd.seeks(dir->fd, dataoff, SEEK_CUR) < 0)
-                    { err = ZZIP_DIR_SEEK; goto error; }
+                if (threaded)
+                {
+                    fp->dataoffset = hdr->d_off + sizeof(*p) + dataoff;
+                    fp->offset = fp->dataoffset;
+                } else
+                {
+                    if (dir->io->fd.seeks(dir->fd, dataoff, SEEK_CUR) < 0)
+                        { err = ZZIP_DIR_SEEK; goto error; }
 
-                fp->dataoffset = dir->io->fd.tells(dir->fd);
+                    fp->dataoffset = dir->io->fd.tells(dir->fd);
+                }
                 fp->usize = hdr->d_usize;
                 fp->csize = hdr->d_csize;
             }
@@ -293,6 +476,11 @@ zzip_file_open(ZZIP_DIR * dir, zzip_char_t * name, int o_mode)
             if (err)
                 goto error;
 
+            /* optional, zzip_seek falls back to reading from the start */
+            if ((o_mode & ZZIP_SEEKPOINTS) && fp->method &&
+                hdr->d_usize > ZZIP_SEEKPOINT_SPAN)
+                fp->seekpoints = zzip_seekpoints_new(0);
+
             return fp;
         } else
         {
@@ -397,7 +585,7 @@ zzip_file_read(ZZIP_FILE * fp, void *buf, zzip_size_t len)
      * If this is other handle than previous, save current seek pointer
      * and read the file position of `this' handle.
      */
-    if (dir->currentfp != fp)
+    if (! fp->threaded && dir->currentfp != fp)
     {
         if (zzip_file_saveoffset(dir->currentfp) < 0
             || fp->io->fd.seeks(dir->fd, fp->offset, SEEK_SET) < 0)
@@ -424,7 +612,9 @@ zzip_file_read(ZZIP_FILE * fp, void *buf, zzip_size_t len)
                 /*  zzip_size_t cl =
                  *      fp->crestlen > 128 ? 128 : fp->crestlen;
                  */
-                zzip_ssize_t i = fp->io->fd.read(dir->fd, fp->buf32k, cl);
+                zzip_ssize_t i = fp->threaded
+                    ? fp->io->fd.pread(dir->fd, fp->buf32k, cl, fp->offset)
+                    : fp->io->fd.read(dir->fd, fp->buf32k, cl);
 
                 if (i <= 0)
                 {
@@ -432,13 +622,16 @@ zzip_file_read(ZZIP_FILE * fp, void *buf, zzip_size_t len)
                     /* or ZZIP_DIR_READ_EOF ? */
                     return -1;
                 }
+                if (fp->threaded)
+                    fp->offset += i;
                 fp->crestlen -= i;
                 fp->d_stream.avail_in = i;
                 fp->d_stream.next_in = (unsigned char *) fp->buf32k;
             }
 
             startlen = fp->d_stream.total_out;
-            err = inflate(&fp->d_stream, Z_NO_FLUSH);
+            err = inflate(&fp->d_stream,
+                          fp->seekpoints ? Z_BLOCK : Z_NO_FLUSH);
 
             if (err == Z_STREAM_END)
                 { fp->restlen = 0; }
@@ -446,15 +639,21 @@ zzip_file_read(ZZIP_FILE * fp, void *buf, zzip_size_t len)
                 { fp->restlen -= (fp->d_stream.total_out - startlen); }
             else
                 { dir->errcode = err; return -1; }
+
+            if (fp->seekpoints && err == Z_OK)
+                zzip_seekpoints_add(fp);
         }
         while (fp->restlen && fp->d_stream.avail_out);
 
         return l - fp->d_stream.avail_out;
     } else
     {                           /* method == 0 -- unstore */
-        rv = fp->io->fd.read(dir->fd, buf, l);
+        if (fp->threaded)
+            rv = fp->io->fd.pread(dir->fd, buf, l, fp->offset);
+        else
+            rv = fp->io->fd.read(dir->fd, buf, l);
         if (rv > 0)
-            { fp->restlen-= rv; }
+            { fp->restlen-= rv; if (fp->threaded) fp->offset += rv; }
         else if (rv < 0)
             { dir->errcode = ZZIP_DIR_READ; }
         return rv;
@@ -945,7 +1144,7 @@ zzip_rewind(ZZIP_FILE * fp)
     /*
      * If this is other handle than previous, save current seek pointer
      */
-    if (dir->currentfp != fp)
+    if (! fp->threaded && dir->currentfp != fp)
     {
         if (zzip_file_saveoffset(dir->currentfp) < 0)
             { dir->errcode = ZZIP_DIR_SEEK; return -1; }
@@ -954,7 +1153,8 @@ zzip_rewind(ZZIP_FILE * fp)
     }
 
     /* seek to beginning of this file */
-    if (fp->io->fd.seeks(dir->fd, fp->dataoffset, SEEK_SET) < 0)
+    if (! fp->threaded &&
+        fp->io->fd.seeks(dir->fd, fp->dataoffset, SEEK_SET) < 0)
         return -1;
 
     /* reset the inflate init stuff */
@@ -992,7 +1192,9 @@ zzip_rewind(ZZIP_FILE * fp)
  * by rewinding the file, and then data is read until the offset is
  * reached.  This can make the function terribly slow, but this is
  * how gzio implements it, so I'm not sure there is a better way
- * without using the internals of the algorithm.
+ * without using the internals of the algorithm. If the file has
+ * inflate checkpoints (see => zzip_file_seekpoints) then reading
+ * restarts at the nearest one before the target offset.
  */
 zzip_off_t
 zzip_seek(ZZIP_FILE * fp, zzip_off_t offset, int whence)
@@ -1029,6 +1231,21 @@ zzip_seek(ZZIP_FILE * fp, zzip_off_t offset, int whence)
     if (rel_ofs == 0)
         return cur_pos;         /* don't have to move */
 
+    if (fp->method && fp->seekpoints &&
+        cur_pos + rel_ofs <= (zzip_off_t) fp->usize)
+    {                           /* restart at the nearest checkpoint */
+        struct zzip_seekpoint *point =
+            zzip_seekpoints_find(fp->seekpoints, cur_pos + rel_ofs);
+
+        if (point && (rel_ofs < 0 || point->out > cur_pos))
+        {
+            if (zzip_seekpoints_jump(fp, point) == -1)
+                return -1;
+            rel_ofs -= point->out - cur_pos;
+            cur_pos = point->out;
+        }
+    }
+
     if (rel_ofs < 0)
     {                           /* convert backward into forward */
         if (zzip_rewind(fp) == -1)
@@ -1055,7 +1272,7 @@ zzip_seek(ZZIP_FILE * fp, zzip_off_t offset, int whence)
      * If this is other handle than previous, save current seek pointer
      * and read the file position of `this' handle.
      */
-    if (dir->currentfp != fp)
+    if (! fp->threaded && dir->currentfp != fp)
     {
         if (zzip_file_saveoffset(dir->currentfp) < 0
             || fp->io->fd.seeks(dir->fd, fp->offset, SEEK_SET) < 0)
@@ -1064,7 +1281,12 @@ zzip_seek(ZZIP_FILE * fp, zzip_off_t offset, int whence)
             { dir->currentfp = fp; }
     }
 
-    if (fp->method == 0)
+    if (fp->method == 0 && fp->threaded)
+    {                           /* unstore, just move our own offset */
+        fp->offset += read_size;
+        fp->restlen -= read_size;
+        return zzip_tell(fp);
+    } else if (fp->method == 0)
     {                           /* unstore, just lseek relatively */
         ofs = fp->io->fd.tells(dir->fd);
         ofs = fp->io->fd.seeks(dir->fd, read_size, SEEK_CUR);
@@ -1103,6 +1325,55 @@ zzip_seek(ZZIP_FILE * fp, zzip_off_t offset, int whence)
     return zzip_tell(fp);
 }
 
+/** => zzip_seek
+ * This function records inflate checkpoints for a deflated file about every
+ * span bytes (or ZZIP_SEEKPOINT_SPAN if zero) by decompressing it once, so
+ * that a later => zzip_seek restarts from the nearest checkpoint instead of
+ * inflating all the data from the start of the file. The read position of
+ * the file is kept. Stored files and files not bigger than span are left
+ * alone. Opening a file with the ZZIP_SEEKPOINTS o_mode records the same
+ * checkpoints lazily while it is being read.
+ *
+ * The checkpoints need 32K each and are freed with the file handle.
+ * It returns zero on success, or -1 on error.
+ */
+int
+zzip_file_seekpoints(ZZIP_FILE * fp, zzip_off_t span)
+{
+    struct zzip_seekpoints *sp;
+    zzip_off_t pos;
+    char *buf;
+
+    if (! fp || ! fp->dir)
+        return -1;
+    if (span <= 0)
+        span = ZZIP_SEEKPOINT_SPAN;
+    if (! fp->method || (zzip_off_t) fp->usize <= span)
+        return 0;
+
+    if (! fp->seekpoints && ! (fp->seekpoints = zzip_seekpoints_new(span)))
+        { fp->dir->errcode = ZZIP_OUTOFMEM; return -1; }
+    sp = fp->seekpoints;
+    sp->span = span;
+
+    /* continue from the last checkpoint if that is ahead of us */
+    pos = zzip_tell(fp);
+    if (sp->count && sp->point[sp->count - 1].out > pos &&
+        zzip_seekpoints_jump(fp, &sp->point[sp->count - 1]) == -1)
+        return -1;
+
+    if (! (buf = (char *) malloc(ZZIP_32K)))
+        { fp->dir->errcode = ZZIP_OUTOFMEM; return -1; }
+    while (fp->restlen)
+    {
+        if (zzip_file_read(fp, buf, ZZIP_32K) <= 0)
+            { free(buf); return -1; }
+    }
+    free(buf);
+
+    return zzip_seek(fp, pos, SEEK_SET) < 0 ? -1 : 0;
+}
+
 /**
  * This function will => tell(2) the current position in a real/zipped file
  *
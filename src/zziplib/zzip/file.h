@@ -75,6 +75,8 @@ struct zzip_file
     zzip_off_t offset; /* offset from the start of zipfile... */
     z_stream d_stream;
     zzip_plugin_io_t io;
+    struct zzip_seekpoints* seekpoints; /* inflate checkpoints for zzip_seek */
+    int threaded;  /* ZZIP_THREADED: offset is kept here, reads use pread */
 };
 
 #endif /* _ZZIP_FILE_H */
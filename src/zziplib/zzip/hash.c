@@ -0,0 +1,158 @@
+
+/*
+ * The name index is a plain chained hash table living in one malloc
+ * block: the entries are kept in central directory order and the bucket
+ * chains are linked through entry numbers. Names are hashed in a folded
+ * form (ASCII lowercase, backslash as slash) so that one table serves
+ * both the case-sensitive and the caseless lookups - the actual compare
+ * is done after a hash match.
+ *
+ *          use under the restrictions of the
+ *          Lesser GNU General Public License
+ *          or alternatively the restrictions
+ *          of the Mozilla Public License 1.1
+ */
+
+#include <zzip/hash.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+struct zzip_hash_entry
+{
+    uint32_t hash;              /* folded FNV-1a of the name */
+    uint32_t next;              /* next entry number in bucket, 0 = end */
+    zzip_size_t namlen;
+    char _zzip_const* name;     /* not zero-terminated */
+    void* item;
+};
+
+struct zzip_hash
+{
+    uint32_t mask;              /* number of buckets - 1 */
+    uint32_t count;             /* entries added */
+    uint32_t size;              /* entries allocated */
+    uint32_t* bucket;           /* last entry number of chain, 0 = empty */
+    struct zzip_hash_entry entry[1];    /* entry[0] is unused */
+};
+
+/* ASCII tolower plus mapping of backslash to a normal slash */
+_zzip_inline static int
+__zzip_hash_fold(int c)
+{
+    if (c >= 'A' && c <= 'Z')
+        return c + ('a' - 'A');
+    if (c == '\\')
+        return '/';
+    return c;
+}
+
+/* compare name (of len bytes) with a key of the same length */
+static int
+__zzip_hash_equal(char _zzip_const* name, char _zzip_const* key,
+                  zzip_size_t len, int flags)
+{
+    zzip_size_t i;
+
+    if (! (flags & ZZIP_HASH_CASELESS))
+        return ! memcmp(name, key, len);
+
+    for (i = 0; i < len; i++)
+    {
+        int c1 = (unsigned char) name[i];
+        int c2 = (unsigned char) key[i];
+        if (c1 == c2)
+            continue;
+        if (flags & ZZIP_HASH_DIRSEP)
+            { c1 = __zzip_hash_fold(c1); c2 = __zzip_hash_fold(c2); }
+        else
+        {
+            if (c1 >= 'A' && c1 <= 'Z') c1 += 'a' - 'A';
+            if (c2 >= 'A' && c2 <= 'Z') c2 += 'a' - 'A';
+        }
+        if (c1 != c2)
+            return 0;
+    }
+    return 1;
+}
+
+struct zzip_hash *
+__zzip_hash_new(zzip_size_t entries)
+{
+    struct zzip_hash *hash;
+    zzip_size_t buckets = 16;
+
+    if (entries >= 0x7FFFFFFF / 2)
+        return 0;
+    while (buckets < entries)
+        buckets <<= 1;
+
+    hash = malloc(sizeof(*hash) + entries * sizeof(hash->entry[0])
+                  + buckets * sizeof(uint32_t));
+    if (! hash)
+        return 0;
+    hash->mask = (uint32_t) (buckets - 1);
+    hash->count = 0;
+    hash->size = (uint32_t) entries;
+    hash->bucket = (uint32_t *) (hash->entry + entries + 1);
+    memset(hash->bucket, 0, buckets * sizeof(uint32_t));
+    return hash;
+}
+
+int
+__zzip_hash_add(struct zzip_hash *hash, char _zzip_const * name,
+                zzip_size_t namlen, void *item)
+{
+    struct zzip_hash_entry *entry;
+    uint32_t h = 2166136261u;
+    zzip_size_t i;
+
+    if (hash->count >= hash->size)
+        return -1;
+    for (i = 0; i < namlen; i++)
+        { h ^= (uint32_t) __zzip_hash_fold((unsigned char) name[i]); h *= 16777619u; }
+
+    entry = &hash->entry[++hash->count];
+    entry->hash = h;
+    entry->name = name;
+    entry->namlen = namlen;
+    entry->item = item;
+    entry->next = hash->bucket[h & hash->mask];
+    hash->bucket[h & hash->mask] = hash->count;
+    return 0;
+}
+
+void *
+__zzip_hash_find(struct zzip_hash *hash, char _zzip_const * name, int flags)
+{
+    uint32_t h = 2166136261u;
+    uint32_t n;
+    zzip_size_t len;
+    void *found = 0;
+
+    for (len = 0; name[len]; len++)
+        { h ^= (uint32_t) __zzip_hash_fold((unsigned char) name[len]); h *= 16777619u; }
+
+    /* chains are linked from the last added entry backwards, so the last
+     * match seen is the first one in central directory order */
+    for (n = hash->bucket[h & hash->mask]; n; n = hash->entry[n].next)
+    {
+        struct zzip_hash_entry *entry = &hash->entry[n];
+        if (entry->hash == h && entry->namlen == len &&
+            __zzip_hash_equal(entry->name, name, len, flags))
+            found = entry->item;
+    }
+    return found;
+}
+
+void
+__zzip_hash_free(struct zzip_hash *hash)
+{
+    free(hash);
+}
+
+/*
+ * Local variables:
+ * c-file-style: "stroustrup"
+ * End:
+ */
@@ -0,0 +1,57 @@
+#ifndef _ZZIP_HASH_H
+#define _ZZIP_HASH_H
+/*
+ * DO NOT USE THIS CODE.
+ *
+ * It is an internal header file for zziplib: a name index over the
+ * entries of a zip central directory, so that finding a file by name
+ * does not need to scan (and compare) every entry of a big archive.
+ * It is used by zzip_file_open, zzip_disk_findfile and the memdisk
+ * variant zzip_mem_disk_findfile.
+ *
+ *          use under the restrictions of the
+ *          Lesser GNU General Public License
+ *          or alternatively the restrictions
+ *          of the Mozilla Public License 1.1
+ */
+
+#include <zzip/types.h>
+#include <zzip/stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* archives with fewer entries are scanned linearly, set to 0 to never
+ * build an index (the index costs about 40 bytes per entry) */
+#ifndef ZZIP_HASH_MINENTRIES
+#define ZZIP_HASH_MINENTRIES 32
+#endif
+
+/* __zzip_hash_find flags : */
+#define ZZIP_HASH_CASELESS 1    /* ignore ASCII case of names */
+#define ZZIP_HASH_DIRSEP   2    /* backslash matches slash (with CASELESS) */
+
+struct zzip_hash;
+
+/* create an index for up to "entries" names, null if out of memory */
+struct zzip_hash*
+__zzip_hash_new(zzip_size_t entries);
+
+/* add an entry in central directory order. The name is not copied and
+ * need not be zero-terminated. Returns -1 when the index is full. */
+int
+__zzip_hash_add(struct zzip_hash* hash, char _zzip_const* name,
+                zzip_size_t namlen, void* item);
+
+/* find the first added entry matching the zero-terminated name */
+void*
+__zzip_hash_find(struct zzip_hash* hash, char _zzip_const* name, int flags);
+
+void
+__zzip_hash_free(struct zzip_hash* hash);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -66,10 +66,28 @@ struct zzip_dir
     char*  realname;
     zzip_strings_t* fileext;      /* list of fileext to test for */
     zzip_plugin_io_t io;          /* vtable for io routines */
+    struct zzip_hash* hash;       /* name index on hdr0, see zzip/hash.h */
 }; 
 
 #define ZZIP_32K 32768
 
+/* dir->refcount is shared by ZZIP_THREADED files, these return the new value */
+#if defined _MSC_VER
+#include <intrin.h>
+#define _zzip_atomic_inc(_p_) _InterlockedIncrement((long volatile*)(_p_))
+#define _zzip_atomic_dec(_p_) _InterlockedDecrement((long volatile*)(_p_))
+#define _zzip_atomic_and(_p_,_m_) \
+        (_InterlockedAnd((long volatile*)(_p_), (_m_)) & (_m_))
+#elif defined __GNUC__ && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 1))
+#define _zzip_atomic_inc(_p_) __sync_add_and_fetch((_p_), 1)
+#define _zzip_atomic_dec(_p_) __sync_sub_and_fetch((_p_), 1)
+#define _zzip_atomic_and(_p_,_m_) __sync_and_and_fetch((_p_), (_m_))
+#else
+#define _zzip_atomic_inc(_p_) (++*(_p_))
+#define _zzip_atomic_dec(_p_) (--*(_p_))
+#define _zzip_atomic_and(_p_,_m_) (*(_p_) &= (_m_))
+#endif
+
 /* try to open a zip-basename with default_fileext */
 int      __zzip_try_open (zzip_char_t* filename, int filemode,
                           zzip_strings_t* ext, zzip_plugin_io_t io);
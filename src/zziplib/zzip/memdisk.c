@@ -37,8 +37,17 @@
 #include <zzip/fetch.h>
 #include <zzip/mmapped.h>
 #include <zzip/memdisk.h>
+#include <zzip/hash.h>
 #include <zzip/__fnmatch.h>
 
+#if defined _WIN32
+#include <windows.h>
+#define ZZIP_MEM_THREADS 1
+#elif defined ZZIP_HAVE_UNISTD_H
+#include <pthread.h>
+#define ZZIP_MEM_THREADS 1
+#endif
+
 #define ___ {
 #define ____ }
 
@@ -54,18 +63,18 @@ static const char *error[] = {
 };
 
 #define ZZIP_EXTRA_zip64 0x0001
-typedef struct _zzip_extra_zip64
-{                               /* ZIP64 extended information extra field */
-    zzip_byte_t z_datatype[2];  /* Tag for this "extra" block type */
-    zzip_byte_t z_datasize[2];  /* Size of this "extra" block */
-    zzip_byte_t z_usize[8];     /* Original uncompressed file size */
-    zzip_byte_t z_csize[8];     /* Size of compressed data */
-    zzip_byte_t z_offset[8];    /* Offset of local header record */
-    zzip_byte_t z_diskstart[4]; /* Number of the disk for file start */
-} zzip_extra_zip64;
+/* ZIP64 extended information extra field: after the datatype and datasize
+ * come 8-byte usize, csize, offset and a 4-byte diskstart, but only those
+ * whose value in the header is all ones (APPNOTE 4.5.3). The local header
+ * block has usize and csize only. */
 
 /*forward*/
 
+static void
+zzip_mem_cache_free(struct zzip_mem_cache *cache);
+static struct zzip_mem_cached *
+zzip_mem_cache_get(ZZIP_MEM_DISK * dir, ZZIP_MEM_ENTRY * entry);
+
 static zzip__new__ ZZIP_MEM_ENTRY *
 zzip_mem_entry_new(ZZIP_DISK * disk, ZZIP_DISK_ENTRY * entry);
 static void
@@ -148,6 +157,16 @@ zzip_mem_disk_load(ZZIP_MEM_DISK * dir, ZZIP_DISK * disk)
         count++;
     }
     ____;
+    if (ZZIP_HASH_MINENTRIES && count >= ZZIP_HASH_MINENTRIES &&
+        (dir->hash = __zzip_hash_new(count)))
+    {
+        /* optional - findfile scans the list when there is no index */
+        ZZIP_MEM_ENTRY *item = dir->list;
+        for (; item; item = item->zz_next)
+            if (item->zz_name)
+                __zzip_hash_add(dir->hash, item->zz_name,
+                                strlen(item->zz_name), item);
+    }
     dir->disk = disk;
     return count;
     ____;
@@ -213,15 +232,41 @@ zzip_mem_entry_new(ZZIP_DISK * disk, ZZIP_DISK_ENTRY * entry)
         }
     }
     {
-        /* override sizes/offsets with zip64 values for largefile support */
-        zzip_extra_zip64 *block = (zzip_extra_zip64 *)
-            zzip_mem_entry_extra_block(item, ZZIP_EXTRA_zip64);
-        if (block)
+        /* override sizes/offsets with zip64 values for largefile support.
+         * The central directory block says which fields are there. */
+        int /*            */ ext = zzip_disk_entry_get_extras(entry);
+        zzip_byte_t *_zzip_restrict ptr = (zzip_byte_t *)
+            zzip_disk_entry_to_extras(entry);
+        while (ext >= zzip_extra_block_headerlength)
         {
-            item->zz_usize = __zzip_get64(block->z_usize);
-            item->zz_csize = __zzip_get64(block->z_csize);
-            item->zz_offset = __zzip_get64(block->z_offset);
-            item->zz_diskstart = __zzip_get32(block->z_diskstart);
+            int size = zzip_extra_block_get_datasize(ptr);
+            if (zzip_extra_block_headerlength + size > ext)
+                break;          /* truncated */
+            if (zzip_extra_block_get_datatype(ptr) == ZZIP_EXTRA_zip64)
+            {
+                zzip_byte_t *field = ptr + zzip_extra_block_headerlength;
+                if (zzip_disk_entry_get_usize(entry) == 0xFFFFFFFF && size >= 8)
+                {
+                    item->zz_usize = __zzip_get64(field);
+                    field += 8; size -= 8;
+                }
+                if (zzip_disk_entry_get_csize(entry) == 0xFFFFFFFF && size >= 8)
+                {
+                    item->zz_csize = __zzip_get64(field);
+                    field += 8; size -= 8;
+                }
+                if (zzip_disk_entry_get_offset(entry) == 0xFFFFFFFF &&
+                    size >= 8)
+                {
+                    item->zz_offset = __zzip_get64(field);
+                    field += 8; size -= 8;
+                }
+                if (zzip_disk_entry_get_diskstart(entry) == 0xFFFF && size >= 4)
+                    item->zz_diskstart = __zzip_get32(field);
+                break;
+            }
+            ptr += zzip_extra_block_headerlength + size;
+            ext -= zzip_extra_block_headerlength + size;
         }
     }
     /* NOTE:
@@ -284,6 +329,9 @@ void
 zzip_mem_disk_unload(ZZIP_MEM_DISK * dir)
 {
     ZZIP_MEM_ENTRY *item = dir->list;
+    if (dir->cache)
+        zzip_mem_cache_free(dir->cache);
+    dir->cache = 0;
     while (item)
     {
         ZZIP_MEM_ENTRY *next = item->zz_next;
@@ -291,6 +339,9 @@ zzip_mem_disk_unload(ZZIP_MEM_DISK * dir)
         item = next;
     }
     dir->list = dir->last = 0;
+    if (dir->hash)
+        __zzip_hash_free(dir->hash);
+    dir->hash = 0;
     zzip_disk_close(dir->disk);
     dir->disk = 0;
 }
@@ -364,6 +415,8 @@ zzip_mem_disk_findfile(ZZIP_MEM_DISK * dir,
     ZZIP_MEM_ENTRY *entry = (! after ? dir->list : after->zz_next);
     if (! compare)
         compare = (zzip_strcmp_fn_t) (strcmp);
+    if (! after && dir->hash && compare == (zzip_strcmp_fn_t) (strcmp))
+        return __zzip_hash_find(dir->hash, filename, 0);
     for (; entry; entry = entry->zz_next)
     {
         if (! compare(filename, entry->zz_name))
@@ -392,6 +445,456 @@ zzip_mem_disk_findmatch(ZZIP_MEM_DISK * dir,
     return 0;
 }
 
+/* ====================================================================== */
+
+/*                  cache of decompressed entries                         */
+
+struct zzip_mem_cached
+{
+    struct zzip_mem_cached *prev;       /* LRU list, most recent first */
+    struct zzip_mem_cached *next;
+    ZZIP_MEM_ENTRY *entry;
+    zzip_byte_t *data;
+    zzip_size_t size;
+    int pinned;                 /* in a preload arena, not in the LRU list */
+    int used;                   /* number of open files on the data */
+};
+
+struct zzip_mem_arena
+{
+    struct zzip_mem_arena *next;
+    int count;
+    struct zzip_mem_cached item[1];     /* followed by the data */
+};
+
+struct zzip_mem_cache
+{
+    zzip_size_t budget;
+    zzip_size_t used;
+    zzip_size_t preloaded;
+    long hits;
+    long misses;
+    long evictions;
+    struct zzip_mem_cached *head;
+    struct zzip_mem_cached *tail;
+    struct zzip_mem_arena *arena;
+};
+
+/* inflate a deflated span completely and check its crc32 */
+static int
+zzip_mem_entry_inflate(ZZIP_MEM_ENTRY * entry, ZZIP_DISK_SPAN * span,
+                       zzip_byte_t * out)
+{
+    z_stream zlib;
+    int err;
+
+    if (span->compr != ZZIP_IS_DEFLATED ||
+        span->csize != (uInt) span->csize || span->usize != (uInt) span->usize)
+        return -1;
+
+    memset(&zlib, 0, sizeof(zlib));
+    if (inflateInit2(&zlib, -MAX_WBITS) != Z_OK)
+        return -1;
+    zlib.next_in = span->data;
+    zlib.avail_in = (uInt) span->csize;
+    zlib.next_out = out;
+    zlib.avail_out = (uInt) span->usize;
+    err = inflate(&zlib, Z_FINISH);
+    inflateEnd(&zlib);
+
+    if (err != Z_STREAM_END || zlib.total_out != span->usize)
+        return -1;
+    if (crc32(crc32(0, Z_NULL, 0), out, (uInt) span->usize) !=
+        (uLong) (entry->zz_crc32 & 0xFFFFFFFFUL))
+        return -1;
+    return 0;
+}
+
+static void
+zzip_mem_cache_unlink(struct zzip_mem_cache *cache,
+                      struct zzip_mem_cached *item)
+{
+    if (item->prev)
+        item->prev->next = item->next;
+    else
+        cache->head = item->next;
+    if (item->next)
+        item->next->prev = item->prev;
+    else
+        cache->tail = item->prev;
+    item->prev = item->next = 0;
+}
+
+static void
+zzip_mem_cache_push(struct zzip_mem_cache *cache,
+                    struct zzip_mem_cached *item)
+{
+    item->prev = 0;
+    item->next = cache->head;
+    if (cache->head)
+        cache->head->prev = item;
+    else
+        cache->tail = item;
+    cache->head = item;
+}
+
+/* drop unused entries from the LRU end until need more bytes fit */
+static int
+zzip_mem_cache_evict(struct zzip_mem_cache *cache, zzip_size_t need)
+{
+    struct zzip_mem_cached *item = cache->tail;
+    while (item && cache->used + need > cache->budget)
+    {
+        struct zzip_mem_cached *prev = item->prev;
+        if (! item->used)
+        {
+            zzip_mem_cache_unlink(cache, item);
+            item->entry->zz_cache = 0;
+            cache->used -= item->size;
+            cache->evictions++;
+            free(item);
+        }
+        item = prev;
+    }
+    return (cache->used + need <= cache->budget) ? 0 : -1;
+}
+
+/* lookup for fopen, a miss decompresses into the LRU list if it fits */
+static struct zzip_mem_cached *
+zzip_mem_cache_get(ZZIP_MEM_DISK * dir, ZZIP_MEM_ENTRY * entry)
+{
+    struct zzip_mem_cache *cache = dir->cache;
+    struct zzip_mem_cached *item = entry->zz_cache;
+    ZZIP_DISK_SPAN span;
+
+    if (item)
+    {
+        cache->hits++;
+        if (! item->pinned && item != cache->head)
+        {
+            zzip_mem_cache_unlink(cache, item);
+            zzip_mem_cache_push(cache, item);
+        }
+        return item;
+    }
+
+    cache->misses++;
+    if ((entry->zz_flags & 1) ||
+        zzip_mem_entry_usize(entry) < 0 ||
+        (zzip_size_t) zzip_mem_entry_usize(entry) > cache->budget ||
+        zzip_mem_entry_to_span(dir, entry, &span) == -1 ||
+        zzip_mem_cache_evict(cache, span.usize) == -1)
+        return 0;
+
+    if (! (item = malloc(sizeof(*item) + span.usize)))
+        return 0;
+    item->data = (zzip_byte_t *) (item + 1);
+    if (zzip_mem_entry_inflate(entry, &span, item->data) == -1)
+        { free(item); return 0; }
+    item->entry = entry;
+    item->size = span.usize;
+    item->pinned = 0;
+    item->used = 0;
+    zzip_mem_cache_push(cache, item);
+    cache->used += item->size;
+    entry->zz_cache = item;
+    return item;
+}
+
+static void
+zzip_mem_cache_free(struct zzip_mem_cache *cache)
+{
+    while (cache->head)
+    {
+        struct zzip_mem_cached *item = cache->head;
+        cache->head = item->next;
+        item->entry->zz_cache = 0;
+        free(item);
+    }
+    while (cache->arena)
+    {
+        struct zzip_mem_arena *arena = cache->arena;
+        int i;
+        cache->arena = arena->next;
+        for (i = 0; i < arena->count; i++)
+            arena->item[i].entry->zz_cache = 0;
+        free(arena);
+    }
+    free(cache);
+}
+
+/** set the memory budget of the LRU cache of decompressed entries.
+ *  a deflated entry opened with zzip_mem_entry_fopen is then inflated
+ *  once into the cache and later opens just copy from there. Entries
+ *  that do not fit the budget are inflated on the fly as before. A
+ *  budget of zero drops all LRU entries (but not preloaded ones). The
+ *  cache (and preloaded data) is released on unload.
+ *  returns: 0, or -1 on error (setting errno)
+ */
+int
+zzip_mem_disk_cache(ZZIP_MEM_DISK * dir, zzip_size_t budget)
+{
+    if (! dir)
+        { errno=EINVAL; return -1; }
+    if (! dir->cache && ! (dir->cache = calloc(1, sizeof(*dir->cache))))
+        return -1;              /* errno=ENOMEM; */
+    dir->cache->budget = budget;
+    zzip_mem_cache_evict(dir->cache, 0);        /* open files may stay */
+    return 0;
+}
+
+/** get the hit/miss counters and memory usage of the cache.
+ *  returns: 0, or -1 if there is no cache (all stats are zero then)
+ */
+int
+zzip_mem_disk_cache_stats(ZZIP_MEM_DISK * dir, ZZIP_MEM_CACHE_STATS * stats)
+{
+    struct zzip_mem_cache *cache = dir ? dir->cache : 0;
+    if (! stats)
+        { errno=EINVAL; return -1; }
+    memset(stats, 0, sizeof(*stats));
+    if (! cache)
+        return -1;
+    stats->hits = cache->hits;
+    stats->misses = cache->misses;
+    stats->evictions = cache->evictions;
+    stats->used = cache->used;
+    stats->budget = cache->budget;
+    stats->preloaded = cache->preloaded;
+    return 0;
+}
+
+struct zzip_mem_preload
+{
+    ZZIP_MEM_ENTRY *entry;
+    ZZIP_DISK_SPAN span;
+    zzip_byte_t *data;          /* in the arena */
+    int worker;
+    int failed;
+};
+
+struct zzip_mem_worker
+{
+    struct zzip_mem_preload *job;
+    int count;
+    int worker;
+};
+
+static void
+zzip_mem_preload_run(struct zzip_mem_worker *work)
+{
+    int i;
+    for (i = 0; i < work->count; i++)
+    {
+        struct zzip_mem_preload *job = &work->job[i];
+        if (job->worker == work->worker)
+            job->failed = zzip_mem_entry_inflate(job->entry, &job->span,
+                                                 job->data);
+    }
+}
+
+#if defined _WIN32
+static DWORD WINAPI
+zzip_mem_preload_thread(LPVOID work)
+{
+    zzip_mem_preload_run((struct zzip_mem_worker *) work);
+    return 0;
+}
+#elif defined ZZIP_MEM_THREADS
+static void *
+zzip_mem_preload_thread(void *work)
+{
+    zzip_mem_preload_run((struct zzip_mem_worker *) work);
+    return 0;
+}
+#endif
+
+static int
+zzip_mem_preload_by_entry(const void *a, const void *b)
+{
+    const struct zzip_mem_preload *x = a, *y = b;
+    return (x->entry < y->entry) ? -1 : (x->entry > y->entry);
+}
+
+static int
+zzip_mem_preload_by_size(const void *a, const void *b)
+{
+    const struct zzip_mem_preload *x = a, *y = b;
+    return (x->span.usize > y->span.usize) ? -1 :
+        (x->span.usize < y->span.usize);
+}
+
+#define ZZIP_MEM_ALIGN(_n_) (((_n_) + 15) & ~(zzip_size_t) 15)
+
+/** decompress a list of entries in parallel into the cache.
+ *  the named deflated entries are inflated by up to "threads" workers
+ *  into one arena block, and zzip_mem_entry_fopen serves them from there
+ *  until unload (without counting against the LRU budget). Stored entries
+ *  are used in place and only prefetched. Unknown, encrypted or broken
+ *  entries are skipped. Without thread support the calling thread does
+ *  all the work.
+ *  returns: number of entries ready, or -1 on error (setting errno)
+ */
+long
+zzip_mem_disk_preload(ZZIP_MEM_DISK * dir, char **names, int count,
+                      int threads)
+{
+    struct zzip_mem_preload *job;
+    struct zzip_mem_worker *work = 0;
+    struct zzip_mem_arena *arena = 0;
+    zzip_size_t *load = 0, total = 0;
+    zzip_byte_t *data;
+    long done = 0;
+    int i, n, k;
+
+    if (! dir || ! dir->disk || (count > 0 && ! names))
+        { errno=EINVAL; return -1; }
+    if (! dir->cache && zzip_mem_disk_cache(dir, 0) == -1)
+        return -1;
+    if (count <= 0)
+        return 0;
+    if (! (job = calloc(count, sizeof(*job))))
+        return -1;
+
+    for (i = n = 0; i < count; i++)
+    {
+        ZZIP_MEM_ENTRY *entry = zzip_mem_disk_findfile(dir, names[i], 0, 0);
+        if (! entry || (entry->zz_flags & 1) ||
+            zzip_mem_entry_to_span(dir, entry, &job[n].span) == -1)
+            continue;
+        if (! zzip_mem_entry_data_stored(entry) &&
+            ! zzip_mem_entry_data_deflated(entry))
+            continue;
+        job[n++].entry = entry;
+    }
+
+    /* drop duplicates, then stored and already cached entries are done */
+    qsort(job, n, sizeof(*job), zzip_mem_preload_by_entry);
+    for (i = k = 0; i < n; i++)
+    {
+        if (k && job[i].entry == job[k - 1].entry)
+            continue;
+        if (job[i].entry->zz_cache || ! job[i].span.usize ||
+            zzip_mem_entry_data_stored(job[i].entry))
+        {
+            if (! job[i].entry->zz_cache)
+                zzip_disk_span_prefetch(dir->disk, &job[i].span);
+            done++;
+            continue;
+        }
+        job[k++] = job[i];
+    }
+    if (! (n = k))
+        goto done;
+
+    /* biggest first, each to the worker with the least bytes so far */
+    qsort(job, n, sizeof(*job), zzip_mem_preload_by_size);
+    if (threads > n)
+        threads = n;
+    if (threads < 1)
+        threads = 1;
+    if (! (load = calloc(threads, sizeof(*load))) ||
+        ! (work = calloc(threads, sizeof(*work))))
+        goto error;
+    for (i = 0; i < n; i++)
+    {
+        int w, least = 0;
+        for (w = 1; w < threads; w++)
+            if (load[w] < load[least])
+                least = w;
+        job[i].worker = least;
+        load[least] += job[i].span.usize;
+        total += ZZIP_MEM_ALIGN(job[i].span.usize);
+    }
+
+    if (! (arena = malloc(sizeof(*arena) + (n - 1) * sizeof(arena->item[0])
+                          + 15 + total)))
+        goto error;
+    data = (zzip_byte_t *) &arena->item[n];
+    data += ZZIP_MEM_ALIGN((zzip_size_t) data) - (zzip_size_t) data;
+    for (i = 0; i < n; i++)
+    {
+        job[i].data = data;
+        data += ZZIP_MEM_ALIGN(job[i].span.usize);
+    }
+
+    for (i = 0; i < threads; i++)
+    {
+        work[i].job = job;
+        work[i].count = n;
+        work[i].worker = i;
+    }
+    ___ int started = 0;
+#if defined _WIN32
+    HANDLE thread[64];
+    for (i = 1; i < threads && i <= 64; i++)
+    {
+        if (! (thread[i - 1] = CreateThread(0, 0, zzip_mem_preload_thread,
+                                            &work[i], 0, 0)))
+            break;
+        started++;
+    }
+#elif defined ZZIP_MEM_THREADS
+    pthread_t thread[64];
+    for (i = 1; i < threads && i <= 64; i++)
+    {
+        if (pthread_create(&thread[i - 1], 0, zzip_mem_preload_thread,
+                           &work[i]))
+            break;
+        started++;
+    }
+#endif
+    /* this thread takes worker 0 and any that did not start */
+    zzip_mem_preload_run(&work[0]);
+    for (i = started + 1; i < threads; i++)
+        zzip_mem_preload_run(&work[i]);
+#if defined _WIN32
+    for (i = 0; i < started; i++)
+    {
+        WaitForSingleObject(thread[i], INFINITE);
+        CloseHandle(thread[i]);
+    }
+#elif defined ZZIP_MEM_THREADS
+    for (i = 0; i < started; i++)
+        pthread_join(thread[i], 0);
+#endif
+    ____;
+
+    for (i = k = 0; i < n; i++)
+    {
+        struct zzip_mem_cached *item;
+        if (job[i].failed)
+            continue;
+        item = &arena->item[k++];
+        item->prev = item->next = 0;
+        item->entry = job[i].entry;
+        item->data = job[i].data;
+        item->size = job[i].span.usize;
+        item->pinned = 1;
+        item->used = 0;
+        job[i].entry->zz_cache = item;
+        dir->cache->preloaded += item->size;
+        done++;
+    }
+    if ((arena->count = k))
+    {
+        arena->next = dir->cache->arena;
+        dir->cache->arena = arena;
+    } else
+        free(arena);
+
+  done:
+    free(work);
+    free(load);
+    free(job);
+    return done;
+  error:
+    free(work);
+    free(load);
+    free(job);
+    return -1;
+}
+
 zzip__new__ ZZIP_MEM_DISK_FILE *
 zzip_mem_entry_fopen(ZZIP_MEM_DISK * dir, ZZIP_MEM_ENTRY * entry)
 {
@@ -402,6 +905,21 @@ zzip_mem_entry_fopen(ZZIP_MEM_DISK * dir, ZZIP_MEM_ENTRY * entry)
     file->buffer = dir->disk->buffer;
     file->endbuf = dir->disk->endbuf;
     file->avail = zzip_mem_entry_usize(entry);
+    file->cached = 0;
+
+    if (dir->cache && file->avail && zzip_mem_entry_data_deflated(entry))
+    {
+        /* read it like a stored file from the decompressed copy */
+        struct zzip_mem_cached *item = zzip_mem_cache_get(dir, entry);
+        if (item)
+        {
+            item->used++;
+            file->cached = item;
+            file->buffer = file->stored = item->data;
+            file->endbuf = item->data + item->size;
+            return file;
+        }
+    }
 
     if (! file->avail || zzip_mem_entry_data_stored(entry))
         { file->stored = zzip_mem_entry_to_data (entry); return file; }
@@ -420,6 +938,35 @@ zzip_mem_entry_fopen(ZZIP_MEM_DISK * dir, ZZIP_MEM_ENTRY * entry)
     return file;
 }
 
+/** get the data of an entry without copying.
+ *  like zzip_disk_entry_to_span but using the (zip64) sizes of the entry.
+ *  returns: 0 on success, or -1 if out of bounds (setting errno)
+ */
+int
+zzip_mem_entry_to_span(ZZIP_MEM_DISK * dir, ZZIP_MEM_ENTRY * entry,
+                       ZZIP_DISK_SPAN * span)
+{
+    ZZIP_DISK *disk;
+    if (! dir || ! dir->disk || ! entry || ! span)
+        { errno=EINVAL; return -1; }
+    disk = dir->disk;
+
+    span->data = zzip_mem_entry_to_data(entry);
+    span->csize = (zzip_size_t) zzip_mem_entry_csize(entry);
+    span->usize = (zzip_size_t) zzip_mem_entry_usize(entry);
+    span->compr = zzip_mem_entry_data_comprlevel(entry);
+
+    /* keep this in sync with zzip_disk_entry_to_span */
+    if (span->data < disk->buffer || span->data > disk->endbuf ||
+        zzip_mem_entry_csize(entry) < 0 ||
+        (zzip_off_t) span->csize != (zzip_off_t) zzip_mem_entry_csize(entry) ||
+        span->csize > (zzip_size_t) (disk->endbuf - span->data))
+        { errno=EINVAL; return -1; }
+    if (disk->flags & ZZIP_DISK_FLAGS_PREFETCH)
+        zzip_disk_span_prefetch(disk, span);
+    return 0;
+}
+
 zzip__new__ ZZIP_MEM_DISK_FILE *
 zzip_mem_disk_fopen(ZZIP_MEM_DISK * dir, char *filename)
 {
@@ -440,6 +987,8 @@ zzip_mem_disk_fread(void *ptr, _zzip_size_t size, _zzip_size_t nmemb,
 int
 zzip_mem_disk_fclose(ZZIP_MEM_DISK_FILE * file)
 {
+    if (file->cached)
+        ((struct zzip_mem_cached *) file->cached)->used--;
     return zzip_disk_fclose(file);
 }
 
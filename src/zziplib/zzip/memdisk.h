@@ -17,6 +17,8 @@ struct _zzip_mem_disk {
     ZZIP_DISK* disk;
     ZZIP_MEM_ENTRY* list;
     ZZIP_MEM_ENTRY* last;
+    struct zzip_hash* hash; /* name index for zzip_mem_disk_findfile */
+    struct zzip_mem_cache* cache; /* decompressed entries, see below */
 };
 
 #ifndef zzip_mem_disk_extern
@@ -66,6 +68,7 @@ struct _zzip_mem_entry {
     int              zz_filetype;  /* (from "z_filetype") */
     char*            zz_comment;   /* zero-terminated (from "comment") */
     ZZIP_EXTRA_BLOCK* zz_ext[3];   /* terminated by null in z_datatype */
+    struct zzip_mem_cached* zz_cache; /* decompressed data if cached */
 };                                 /* the extra blocks are NOT converted */
 
 #define _zzip_mem_disk_findfirst(_d_) ((_d_)->list)
@@ -122,6 +125,10 @@ zzip_mem_entry_to_data(ZZIP_MEM_ENTRY* entry) {
     return _zzip_mem_entry_to_data(entry); }
 #endif
 
+int
+zzip_mem_entry_to_span(ZZIP_MEM_DISK* dir, ZZIP_MEM_ENTRY* entry,
+                       ZZIP_DISK_SPAN* span);
+
 ZZIP_MEM_ENTRY*
 zzip_mem_disk_findfile(ZZIP_MEM_DISK* dir,
                        char* filename, ZZIP_MEM_ENTRY* after,
@@ -162,6 +169,32 @@ zzip_mem_disk_fclose (ZZIP_MEM_DISK_FILE* file);
 int
 zzip_mem_disk_feof (ZZIP_MEM_DISK_FILE* file);
 
+/* zzip_mem_disk cache --------------------------------------------------- */
+
+/* with a cache the fopen of a deflated entry is served from a copy of the
+ * decompressed data: either from a preload arena (kept until unload) or
+ * from an LRU list that is limited by the budget. Cached data stays valid
+ * while a file on it is open. This is not thread-safe by itself - only
+ * the decompression in zzip_mem_disk_preload runs on worker threads.
+ */
+typedef struct zzip_mem_cache_stats ZZIP_MEM_CACHE_STATS;
+struct zzip_mem_cache_stats {
+    long        hits;      /* fopen served from the cache */
+    long        misses;    /* fopen of a deflated entry not in the cache */
+    long        evictions; /* entries dropped from the LRU list */
+    zzip_size_t used;      /* bytes in the LRU list */
+    zzip_size_t budget;    /* limit of the LRU list */
+    zzip_size_t preloaded; /* bytes in preload arenas */
+};
+
+int
+zzip_mem_disk_cache (ZZIP_MEM_DISK* dir, zzip_size_t budget);
+long
+zzip_mem_disk_preload (ZZIP_MEM_DISK* dir, char** names, int count,
+                       int threads);
+int
+zzip_mem_disk_cache_stats (ZZIP_MEM_DISK* dir, ZZIP_MEM_CACHE_STATS* stats);
+
 /* convert dostime of entry to unix time_t */
 long zzip_disk_entry_get_mktime(ZZIP_DISK_ENTRY* entry);
 
@@ -35,10 +35,15 @@
 #include <zzip/mmapped.h>
 #include <zzip/format.h>
 #include <zzip/fetch.h>
+#if defined ZZIP_HAVE_SYS_MMAN_H && ! defined _WIN32
+#define _USE_MMAP 1             /* zzip_disk_mmap uses mmap(2) */
+#endif
 #include <zzip/__mmap.h>
 #include <zzip/__fnmatch.h>
+#include <zzip/hash.h>
 
 #include <stdlib.h>
+#include <errno.h>
 #include <sys/stat.h>
 
 #if   defined ZZIP_HAVE_UNISTD_H
@@ -62,6 +67,8 @@
 #define ____ }
 #endif
 
+static void __zzip_disk_hash(ZZIP_DISK * disk);        /* forward */
+
 /** => zzip_disk_mmap
  * This function does primary initialization of a disk-buffer struct.
  */
@@ -111,6 +118,7 @@ zzip_disk_mmap(int fd)
     if (disk->buffer == MAP_FAILED)
         { free (disk); return 0; }
     disk->endbuf = disk->buffer + st.st_size;
+    __zzip_disk_hash(disk);
     return disk;
     ____;
 }
@@ -124,6 +132,8 @@ zzip_disk_munmap(ZZIP_DISK * disk)
 {
     if (! disk)
         return 0;
+    if (disk->reserved)
+        __zzip_hash_free(disk->reserved);
     _zzip_munmap(disk->mapped, disk->buffer, disk->endbuf - disk->buffer);
     free(disk);
     return 0;
@@ -162,6 +172,7 @@ zzip_disk_open(char *filename)
         disk->endbuf = buffer + st.st_size;
         disk->mapped = -1;
         disk->flags |= ZZIP_DISK_FLAGS_OWNED_BUFFER;
+        __zzip_disk_hash(disk);
     } else {
         free(buffer);
     }
@@ -188,6 +199,7 @@ zzip_disk_buffer(void *buffer, size_t buflen) {
         disk->buffer = (zzip_byte_t *) buffer;
         disk->endbuf = (zzip_byte_t *) buffer + buflen;
         disk->mapped = -1;
+        __zzip_disk_hash(disk);
     }
     return disk;
 }
@@ -205,6 +217,8 @@ zzip_disk_close(ZZIP_DISK * disk)
         return 0;
     if (disk->mapped != -1)
         return zzip_disk_munmap(disk);
+    if (disk->reserved)
+        __zzip_hash_free(disk->reserved);
     if (disk->flags & ZZIP_DISK_FLAGS_OWNED_BUFFER)
         free(disk->buffer);
     free(disk);
@@ -278,6 +292,74 @@ zzip_disk_entry_to_data(ZZIP_DISK * disk, struct zzip_disk_entry * entry)
     return 0;
 }
 
+/** => zzip_disk_entry_to_data
+ * This function locates the data of an entry without copying anything:
+ * the span is filled with a pointer into the disk->buffer and the sizes
+ * from the central directory. For a stored entry the span data is the
+ * file content itself, for a deflated entry it is the raw deflate stream
+ * (to be inflated with windowbits -MAX_WBITS). The span is checked to be
+ * within the zip area and stays valid as long as the disk is open.
+ * With ZZIP_DISK_FLAGS_PREFETCH the span is also given to
+ * => zzip_disk_span_prefetch
+ *
+ * Returns zero on success or -1 (setting errno to EINVAL) if the entry
+ * or its data is not within the bounds of the zip area.
+ */
+int
+zzip_disk_entry_to_span(ZZIP_DISK * disk, struct zzip_disk_entry *entry,
+                        ZZIP_DISK_SPAN * span)
+{
+    struct zzip_file_header *header;
+    if (! disk || ! entry || ! span ||
+        (zzip_byte_t *) entry < disk->buffer ||
+        (zzip_byte_t *) entry + sizeof(*entry) > disk->endbuf)
+        { errno = EINVAL; return -1; }
+    header = zzip_disk_entry_to_file_header(disk, entry);
+    if (! header ||
+        (zzip_size_t) (disk->endbuf - (zzip_byte_t *) header) < sizeof(*header) ||
+        ! zzip_file_header_check_magic(header))
+        { errno = EINVAL; return -1; }
+
+    span->data = zzip_file_header_to_data(header);
+    span->csize = zzip_disk_entry_csize(entry);
+    span->usize = zzip_disk_entry_usize(entry);
+    span->compr = zzip_disk_entry_get_compr(entry);
+
+    /* keep this in sync with zzip_mem_entry_to_span */
+    if (span->data < disk->buffer || span->data > disk->endbuf ||
+        span->csize > (zzip_size_t) (disk->endbuf - span->data))
+        { errno = EINVAL; return -1; }
+    if (disk->flags & ZZIP_DISK_FLAGS_PREFETCH)
+        zzip_disk_span_prefetch(disk, span);
+    return 0;
+}
+
+/** => zzip_disk_entry_to_data
+ * This function tells the system that the span will be read soon, using
+ * => madvise(2) with MADV_WILLNEED on the pages of an mmapped disk. That
+ * starts the readahead without blocking the caller on page faults. It does
+ * nothing for disks that are not mmapped (returning zero as well).
+ */
+int
+zzip_disk_span_prefetch(ZZIP_DISK * disk, ZZIP_DISK_SPAN * span)
+{
+    if (! disk || ! span)
+        { errno = EINVAL; return -1; }
+#if defined USE_POSIX_MMAP && defined MADV_WILLNEED
+    if (disk->mapped != -1 && span->csize &&
+        span->data >= disk->buffer && span->data < disk->endbuf)
+    {
+        /* the disk->buffer of mmap is page aligned */
+        zzip_size_t pagesize = _zzip_getpagesize(disk->mapped);
+        zzip_byte_t *start = disk->buffer +
+            (span->data - disk->buffer) / pagesize * pagesize;
+        return madvise((void *) start, span->data + span->csize - start,
+                       MADV_WILLNEED);
+    }
+#endif
+    return 0;
+}
+
 /** => zzip_disk_entry_to_data
  * This function does half the job of => zzip_disk_entry_to_data where it
  * can augment with => zzip_file_header_to_data helper from format/fetch.h
@@ -461,11 +543,20 @@ struct zzip_disk_entry *
 zzip_disk_findfile(ZZIP_DISK * disk, char *filename,
                    struct zzip_disk_entry *after, zzip_strcmp_fn_t compare)
 {
-    struct zzip_disk_entry *entry = (! after ? zzip_disk_findfirst(disk)
-                                     : zzip_disk_findnext(disk, after));
+    struct zzip_disk_entry *entry;
     if (! compare)
         compare = (zzip_strcmp_fn_t) ((disk->flags & ZZIP_DISK_FLAGS_MATCH_NOCASE) ?
                                       (_zzip_strcasecmp) : (strcmp));
+    if (! after && disk->reserved)
+    {
+        if (compare == (zzip_strcmp_fn_t) strcmp)
+            return __zzip_hash_find(disk->reserved, filename, 0);
+        if (compare == (zzip_strcmp_fn_t) _zzip_strcasecmp)
+            return __zzip_hash_find(disk->reserved, filename,
+                                    ZZIP_HASH_CASELESS);
+    }
+    entry = (! after ? zzip_disk_findfirst(disk)
+             : zzip_disk_findnext(disk, after));
     for (; entry; entry = zzip_disk_findnext(disk, entry))
     {
         /* filenames within zip files are often not null-terminated! */
@@ -480,6 +571,57 @@ zzip_disk_findfile(ZZIP_DISK * disk, char *filename,
     return 0;
 }
 
+/*
+ * build the name index of a newly opened disk, it is stored in the
+ * disk->reserved field and used by => zzip_disk_findfile for plain strcmp
+ * and strcasecmp lookups. Small archives and a failed malloc just leave
+ * it null so that the lookup falls back to scanning the entries.
+ */
+static void
+__zzip_disk_hash(ZZIP_DISK * disk)
+{
+    struct zzip_disk_entry *entry;
+    zzip_size_t entries = 0;
+
+    disk->reserved = 0;
+    if (! ZZIP_HASH_MINENTRIES)
+        return;
+    for (entry = zzip_disk_findfirst(disk); entry;
+         entry = zzip_disk_findnext(disk, entry))
+        entries++;
+    if (entries < ZZIP_HASH_MINENTRIES)
+        return;
+
+    ___ struct zzip_hash *hash = __zzip_hash_new(entries);
+    if (! hash)
+        return;
+    for (entry = zzip_disk_findfirst(disk); entry;
+         entry = zzip_disk_findnext(disk, entry))
+    {
+        /* the same name that zzip_disk_entry_strdup_name would copy */
+        char *name;
+        zzip_size_t len;
+        struct zzip_file_header *file;
+        if ((len = zzip_disk_entry_namlen(entry)))
+            name = zzip_disk_entry_to_filename(entry);
+        else if ((file = zzip_disk_entry_to_file_header(disk, entry)) &&
+                 (len = zzip_file_header_namlen(file)))
+            name = zzip_file_header_to_filename(file);
+        else
+            continue;
+        if ((zzip_byte_t *) name < disk->buffer ||
+            (zzip_byte_t *) name + len > disk->endbuf)
+            continue;
+        ___ char *end = memchr(name, '\0', len);
+        if (end)
+            len = end - name;
+        __zzip_hash_add(hash, name, len, entry);
+        ____;
+    }
+    disk->reserved = hash;
+    ____;
+}
+
 /** => zzip_disk_findfile
  *
  * This function uses a compare-function with an additional argument
@@ -547,6 +689,7 @@ zzip_disk_entry_fopen(ZZIP_DISK * disk, ZZIP_DISK_ENTRY * entry)
     file->buffer = disk->buffer;
     file->endbuf = disk->endbuf;
     file->avail = zzip_file_header_usize(header);
+    file->cached = 0;
 
     if (! file->avail || zzip_file_header_data_stored(header))
         { file->stored = zzip_file_header_to_data (header); return file; }
@@ -50,6 +50,20 @@ struct zzip_disk
 /* fnmatch search shall be case insensitive */
 #define ZZIP_DISK_FLAGS_MATCH_NOCASE 1
 #define ZZIP_DISK_FLAGS_OWNED_BUFFER 2
+/* entry_to_span does also a span_prefetch */
+#define ZZIP_DISK_FLAGS_PREFETCH 4
+
+/* a zero-copy view of the data of a zip entry within the disk->buffer,
+ * see zzip_disk_entry_to_span.
+ */
+typedef struct zzip_disk_span ZZIP_DISK_SPAN;
+struct zzip_disk_span
+{
+    zzip_byte_t* data;   /* start of the (compressed) data in disk->buffer */
+    zzip_size_t  csize;  /* number of bytes at data */
+    zzip_size_t  usize;  /* size after decompression */
+    int          compr;  /* ZZIP_IS_STORED, ZZIP_IS_DEFLATED or other */
+};
 
 typedef int (*zzip_strcmp_fn_t)(char*, char*);
 typedef int (*zzip_fnmatch_fn_t)(char*, char*, int);
@@ -92,6 +106,11 @@ zzip_disk_extern struct zzip_file_header*
 zzip_disk_entry_to_file_header(ZZIP_DISK* disk, ZZIP_DISK_ENTRY* entry);
 zzip_disk_extern zzip_byte_t*
 zzip_disk_entry_to_data(ZZIP_DISK* disk, ZZIP_DISK_ENTRY* entry);
+zzip_disk_extern int
+zzip_disk_entry_to_span(ZZIP_DISK* disk, ZZIP_DISK_ENTRY* entry,
+			ZZIP_DISK_SPAN* span);
+zzip_disk_extern int
+zzip_disk_span_prefetch(ZZIP_DISK* disk, ZZIP_DISK_SPAN* span);
 
 zzip_disk_extern ZZIP_DISK_ENTRY*
 zzip_disk_findfile(ZZIP_DISK* disk,
@@ -128,6 +147,7 @@ struct zzip_disk_file
     zzip_size_t avail;                 /* memorized for checks on EOF */
     z_stream zlib;                     /* for inflated blocks */
     zzip_byte_t* stored;               /* for stored blocks */
+    void* cached;                      /* memdisk cache item, or null */
 };
 #endif
 
@@ -43,6 +43,17 @@ zzip_filesize(int fd)
     return st.st_size;
 }
 
+#ifdef _zzip_pread
+static zzip_ssize_t
+zzip_pread(int fd, void *buf, zzip_size_t len, zzip_off_t offset)
+{
+    return _zzip_pread(fd, buf, len, offset);
+}
+#define zzip_default_pread &zzip_pread
+#else
+#define zzip_default_pread 0    /* ZZIP_THREADED files use the shared fd */
+#endif
+
 static const struct zzip_plugin_io default_io = {
     &open,
     &close,
@@ -50,7 +61,8 @@ static const struct zzip_plugin_io default_io = {
     &_zzip_lseek,
     &zzip_filesize,
     1, 1,
-    &_zzip_write
+    &_zzip_write,
+    zzip_default_pread
 };
 
 /** => zzip_init_io
@@ -50,12 +50,15 @@ struct zzip_plugin_io { /* use "zzip_plugin_io_handlers" in applications !! */
     long         sys;
     long         type;
     zzip_ssize_t (*write)(int fd, _zzip_const void* buf, zzip_size_t len);
+    /* read at an offset without moving the file position (may be null) */
+    zzip_ssize_t (*pread)(int fd, void* buf, zzip_size_t len,
+                          zzip_off_t offset);
 };
 
 typedef union _zzip_plugin_io
 {
     struct zzip_plugin_io fd;
-    struct { void* padding[8]; } ptr;
+    struct { void* padding[16]; } ptr;
 } zzip_plugin_io_handlers;
 
 #define _zzip_plugin_io_handlers zzip_plugin_io_handlers
@@ -13,6 +13,7 @@
  * export the relevant call entries which will return EROFS (read-only
  * filesystem) in case they are being called. That allows later programs
  * to start up with earlier versions of zziplib that can only read ZIPs.
+ * For creating zip archives use the zzip_writer calls (zzip/writer.h).
  *
  * Author: 
  *      Guido Draheim <guidod@gmx.de>
@@ -0,0 +1,976 @@
+
+/*
+ * NOTE: this is part of libzzipmmapped (i.e. it is not libzzip).
+ *                                            ==================
+ *
+ * These routines write a zip archive strictly sequentially (so the
+ * output may be a pipe), independent from the zzip_dir_creat stubs in
+ * write.c. Entries given to zzip_writer_add are queued to the worker
+ * threads that compute the crc32 and deflate them; the calling thread
+ * writes the finished entries in the order of the calls. An entry from
+ * zzip_writer_begin/_write/_end is deflated on the fly and written with
+ * the "streamed" flag and a data descriptor behind it. The central
+ * directory is kept in memory until zzip_writer_close writes it, along
+ * with the zip64 trailer records when the archive needs them.
+ *
+ *          use under the restrictions of the
+ *          Lesser GNU General Public License
+ *          or alternatively the restrictions
+ *          of the Mozilla Public License 1.1
+ */
+
+#include <zzip/writer.h>
+#include <zzip/format.h>
+#include <zzip/fetch.h>
+
+#include <zlib.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#if   defined ZZIP_HAVE_UNISTD_H
+#include <unistd.h>
+#elif defined ZZIP_HAVE_IO_H
+#include <io.h>
+#endif
+
+#if   defined ZZIP_HAVE_STRING_H
+#include <string.h>
+#elif defined ZZIP_HAVE_STRINGS_H
+#include <strings.h>
+#endif
+
+#if defined _WIN32
+#include <windows.h>
+#define ZZIP_WRITER_THREADS 1
+#define zzip_writer_lock(_w_) EnterCriticalSection(&(_w_)->mutex)
+#define zzip_writer_unlock(_w_) LeaveCriticalSection(&(_w_)->mutex)
+#define zzip_writer_wait(_w_,_c_) \
+        SleepConditionVariableCS(&(_w_)->_c_, &(_w_)->mutex, INFINITE)
+#define zzip_writer_wakeup(_w_,_c_) WakeAllConditionVariable(&(_w_)->_c_)
+#elif defined ZZIP_HAVE_UNISTD_H
+#include <pthread.h>
+#define ZZIP_WRITER_THREADS 1
+#define zzip_writer_lock(_w_) pthread_mutex_lock(&(_w_)->mutex)
+#define zzip_writer_unlock(_w_) pthread_mutex_unlock(&(_w_)->mutex)
+#define zzip_writer_wait(_w_,_c_) pthread_cond_wait(&(_w_)->_c_, &(_w_)->mutex)
+#define zzip_writer_wakeup(_w_,_c_) pthread_cond_broadcast(&(_w_)->_c_)
+#else /* no worker threads, everything is deflated in zzip_writer_add */
+#define zzip_writer_lock(_w_)
+#define zzip_writer_unlock(_w_)
+#define zzip_writer_wait(_w_,_c_)
+#define zzip_writer_wakeup(_w_,_c_)
+#endif
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+#define ___ {
+#define ____ }
+
+#define ZZIP_WRITER_MAXTHREADS 64
+#define ZZIP_WRITER_MAXALIGN 0x8000     /* padding is an extra block */
+#define ZZIP_WRITER_CHUNK (1 << 30)     /* largest zlib and write(2) call */
+#define ZZIP_WRITER_BUFSIZE 65536       /* output buffer of streamed entry */
+#define ZZIP_WRITER_ALIGN_ID 0xD935     /* extra block id as zipalign uses */
+#define ZZIP_WRITER_MAX32 0xFFFFFFFFUL
+
+struct zzip_writer_entry
+{
+    char *name;
+    zzip_size_t namlen;
+    int method;
+    int flags;                  /* general purpose bits */
+    int zip64;                  /* local header has zip64 sizes */
+    uint16_t dostime;
+    uint16_t dosdate;
+    uint32_t crc32;
+    uint64_t csize;
+    uint64_t usize;
+    uint64_t offset;            /* of the local header */
+};
+
+struct zzip_writer_job
+{
+    struct zzip_writer_job *next;
+    char *name;
+    int flags;
+    int level;
+    const zzip_byte_t *data;
+    zzip_size_t len;
+    zzip_byte_t *copy;          /* owned copy of data, or null */
+    zzip_byte_t *out;           /* deflated data, null when it is stored */
+    zzip_size_t outlen;
+    uint32_t crc32;
+    int done;
+    int failed;                 /* errno */
+};
+
+struct zzip_writer
+{
+    int fd;
+    int owned;                  /* fd is closed by zzip_writer_close */
+    int error;                  /* first errno, all later calls fail */
+    int level;
+    int align;
+    uint16_t dostime;
+    uint16_t dosdate;
+    uint64_t offset;            /* bytes written so far */
+    struct zzip_writer_entry *entry;
+    zzip_size_t entries;
+    zzip_size_t allocated;
+    zzip_size_t stream;         /* entry number + 1 of a begin..end */
+    z_stream zlib;
+    zzip_byte_t *zbuf;
+    int threads;                /* running workers, 0 = no queue */
+    int limit;                  /* of queued jobs before add waits */
+    int queued;
+    int quit;
+    struct zzip_writer_job *head;       /* next to be written */
+    struct zzip_writer_job *tail;
+    struct zzip_writer_job *todo;       /* next to be deflated */
+#if defined _WIN32
+    CRITICAL_SECTION mutex;
+    CONDITION_VARIABLE work;
+    CONDITION_VARIABLE done;
+    HANDLE thread[ZZIP_WRITER_MAXTHREADS];
+#elif defined ZZIP_WRITER_THREADS
+    pthread_mutex_t mutex;
+    pthread_cond_t work;
+    pthread_cond_t done;
+    pthread_t thread[ZZIP_WRITER_MAXTHREADS];
+#endif
+};
+
+static zzip_byte_t zzip_writer_zeros[256];
+
+/* write all bytes or remember the error */
+static int
+zzip_writer_out(ZZIP_WRITER * w, const void *data, uint64_t len)
+{
+    const char *p = data;
+    while (len && ! w->error)
+    {
+        unsigned chunk = len > ZZIP_WRITER_CHUNK ? ZZIP_WRITER_CHUNK : len;
+        zzip_ssize_t n = _zzip_write(w->fd, p, chunk);
+        if (n <= 0)
+        {
+            if (n == -1 && errno == EINTR)
+                continue;
+            w->error = (n == -1 && errno) ? errno : EIO;
+            break;
+        }
+        p += n;
+        len -= n;
+        w->offset += n;
+    }
+    return w->error ? -1 : 0;
+}
+
+static int
+zzip_writer_pad(ZZIP_WRITER * w, zzip_size_t len)
+{
+    while (len)
+    {
+        zzip_size_t n = len;
+        if (n > sizeof(zzip_writer_zeros))
+            n = sizeof(zzip_writer_zeros);
+        if (zzip_writer_out(w, zzip_writer_zeros, n) == -1)
+            return -1;
+        len -= n;
+    }
+    return 0;
+}
+
+/* names with bytes beyond ASCII are flagged as UTF-8 (bit 11) */
+static int
+zzip_writer_nameflags(char *name)
+{
+    for (; *name; name++)
+        if (*name & 0x80)
+            return 0x0800;
+    return 0;
+}
+
+/* append the central directory record and write the local header. The
+ * entry name is taken over by the writer (even on errors). */
+static int
+zzip_writer_local(ZZIP_WRITER * w, struct zzip_writer_entry *e, int align)
+{
+    zzip_byte_t head[zzip_file_header_headerlength + 20 + 6];
+    zzip_byte_t *extra = head + zzip_file_header_headerlength;
+    zzip_size_t pad = 0;
+
+    if (w->entries == w->allocated)
+    {
+        zzip_size_t n = w->allocated ? 2 * w->allocated : 64;
+        struct zzip_writer_entry *entry =
+            realloc(w->entry, n * sizeof(*entry));
+        if (! entry)
+        {
+            free(e->name);
+            if (! w->error)
+                w->error = ENOMEM;
+            return -1;
+        }
+        w->entry = entry;
+        w->allocated = n;
+    }
+    e->offset = w->offset;
+    e->dostime = w->dostime;
+    e->dosdate = w->dosdate;
+    if (e->usize >= ZZIP_WRITER_MAX32 || e->csize >= ZZIP_WRITER_MAX32)
+        e->zip64 = 1;
+    w->entry[w->entries++] = *e;
+    if (w->error)
+        return -1;
+
+    __zzip_set32(head + 0, ZZIP_FILE_HEADER_MAGIC);
+    __zzip_set16(head + 4, e->zip64 ? 45 : 20);
+    __zzip_set16(head + 6, e->flags);
+    __zzip_set16(head + 8, e->method);
+    __zzip_set16(head + 10, w->dostime);
+    __zzip_set16(head + 12, w->dosdate);
+    __zzip_set32(head + 14, e->crc32);
+    __zzip_set32(head + 18, e->zip64 ? ZZIP_WRITER_MAX32 : e->csize);
+    __zzip_set32(head + 22, e->zip64 ? ZZIP_WRITER_MAX32 : e->usize);
+    __zzip_set16(head + 26, e->namlen);
+    if (e->zip64)
+    {
+        __zzip_set16(extra + 0, 0x0001);
+        __zzip_set16(extra + 2, 16);
+        __zzip_set64(extra + 4, e->usize);
+        __zzip_set64(extra + 12, e->csize);
+        extra += 20;
+    }
+    if (align && w->align > 1)
+    {
+        uint64_t data = w->offset + (extra - head) + e->namlen + 6;
+        pad = (w->align - (zzip_size_t) (data % w->align)) % w->align;
+        __zzip_set16(extra + 0, ZZIP_WRITER_ALIGN_ID);
+        __zzip_set16(extra + 2, 2 + pad);
+        __zzip_set16(extra + 4, w->align);
+        extra += 6;
+    }
+    __zzip_set16(head + 28, (extra - head) - zzip_file_header_headerlength
+                 + pad);
+
+    zzip_writer_out(w, head, zzip_file_header_headerlength);
+    zzip_writer_out(w, e->name, e->namlen);
+    zzip_writer_out(w, head + zzip_file_header_headerlength,
+                    (extra - head) - zzip_file_header_headerlength);
+    return zzip_writer_pad(w, pad);
+}
+
+/* crc32 and (for deflated entries) the compressed copy of a job */
+static void
+zzip_writer_deflate(struct zzip_writer_job *job)
+{
+    zzip_size_t given = 0, bound;
+    z_stream zlib;
+    int err;
+
+    job->crc32 = crc32(0, Z_NULL, 0);
+    while (given < job->len)
+    {
+        zzip_size_t chunk = job->len - given;
+        if (chunk > ZZIP_WRITER_CHUNK)
+            chunk = ZZIP_WRITER_CHUNK;
+        job->crc32 = crc32(job->crc32, job->data + given, (uInt) chunk);
+        given += chunk;
+    }
+    if ((job->flags & ZZIP_WRITER_METHOD) != ZZIP_WRITER_DEFLATED)
+        return;
+
+    /* a raw deflate stream is never longer than that (see deflateBound) */
+    bound = job->len + (job->len >> 12) + (job->len >> 14)
+        + (job->len >> 25) + 64;
+    if (! (job->out = malloc(bound)))
+        { job->failed = ENOMEM; return; }
+    memset(&zlib, 0, sizeof(zlib));
+    if (deflateInit2(&zlib, job->level, Z_DEFLATED, -MAX_WBITS, 8,
+                     Z_DEFAULT_STRATEGY) != Z_OK)
+        { job->failed = ENOMEM; goto error; }
+    zlib.next_out = job->out;
+    given = 0;
+    for (;;)
+    {
+        zzip_size_t pos = zlib.next_out - job->out;
+        if (! zlib.avail_in && given < job->len)
+        {
+            zzip_size_t chunk = job->len - given;
+            if (chunk > ZZIP_WRITER_CHUNK)
+                chunk = ZZIP_WRITER_CHUNK;
+            zlib.next_in = (Bytef *) job->data + given;
+            zlib.avail_in = (uInt) chunk;
+            given += chunk;
+        }
+        if (! zlib.avail_out)
+        {
+            zzip_size_t chunk = bound - pos;
+            if (chunk > ZZIP_WRITER_CHUNK)
+                chunk = ZZIP_WRITER_CHUNK;
+            zlib.avail_out = (uInt) chunk;
+        }
+        err = deflate(&zlib, given == job->len ? Z_FINISH : Z_NO_FLUSH);
+        if (err == Z_STREAM_END)
+            break;
+        if (err != Z_OK)
+            { job->failed = EIO; break; }
+    }
+    job->outlen = zlib.next_out - job->out;
+    deflateEnd(&zlib);
+    if (! job->failed &&
+        (! (job->flags & ZZIP_WRITER_AUTO) || job->outlen < job->len))
+        return;
+  error:                       /* or stored after all */
+    free(job->out);
+    job->out = 0;
+    job->outlen = 0;
+}
+
+/* write a finished job, errors are kept in the writer */
+static void
+zzip_writer_emit(ZZIP_WRITER * w, struct zzip_writer_job *job)
+{
+    struct zzip_writer_entry e;
+    if (job->failed && ! w->error)
+        w->error = job->failed;
+    if (w->error)
+        return;
+
+    memset(&e, 0, sizeof(e));
+    e.name = job->name;
+    e.namlen = strlen(job->name);
+    e.method = job->out ? ZZIP_WRITER_DEFLATED : ZZIP_WRITER_STORED;
+    e.flags = zzip_writer_nameflags(job->name);
+    e.crc32 = job->crc32;
+    e.usize = job->len;
+    e.csize = job->out ? job->outlen : job->len;
+    job->name = 0;
+    if (zzip_writer_local(w, &e, ! job->out &&
+                          (job->flags & ZZIP_WRITER_ALIGN)) == -1)
+        return;
+    zzip_writer_out(w, job->out ? job->out : job->data, e.csize);
+}
+
+static void
+zzip_writer_job_free(struct zzip_writer_job *job)
+{
+    free(job->name);
+    free(job->copy);
+    free(job->out);
+    free(job);
+}
+
+/* write the finished jobs at the head of the queue, waiting for more
+ * while the queue is over its limit (or until it is empty if "all") */
+static void
+zzip_writer_drain(ZZIP_WRITER * w, int all)
+{
+    for (;;)
+    {
+        struct zzip_writer_job *job;
+        zzip_writer_lock(w);
+        while (w->head && ! w->head->done && (all || w->queued > w->limit))
+            zzip_writer_wait(w, done);
+        job = w->head;
+        if (job && job->done)
+        {
+            if (! (w->head = job->next))
+                w->tail = 0;
+            w->queued--;
+        } else
+            job = 0;
+        zzip_writer_unlock(w);
+        if (! job)
+            return;
+        zzip_writer_emit(w, job);
+        zzip_writer_job_free(job);
+    }
+}
+
+#ifdef ZZIP_WRITER_THREADS
+static void
+zzip_writer_work(ZZIP_WRITER * w)
+{
+    for (;;)
+    {
+        struct zzip_writer_job *job;
+        zzip_writer_lock(w);
+        while (! w->todo && ! w->quit)
+            zzip_writer_wait(w, work);
+        if ((job = w->todo))
+            w->todo = job->next;
+        zzip_writer_unlock(w);
+        if (! job)
+            return;
+        zzip_writer_deflate(job);
+        zzip_writer_lock(w);
+        job->done = 1;
+        zzip_writer_wakeup(w, done);
+        zzip_writer_unlock(w);
+    }
+}
+
+#if defined _WIN32
+static DWORD WINAPI
+zzip_writer_thread(LPVOID w)
+{
+    zzip_writer_work((ZZIP_WRITER *) w);
+    return 0;
+}
+#else
+static void *
+zzip_writer_thread(void *w)
+{
+    zzip_writer_work((ZZIP_WRITER *) w);
+    return 0;
+}
+#endif
+#endif
+
+/** create a zip archive.
+ *
+ * This function creates (or truncates) the given file and returns a
+ * writer handle for it. Deflating of => zzip_writer_add entries is done
+ * by up to "threads" worker threads; with zero threads (or without
+ * thread support) it is done by the calling thread. The archive is only
+ * complete after => zzip_writer_close.
+ *
+ * Returns null on error setting errno.
+ */
+zzip__new__ ZZIP_WRITER *
+zzip_writer_open(char *filename, int threads)
+{
+    ZZIP_WRITER *w;
+    int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0644);
+    if (fd == -1)
+        return 0;
+    if (! (w = zzip_writer_fdopen(fd, threads)))
+    {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return 0;
+    }
+    w->owned = 1;
+    return w;
+}
+
+/** => zzip_writer_open
+ * This function writes the archive to an open file descriptor starting
+ * at its current position (the offsets in the archive count from there).
+ * The descriptor is not closed by => zzip_writer_close.
+ */
+zzip__new__ ZZIP_WRITER *
+zzip_writer_fdopen(int fd, int threads)
+{
+    ZZIP_WRITER *w = calloc(1, sizeof(*w));
+    if (! w)
+        return 0;               /* errno=ENOMEM; */
+    w->fd = fd;
+    w->level = Z_DEFAULT_COMPRESSION;
+    w->align = 4096;
+    zzip_writer_mtime(w, (long) time(0));
+    if (threads > ZZIP_WRITER_MAXTHREADS)
+        threads = ZZIP_WRITER_MAXTHREADS;
+#if defined _WIN32
+    if (threads > 0)
+    {
+        InitializeCriticalSection(&w->mutex);
+        InitializeConditionVariable(&w->work);
+        InitializeConditionVariable(&w->done);
+        for (; w->threads < threads; w->threads++)
+            if (! (w->thread[w->threads] =
+                   CreateThread(0, 0, zzip_writer_thread, w, 0, 0)))
+                break;
+        if (! w->threads)
+            DeleteCriticalSection(&w->mutex);
+    }
+#elif defined ZZIP_WRITER_THREADS
+    if (threads > 0)
+    {
+        pthread_mutex_init(&w->mutex, 0);
+        pthread_cond_init(&w->work, 0);
+        pthread_cond_init(&w->done, 0);
+        for (; w->threads < threads; w->threads++)
+            if (pthread_create(&w->thread[w->threads], 0,
+                               zzip_writer_thread, w))
+                break;
+        if (! w->threads)
+        {
+            pthread_cond_destroy(&w->done);
+            pthread_cond_destroy(&w->work);
+            pthread_mutex_destroy(&w->mutex);
+        }
+    }
+#endif
+    w->limit = 2 * w->threads;
+    return w;
+}
+
+/** set the deflate level (0..9 or -1 for the zlib default) of the
+ * entries added after this call.
+ * returns: 0, or -1 on error (setting errno)
+ */
+int
+zzip_writer_level(ZZIP_WRITER * w, int level)
+{
+    if (! w || level < -1 || level > 9)
+        { errno = EINVAL; return -1; }
+    w->level = level;
+    return 0;
+}
+
+/** set the boundary for stored entries with ZZIP_WRITER_ALIGN. It must
+ * be a power of two up to 32768, the default is 4096 (a page). The data
+ * is aligned relative to the start of the archive by padding the extra
+ * field of the local header.
+ * returns: 0, or -1 on error (setting errno)
+ */
+int
+zzip_writer_align(ZZIP_WRITER * w, int align)
+{
+    if (! w || align < 1 || align > ZZIP_WRITER_MAXALIGN ||
+        (align & (align - 1)))
+        { errno = EINVAL; return -1; }
+    w->align = align;
+    return 0;
+}
+
+/** set the modification time (a unix time_t) of the entries added after
+ * this call, the default is the time of => zzip_writer_open.
+ * returns: 0, or -1 on error (setting errno)
+ */
+int
+zzip_writer_mtime(ZZIP_WRITER * w, long mtime)
+{
+    time_t t = (time_t) mtime;
+    struct tm *date = localtime(&t);
+    if (! w || ! date || date->tm_year < 80)
+        { errno = EINVAL; return -1; }
+    w->dostime = (date->tm_hour << 11) | (date->tm_min << 5)
+        | (date->tm_sec >> 1);
+    w->dosdate = ((date->tm_year - 80) << 9) | ((date->tm_mon + 1) << 5)
+        | date->tm_mday;
+    return 0;
+}
+
+/** add an entry with the given data.
+ *
+ * The flags choose ZZIP_WRITER_STORED or ZZIP_WRITER_DEFLATED, where
+ * ZZIP_WRITER_AUTO stores the data if deflating would not shrink it and
+ * ZZIP_WRITER_ALIGN aligns the data of stored entries for mmap access.
+ * The data is copied unless ZZIP_WRITER_NOCOPY is given, then it must
+ * stay valid until => zzip_writer_flush or => zzip_writer_close. With
+ * worker threads the entry is written later (but in order), so errors
+ * may show up only in a later call.
+ *
+ * returns: 0, or -1 on error (setting errno)
+ */
+int
+zzip_writer_add(ZZIP_WRITER * w, char *name, const void *data,
+                zzip_size_t len, int flags)
+{
+    struct zzip_writer_job *job;
+    int method = flags & ZZIP_WRITER_METHOD;
+
+    if (! w || ! name || (len && ! data) || w->stream ||
+        strlen(name) > 0xFFFF ||
+        (method != ZZIP_WRITER_STORED && method != ZZIP_WRITER_DEFLATED))
+        { errno = EINVAL; return -1; }
+    if (w->error)
+        { errno = w->error; return -1; }
+
+    if (! (job = calloc(1, sizeof(*job))) ||
+        ! (job->name = malloc(strlen(name) + 1)))
+        goto nomem;
+    strcpy(job->name, name);
+    job->flags = flags;
+    job->level = w->level;
+    job->len = len;
+    job->data = data;
+    if (len && ! (flags & ZZIP_WRITER_NOCOPY))
+    {
+        if (! (job->copy = malloc(len)))
+            goto nomem;
+        memcpy(job->copy, data, len);
+        job->data = job->copy;
+    }
+
+    if (! w->threads)
+    {
+        zzip_writer_deflate(job);
+        zzip_writer_emit(w, job);
+        zzip_writer_job_free(job);
+    } else
+    {
+        zzip_writer_lock(w);
+        if (w->tail)
+            w->tail->next = job;
+        else
+            w->head = job;
+        w->tail = job;
+        if (! w->todo)
+            w->todo = job;
+        w->queued++;
+        zzip_writer_wakeup(w, work);
+        zzip_writer_unlock(w);
+        zzip_writer_drain(w, 0);
+    }
+    if (w->error)
+        { errno = w->error; return -1; }
+    return 0;
+  nomem:
+    if (job)
+        zzip_writer_job_free(job);
+    errno = ENOMEM;
+    return -1;
+}
+
+/** write all queued entries.
+ * Afterwards the data of ZZIP_WRITER_NOCOPY entries is not used anymore.
+ * returns: 0, or -1 on error (setting errno)
+ */
+int
+zzip_writer_flush(ZZIP_WRITER * w)
+{
+    if (! w)
+        { errno = EINVAL; return -1; }
+    zzip_writer_drain(w, 1);
+    if (w->error)
+        { errno = w->error; return -1; }
+    return 0;
+}
+
+/** start a streamed entry.
+ *
+ * The data of the entry is given with => zzip_writer_write and deflated
+ * (or stored) on the calling thread, => zzip_writer_end finishes it.
+ * The local header can not carry the sizes, they follow the data in a
+ * data descriptor. An entry that may grow beyond 4 GiB must be started
+ * with ZZIP_WRITER_ZIP64. Queued entries are written before.
+ *
+ * returns: 0, or -1 on error (setting errno)
+ */
+int
+zzip_writer_begin(ZZIP_WRITER * w, char *name, int flags)
+{
+    struct zzip_writer_entry e;
+    int method = flags & ZZIP_WRITER_METHOD;
+
+    if (! w || ! name || w->stream || strlen(name) > 0xFFFF ||
+        (method != ZZIP_WRITER_STORED && method != ZZIP_WRITER_DEFLATED))
+        { errno = EINVAL; return -1; }
+    zzip_writer_drain(w, 1);
+    if (w->error)
+        { errno = w->error; return -1; }
+
+    if (method == ZZIP_WRITER_DEFLATED)
+    {
+        memset(&w->zlib, 0, sizeof(w->zlib));
+        if (! w->zbuf && ! (w->zbuf = malloc(ZZIP_WRITER_BUFSIZE)))
+            { errno = ENOMEM; return -1; }
+        if (deflateInit2(&w->zlib, w->level, Z_DEFLATED, -MAX_WBITS, 8,
+                         Z_DEFAULT_STRATEGY) != Z_OK)
+            { errno = ENOMEM; return -1; }
+    }
+
+    memset(&e, 0, sizeof(e));
+    if (! (e.name = malloc(strlen(name) + 1)))
+    {
+        if (method == ZZIP_WRITER_DEFLATED)
+            deflateEnd(&w->zlib);
+        errno = ENOMEM;
+        return -1;
+    }
+    strcpy(e.name, name);
+    e.namlen = strlen(name);
+    e.method = method;
+    e.flags = 0x0008 | zzip_writer_nameflags(name);
+    e.zip64 = (flags & ZZIP_WRITER_ZIP64) ? 1 : 0;
+    if (zzip_writer_local(w, &e, method == ZZIP_WRITER_STORED &&
+                          (flags & ZZIP_WRITER_ALIGN)) == -1)
+    {
+        if (method == ZZIP_WRITER_DEFLATED)
+            deflateEnd(&w->zlib);
+        errno = w->error;
+        return -1;
+    }
+    w->stream = w->entries;
+    return 0;
+}
+
+/* deflate the input given in w->zlib and write the output */
+static int
+zzip_writer_stream(ZZIP_WRITER * w, struct zzip_writer_entry *e, int flush)
+{
+    int err;
+    do
+    {
+        w->zlib.next_out = w->zbuf;
+        w->zlib.avail_out = ZZIP_WRITER_BUFSIZE;
+        err = deflate(&w->zlib, flush);
+        if (err != Z_OK && err != Z_STREAM_END && err != Z_BUF_ERROR)
+            { w->error = EIO; return -1; }
+        e->csize += ZZIP_WRITER_BUFSIZE - w->zlib.avail_out;
+        if (zzip_writer_out(w, w->zbuf,
+                            ZZIP_WRITER_BUFSIZE - w->zlib.avail_out) == -1)
+            return -1;
+    } while (flush == Z_FINISH ? err != Z_STREAM_END : ! w->zlib.avail_out);
+    return 0;
+}
+
+/** => zzip_writer_begin
+ * This function appends data to the current streamed entry.
+ * returns: len, or -1 on error (setting errno)
+ */
+zzip_ssize_t
+zzip_writer_write(ZZIP_WRITER * w, const void *data, zzip_size_t len)
+{
+    struct zzip_writer_entry *e;
+    zzip_size_t given = 0;
+
+    if (! w || ! w->stream || (len && ! data))
+        { errno = EINVAL; return -1; }
+    if (w->error)
+        { errno = w->error; return -1; }
+    e = &w->entry[w->stream - 1];
+    while (given < len)
+    {
+        zzip_size_t chunk = len - given;
+        if (chunk > ZZIP_WRITER_CHUNK)
+            chunk = ZZIP_WRITER_CHUNK;
+        e->crc32 = crc32(e->crc32, (const Bytef *) data + given,
+                         (uInt) chunk);
+        e->usize += chunk;
+        if (e->method == ZZIP_WRITER_STORED)
+        {
+            e->csize += chunk;
+            zzip_writer_out(w, (const char *) data + given, chunk);
+        } else
+        {
+            w->zlib.next_in = (Bytef *) data + given;
+            w->zlib.avail_in = (uInt) chunk;
+            zzip_writer_stream(w, e, Z_NO_FLUSH);
+        }
+        given += chunk;
+        if (w->error)
+            { errno = w->error; return -1; }
+    }
+    return len;
+}
+
+/** => zzip_writer_begin
+ * This function finishes the current streamed entry by writing its
+ * data descriptor.
+ * returns: 0, or -1 on error (setting errno)
+ */
+int
+zzip_writer_end(ZZIP_WRITER * w)
+{
+    zzip_byte_t desc[4 + 4 + 8 + 8];
+    struct zzip_writer_entry *e;
+
+    if (! w || ! w->stream)
+        { errno = EINVAL; return -1; }
+    e = &w->entry[w->stream - 1];
+    w->stream = 0;
+    if (e->method == ZZIP_WRITER_DEFLATED)
+    {
+        if (! w->error)
+        {
+            w->zlib.next_in = Z_NULL;
+            w->zlib.avail_in = 0;
+            zzip_writer_stream(w, e, Z_FINISH);
+        }
+        deflateEnd(&w->zlib);
+    }
+    if (! e->zip64 &&
+        (e->usize >= ZZIP_WRITER_MAX32 || e->csize >= ZZIP_WRITER_MAX32) &&
+        ! w->error)
+        w->error = EFBIG;       /* ZZIP_WRITER_ZIP64 was needed */
+    if (w->error)
+        { errno = w->error; return -1; }
+
+    __zzip_set32(desc + 0, ZZIP_FILE_TRAILER_MAGIC);
+    __zzip_set32(desc + 4, e->crc32);
+    if (e->zip64)
+    {
+        __zzip_set64(desc + 8, e->csize);
+        __zzip_set64(desc + 16, e->usize);
+    } else
+    {
+        __zzip_set32(desc + 8, e->csize);
+        __zzip_set32(desc + 12, e->usize);
+    }
+    if (zzip_writer_out(w, desc, e->zip64 ? 24 : 16) == -1)
+        { errno = w->error; return -1; }
+    return 0;
+}
+
+/* the central directory and the end records */
+static int
+zzip_writer_directory(ZZIP_WRITER * w)
+{
+    zzip_byte_t head[zzip_disk_entry_headerlength + 4 + 3 * 8];
+    uint64_t start = w->offset;
+    zzip_size_t i;
+
+    for (i = 0; i < w->entries; i++)
+    {
+        struct zzip_writer_entry *e = &w->entry[i];
+        zzip_byte_t *extra = head + zzip_disk_entry_headerlength + 4;
+        int dir = e->namlen && e->name[e->namlen - 1] == '/';
+        int zip64 = e->zip64;
+        if (e->usize >= ZZIP_WRITER_MAX32)
+            { __zzip_set64(extra, e->usize); extra += 8; }
+        if (e->csize >= ZZIP_WRITER_MAX32)
+            { __zzip_set64(extra, e->csize); extra += 8; }
+        if (e->offset >= ZZIP_WRITER_MAX32)
+            { __zzip_set64(extra, e->offset); extra += 8; }
+        if (extra > head + zzip_disk_entry_headerlength + 4)
+        {
+            zip64 = 1;
+            __zzip_set16(head + zzip_disk_entry_headerlength, 0x0001);
+            __zzip_set16(head + zzip_disk_entry_headerlength + 2,
+                         (extra - head) - zzip_disk_entry_headerlength - 4);
+        } else
+            extra = head + zzip_disk_entry_headerlength;
+
+        __zzip_set32(head + 0, ZZIP_DISK_ENTRY_MAGIC);
+        __zzip_set16(head + 4, (3 << 8) | (zip64 ? 45 : 20));   /* unix */
+        __zzip_set16(head + 6, zip64 ? 45 : 20);
+        __zzip_set16(head + 8, e->flags);
+        __zzip_set16(head + 10, e->method);
+        __zzip_set16(head + 12, e->dostime);
+        __zzip_set16(head + 14, e->dosdate);
+        __zzip_set32(head + 16, e->crc32);
+        __zzip_set32(head + 20, e->csize >= ZZIP_WRITER_MAX32 ?
+                     ZZIP_WRITER_MAX32 : e->csize);
+        __zzip_set32(head + 24, e->usize >= ZZIP_WRITER_MAX32 ?
+                     ZZIP_WRITER_MAX32 : e->usize);
+        __zzip_set16(head + 28, e->namlen);
+        __zzip_set16(head + 30, (extra - head) - zzip_disk_entry_headerlength);
+        __zzip_set16(head + 32, 0);     /* comment */
+        __zzip_set16(head + 34, 0);     /* disk */
+        __zzip_set16(head + 36, 0);     /* internal attributes */
+        __zzip_set32(head + 38, dir ? (040755UL << 16) | 0x10
+                     : (0100644UL << 16));
+        __zzip_set32(head + 42, e->offset >= ZZIP_WRITER_MAX32 ?
+                     ZZIP_WRITER_MAX32 : e->offset);
+        zzip_writer_out(w, head, zzip_disk_entry_headerlength);
+        zzip_writer_out(w, e->name, e->namlen);
+        zzip_writer_out(w, head + zzip_disk_entry_headerlength,
+                        (extra - head) - zzip_disk_entry_headerlength);
+    }
+
+    ___ uint64_t size = w->offset - start;
+    zzip_byte_t end[zzip_disk64_trailer_headerlength + 20
+                    + zzip_disk_trailer_headerlength];
+    zzip_byte_t *p = end;
+    if (w->entries >= 0xFFFF || size >= ZZIP_WRITER_MAX32 ||
+        start >= ZZIP_WRITER_MAX32)
+    {
+        uint64_t at = w->offset;
+        __zzip_set32(p + 0, ZZIP_DISK64_TRAILER_MAGIC);
+        __zzip_set64(p + 4, zzip_disk64_trailer_headerlength - 12);
+        __zzip_set16(p + 12, (3 << 8) | 45);
+        __zzip_set16(p + 14, 45);
+        __zzip_set32(p + 16, 0);
+        __zzip_set32(p + 20, 0);
+        __zzip_set64(p + 24, w->entries);
+        __zzip_set64(p + 32, w->entries);
+        __zzip_set64(p + 40, size);
+        __zzip_set64(p + 48, start);
+        p += zzip_disk64_trailer_headerlength;
+        __zzip_set32(p + 0, 0x07064b50);        /* zip64 end locator */
+        __zzip_set32(p + 4, 0);
+        __zzip_set64(p + 8, at);
+        __zzip_set32(p + 16, 1);
+        p += 20;
+    }
+    __zzip_set32(p + 0, ZZIP_DISK_TRAILER_MAGIC);
+    __zzip_set16(p + 4, 0);
+    __zzip_set16(p + 6, 0);
+    __zzip_set16(p + 8, w->entries >= 0xFFFF ? 0xFFFF : w->entries);
+    __zzip_set16(p + 10, w->entries >= 0xFFFF ? 0xFFFF : w->entries);
+    __zzip_set32(p + 12, size >= ZZIP_WRITER_MAX32 ? ZZIP_WRITER_MAX32 : size);
+    __zzip_set32(p + 16, start >= ZZIP_WRITER_MAX32 ?
+                 ZZIP_WRITER_MAX32 : start);
+    __zzip_set16(p + 20, 0);
+    p += zzip_disk_trailer_headerlength;
+    return zzip_writer_out(w, end, p - end);
+    ____;
+}
+
+/** finish the zip archive.
+ *
+ * This function writes the queued entries, the central directory and
+ * the end records, closes the file (unless it came from =>
+ * zzip_writer_fdopen) and frees the writer. A streamed entry that is
+ * still open is ended first.
+ *
+ * returns: 0, or -1 on error (setting errno) - the archive is broken
+ * then and the writer is released anyway.
+ */
+int
+zzip_writer_close(ZZIP_WRITER * w)
+{
+    zzip_size_t i;
+    int err;
+
+    if (! w)
+        { errno = EINVAL; return -1; }
+    if (w->stream)
+        zzip_writer_end(w);
+    zzip_writer_drain(w, 1);
+#ifdef ZZIP_WRITER_THREADS
+    if (w->threads)
+    {
+        int t;
+        zzip_writer_lock(w);
+        w->quit = 1;
+        zzip_writer_wakeup(w, work);
+        zzip_writer_unlock(w);
+# if defined _WIN32
+        for (t = 0; t < w->threads; t++)
+        {
+            WaitForSingleObject(w->thread[t], INFINITE);
+            CloseHandle(w->thread[t]);
+        }
+        DeleteCriticalSection(&w->mutex);
+# else
+        for (t = 0; t < w->threads; t++)
+            pthread_join(w->thread[t], 0);
+        pthread_cond_destroy(&w->done);
+        pthread_cond_destroy(&w->work);
+        pthread_mutex_destroy(&w->mutex);
+# endif
+    }
+#endif
+    if (! w->error)
+        zzip_writer_directory(w);
+    err = w->error;
+    if (w->owned && close(w->fd) == -1 && ! err)
+        err = errno;
+
+    for (i = 0; i < w->entries; i++)
+        free(w->entry[i].name);
+    free(w->entry);
+    free(w->zbuf);
+    free(w);
+    if (err)
+        { errno = err; return -1; }
+    return 0;
+}
+
+/*
+ * Local variables:
+ * c-file-style: "stroustrup"
+ * End:
+ */
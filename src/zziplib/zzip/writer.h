@@ -0,0 +1,70 @@
+#ifndef _ZZIP_WRITER_H_
+#define _ZZIP_WRITER_H_
+/*
+ * NOTE: this does not use the ZZIP_DIR/ZZIP_FILE calls of zzip/write.h,
+ * which are not implemented, and needs only zlib and zzip/fetch.h.
+ *
+ * creating zip archives: entries are appended to a plain file with
+ * local headers (data descriptors for streamed entries), followed by
+ * the central directory and zip64 records when the sizes need them.
+ * Deflating of zzip_writer_add entries runs on a small thread pool
+ * while the calling thread writes the results in order. Stored entries
+ * can be aligned so that a zzip_disk_mmap of the archive maps their
+ * data at a page boundary.
+ *
+ *          use under the restrictions of the
+ *          Lesser GNU General Public License
+ *          or alternatively the restrictions
+ *          of the Mozilla Public License 1.1
+ */
+
+#include <zzip/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct zzip_writer ZZIP_WRITER;
+
+/* zzip_writer_add and zzip_writer_begin flags : */
+#define ZZIP_WRITER_STORED   0       /* same as ZZIP_IS_STORED */
+#define ZZIP_WRITER_DEFLATED 8       /* same as ZZIP_IS_DEFLATED */
+#define ZZIP_WRITER_METHOD   0xFF    /* mask of the two above */
+#define ZZIP_WRITER_AUTO     0x100   /* store it if deflate does not shrink */
+#define ZZIP_WRITER_ALIGN    0x200   /* stored data starts at an alignment */
+#define ZZIP_WRITER_NOCOPY   0x400   /* data is kept until flush or close */
+#define ZZIP_WRITER_ZIP64    0x800   /* streamed entry may exceed 4 GiB */
+
+#define zzip_writer_extern extern
+
+zzip_writer_extern zzip__new__ ZZIP_WRITER*
+zzip_writer_open(char* filename, int threads);
+zzip_writer_extern zzip__new__ ZZIP_WRITER*
+zzip_writer_fdopen(int fd, int threads);
+zzip_writer_extern int
+zzip_writer_close(ZZIP_WRITER* writer);
+
+zzip_writer_extern int
+zzip_writer_level(ZZIP_WRITER* writer, int level);
+zzip_writer_extern int
+zzip_writer_align(ZZIP_WRITER* writer, int align);
+zzip_writer_extern int
+zzip_writer_mtime(ZZIP_WRITER* writer, long mtime);
+
+zzip_writer_extern int
+zzip_writer_add(ZZIP_WRITER* writer, char* name,
+                const void* data, zzip_size_t len, int flags);
+zzip_writer_extern int
+zzip_writer_flush(ZZIP_WRITER* writer);
+
+zzip_writer_extern int
+zzip_writer_begin(ZZIP_WRITER* writer, char* name, int flags);
+zzip_writer_extern zzip_ssize_t
+zzip_writer_write(ZZIP_WRITER* writer, const void* data, zzip_size_t len);
+zzip_writer_extern int
+zzip_writer_end(ZZIP_WRITER* writer);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -16,6 +16,7 @@
 #include <zzip/file.h>
 #include <zzip/format.h>
 #include <zzip/fetch.h>
+#include <zzip/hash.h>
 
 #include <ctype.h>
 #include <errno.h>
@@ -644,6 +645,8 @@ zzip_dir_free(ZZIP_DIR * dir)
         dir->io->fd.close(dir->fd);
     if (dir->hdr0)
         free(dir->hdr0);
+    if (dir->hash)
+        __zzip_hash_free(dir->hash);
     if (dir->cache.fp)
         free(dir->cache.fp);
     if (dir->cache.buf32k)
@@ -662,7 +665,10 @@ zzip_dir_free(ZZIP_DIR * dir)
 int
 zzip_dir_close(ZZIP_DIR * dir)
 {
-    dir->refcount &= ~0x10000000;       /* explicit dir close */
+    /* explicit dir close */
+    long refcount = _zzip_atomic_and(&dir->refcount, ~0x10000000L);
+    if (refcount)
+        return refcount;        /* still open files attached */
     return zzip_dir_free(dir);
 }
 
@@ -682,6 +688,7 @@ zzip_dir_fdopen(int fd, zzip_error_t * errcode_p)
 }
 
 static zzip_error_t __zzip_dir_parse(ZZIP_DIR * dir);   /* forward */
+static void __zzip_dir_hash(ZZIP_DIR * dir);           /* forward */
 
 /** => zzip_dir_fdopen
  * this function uses explicit ext and io instead of the internal
@@ -701,6 +708,7 @@ zzip_dir_fdopen_ext_io(int fd, zzip_error_t * errcode_p,
     if ((rv = __zzip_dir_parse(dir)))
         goto error;
 
+    __zzip_dir_hash(dir);
     dir->hdr = dir->hdr0;
     dir->refcount |= 0x10000000;
 
@@ -747,6 +755,35 @@ __zzip_dir_parse(ZZIP_DIR * dir)
     return rv;
 }
 
+/*
+ * build the name index used by => zzip_file_open on big archives. It is
+ * only an accelerator - if it can not be allocated then dir->hash stays
+ * null and the lookup falls back to scanning the hdr0 list.
+ */
+static void
+__zzip_dir_hash(ZZIP_DIR * dir)
+{
+    struct zzip_dir_hdr *hdr;
+    zzip_size_t entries = 1;
+
+    if (! ZZIP_HASH_MINENTRIES || ! dir->hdr0)
+        return;
+    for (hdr = dir->hdr0; hdr->d_reclen; entries++)
+        hdr = (struct zzip_dir_hdr *) ((char *) hdr + hdr->d_reclen);
+    if (entries < ZZIP_HASH_MINENTRIES)
+        return;
+
+    if (! (dir->hash = __zzip_hash_new(entries)))
+        return;
+    for (hdr = dir->hdr0; ; hdr = (struct zzip_dir_hdr *)
+             ((char *) hdr + hdr->d_reclen))
+    {
+        __zzip_hash_add(dir->hash, hdr->d_name, strlen(hdr->d_name), hdr);
+        if (! hdr->d_reclen)
+            break;
+    }
+}
+
 /**
  * This function will attach any of the .zip extensions then
  * trying to open it the with => open(2). This is a helper
@@ -61,6 +61,7 @@ typedef enum
 #define ZZIP_FACTORY            (1<<17) /* old file handle is not closed */
 #define ZZIP_ALLOWREAL          (1<<18) /* real files use default_io (magic) */
 #define ZZIP_THREADED           (1<<19) /* try to be safe for multithreading */
+#define ZZIP_SEEKPOINTS         (1<<20) /* record inflate checkpoints on read */
 
 /*
  * zzip largefile renames
@@ -208,6 +209,8 @@ _zzip_export
 zzip_off_t      zzip_seek(ZZIP_FILE * fp, zzip_off_t offset, int whence);
 _zzip_export
 zzip_off_t      zzip_tell(ZZIP_FILE * fp);
+_zzip_export
+int             zzip_file_seekpoints(ZZIP_FILE * fp, zzip_off_t span);
 
 /*
  * reading info of a single file 